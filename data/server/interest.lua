@@ -0,0 +1,10 @@
+-- setInterest(type, nearFraction, midFraction, midInterval, significantDistance, significantOrientation)
+--
+-- nearFraction and midFraction are fractions of the view distance of the observer.
+-- near entities are updated every tick, mid range entities every midInterval ticks and
+-- far entities only if they moved more than significantDistance or turned more than
+-- significantOrientation (radians) since the last update that was sent.
+setInterest("PLAYER", 0.3, 0.7, 2, 2.0, 0.3)
+setInterest("ANIMAL_WOLF", 0.25, 0.6, 2, 4.0, 0.5)
+setInterest("ANIMAL_RABBIT", 0.2, 0.5, 3, 6.0, 0.8)
+setInterest("BLACKSMITH", 0.2, 0.5, 4, 8.0, 1.0)
@@ -30,6 +30,7 @@
 
 #include <restclient-cpp/restclient.h>
 #include <restclient-cpp/connection.h>
+#include <algorithm>
 
 #define registerMoveCmd(name, flag) \
 	core::Command::registerCommand(name, [&] (const core::CmdArgs& args) { \
@@ -79,6 +80,10 @@ void Client::onMouseMotion(int32_t x, int32_t y, int32_t relX, int32_t relY) {
 }
 
 void Client::onEvent(const network::DisconnectEvent& event) {
+	// the disconnects of a previous client host are reported asynchronously
+	if (event.peer() != _peer) {
+		return;
+	}
 	removeState(CLIENT_CONNECTING);
 	ui::Window* main = new frontend::LoginWindow(this);
 	new frontend::DisconnectWindow(main);
@@ -108,6 +113,8 @@ core::AppState Client::onConstruct() {
 
 	core::Var::get(cfg::ClientPort, SERVER_PORT);
 	core::Var::get(cfg::ClientHost, SERVER_HOST);
+	core::Var::get(cfg::ClientIncomingBandwidth, "0");
+	core::Var::get(cfg::ClientOutgoingBandwidth, "0");
 	core::Var::get(cfg::ClientAutoLogin, "false");
 	core::Var::get(cfg::ClientName, "noname");
 	core::Var::get(cfg::ClientPassword, "");
@@ -205,7 +212,7 @@ void Client::beforeUI() {
 
 		_drawCallsWorld = _worldRenderer.renderWorld(_camera);
 		_drawCallsEntities = _worldRenderer.renderEntities(_camera);
-		_worldRenderer.extractMeshes(_camera.position());
+		_worldRenderer.extractMeshes(_camera);
 	} else {
 		_drawCallsWorld = 0;
 		_drawCallsEntities = 0;
@@ -288,6 +295,8 @@ core::AppState Client::onRunning() {
 		if (_world->created()) {
 			_worldRenderer.onRunning(_camera, _deltaFrame);
 		}
+		// hand everything that was produced in this frame over to the send scheduler
+		_network->flush();
 	}
 
 	return state;
@@ -370,7 +379,9 @@ void Client::spawn(frontend::ClientEntityId id, const char *name, const glm::vec
 
 bool Client::connect(uint16_t port, const std::string& hostname) {
 	setState(CLIENT_CONNECTING);
-	ENetPeer* peer = _network->connect(port, hostname);
+	const uint32_t incomingBandwidth = (uint32_t)std::max(0, core::Var::getSafe(cfg::ClientIncomingBandwidth)->intVal());
+	const uint32_t outgoingBandwidth = (uint32_t)std::max(0, core::Var::getSafe(cfg::ClientOutgoingBandwidth)->intVal());
+	ENetPeer* peer = _network->connect(port, hostname, 1, incomingBandwidth, outgoingBandwidth);
 	if (!peer) {
 		removeState(CLIENT_CONNECTING);
 		Log::error("Failed to connect to server %s:%i", hostname.c_str(), port);
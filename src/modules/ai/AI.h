@@ -21,6 +21,8 @@ namespace ai {
 class ICharacter;
 typedef std::shared_ptr<ICharacter> ICharacterPtr;
 class Zone;
+class CompiledTree;
+typedef std::shared_ptr<const CompiledTree> CompiledTreePtr;
 
 typedef std::vector<CharacterId> FilteredEntities;
 
@@ -40,6 +42,7 @@ typedef std::vector<CharacterId> FilteredEntities;
  */
 class AI : public NonCopyable, public std::enable_shared_from_this<AI> {
 	friend class TreeNode;
+	friend class CompiledTree;
 	friend class LUAAIRegistry;
 	friend class IFilter;
 	friend class Filter;
@@ -80,6 +83,22 @@ protected:
 	typedef std::unordered_map<int, int> LimitStates;
 	LimitStates _limitStates;
 
+	/**
+	 * The compiled version of the behaviour - see @ai{CompiledTree}
+	 */
+	CompiledTreePtr _compiledTree;
+	/**
+	 * The selector and limit states of the compiled behaviour - indexed by the compiled node index.
+	 * If a compiled tree is bound, these are used instead of @c _selectorStates and @c _limitStates.
+	 */
+	std::vector<int> _nodeStates;
+
+	void bindCompiledTree(const CompiledTreePtr& compiledTree);
+	/**
+	 * @return The index of the given node in @c _nodeStates or @c -1
+	 */
+	int nodeStateSlot(int nodeId) const;
+
 	TreeNodePtr _behaviour;
 	AggroMgr _aggroMgr;
 
@@ -288,6 +307,8 @@ inline void AI::update(int64_t dt, bool debuggingActive) {
 		_lastExecMillis.clear();
 		_filteredEntities.clear();
 		_selectorStates.clear();
+		_nodeStates.clear();
+		_compiledTree.reset();
 	}
 
 	_debuggingActive = debuggingActive;
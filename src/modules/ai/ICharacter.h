@@ -50,6 +50,8 @@ protected:
 	// m/s
 	std::atomic<float> _speed;
 	CharacterAttributes _attributes;
+	// incremented whenever an attribute value changes
+	uint32_t _attributesRevision = 0u;
 
 public:
 	explicit ICharacter(CharacterId id) :
@@ -104,6 +106,11 @@ public:
 	 * @brief Get the debugger attributes.
 	 */
 	const CharacterAttributes& getAttributes() const;
+	/**
+	 * @brief Changes whenever one of the attributes got a new value. This allows the debug server to
+	 * only transfer the attributes if they were modified.
+	 */
+	uint32_t getAttributesRevision() const;
 	/**
 	 * @brief override this method to let your own @c ICharacter implementation
 	 * tick with the @c Zone::update
@@ -140,7 +147,20 @@ inline float ICharacter::getOrientation () const {
 }
 
 inline void ICharacter::setAttribute(const std::string& key, const std::string& value) {
-	_attributes[key] = value;
+	auto i = _attributes.find(key);
+	if (i != _attributes.end()) {
+		if (i->second == value) {
+			return;
+		}
+		i->second = value;
+	} else {
+		_attributes.emplace(key, value);
+	}
+	++_attributesRevision;
+}
+
+inline uint32_t ICharacter::getAttributesRevision() const {
+	return _attributesRevision;
 }
 
 inline const CharacterAttributes& ICharacter::getAttributes() const {
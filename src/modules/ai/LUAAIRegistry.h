@@ -10,6 +10,10 @@
 #include "conditions/LUACondition.h"
 #include "filter/LUAFilter.h"
 #include "movement/LUASteering.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
 
 namespace ai {
 
@@ -65,11 +69,31 @@ namespace ai {
  * @par AI metatable
  * There is a metatable that you can modify by calling @ai{LUAAIRegistry::pushAIMetatable()}.
  * This metatable is applied to all @ai{AI} pointers that are forwarded to the lua functions.
+ *
+ * @par Threading
+ * The thread that calls init() owns the main lua state that the scripts are loaded into. Every
+ * other thread that executes one of the lua nodes, conditions, filters or steerings gets a lua state
+ * of its own on first use. The scripts that were given to evaluate() are replayed into those
+ * replicas - they only set up the metatables there and don't register the factories again.
+ * This allows a @ai{Zone} to tick lua behaviour trees in parallel.
+ * @note Modifications that are not done by a script that is given to evaluate() (e.g. via
+ * pushAIMetatable()) are only visible in the main lua state.
  */
-class LUAAIRegistry : public AIRegistry {
+class LUAAIRegistry : public AIRegistry, public ILUAStateProvider {
 protected:
 	lua_State* _s = nullptr;
 
+	/**
+	 * @brief The lua state of a worker thread
+	 */
+	struct LUAStateReplica {
+		std::thread::id thread;
+		lua_State* state = nullptr;
+		// the amount of entries in _scripts that were already evaluated in this state
+		size_t scripts = 0u;
+	};
+	typedef std::unique_ptr<LUAStateReplica> LUAStateReplicaPtr;
+
 	using LuaNodeFactory = LUATreeNode::LUATreeNodeFactory;
 	typedef std::shared_ptr<LuaNodeFactory> LUATreeNodeFactoryPtr;
 	typedef std::map<std::string, LUATreeNodeFactoryPtr> TreeNodeFactoryMap;
@@ -91,6 +115,35 @@ protected:
 	ConditionFactoryMap _conditionFactories;
 	FilterFactoryMap _filterFactories;
 	SteeringFactoryMap _steeringFactories;
+	std::vector<LUAStateReplicaPtr> _replicas;
+	// every script that was loaded into the main state - replayed into the replicas
+	std::vector<std::string> _scripts;
+	std::atomic<size_t> _scriptCount { 0u };
+	std::thread::id _owner;
+	// changes with every init() to invalidate the thread local replica lookups
+	uint64_t _generation = 0u;
+
+	static uint64_t nextGeneration() {
+		static std::atomic<uint64_t> generation { 0u };
+		return ++generation;
+	}
+
+	static bool luaAI_isreplica(lua_State* s) {
+		lua_getfield(s, LUA_REGISTRYINDEX, "__ai_replica");
+		const bool replica = lua_toboolean(s, -1) != 0;
+		lua_pop(s, 1);
+		return replica;
+	}
+
+	template<class FACTORYMAP>
+	typename FACTORYMAP::mapped_type findFactory(const FACTORYMAP& factories, const std::string& type) const {
+		ScopedReadLock scopedLock(_lock);
+		const auto& i = factories.find(type);
+		if (i == factories.end()) {
+			return typename FACTORYMAP::mapped_type();
+		}
+		return i->second;
+	}
 
 	/***
 	 * Gives you access the the light userdata for the LUAAIRegistry.
@@ -164,10 +217,19 @@ protected:
 	static int luaAI_createnode(lua_State* s) {
 		LUAAIRegistry* r = luaAI_toregistry(s);
 		const std::string type = luaL_checkstring(s, -1);
-		const LUATreeNodeFactoryPtr& factory = std::make_shared<LuaNodeFactory>(s, type);
-		const bool inserted = r->registerNodeFactory(type, *factory);
-		if (!inserted) {
-			return luaL_error(s, "tree node %s is already registered", type.c_str());
+		const bool replica = luaAI_isreplica(s);
+		LUATreeNodeFactoryPtr factory;
+		if (replica) {
+			factory = r->findFactory(r->_treeNodeFactories, type);
+			if (!factory) {
+				return luaL_error(s, "tree node %s is not registered in the main lua state", type.c_str());
+			}
+		} else {
+			factory = std::make_shared<LuaNodeFactory>(r, type);
+			const bool inserted = r->registerNodeFactory(type, *factory);
+			if (!inserted) {
+				return luaL_error(s, "tree node %s is already registered", type.c_str());
+			}
 		}
 
 		luaAI_newuserdata<LuaNodeFactory*>(s, factory.get());
@@ -178,8 +240,10 @@ protected:
 			{nullptr, nullptr}
 		};
 		luaAI_setupmetatable(s, type, nodes, "node");
-		ScopedWriteLock scopedLock(r->_lock);
-		r->_treeNodeFactories.emplace(type, factory);
+		if (!replica) {
+			ScopedWriteLock scopedLock(r->_lock);
+			r->_treeNodeFactories.emplace(type, factory);
+		}
 		return 1;
 	}
 
@@ -206,10 +270,19 @@ protected:
 	static int luaAI_createcondition(lua_State* s) {
 		LUAAIRegistry* r = luaAI_toregistry(s);
 		const std::string type = luaL_checkstring(s, -1);
-		const LUAConditionFactoryPtr& factory = std::make_shared<LuaConditionFactory>(s, type);
-		const bool inserted = r->registerConditionFactory(type, *factory);
-		if (!inserted) {
-			return luaL_error(s, "condition %s is already registered", type.c_str());
+		const bool replica = luaAI_isreplica(s);
+		LUAConditionFactoryPtr factory;
+		if (replica) {
+			factory = r->findFactory(r->_conditionFactories, type);
+			if (!factory) {
+				return luaL_error(s, "condition %s is not registered in the main lua state", type.c_str());
+			}
+		} else {
+			factory = std::make_shared<LuaConditionFactory>(r, type);
+			const bool inserted = r->registerConditionFactory(type, *factory);
+			if (!inserted) {
+				return luaL_error(s, "condition %s is already registered", type.c_str());
+			}
 		}
 
 		luaAI_newuserdata<LuaConditionFactory*>(s, factory.get());
@@ -220,8 +293,10 @@ protected:
 			{nullptr, nullptr}
 		};
 		luaAI_setupmetatable(s, type, nodes, "condition");
-		ScopedWriteLock scopedLock(r->_lock);
-		r->_conditionFactories.emplace(type, factory);
+		if (!replica) {
+			ScopedWriteLock scopedLock(r->_lock);
+			r->_conditionFactories.emplace(type, factory);
+		}
 		return 1;
 	}
 
@@ -244,10 +319,19 @@ protected:
 	static int luaAI_createfilter(lua_State* s) {
 		LUAAIRegistry* r = luaAI_toregistry(s);
 		const std::string type = luaL_checkstring(s, -1);
-		const LUAFilterFactoryPtr& factory = std::make_shared<LuaFilterFactory>(s, type);
-		const bool inserted = r->registerFilterFactory(type, *factory);
-		if (!inserted) {
-			return luaL_error(s, "filter %s is already registered", type.c_str());
+		const bool replica = luaAI_isreplica(s);
+		LUAFilterFactoryPtr factory;
+		if (replica) {
+			factory = r->findFactory(r->_filterFactories, type);
+			if (!factory) {
+				return luaL_error(s, "filter %s is not registered in the main lua state", type.c_str());
+			}
+		} else {
+			factory = std::make_shared<LuaFilterFactory>(r, type);
+			const bool inserted = r->registerFilterFactory(type, *factory);
+			if (!inserted) {
+				return luaL_error(s, "filter %s is already registered", type.c_str());
+			}
 		}
 
 		luaAI_newuserdata<LuaFilterFactory*>(s, factory.get());
@@ -258,9 +342,10 @@ protected:
 			{nullptr, nullptr}
 		};
 		luaAI_setupmetatable(s, type, nodes, "filter");
-
-		ScopedWriteLock scopedLock(r->_lock);
-		r->_filterFactories.emplace(type, factory);
+		if (!replica) {
+			ScopedWriteLock scopedLock(r->_lock);
+			r->_filterFactories.emplace(type, factory);
+		}
 		return 1;
 	}
 
@@ -278,10 +363,19 @@ protected:
 	static int luaAI_createsteering(lua_State* s) {
 		LUAAIRegistry* r = luaAI_toregistry(s);
 		const std::string type = luaL_checkstring(s, -1);
-		const LUASteeringFactoryPtr& factory = std::make_shared<LuaSteeringFactory>(s, type);
-		const bool inserted = r->registerSteeringFactory(type, *factory);
-		if (!inserted) {
-			return luaL_error(s, "steering %s is already registered", type.c_str());
+		const bool replica = luaAI_isreplica(s);
+		LUASteeringFactoryPtr factory;
+		if (replica) {
+			factory = r->findFactory(r->_steeringFactories, type);
+			if (!factory) {
+				return luaL_error(s, "steering %s is not registered in the main lua state", type.c_str());
+			}
+		} else {
+			factory = std::make_shared<LuaSteeringFactory>(r, type);
+			const bool inserted = r->registerSteeringFactory(type, *factory);
+			if (!inserted) {
+				return luaL_error(s, "steering %s is already registered", type.c_str());
+			}
 		}
 
 		luaAI_newuserdata<LuaSteeringFactory*>(s, factory.get());
@@ -292,9 +386,10 @@ protected:
 			{nullptr, nullptr}
 		};
 		luaAI_setupmetatable(s, type, nodes, "steering");
-
-		ScopedWriteLock scopedLock(r->_lock);
-		r->_steeringFactories.emplace(type, factory);
+		if (!replica) {
+			ScopedWriteLock scopedLock(r->_lock);
+			r->_steeringFactories.emplace(type, factory);
+		}
 		return 1;
 	}
 
@@ -411,19 +506,45 @@ public:
 	}
 
 	/**
-	 * @brief Access to the lua state.
+	 * @brief Access to the main lua state - the one of the thread that called init().
 	 * @see pushAIMetatable()
 	 */
 	lua_State* getLuaState() {
 		return _s;
 	}
 
+	/**
+	 * @brief The lua state that belongs to the calling thread. The state is created and the
+	 * scripts are replayed on first use - or if new scripts were evaluated in the meantime.
+	 * @note The lookup is cached in thread local storage, the registry lock is only taken
+	 * if a thread needs a new replica or has to catch up with new scripts.
+	 */
+	lua_State* luaState() override {
+		if (std::this_thread::get_id() == _owner) {
+			return _s;
+		}
+		struct ReplicaCache {
+			uint64_t generation = 0u;
+			LUAStateReplica* replica = nullptr;
+		};
+		AI_THREAD_LOCAL ReplicaCache cache;
+		if (cache.generation != _generation) {
+			cache.replica = replica();
+			cache.generation = _generation;
+		}
+		if (cache.replica->scripts != _scriptCount.load(std::memory_order_acquire)) {
+			synchronize(*cache.replica);
+		}
+		return cache.replica->state;
+	}
+
 	/**
 	 * @brief Pushes the AI metatable onto the stack. This allows anyone to modify it
 	 * to provide own functions and data that is applied to the @c ai parameters of the
 	 * lua functions.
 	 * @note lua_ctxai() can be used in your lua c callbacks to get access to the
 	 * @ai{AI} pointer: @code const AI* ai = lua_ctxai(s, 1); @endcode
+	 * @note This only modifies the main lua state - see the threading notes of this class
 	 */
 	int pushAIMetatable() {
 		ai_assert(_s != nullptr, "LUA state is not yet initialized");
@@ -433,6 +554,7 @@ public:
 	/**
 	 * @brief Pushes the character metatable onto the stack. This allows anyone to modify it
 	 * to provide own functions and data that is applied to the @c ai:character() value
+	 * @note This only modifies the main lua state - see the threading notes of this class
 	 */
 	int pushCharacterMetatable() {
 		ai_assert(_s != nullptr, "LUA state is not yet initialized");
@@ -440,43 +562,19 @@ public:
 	}
 
 	/**
+	 * @note The calling thread becomes the owner of the main lua state.
 	 * @see shutdown()
 	 */
 	bool init() {
 		if (_s != nullptr) {
 			return true;
 		}
-		_s = luaL_newstate();
-
-		lua_atpanic(_s, [] (lua_State* L) {
-			ai_log_error("Lua panic. Error message: %s", (lua_isnil(L, -1) ? "" : lua_tostring(L, -1)));
-			return 0;
-		});
-		lua_gc(_s, LUA_GCSTOP, 0);
-		luaL_openlibs(_s);
-
-		luaAI_registerfuncs(_s, &registryFuncs.front(), "META_REGISTRY");
-		lua_setglobal(_s, "REGISTRY");
-
-		// TODO: random
-
-		luaAI_globalpointer(_s, this, luaAI_metaregistry());
-
-		luaAI_registerfuncs(_s, &aiFuncs.front(), luaAI_metaai());
-		luaAI_registerfuncs(_s, &vecFuncs.front(), luaAI_metavec());
-		luaAI_registerfuncs(_s, &zoneFuncs.front(), luaAI_metazone());
-		luaAI_registerfuncs(_s, &characterFuncs.front(), luaAI_metacharacter());
-		luaAI_registerfuncs(_s, &aggroMgrFuncs.front(), luaAI_metaaggromgr());
-		luaAI_registerfuncs(_s, &groupMgrFuncs.front(), luaAI_metagroupmgr());
-
-		const char* script = ""
-			"UNKNOWN, CANNOTEXECUTE, RUNNING, FINISHED, FAILED, EXCEPTION = 0, 1, 2, 3, 4, 5\n";
-
-		if (luaL_loadbufferx(_s, script, strlen(script), "", nullptr) || lua_pcall(_s, 0, 0, 0)) {
-			ai_log_error("%s", lua_tostring(_s, -1));
-			lua_pop(_s, 1);
+		_s = createState(false);
+		if (_s == nullptr) {
 			return false;
 		}
+		_owner = std::this_thread::get_id();
+		_generation = nextGeneration();
 		return true;
 	}
 
@@ -486,6 +584,12 @@ public:
 	void shutdown() {
 		{
 			ScopedWriteLock scopedLock(_lock);
+			for (const LUAStateReplicaPtr& replica : _replicas) {
+				lua_close(replica->state);
+			}
+			_replicas.clear();
+			_scripts.clear();
+			_scriptCount = 0u;
 			_treeNodeFactories.clear();
 			_conditionFactories.clear();
 			_filterFactories.clear();
@@ -495,6 +599,8 @@ public:
 			lua_close(_s);
 			_s = nullptr;
 		}
+		_owner = std::thread::id();
+		_generation = 0u;
 	}
 
 	~LUAAIRegistry() {
@@ -509,20 +615,101 @@ public:
 	 * @brief Load your lua scripts into the lua state of the registry.
 	 * This can be called multiple times to e.g. load multiple files.
 	 * @return @c true if the lua script was loaded, @c false otherwise
-	 * @note you have to call init() before
+	 * @note you have to call init() before - and call this from the same thread
 	 */
 	bool evaluate(const char* luaBuffer, size_t size) {
 		if (_s == nullptr) {
 			ai_log_debug("LUA state is not yet initialized");
 			return false;
 		}
-		if (luaL_loadbufferx(_s, luaBuffer, size, "", nullptr) || lua_pcall(_s, 0, 0, 0)) {
-			ai_log_error("%s", lua_tostring(_s, -1));
-			lua_pop(_s, 1);
+		const bool success = evaluateScript(_s, luaBuffer, size);
+		// even a failed script might have registered something - the replicas must match
+		ScopedWriteLock scopedLock(_lock);
+		_scripts.emplace_back(luaBuffer, size);
+		_scriptCount.store(_scripts.size(), std::memory_order_release);
+		return success;
+	}
+
+private:
+	lua_State* createState(bool replica) {
+		lua_State* s = luaL_newstate();
+
+		lua_atpanic(s, [] (lua_State* L) {
+			ai_log_error("Lua panic. Error message: %s", (lua_isnil(L, -1) ? "" : lua_tostring(L, -1)));
+			return 0;
+		});
+		lua_gc(s, LUA_GCSTOP, 0);
+		luaL_openlibs(s);
+
+		luaAI_registerfuncs(s, &registryFuncs.front(), "META_REGISTRY");
+		lua_setglobal(s, "REGISTRY");
+
+		// TODO: random
+
+		luaAI_globalpointer(s, this, luaAI_metaregistry());
+		if (replica) {
+			lua_pushboolean(s, 1);
+			lua_setfield(s, LUA_REGISTRYINDEX, "__ai_replica");
+		}
+
+		luaAI_registerfuncs(s, &aiFuncs.front(), luaAI_metaai());
+		luaAI_registerfuncs(s, &vecFuncs.front(), luaAI_metavec());
+		luaAI_registerfuncs(s, &zoneFuncs.front(), luaAI_metazone());
+		luaAI_registerfuncs(s, &characterFuncs.front(), luaAI_metacharacter());
+		luaAI_registerfuncs(s, &aggroMgrFuncs.front(), luaAI_metaaggromgr());
+		luaAI_registerfuncs(s, &groupMgrFuncs.front(), luaAI_metagroupmgr());
+
+		const char* script = ""
+			"UNKNOWN, CANNOTEXECUTE, RUNNING, FINISHED, FAILED, EXCEPTION = 0, 1, 2, 3, 4, 5\n";
+
+		if (!evaluateScript(s, script, strlen(script))) {
+			lua_close(s);
+			return nullptr;
+		}
+		return s;
+	}
+
+	static bool evaluateScript(lua_State* s, const char* luaBuffer, size_t size) {
+		if (luaL_loadbufferx(s, luaBuffer, size, "", nullptr) || lua_pcall(s, 0, 0, 0)) {
+			ai_log_error("%s", lua_tostring(s, -1));
+			lua_pop(s, 1);
 			return false;
 		}
 		return true;
 	}
+
+	LUAStateReplica* replica() {
+		const std::thread::id id = std::this_thread::get_id();
+		{
+			ScopedReadLock scopedLock(_lock);
+			for (const LUAStateReplicaPtr& replica : _replicas) {
+				if (replica->thread == id) {
+					return replica.get();
+				}
+			}
+		}
+		LUAStateReplicaPtr replica(new LUAStateReplica());
+		replica->thread = id;
+		replica->state = createState(true);
+		ai_assert(replica->state != nullptr, "Could not create the lua state for a worker thread");
+		LUAStateReplica* ptr = replica.get();
+		ScopedWriteLock scopedLock(_lock);
+		_replicas.push_back(std::move(replica));
+		return ptr;
+	}
+
+	void synchronize(LUAStateReplica& replica) {
+		std::vector<std::string> scripts;
+		{
+			ScopedReadLock scopedLock(_lock);
+			scripts.assign(_scripts.begin() + replica.scripts, _scripts.end());
+		}
+		// the lock must not be held here - the scripts call back into the registry
+		for (const std::string& script : scripts) {
+			evaluateScript(replica.state, script.c_str(), script.size());
+		}
+		replica.scripts += scripts.size();
+	}
 };
 
 }
@@ -16,6 +16,19 @@ struct luaAI_ICharacter {
 	ICharacterPtr character;
 };
 
+/**
+ * @brief Hands out the lua state the lua nodes, conditions, filters and steerings are executed in.
+ * A lua state must never be used by two threads at the same time - the provider has to take care
+ * of returning a state that belongs to the calling thread.
+ * @see @ai{LUAAIRegistry}
+ */
+class ILUAStateProvider {
+public:
+	virtual ~ILUAStateProvider() {}
+
+	virtual lua_State* luaState() = 0;
+};
+
 static inline const char *luaAI_metaai() {
 	return "__meta_ai";
 }
@@ -487,7 +500,8 @@ static int luaAI_aggromgrresetreducevalue(lua_State* s) {
  * Apply aggro on some other character
  * @tparam integer id The character id to get aggro on
  * @tparam number amount The amount of aggro to apply
- * @treturn number The amount of aggro you have on the given entity
+ * @treturn number The amount of aggro you have on the given entity - @c 0 if the entity isn't tracked
+ * because the entry limit is reached
  * @function aggroMgr:addAggro
  */
 static int luaAI_aggromgraddaggro(lua_State* s) {
@@ -495,6 +509,11 @@ static int luaAI_aggromgraddaggro(lua_State* s) {
 	const CharacterId chrId = (CharacterId)luaL_checkinteger(s, 2);
 	const lua_Number amount = luaL_checknumber(s, 3);
 	const EntryPtr& entry = aggroMgr->addAggro(chrId, (float)amount);
+	if (entry == nullptr) {
+		// the entry limit of the aggro manager is reached
+		lua_pushnumber(s, 0.0);
+		return 1;
+	}
 	lua_pushnumber(s, entry->getAggro());
 	return 1;
 }
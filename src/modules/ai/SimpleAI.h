@@ -252,6 +252,7 @@
 #include "AIRegistry.h"
 #include "ICharacter.h"
 
+#include "tree/CompiledTree.h"
 #include "tree/Fail.h"
 #include "tree/Limit.h"
 #include "tree/Idle.h"
@@ -293,6 +294,8 @@
 #include "server/AIStepMessage.h"
 #include "server/AISelectMessage.h"
 #include "server/AIStateMessage.h"
+#include "server/AIStateDeltaMessage.h"
+#include "server/AIViewportMessage.h"
 #include "server/AINamesMessage.h"
 #include "server/AIChangeMessage.h"
 #include "server/AIAddNodeMessage.h"
@@ -11,92 +11,168 @@
 #include <memory>
 #include "ICharacter.h"
 #include <algorithm>
+#include <unordered_map>
 #include "aggro/Entry.h"
 
 namespace ai {
 
 /**
  * @brief Manages the aggro values for one @c AI instance. There are several ways to degrade the aggro values.
+ *
+ * The entries are kept in an indexed binary max heap - the entry with the highest aggro is always
+ * the first one. Adding aggro and querying the highest entry is @c O(log n) or better, the decay in
+ * @c update() is done for all entries at once and restores the heap in a single @c O(n) pass.
+ *
+ * Optionally the amount of tracked entries can be limited (see @c setMaxEntries()). If the limit is
+ * reached, a new entry replaces the entry with the lowest aggro - but only if it has more aggro.
+ *
+ * @note The returned @c EntryPtr are only valid until the next modification of the manager. Don't
+ * modify the aggro value of an entry directly, use @c addAggro() instead - otherwise the order gets lost.
  */
 class AggroMgr {
 public:
 	typedef std::vector<Entry> Entries;
 	typedef Entries::iterator EntriesIter;
 protected:
+	/**
+	 * binary max heap ordered by aggro (and character id for equal aggro values)
+	 */
 	mutable Entries _entries;
-
-	mutable bool _dirty;
+	/**
+	 * position of the character entry in the heap
+	 */
+	std::unordered_map<CharacterId, size_t> _index;
+	/**
+	 * 0 means unlimited
+	 */
+	size_t _maxEntries = 0u;
 
 	float _minAggro = 0.0f;
 	float _reduceRatioSecond = 0.0f;
 	float _reduceValueSecond = 0.0f;
 	ReductionType _reduceType = DISABLED;
 
-	class CharacterIdPredicate {
-	private:
-		const CharacterId& _id;
-	public:
-		explicit CharacterIdPredicate(const CharacterId& id) :
-			_id(id) {
+	/**
+	 * @return @c true if @c a has less aggro than @c b
+	 */
+	static inline bool lower(const Entry& a, const Entry& b) {
+		if (a.getAggro() != b.getAggro()) {
+			return a.getAggro() < b.getAggro();
 		}
+		return a.getCharacterId() < b.getCharacterId();
+	}
 
-		inline bool operator()(const Entry &n1) {
-			return n1.getCharacterId() == _id;
-		}
-	};
+	inline void place(size_t pos, const Entry& entry) {
+		_entries[pos] = entry;
+		_index[entry.getCharacterId()] = pos;
+	}
 
-	static bool EntrySorter(const Entry& a, const Entry& b) {
-		if (a.getAggro() > b.getAggro()) {
-			return false;
-		}
-		if (::fabs(a.getAggro() - b.getAggro()) < 0.0000001f) {
-			return a.getCharacterId() < b.getCharacterId();
+	size_t siftUp(size_t pos) {
+		const Entry entry = _entries[pos];
+		while (pos > 0u) {
+			const size_t parent = (pos - 1u) / 2u;
+			if (!lower(_entries[parent], entry)) {
+				break;
+			}
+			place(pos, _entries[parent]);
+			pos = parent;
 		}
-		return true;
+		place(pos, entry);
+		return pos;
 	}
 
-	/**
-	 * @brief Remove the entries from the list that have no aggro left.
-	 * This list is ordered, so we will only remove the first X elements.
-	 */
-	void cleanupList() {
-		EntriesIter::difference_type remove = 0;
-		for (EntriesIter i = _entries.begin(); i != _entries.end(); ++i) {
-			const float aggroValue = i->getAggro();
-			if (aggroValue > 0.0f) {
+	size_t siftDown(size_t pos) {
+		const Entry entry = _entries[pos];
+		const size_t size = _entries.size();
+		for (;;) {
+			size_t child = pos * 2u + 1u;
+			if (child >= size) {
 				break;
 			}
+			if (child + 1u < size && lower(_entries[child], _entries[child + 1u])) {
+				++child;
+			}
+			if (!lower(entry, _entries[child])) {
+				break;
+			}
+			place(pos, _entries[child]);
+			pos = child;
+		}
+		place(pos, entry);
+		return pos;
+	}
 
-			++remove;
+	inline size_t restore(size_t pos) {
+		const size_t newPos = siftUp(pos);
+		if (newPos != pos) {
+			return newPos;
 		}
+		return siftDown(pos);
+	}
 
-		if (remove == 0) {
+	void removeAt(size_t pos) {
+		_index.erase(_entries[pos].getCharacterId());
+		const size_t last = _entries.size() - 1u;
+		if (pos != last) {
+			_entries[pos] = _entries[last];
+			_entries.pop_back();
+			_index[_entries[pos].getCharacterId()] = pos;
+			restore(pos);
 			return;
 		}
+		_entries.pop_back();
+	}
 
-		const int size = static_cast<int>(_entries.size());
-		if (size == remove) {
-			_entries.clear();
-			return;
+	/**
+	 * @brief The entry with the lowest aggro is one of the leaves of the heap
+	 */
+	size_t lowestEntry() const {
+		const size_t size = _entries.size();
+		size_t lowest = size / 2u;
+		for (size_t i = lowest + 1u; i < size; ++i) {
+			if (lower(_entries[i], _entries[lowest])) {
+				lowest = i;
+			}
 		}
+		return lowest;
+	}
 
-		EntriesIter i = _entries.begin();
-		std::advance(i, remove);
-		_entries.erase(_entries.begin(), i);
+	/**
+	 * @brief Remove the entries from the list that have no aggro left and rebuild the heap
+	 */
+	void rebuild() {
+		size_t n = 0u;
+		const size_t size = _entries.size();
+		for (size_t i = 0u; i < size; ++i) {
+			if (_entries[i].getAggro() <= 0.0f) {
+				_index.erase(_entries[i].getCharacterId());
+				continue;
+			}
+			if (n != i) {
+				_entries[n] = _entries[i];
+			}
+			++n;
+		}
+		_entries.erase(_entries.begin() + n, _entries.end());
+		std::make_heap(_entries.begin(), _entries.end(), lower);
+		for (size_t i = 0u; i < n; ++i) {
+			_index[_entries[i].getCharacterId()] = i;
+		}
 	}
 
-	inline void sort() const {
-		if (!_dirty) {
+	void applyLimit() {
+		if (_maxEntries == 0u) {
 			return;
 		}
-		std::sort(_entries.begin(), _entries.end(), EntrySorter);
-		_dirty = false;
+		while (_entries.size() > _maxEntries) {
+			removeAt(lowestEntry());
+		}
 	}
 public:
-	explicit AggroMgr(std::size_t expectedEntrySize = 0u) :
-		_dirty(false) {
+	explicit AggroMgr(std::size_t expectedEntrySize = 0u) {
 		if (expectedEntrySize > 0) {
 			_entries.reserve(expectedEntrySize);
+			_index.reserve(expectedEntrySize);
 		}
 	}
 
@@ -124,18 +200,32 @@ public:
 		_minAggro = 0.0f;
 	}
 
+	/**
+	 * @brief Limits the amount of tracked entries. If there are already more entries, those with the lowest
+	 * aggro are removed.
+	 * @param[in] maxEntries @c 0 means unlimited
+	 */
+	void setMaxEntries(size_t maxEntries) {
+		_maxEntries = maxEntries;
+		applyLimit();
+	}
+
+	inline size_t getMaxEntries() const {
+		return _maxEntries;
+	}
+
 	/**
 	 * @brief this will update the aggro list according to the reduction type of an entry.
 	 * @param[in] deltaMillis The current milliseconds to use to update the aggro value of the entries.
 	 */
 	void update(int64_t deltaMillis) {
-		for (EntriesIter i = _entries.begin(); i != _entries.end(); ++i) {
-			_dirty |= i->reduceByTime(deltaMillis);
+		bool reduced = false;
+		for (Entry& e : _entries) {
+			reduced |= e.reduceByTime(deltaMillis);
 		}
 
-		if (_dirty) {
-			sort();
-			cleanupList();
+		if (reduced) {
+			rebuild();
 		}
 	}
 
@@ -144,34 +234,40 @@ public:
 	 * @param[in] id The entity id to increase the aggro against
 	 * @param[in] amount The amount to increase the aggro for
 	 * @return The aggro @c Entry that was added or updated. Useful for changing the reduce type or amount.
+	 * This is @c nullptr if the entry limit is reached and the aggro isn't high enough to replace the
+	 * entry with the lowest aggro.
 	 */
 	EntryPtr addAggro(CharacterId id, float amount) {
-		const CharacterIdPredicate p(id);
-		EntriesIter i = std::find_if(_entries.begin(), _entries.end(), p);
-		if (i == _entries.end()) {
-			Entry newEntry(id, amount);
-			switch (_reduceType) {
-			case RATIO:
-				newEntry.setReduceByRatio(_reduceRatioSecond, _minAggro);
-				break;
-			case VALUE:
-				newEntry.setReduceByValue(_reduceValueSecond);
-				break;
-			default:
-				break;
-			}
-			_entries.push_back(newEntry);
-			_dirty = true;
-			return &_entries.back();
+		auto i = _index.find(id);
+		if (i != _index.end()) {
+			_entries[i->second].addAggro(amount);
+			return &_entries[restore(i->second)];
 		}
 
-		i->addAggro(amount);
-		_dirty = true;
-		return &*i;
+		Entry newEntry(id, amount);
+		switch (_reduceType) {
+		case RATIO:
+			newEntry.setReduceByRatio(_reduceRatioSecond, _minAggro);
+			break;
+		case VALUE:
+			newEntry.setReduceByValue(_reduceValueSecond);
+			break;
+		default:
+			break;
+		}
+		if (_maxEntries > 0u && _entries.size() >= _maxEntries) {
+			const size_t lowest = lowestEntry();
+			if (!lower(_entries[lowest], newEntry)) {
+				return nullptr;
+			}
+			removeAt(lowest);
+		}
+		_entries.push_back(newEntry);
+		return &_entries[siftUp(_entries.size() - 1u)];
 	}
 
 	/**
-	 * @return All the aggro entries
+	 * @return All the aggro entries - the first entry has the highest aggro, the rest is in heap order
 	 */
 	const Entries& getEntries() const {
 		return _entries;
@@ -179,17 +275,12 @@ public:
 
 	/**
 	 * @brief Get the entry with the highest aggro value.
-	 *
-	 * @note Might execute a sort on the list if its dirty
 	 */
 	EntryPtr getHighestEntry() const {
 		if (_entries.empty()) {
 			return nullptr;
 		}
-
-		sort();
-
-		return &_entries.back();
+		return &_entries.front();
 	}
 };
 
@@ -8,11 +8,11 @@
 #include "common/Math.h"
 #include "ICharacter.h"
 #include "AI.h"
-#include <map>
+#include <algorithm>
+#include <atomic>
 #include <memory>
-#include <numeric>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
 namespace ai {
 
@@ -23,35 +23,57 @@ namespace ai {
  *
  * Every @ai{Zone} has its own @c GroupMgr instance. It is automatically updated with the zone.
  * The average group position is only updated once per @c update() call.
+ *
+ * The groups are stored densely - each group has its own member array and the leader and the
+ * average position are cached in the group entry. None of the query methods takes a lock.
+ *
+ * While the zone executes the @c AI ticks in parallel, the group manager is frozen (see @c freeze()).
+ * The queries are answered from the state of the last @c update() call then, and @c add(), @c remove()
+ * and @c removeFromAllGroups() are only queued - they are applied in the next @c update() call. If the
+ * group manager isn't frozen, the changes are applied immediately. In this case the group manager
+ * may only be used by one thread - the one that is updating the zone.
  */
 class GroupMgr {
 private:
-	struct AveragePositionFunctor {
-		glm::vec3 operator()(const glm::vec3& result, const AIPtr& ai) {
-			return ai->getCharacter()->getPosition() + result;
-		}
-	};
-
-	typedef std::unordered_set<AIPtr> GroupMembersSet;
-	typedef GroupMembersSet::iterator GroupMembersSetIter;
-	typedef GroupMembersSet::const_iterator GroupMembersSetConstIter;
-
-	ReadWriteLock _groupLock = {"groupmgr-group"};
 	struct Group {
+		GroupId id;
 		AIPtr leader;
-		GroupMembersSet members;
+		std::vector<AIPtr> members;
 		glm::vec3 position;
 	};
 
-	typedef std::unordered_multimap<AIPtr, GroupId> GroupMembers;
-	typedef std::unordered_map<GroupId, Group> Groups;
-	typedef Groups::const_iterator GroupsConstIter;
-	typedef Groups::iterator GroupsIter;
+	// a group the ai is in - and the index of the ai in the member array of that group
+	struct Membership {
+		GroupId id;
+		size_t index;
+	};
+	typedef std::vector<Membership> Memberships;
+
+	struct Change {
+		enum class Type : uint8_t {
+			Add, Remove, RemoveFromAll
+		};
+		Type type;
+		GroupId id;
+		AIPtr ai;
+	};
+
+	std::vector<Group> _groups;
+	std::unordered_map<GroupId, size_t> _groupIndex;
+	std::unordered_map<AIPtr, Memberships> _memberships;
 
-	GroupMembersSet _empty;
-	ReadWriteLock _lock = {"groupmgr"};
-	Groups _groups;
-	GroupMembers _groupMembers;
+	std::atomic_bool _frozen { false };
+	ReadWriteLock _changesLock = {"groupmgr-changes"};
+	std::vector<Change> _changes;
+
+	const Group* findGroup(GroupId id) const;
+	const Membership* findMembership(GroupId id, const AIPtr& ai) const;
+	void queueChange(Change::Type type, GroupId id, const AIPtr& ai);
+
+	bool doAdd(GroupId id, const AIPtr& ai);
+	bool doRemove(GroupId id, const AIPtr& ai);
+	bool doRemoveFromAllGroups(const AIPtr& ai);
+	void removeGroup(size_t groupIndex);
 
 public:
 	GroupMgr () {
@@ -69,34 +91,39 @@ public:
 	 * @param ai The @ai{AI} to add to the group. Keep
 	 * in mind that you have to remove it manually from any group
 	 * whenever you destroy the @ai{AI} instance.
-	 * @return @c true if the add to the group was successful.
-	 *
-	 * @note This method performs a write lock on the group manager
+	 * @return @c true if the add to the group was successful. If the group manager is frozen,
+	 * this is @c true if the @ai{AI} wasn't yet part of the group at the last @c update() call.
 	 */
 	bool add(GroupId id, const AIPtr& ai);
 
+	/**
+	 * @brief Applies the changes that were queued while the group manager was frozen, ends
+	 * the frozen state and calculates the average group positions.
+	 */
 	void update(int64_t deltaTime);
 
+	/**
+	 * @brief Queue all modifications until the next @c update() call. This is done by the @ai{Zone}
+	 * before the @c AI ticks are executed in parallel.
+	 */
+	void freeze();
+
 	/**
 	 * @brief Removes a group member from the given @ai{GroupId}. If the member
-	 * is the group leader, a new leader will be picked randomly. If after the
-	 * removal of the member only one other member is left in the group, the
-	 * group is destroyed.
+	 * is the group leader, a new leader will be picked. If the last member is
+	 * removed, the group is destroyed.
 	 *
 	 * @param ai The @ai{AI} to remove from this the group.
 	 * @return @c true if the given @ai{AI} was removed from the group,
 	 * @c false if the removal failed (e.g. the @ai{AI} instance was not part of
-	 * the group)
-	 *
-	 * @note This method performs a write lock on the group manager
+	 * the group). If the group manager is frozen, this is @c true if the @ai{AI} was part of
+	 * the group at the last @c update() call.
 	 */
 	bool remove(GroupId id, const AIPtr& ai);
 
 	/**
 	 * @brief Use this method to remove a @ai{AI} instance from all the group it is
 	 * part of. Useful if you e.g. destroy a @ai{AI} instance.
-	 *
-	 * @note This method performs a write lock on the group manager
 	 */
 	bool removeFromAllGroups(const AIPtr& ai);
 
@@ -104,33 +131,26 @@ public:
 	 * @brief Returns the average position of the group
 	 *
 	 * @note If the given group doesn't exist or some other error occurred, this method returns @c glm::vec3::VEC3_INFINITE
-	 * @note The position of a group is calculated once per @c update() call.
-	 *
-	 * @note This method performs a read lock on the group manager
+	 * @note The position of a group is calculated once per @c update() call - a new group starts at the
+	 * position of its leader.
 	 */
 	glm::vec3 getPosition(GroupId id) const;
 
 	/**
 	 * @return The @ai{ICharacter} object of the leader, or @c nullptr if no such group exists.
-	 *
-	 * @note This method performs a read lock on the group manager
 	 */
 	AIPtr getLeader(GroupId id) const;
 
 	/**
 	 * @brief Visit all the group members of the given group until the functor returns @c false
-	 *
-	 * @note This methods performs a read lock on the group manager
 	 */
 	template<typename Func>
 	void visit(GroupId id, Func& func) const {
-		ScopedReadLock scopedLock(_lock);
-		const GroupsConstIter& i = _groups.find(id);
-		if (i == _groups.end()) {
+		const Group* group = findGroup(id);
+		if (group == nullptr) {
 			return;
 		}
-		for (GroupMembersSetConstIter it = i->second.members.begin(); it != i->second.members.end(); ++it) {
-			const AIPtr& chr = *it;
+		for (const AIPtr& chr : group->members) {
 			if (!func(chr))
 				break;
 		}
@@ -139,168 +159,228 @@ public:
 	/**
 	 * @return If the group doesn't exist, this method returns @c 0 - otherwise the amount of members
 	 * that must be bigger than @c 1
-	 *
-	 * @note This method performs a read lock on the group manager
 	 */
 	int getGroupSize(GroupId id) const;
 
-	/**
-	 * @note This method performs a read lock on the group manager
-	 */
 	bool isInAnyGroup(const AIPtr& ai) const;
 
-	/**
-	 * @note This method performs a read lock on the group manager
-	 */
 	bool isInGroup(GroupId id, const AIPtr& ai) const;
 
-	/**
-	 * @note This method performs a read lock on the group manager
-	 */
 	bool isGroupLeader(GroupId id, const AIPtr& ai) const;
 };
 
+inline const GroupMgr::Group* GroupMgr::findGroup(GroupId id) const {
+	auto i = _groupIndex.find(id);
+	if (i == _groupIndex.end()) {
+		return nullptr;
+	}
+	return &_groups[i->second];
+}
+
+inline const GroupMgr::Membership* GroupMgr::findMembership(GroupId id, const AIPtr& ai) const {
+	auto i = _memberships.find(ai);
+	if (i == _memberships.end()) {
+		return nullptr;
+	}
+	for (const Membership& membership : i->second) {
+		if (membership.id == id) {
+			return &membership;
+		}
+	}
+	return nullptr;
+}
+
+inline void GroupMgr::queueChange(Change::Type type, GroupId id, const AIPtr& ai) {
+	ScopedWriteLock scopedLock(_changesLock);
+	_changes.push_back(Change{type, id, ai});
+}
+
+inline void GroupMgr::freeze() {
+	_frozen = true;
+}
 
 inline void GroupMgr::update(int64_t) {
-	ScopedReadLock scopedLock(_lock);
-	for (auto i = _groups.begin(); i != _groups.end(); ++i) {
-		Group& group = i->second;
-		glm::vec3 averagePosition;
-		{
-			ScopedReadLock lock(_groupLock);
-			averagePosition = std::accumulate(group.members.begin(), group.members.end(), glm::vec3(), AveragePositionFunctor());
-			averagePosition *= 1.0f / (float) group.members.size();
+	std::vector<Change> changes;
+	{
+		ScopedWriteLock scopedLock(_changesLock);
+		changes.swap(_changes);
+		_frozen = false;
+	}
+	for (const Change& change : changes) {
+		switch (change.type) {
+		case Change::Type::Add:
+			doAdd(change.id, change.ai);
+			break;
+		case Change::Type::Remove:
+			doRemove(change.id, change.ai);
+			break;
+		case Change::Type::RemoveFromAll:
+			doRemoveFromAllGroups(change.ai);
+			break;
 		}
-		ScopedWriteLock lock(_groupLock);
-		group.position = averagePosition;
+	}
+
+	for (Group& group : _groups) {
+		glm::vec3 sum(0.0f);
+		for (const AIPtr& ai : group.members) {
+			sum += ai->getCharacter()->getPosition();
+		}
+		group.position = sum / (float) group.members.size();
 	}
 }
 
 inline bool GroupMgr::add(GroupId id, const AIPtr& ai) {
-	ScopedWriteLock scopedLock(_lock);
-	GroupsIter i = _groups.find(id);
-	if (i == _groups.end()) {
-		Group group;
+	if (_frozen) {
+		if (findMembership(id, ai) != nullptr) {
+			return false;
+		}
+		queueChange(Change::Type::Add, id, ai);
+		return true;
+	}
+	return doAdd(id, ai);
+}
+
+inline bool GroupMgr::doAdd(GroupId id, const AIPtr& ai) {
+	if (findMembership(id, ai) != nullptr) {
+		return false;
+	}
+	auto i = _groupIndex.find(id);
+	if (i == _groupIndex.end()) {
+		i = _groupIndex.emplace(id, _groups.size()).first;
+		_groups.emplace_back();
+		Group& group = _groups.back();
+		group.id = id;
 		group.leader = ai;
-		i = _groups.insert(std::pair<GroupId, Group>(id, group)).first;
+		group.position = ai->getCharacter()->getPosition();
 	}
+	Group& group = _groups[i->second];
+	_memberships[ai].push_back(Membership{id, group.members.size()});
+	group.members.push_back(ai);
+	return true;
+}
 
-	Group& group = i->second;
-	ScopedWriteLock lock(_groupLock);
-	std::pair<GroupMembersSetIter, bool> ret = group.members.insert(ai);
-	if (ret.second) {
-		_groupMembers.insert(GroupMembers::value_type(ai, id));
+inline bool GroupMgr::remove(GroupId id, const AIPtr& ai) {
+	if (_frozen) {
+		if (findMembership(id, ai) == nullptr) {
+			return false;
+		}
+		queueChange(Change::Type::Remove, id, ai);
 		return true;
 	}
-	return false;
+	return doRemove(id, ai);
 }
 
-inline bool GroupMgr::remove(GroupId id, const AIPtr& ai) {
-	ScopedWriteLock scopedLock(_lock);
-	const GroupsIter& i = _groups.find(id);
-	if (i == _groups.end()) {
+inline bool GroupMgr::doRemove(GroupId id, const AIPtr& ai) {
+	auto mi = _memberships.find(ai);
+	if (mi == _memberships.end()) {
 		return false;
 	}
-	Group& group = i->second;
-	GroupMembersSetIter si;
-	{
-		ScopedReadLock lock(_groupLock);
-		si = group.members.find(ai);
-		if (si == group.members.end()) {
-			return false;
-		}
+	Memberships& memberships = mi->second;
+	auto membership = std::find_if(memberships.begin(), memberships.end(), [id] (const Membership& m) {
+		return m.id == id;
+	});
+	if (membership == memberships.end()) {
+		return false;
 	}
-	{
-		ScopedWriteLock lock(_groupLock);
-		group.members.erase(si);
-		if (group.members.empty()) {
-			_groups.erase(i);
-		} else if (group.leader == ai) {
-			group.leader = *group.members.begin();
-		}
+	const size_t index = membership->index;
+	*membership = memberships.back();
+	memberships.pop_back();
+	if (memberships.empty()) {
+		_memberships.erase(mi);
 	}
 
-	auto range = _groupMembers.equal_range(ai);
-	for (auto it = range.first; it != range.second; ++it) {
-		if (it->second == id) {
-			_groupMembers.erase(it);
-			break;
+	const size_t groupIndex = _groupIndex[id];
+	Group& group = _groups[groupIndex];
+	if (group.members.size() == 1u) {
+		removeGroup(groupIndex);
+		return true;
+	}
+
+	// move the last member into the free slot and fix its membership index
+	if (index != group.members.size() - 1u) {
+		group.members[index] = std::move(group.members.back());
+		for (Membership& m : _memberships[group.members[index]]) {
+			if (m.id == id) {
+				m.index = index;
+				break;
+			}
 		}
 	}
+	group.members.pop_back();
+	if (group.leader == ai) {
+		group.leader = group.members.front();
+	}
 	return true;
 }
 
+inline void GroupMgr::removeGroup(size_t groupIndex) {
+	_groupIndex.erase(_groups[groupIndex].id);
+	if (groupIndex != _groups.size() - 1u) {
+		_groups[groupIndex] = std::move(_groups.back());
+		_groupIndex[_groups[groupIndex].id] = groupIndex;
+	}
+	_groups.pop_back();
+}
+
 inline bool GroupMgr::removeFromAllGroups(const AIPtr& ai) {
-	std::list<GroupId> groups;
-	{
-		ScopedReadLock scopedLock(_lock);
-		auto range = _groupMembers.equal_range(ai);
-		for (auto it = range.first; it != range.second; ++it) {
-			groups.push_back(it->second);
-		}
+	if (_frozen) {
+		queueChange(Change::Type::RemoveFromAll, GroupId(), ai);
+		return true;
+	}
+	return doRemoveFromAllGroups(ai);
+}
+
+inline bool GroupMgr::doRemoveFromAllGroups(const AIPtr& ai) {
+	auto i = _memberships.find(ai);
+	if (i == _memberships.end()) {
+		return true;
 	}
-	for (GroupId groupId : groups) {
-		remove(groupId, ai);
+	// copy - the memberships entry is erased with the last removal
+	const Memberships memberships = i->second;
+	for (const Membership& membership : memberships) {
+		doRemove(membership.id, ai);
 	}
 	return true;
 }
 
 inline AIPtr GroupMgr::getLeader(GroupId id) const {
-	ScopedReadLock scopedLock(_lock);
-	const GroupsConstIter& i = _groups.find(id);
-	if (i == _groups.end()) {
+	const Group* group = findGroup(id);
+	if (group == nullptr) {
 		return AIPtr();
 	}
-
-	ScopedReadLock lock(_groupLock);
-	return i->second.leader;
+	return group->leader;
 }
 
 inline glm::vec3 GroupMgr::getPosition(GroupId id) const {
-	ScopedReadLock scopedLock(_lock);
-	const GroupsConstIter& i = _groups.find(id);
-	if (i == _groups.end()) {
+	const Group* group = findGroup(id);
+	if (group == nullptr) {
 		return VEC3_INFINITE;
 	}
-
-	ScopedReadLock lock(_groupLock);
-	return i->second.position;
+	return group->position;
 }
 
 inline bool GroupMgr::isGroupLeader(GroupId id, const AIPtr& ai) const {
-	ScopedReadLock scopedLock(_lock);
-	const GroupsConstIter& i = _groups.find(id);
-	if (i == _groups.end()) {
-		return 0;
+	const Group* group = findGroup(id);
+	if (group == nullptr) {
+		return false;
 	}
-	ScopedReadLock lock(_groupLock);
-	return i->second.leader == ai;
+	return group->leader == ai;
 }
 
 inline int GroupMgr::getGroupSize(GroupId id) const {
-	ScopedReadLock scopedLock(_lock);
-	const GroupsConstIter& i = _groups.find(id);
-	if (i == _groups.end()) {
+	const Group* group = findGroup(id);
+	if (group == nullptr) {
 		return 0;
 	}
-	ScopedReadLock lock(_groupLock);
-	return static_cast<int>(std::distance(i->second.members.begin(), i->second.members.end()));
+	return static_cast<int>(group->members.size());
 }
 
 inline bool GroupMgr::isInAnyGroup(const AIPtr& ai) const {
-	ScopedReadLock scopedLock(_lock);
-	return _groupMembers.find(ai) != _groupMembers.end();
+	return _memberships.find(ai) != _memberships.end();
 }
 
 inline bool GroupMgr::isInGroup(GroupId id, const AIPtr& ai) const {
-	ScopedReadLock scopedLock(_lock);
-	auto range = _groupMembers.equal_range(ai);
-	for (auto it = range.first; it != range.second; ++it) {
-		if (it->second == id) {
-			return true;
-		}
-	}
-	return false;
+	return findMembership(id, ai) != nullptr;
 }
 
 }
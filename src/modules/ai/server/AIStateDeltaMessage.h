@@ -0,0 +1,135 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "AIStateMessage.h"
+#include <vector>
+
+namespace ai {
+
+/**
+ * @brief Message for the remote debugging interface
+ *
+ * Changes to the state of the world since the last @c AIStateMessage or @c AIStateDeltaMessage that
+ * was sent to the client. Only the entities that were changed are included - the attributes of an
+ * entity are only included if they were modified. Entities that are no longer part of the world are
+ * listed by their id.
+ */
+class AIStateDeltaMessage: public IProtocolMessage {
+private:
+	typedef std::vector<AIStateWorld> States;
+	States _states;
+	// whether the attributes of the state with the same index are included
+	std::vector<bool> _attributes;
+	std::vector<CharacterId> _removed;
+
+	void readState(streamContainer& in) {
+		const ai::CharacterId id = readInt(in);
+		const float x = readFloat(in);
+		const float y = readFloat(in);
+		const float z = readFloat(in);
+		const float orientation = readFloat(in);
+		const bool attributes = readBool(in);
+		AIStateWorld state(id, glm::vec3(x, y, z), orientation);
+		if (attributes) {
+			CharacterAttributes& attribs = state.getAttributes();
+			const int size = readShort(in);
+			attribs.reserve(size);
+			for (int i = 0; i < size; ++i) {
+				const std::string& key = readString(in);
+				const std::string& value = readString(in);
+				attribs.insert(std::make_pair(key, value));
+			}
+		}
+		addState(std::move(state), attributes);
+	}
+
+	void writeState(streamContainer& out, const AIStateWorld& state, bool attributes) const {
+		addInt(out, state.getId());
+		const glm::vec3& position = state.getPosition();
+		addFloat(out, position.x);
+		addFloat(out, position.y);
+		addFloat(out, position.z);
+		addFloat(out, state.getOrientation());
+		addBool(out, attributes);
+		if (!attributes) {
+			return;
+		}
+		const CharacterAttributes& attribs = state.getAttributes();
+		addShort(out, static_cast<int16_t>(attribs.size()));
+		for (CharacterAttributes::const_iterator i = attribs.begin(); i != attribs.end(); ++i) {
+			addString(out, i->first);
+			addString(out, i->second);
+		}
+	}
+
+public:
+	AIStateDeltaMessage() :
+			IProtocolMessage(PROTO_STATE_DELTA) {
+	}
+
+	explicit AIStateDeltaMessage(streamContainer& in) :
+			IProtocolMessage(PROTO_STATE_DELTA) {
+		const int stateSize = readInt(in);
+		for (int i = 0; i < stateSize; ++i) {
+			readState(in);
+		}
+		const int removedSize = readInt(in);
+		_removed.reserve(removedSize);
+		for (int i = 0; i < removedSize; ++i) {
+			_removed.push_back(readInt(in));
+		}
+	}
+
+	/**
+	 * @param[in] attributes @c false if the attributes of the given state should not be transferred
+	 */
+	void addState(const AIStateWorld& state, bool attributes) {
+		_states.push_back(state);
+		_attributes.push_back(attributes);
+	}
+
+	void addState(AIStateWorld&& state, bool attributes) {
+		_states.push_back(std::move(state));
+		_attributes.push_back(attributes);
+	}
+
+	void addRemoved(CharacterId id) {
+		_removed.push_back(id);
+	}
+
+	inline bool empty() const {
+		return _states.empty() && _removed.empty();
+	}
+
+	void serialize(streamContainer& out) const override {
+		addByte(out, _id);
+		addInt(out, static_cast<int>(_states.size()));
+		for (size_t i = 0; i < _states.size(); ++i) {
+			writeState(out, _states[i], _attributes[i]);
+		}
+		addInt(out, static_cast<int>(_removed.size()));
+		for (CharacterId id : _removed) {
+			addInt(out, id);
+		}
+	}
+
+	inline const std::vector<AIStateWorld>& getStates() const {
+		return _states;
+	}
+
+	/**
+	 * @return @c true if the state at the given index contains the attributes of the entity. If
+	 * this is @c false, the previously received attributes are still valid.
+	 */
+	inline bool hasAttributes(size_t index) const {
+		return _attributes[index];
+	}
+
+	inline const std::vector<CharacterId>& getRemoved() const {
+		return _removed;
+	}
+};
+
+}
@@ -0,0 +1,53 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "IProtocolMessage.h"
+#include "common/Math.h"
+
+namespace ai {
+
+/**
+ * @brief Message for the remote debugging interface
+ *
+ * The area of the world (on the x and z axis) that the client is currently looking at. Entities
+ * outside of this area are transferred less often. If the minimum is bigger than the maximum, all
+ * entities are treated as visible.
+ */
+class AIViewportMessage: public IProtocolMessage {
+private:
+	glm::vec2 _mins;
+	glm::vec2 _maxs;
+
+public:
+	AIViewportMessage(const glm::vec2& mins, const glm::vec2& maxs) :
+			IProtocolMessage(PROTO_VIEWPORT), _mins(mins), _maxs(maxs) {
+	}
+
+	explicit AIViewportMessage(streamContainer& in) :
+			IProtocolMessage(PROTO_VIEWPORT) {
+		_mins.x = readFloat(in);
+		_mins.y = readFloat(in);
+		_maxs.x = readFloat(in);
+		_maxs.y = readFloat(in);
+	}
+
+	void serialize(streamContainer& out) const override {
+		addByte(out, _id);
+		addFloat(out, _mins.x);
+		addFloat(out, _mins.y);
+		addFloat(out, _maxs.x);
+		addFloat(out, _maxs.y);
+	}
+
+	inline const glm::vec2& getMins() const {
+		return _mins;
+	}
+
+	inline const glm::vec2& getMaxs() const {
+		return _maxs;
+	}
+};
+
+}
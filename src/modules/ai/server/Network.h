@@ -4,10 +4,12 @@
 #pragma once
 
 #include "IProtocolHandler.h"
+#include "RingBuffer.h"
 #include "common/Thread.h"
 #include <string>
 #include <stdint.h>
 #include <list>
+#include <vector>
 #ifdef WIN32
 #define NOMINMAX
 #include <winsock2.h>
@@ -16,6 +18,9 @@
 #else
 #define SOCKET  int
 #include <sys/select.h>
+#ifdef __linux__
+#define AI_NETWORK_EPOLL 1
+#endif
 #endif
 
 namespace ai {
@@ -23,13 +28,15 @@ namespace ai {
 class IProtocolMessage;
 
 struct Client {
-	explicit Client(SOCKET _socket) :
-			socket(_socket), finished(false), in(), out() {
+	Client(ClientId _id, SOCKET _socket) :
+			id(_id), socket(_socket), finished(false), in(), out() {
 	}
+	// stays the same while the client is connected
+	ClientId id;
 	SOCKET socket;
 	bool finished;
 	streamContainer in;
-	streamContainer out;
+	RingBuffer out;
 };
 
 class INetworkListener {
@@ -40,15 +47,27 @@ public:
 	virtual void onDisconnect(Client*) {}
 };
 
+/**
+ * @brief Non-blocking tcp server for the remote debugger connections.
+ *
+ * Uses epoll on linux and select everywhere else to find the sockets with incoming data. The
+ * outgoing data is queued in a @c RingBuffer per client and handed over to the socket with one
+ * scatter/gather send per @c update() call.
+ */
 class Network {
 protected:
 	uint16_t _port;
 	std::string _hostname;
 	// the socket file descriptor
 	SOCKET _socketFD;
+#ifdef AI_NETWORK_EPOLL
+	int _epollFD;
+#else
 	fd_set _readFDSet;
-	fd_set _writeFDSet;
+#endif
 	int64_t _time;
+	ClientId _nextClientId;
+	std::vector<uint8_t> _recvBuffer;
 
 	typedef std::list<Client> ClientSockets;
 	typedef ClientSockets::iterator ClientSocketsIter;
@@ -58,7 +77,11 @@ protected:
 	typedef std::list<INetworkListener*> Listeners;
 	Listeners _listeners;
 
+	void acceptClients();
+	bool readClient(Client& client);
 	bool sendMessage(Client& client);
+	Client* findClient(ClientId id);
+	static void frame(streamContainer& out, const IProtocolMessage& msg);
 public:
 	Network(uint16_t port = 10001, const std::string& hostname = "0.0.0.0");
 	virtual ~Network();
@@ -76,6 +99,11 @@ public:
 	 */
 	bool broadcast(const IProtocolMessage& msg);
 	bool sendToClient(Client* client, const IProtocolMessage& msg);
+	/**
+	 * @brief Queues already framed messages for the given client
+	 * @return @c false if the client isn't connected (anymore)
+	 */
+	bool sendToClient(ClientId clientId, const uint8_t* data, size_t size);
 };
 
 inline int Network::getConnectedClients() const {
@@ -11,6 +11,7 @@
 #ifdef WIN32
 #define network_cleanup() WSACleanup()
 #define network_return int
+#define network_wouldblock() (WSAGetLastError() == WSAEWOULDBLOCK)
 #else
 #define network_return ssize_t
 #include <sys/types.h>
@@ -21,6 +22,11 @@
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <sys/uio.h>
+#include <errno.h>
+#ifdef AI_NETWORK_EPOLL
+#include <sys/epoll.h>
+#endif
 #include <sys/socket.h>
 #include <net/if.h>
 #include <netdb.h>
@@ -28,6 +34,7 @@
 #define closesocket close
 #define INVALID_SOCKET  -1
 #define network_cleanup()
+#define network_wouldblock() (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
 #endif
 #include <string.h>
 #include <deque>
@@ -36,17 +43,38 @@
 #include <cstddef>
 #include <memory>
 #include <iterator>
-#include <array>
 
 namespace ai {
 
+namespace {
+inline void setNonBlocking(SOCKET socket) {
+#ifdef WIN32
+	unsigned long mode = 1;
+	ioctlsocket(socket, FIONBIO, &mode);
+#else
+	fcntl(socket, F_SETFL, fcntl(socket, F_GETFL, 0) | O_NONBLOCK);
+#endif
+}
+}
+
 inline Network::Network(uint16_t port, const std::string& hostname) :
-		_port(port), _hostname(hostname), _socketFD(INVALID_SOCKET), _time(0L) {
+		_port(port), _hostname(hostname), _socketFD(INVALID_SOCKET), _time(0L), _nextClientId(0u), _recvBuffer(16384) {
+#ifdef AI_NETWORK_EPOLL
+	_epollFD = -1;
+#else
 	FD_ZERO(&_readFDSet);
-	FD_ZERO(&_writeFDSet);
+#endif
 }
 
 inline Network::~Network() {
+	for (ClientSocketsIter i = _clientSockets.begin(); i != _clientSockets.end(); ++i) {
+		closesocket(i->socket);
+	}
+#ifdef AI_NETWORK_EPOLL
+	if (_epollFD != -1) {
+		close(_epollFD);
+	}
+#endif
 	closesocket(_socketFD);
 	network_cleanup();
 }
@@ -62,9 +90,6 @@ inline bool Network::start() {
 	signal(SIGPIPE, SIG_IGN);
 #endif
 
-	FD_ZERO(&_readFDSet);
-	FD_ZERO(&_writeFDSet);
-
 	_socketFD = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
 	if (_socketFD == INVALID_SOCKET) {
 		network_cleanup();
@@ -89,8 +114,6 @@ inline bool Network::start() {
 	if (bind(_socketFD, (struct sockaddr *) &sin, sizeof(sin)) < 0) {
 		// Handle the error.
 		network_cleanup();
-		FD_CLR(_socketFD, &_readFDSet);
-		FD_CLR(_socketFD, &_writeFDSet);
 		closesocket(_socketFD);
 		_socketFD = INVALID_SOCKET;
 		return false;
@@ -104,15 +127,25 @@ inline bool Network::start() {
 		return false;
 	}
 
-#ifdef O_NONBLOCK
-	fcntl(_socketFD, F_SETFL, O_NONBLOCK);
-#endif
-#ifdef WIN32
-	unsigned long mode = 1;
-	ioctlsocket(_socketFD, FIONBIO, &mode);
-#endif
+	setNonBlocking(_socketFD);
 
+#ifdef AI_NETWORK_EPOLL
+	_epollFD = epoll_create1(0);
+	if (_epollFD == -1) {
+		closesocket(_socketFD);
+		_socketFD = INVALID_SOCKET;
+		return false;
+	}
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	// the listen socket is identified by a null pointer
+	event.data.ptr = nullptr;
+	epoll_ctl(_epollFD, EPOLL_CTL_ADD, _socketFD, &event);
+#else
+	FD_ZERO(&_readFDSet);
 	FD_SET(_socketFD, &_readFDSet);
+#endif
 
 	return true;
 }
@@ -120,9 +153,14 @@ inline bool Network::start() {
 inline Network::ClientSocketsIter Network::closeClient(ClientSocketsIter& iter) {
 	Client& client = *iter;
 	const SOCKET clientSocket = client.socket;
-	FD_CLR(clientSocket, &_readFDSet);
-	FD_CLR(clientSocket, &_writeFDSet);
-	closesocket(clientSocket);
+	if (clientSocket != INVALID_SOCKET) {
+#ifdef AI_NETWORK_EPOLL
+		epoll_ctl(_epollFD, EPOLL_CTL_DEL, clientSocket, nullptr);
+#else
+		FD_CLR(clientSocket, &_readFDSet);
+#endif
+		closesocket(clientSocket);
+	}
 	client.socket = INVALID_SOCKET;
 	for (INetworkListener* listener : _listeners) {
 		listener->onDisconnect(&client);
@@ -130,25 +168,84 @@ inline Network::ClientSocketsIter Network::closeClient(ClientSocketsIter& iter)
 	return _clientSockets.erase(iter);
 }
 
-inline bool Network::sendMessage(Client& client) {
-	if (client.out.empty()) {
-		return true;
+inline Client* Network::findClient(ClientId id) {
+	for (Client& client : _clientSockets) {
+		if (client.id == id) {
+			return &client;
+		}
+	}
+	return nullptr;
+}
+
+inline void Network::acceptClients() {
+	for (;;) {
+		const SOCKET clientSocket = accept(_socketFD, nullptr, nullptr);
+		if (clientSocket == INVALID_SOCKET) {
+			return;
+		}
+		setNonBlocking(clientSocket);
+		// don't hand out the id of a client that is still connected
+		do {
+			++_nextClientId;
+		} while (findClient(_nextClientId) != nullptr);
+		_clientSockets.emplace_back(_nextClientId, clientSocket);
+		Client& client = _clientSockets.back();
+#ifdef AI_NETWORK_EPOLL
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.ptr = &client;
+		epoll_ctl(_epollFD, EPOLL_CTL_ADD, clientSocket, &event);
+#else
+		FD_SET(clientSocket, &_readFDSet);
+#endif
+		for (INetworkListener* listener : _listeners) {
+			listener->onConnect(&client);
+		}
+	}
+}
+
+inline bool Network::readClient(Client& client) {
+	for (;;) {
+		const network_return len = recv(client.socket, (char*)&_recvBuffer[0], _recvBuffer.size(), 0);
+		if (len < 0) {
+			return network_wouldblock();
+		}
+		if (len == 0) {
+			// orderly shutdown of the remote side
+			return false;
+		}
+		client.in.insert(client.in.end(), _recvBuffer.begin(), _recvBuffer.begin() + len);
+		if ((size_t)len < _recvBuffer.size()) {
+			return true;
+		}
 	}
+}
 
-	std::array<uint8_t, 16384> buf;
+inline bool Network::sendMessage(Client& client) {
 	while (!client.out.empty()) {
-		const size_t len = std::min(buf.size(), client.out.size());
-		std::copy_n(client.out.begin(), len, buf.begin());
-		const SOCKET clientSocket = client.socket;
-		const network_return sent = send(clientSocket, (const char*)&buf[0], len, 0);
+		const uint8_t* data[2];
+		size_t len[2];
+		const int n = client.out.spans(data, len);
+#ifdef WIN32
+		(void)n;
+		const network_return sent = send(client.socket, (const char*)data[0], (int)len[0], 0);
+#else
+		struct iovec iov[2];
+		for (int i = 0; i < n; ++i) {
+			iov[i].iov_base = const_cast<uint8_t*>(data[i]);
+			iov[i].iov_len = len[i];
+		}
+		const network_return sent = writev(client.socket, iov, n);
+#endif
 		if (sent < 0) {
-			return false;
+			return network_wouldblock();
 		}
 		if (sent == 0) {
 			// better luck next time - but don't block others
 			return true;
 		}
-		client.out.erase(client.out.begin(), std::next(client.out.begin(), sent));
+		client.out.consume(sent);
 	}
 	return true;
 }
@@ -160,90 +257,96 @@ inline void Network::update(int64_t deltaTime) {
 			_time = 0L;
 		}
 	}
-	fd_set readFDsOut;
-	fd_set writeFDsOut;
+	if (_socketFD == INVALID_SOCKET) {
+		return;
+	}
 
+#ifdef AI_NETWORK_EPOLL
+	struct epoll_event events[64];
+	const int ready = epoll_wait(_epollFD, events, (int)(sizeof(events) / sizeof(events[0])), 0);
+	for (int i = 0; i < ready; ++i) {
+		Client* client = (Client*)events[i].data.ptr;
+		if (client == nullptr) {
+			acceptClients();
+			continue;
+		}
+		if (!readClient(*client)) {
+			client->finished = true;
+		}
+	}
+#else
+	fd_set readFDsOut;
 	memcpy(&readFDsOut, &_readFDSet, sizeof(readFDsOut));
-	memcpy(&writeFDsOut, &_writeFDSet, sizeof(writeFDsOut));
 
 	struct timeval tv;
 	tv.tv_sec = 0;
 	tv.tv_usec = 0;
-	const int ready = select(FD_SETSIZE, &readFDsOut, &writeFDsOut, nullptr, &tv);
+	const int ready = select(FD_SETSIZE, &readFDsOut, nullptr, nullptr, &tv);
 	if (ready < 0) {
 		return;
 	}
-	if (_socketFD != INVALID_SOCKET && FD_ISSET(_socketFD, &readFDsOut)) {
-		const SOCKET clientSocket = accept(_socketFD, nullptr, nullptr);
-		if (clientSocket != INVALID_SOCKET) {
-			FD_SET(clientSocket, &_readFDSet);
-			const Client c(clientSocket);
-			_clientSockets.push_back(c);
-			for (INetworkListener* listener : _listeners) {
-				listener->onConnect(&_clientSockets.back());
-			}
+	// the clients that are accepted now are not part of the result set
+	const size_t knownClients = _clientSockets.size();
+	if (FD_ISSET(_socketFD, &readFDsOut)) {
+		acceptClients();
+	}
+	size_t n = 0u;
+	for (ClientSocketsIter i = _clientSockets.begin(); i != _clientSockets.end() && n < knownClients; ++i, ++n) {
+		if (FD_ISSET(i->socket, &readFDsOut) && !readClient(*i)) {
+			i->finished = true;
 		}
 	}
+#endif
 
-	ClientId clientId = 0;
-	for (ClientSocketsIter i = _clientSockets.begin(); i != _clientSockets.end(); ++clientId) {
+	ProtocolMessageFactory& factory = ProtocolMessageFactory::get();
+	ProtocolHandlerRegistry& registry = ProtocolHandlerRegistry::get();
+	for (ClientSocketsIter i = _clientSockets.begin(); i != _clientSockets.end();) {
 		Client& client = *i;
-		const SOCKET clientSocket = client.socket;
-		if (clientSocket == INVALID_SOCKET) {
+		if (client.socket == INVALID_SOCKET) {
 			i = closeClient(i);
 			continue;
 		}
 
-		if (FD_ISSET(clientSocket, &writeFDsOut)) {
-			if (!sendMessage(client) || client.finished) {
-				i = closeClient(i);
-				continue;
-			}
-		}
-
-		if (FD_ISSET(clientSocket, &readFDsOut)) {
-			std::array<uint8_t, 16384> buf;
-			const network_return len = recv(clientSocket, (char*)&buf[0], buf.size(), 0);
-			if (len < 0) {
-				i = closeClient(i);
-				continue;
-			}
-			std::copy_n(buf.begin(), len, std::back_inserter(client.in));
-		}
-
-		ProtocolMessageFactory& factory = ProtocolMessageFactory::get();
-		if (factory.isNewMessageAvailable(client.in)) {
+		bool valid = true;
+		while (factory.isNewMessageAvailable(client.in)) {
 			IProtocolMessage* msg = factory.create(client.in);
 			if (!msg) {
-				i = closeClient(i);
-				continue;
+				valid = false;
+				break;
 			}
-			IProtocolHandler* handler = ProtocolHandlerRegistry::get().getHandler(*msg);
+			IProtocolHandler* handler = registry.getHandler(*msg);
 			if (handler) {
-				handler->execute(clientId, *msg);
+				handler->execute(client.id, *msg);
 			}
 		}
+
+		if (!valid || !sendMessage(client) || client.finished) {
+			i = closeClient(i);
+			continue;
+		}
 		++i;
 	}
 }
 
+inline void Network::frame(streamContainer& out, const IProtocolMessage& msg) {
+	streamContainer data;
+	msg.serialize(data);
+	IProtocolMessage::addInt(out, static_cast<int32_t>(data.size()));
+	out.insert(out.end(), data.begin(), data.end());
+}
+
 inline bool Network::broadcast(const IProtocolMessage& msg) {
 	if (_clientSockets.empty()) {
 		return false;
 	}
 	_time = 0L;
 	streamContainer out;
-	msg.serialize(out);
-	for (ClientSocketsIter i = _clientSockets.begin(); i != _clientSockets.end(); ++i) {
-		Client& client = *i;
+	frame(out, msg);
+	for (Client& client : _clientSockets) {
 		if (client.socket == INVALID_SOCKET) {
-			i = closeClient(i);
 			continue;
 		}
-
-		IProtocolMessage::addInt(client.out, static_cast<int32_t>(out.size()));
-		std::copy(out.begin(), out.end(), std::back_inserter(client.out));
-		FD_SET(client.socket, &_writeFDSet);
+		client.out.append(out);
 	}
 
 	return true;
@@ -256,15 +359,22 @@ inline bool Network::sendToClient(Client* client, const IProtocolMessage& msg) {
 	}
 
 	streamContainer out;
-	msg.serialize(out);
+	frame(out, msg);
+	client->out.append(out);
+	return true;
+}
 
-	IProtocolMessage::addInt(client->out, static_cast<int32_t>(out.size()));
-	std::copy(out.begin(), out.end(), std::back_inserter(client->out));
-	FD_SET(client->socket, &_writeFDSet);
+inline bool Network::sendToClient(ClientId clientId, const uint8_t* data, size_t size) {
+	Client* client = findClient(clientId);
+	if (client == nullptr || client->socket == INVALID_SOCKET) {
+		return false;
+	}
+	client->out.append(data, size);
 	return true;
 }
 
 #undef network_cleanup
+#undef network_wouldblock
 #undef INVALID_SOCKET
 #ifndef WIN32
 #undef closesocket
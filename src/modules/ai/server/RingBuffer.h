@@ -0,0 +1,122 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "IProtocolMessage.h"
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+namespace ai {
+
+/**
+ * @brief Growing byte ring buffer for the outgoing data of a debug client.
+ *
+ * Sent bytes are consumed from the front without moving the remaining data. The pending data is
+ * available as up to two contiguous spans - which can be handed over to a scatter/gather send.
+ */
+class RingBuffer {
+private:
+	std::vector<uint8_t> _buffer;
+	size_t _head = 0u;
+	size_t _size = 0u;
+
+	// the capacity is always a power of two
+	inline size_t mask() const {
+		return _buffer.size() - 1u;
+	}
+
+	void reserve(size_t size) {
+		if (size <= _buffer.size()) {
+			return;
+		}
+		size_t capacity = std::max(_buffer.size(), size_t(1024u));
+		while (capacity < size) {
+			capacity <<= 1;
+		}
+		std::vector<uint8_t> buffer(capacity);
+		const uint8_t* data[2];
+		size_t len[2];
+		const int n = spans(data, len);
+		size_t offset = 0u;
+		for (int i = 0; i < n; ++i) {
+			memcpy(&buffer[offset], data[i], len[i]);
+			offset += len[i];
+		}
+		_buffer.swap(buffer);
+		_head = 0u;
+	}
+
+	template<class Iter>
+	void write(Iter begin, size_t len) {
+		reserve(_size + len);
+		const size_t tail = (_head + _size) & mask();
+		const size_t first = std::min(len, _buffer.size() - tail);
+		Iter i = begin;
+		std::copy_n(i, first, _buffer.begin() + tail);
+		std::advance(i, first);
+		std::copy_n(i, len - first, _buffer.begin());
+		_size += len;
+	}
+
+public:
+	inline size_t size() const {
+		return _size;
+	}
+
+	inline bool empty() const {
+		return _size == 0u;
+	}
+
+	inline size_t capacity() const {
+		return _buffer.size();
+	}
+
+	void append(const uint8_t* data, size_t len) {
+		write(data, len);
+	}
+
+	void append(const streamContainer& data) {
+		write(data.begin(), data.size());
+	}
+
+	/**
+	 * @brief Get the pending data
+	 * @return The amount of filled spans - @c 0 if the buffer is empty
+	 */
+	int spans(const uint8_t* data[2], size_t len[2]) const {
+		if (_size == 0u) {
+			return 0;
+		}
+		const size_t first = std::min(_size, _buffer.size() - _head);
+		data[0] = &_buffer[_head];
+		len[0] = first;
+		if (first == _size) {
+			return 1;
+		}
+		data[1] = &_buffer[0];
+		len[1] = _size - first;
+		return 2;
+	}
+
+	/**
+	 * @brief Removes the given amount of bytes from the front - e.g. after they were sent.
+	 */
+	void consume(size_t len) {
+		len = std::min(len, _size);
+		_size -= len;
+		if (_size == 0u) {
+			_head = 0u;
+			return;
+		}
+		_head = (_head + len) & mask();
+	}
+
+	void clear() {
+		_head = 0u;
+		_size = 0u;
+	}
+};
+
+}
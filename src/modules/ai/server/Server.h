@@ -6,10 +6,12 @@
 #include "common/Thread.h"
 #include "tree/TreeNode.h"
 #include <unordered_set>
+#include <unordered_map>
 #include "Network.h"
 #include "zone/Zone.h"
 #include "AIRegistry.h"
 #include "AIStateMessage.h"
+#include "StateSerializer.h"
 #include "AINamesMessage.h"
 #include "AIStubTypes.h"
 #include "AICharacterDetailsMessage.h"
@@ -32,6 +34,7 @@ class ChangeHandler;
 class AddNodeHandler;
 class DeleteNodeHandler;
 class UpdateNodeHandler;
+class ViewportHandler;
 class NopHandler;
 
 /**
@@ -45,6 +48,11 @@ class NopHandler;
  * clients. If someone selected a particular @ai{AI} instance by sending @ai{AISelectMessage} to the server, it
  * will also broadcast an @ai{AICharacterDetailsMessage} to all connected clients.
  *
+ * The world state is only captured as a snapshot in @c update(). The @ai{StateSerializer} turns it into the
+ * messages for the clients on a background thread: a client gets the full state once and
+ * @ai{AIStateDeltaMessage}s with the changed entities afterwards. Entities outside of the viewport that a
+ * client announced with @ai{AIViewportMessage} are only updated every few snapshots.
+ *
  * You can only debug one @ai{Zone} at the same time. The debugging session is shared between all connected clients.
  */
 class Server: public INetworkListener {
@@ -65,6 +73,7 @@ protected:
 	AddNodeHandler *_addNodeHandler;
 	DeleteNodeHandler *_deleteNodeHandler;
 	UpdateNodeHandler *_updateNodeHandler;
+	ViewportHandler *_viewportHandler;
 	NopHandler _nopHandler;
 	std::atomic_bool _pause;
 	// the current active debugging zone
@@ -73,6 +82,17 @@ protected:
 	std::vector<std::string> _names;
 	uint32_t _broadcastMask = 0u;
 
+	// the attributes are only copied into the snapshot if their revision changed
+	struct SnapshotAttributes {
+		uint32_t revision;
+		uint32_t seen;
+		std::shared_ptr<const CharacterAttributes> attributes;
+	};
+	std::unordered_map<CharacterId, SnapshotAttributes> _snapshotAttributes;
+	uint32_t _snapshotSequence = 0u;
+	StateSerializer _serializer;
+	std::vector<StateSerializer::Output> _serializedStates;
+
 	enum EventType {
 		EV_SELECTION,
 		EV_STEP,
@@ -204,6 +224,12 @@ public:
 	 */
 	void pause(const ClientId& clientId, bool pause);
 
+	/**
+	 * @brief The area of the world (x and z axis) the given client is looking at. Entities outside of this
+	 * area are updated less often for this client.
+	 */
+	void setViewport(const ClientId& clientId, const glm::vec2& mins, const glm::vec2& maxs);
+
 	/**
 	 * @brief Performs one step of the @ai{AI} in pause mode
 	 */
@@ -12,6 +12,7 @@
 #include "AddNodeHandler.h"
 #include "DeleteNodeHandler.h"
 #include "UpdateNodeHandler.h"
+#include "ViewportHandler.h"
 
 namespace ai {
 
@@ -24,7 +25,7 @@ inline Server::Server(AIRegistry& aiRegistry, short port, const std::string& hos
 		_aiRegistry(aiRegistry), _network(port, hostname), _selectedCharacterId(AI_NOTHING_SELECTED), _time(0L),
 		_selectHandler(new SelectHandler(*this)), _pauseHandler(new PauseHandler(*this)), _resetHandler(new ResetHandler(*this)),
 		_stepHandler(new StepHandler(*this)), _changeHandler(new ChangeHandler(*this)), _addNodeHandler(new AddNodeHandler(*this)),
-		_deleteNodeHandler(new DeleteNodeHandler(*this)), _updateNodeHandler(new UpdateNodeHandler(*this)), _pause(false), _zone(nullptr) {
+		_deleteNodeHandler(new DeleteNodeHandler(*this)), _updateNodeHandler(new UpdateNodeHandler(*this)), _viewportHandler(new ViewportHandler(*this)), _pause(false), _zone(nullptr) {
 	_network.addListener(this);
 	ProtocolHandlerRegistry& r = ai::ProtocolHandlerRegistry::get();
 	r.registerHandler(ai::PROTO_SELECT, _selectHandler);
@@ -36,9 +37,11 @@ inline Server::Server(AIRegistry& aiRegistry, short port, const std::string& hos
 	r.registerHandler(ai::PROTO_ADDNODE, _addNodeHandler);
 	r.registerHandler(ai::PROTO_DELETENODE, _deleteNodeHandler);
 	r.registerHandler(ai::PROTO_UPDATENODE, _updateNodeHandler);
+	r.registerHandler(ai::PROTO_VIEWPORT, _viewportHandler);
 }
 
 inline Server::~Server() {
+	_serializer.stop();
 	delete _selectHandler;
 	delete _pauseHandler;
 	delete _resetHandler;
@@ -47,6 +50,7 @@ inline Server::~Server() {
 	delete _addNodeHandler;
 	delete _deleteNodeHandler;
 	delete _updateNodeHandler;
+	delete _viewportHandler;
 	_network.removeListener(this);
 }
 
@@ -60,9 +64,11 @@ inline void Server::onConnect(Client* client) {
 	event.type = EV_NEWCONNECTION;
 	event.data.newClient = client;
 	enqueueEvent(event);
+	_serializer.addClient(client->id);
 }
 
-inline void Server::onDisconnect(Client* /*client*/) {
+inline void Server::onDisconnect(Client* client) {
+	_serializer.removeClient(client->id);
 	ai_log("remote debugger disconnect (%i)", _network.getConnectedClients());
 	Zone* zone = _zone;
 	if (zone == nullptr) {
@@ -88,7 +94,11 @@ inline void Server::onDisconnect(Client* /*client*/) {
 }
 
 inline bool Server::start() {
-	return _network.start();
+	if (!_network.start()) {
+		return false;
+	}
+	_serializer.start();
+	return true;
 }
 
 inline void Server::addChildren(const TreeNodePtr& node, std::vector<AIStateNodeStatic>& out) const {
@@ -120,14 +130,32 @@ inline void Server::addChildren(const TreeNodePtr& node, AIStateNode& parent, co
 
 inline void Server::broadcastState(const Zone* zone) {
 	_broadcastMask |= SV_BROADCAST_STATE;
-	AIStateMessage msg;
+	const uint32_t sequence = ++_snapshotSequence;
+	std::shared_ptr<AIStateSnapshot> snapshot = std::make_shared<AIStateSnapshot>();
+	snapshot->reserve(_snapshotAttributes.size());
 	auto func = [&] (const AIPtr& ai) {
 		const ICharacterPtr& chr = ai->getCharacter();
-		const AIStateWorld b(chr->getId(), chr->getPosition(), chr->getOrientation(), chr->getAttributes());
-		msg.addState(b);
+		const CharacterId id = chr->getId();
+		const uint32_t revision = chr->getAttributesRevision();
+		auto i = _snapshotAttributes.find(id);
+		if (i == _snapshotAttributes.end()) {
+			i = _snapshotAttributes.emplace(id, SnapshotAttributes{revision, sequence, std::make_shared<const CharacterAttributes>(chr->getAttributes())}).first;
+		} else if (i->second.revision != revision) {
+			i->second.revision = revision;
+			i->second.attributes = std::make_shared<const CharacterAttributes>(chr->getAttributes());
+		}
+		i->second.seen = sequence;
+		snapshot->push_back(AIStateSnapshotEntry{id, chr->getPosition(), chr->getOrientation(), revision, i->second.attributes});
 	};
 	zone->execute(func);
-	_network.broadcast(msg);
+	for (auto i = _snapshotAttributes.begin(); i != _snapshotAttributes.end();) {
+		if (i->second.seen != sequence) {
+			i = _snapshotAttributes.erase(i);
+		} else {
+			++i;
+		}
+	}
+	_serializer.submit(snapshot);
 }
 
 inline void Server::broadcastStaticCharacterDetails(const Zone* zone) {
@@ -218,10 +246,10 @@ inline void Server::handleEvents(Zone* zone, bool pauseState) {
 					return;
 				ai->setPause(false);
 				ai->update(queuedStepMillis, true);
-				ai->getBehaviour()->execute(ai, queuedStepMillis);
+				CompiledTree::execute(ai, queuedStepMillis);
 				ai->setPause(true);
 			};
-			zone->executeParallel(func);
+			zone->executeParallelTick(func, queuedStepMillis);
 			broadcastState(zone);
 			broadcastCharacterDetails(zone);
 			break;
@@ -291,6 +319,8 @@ inline void Server::handleEvents(Zone* zone, bool pauseState) {
 			Zone* nullzone = nullptr;
 			_zone = nullzone;
 			resetSelection();
+			// the clients need the complete state of the new zone
+			_serializer.resetClients();
 
 			for (Zone* z : _zones) {
 				const bool debug = z->getName() == event.strData;
@@ -468,6 +498,10 @@ inline void Server::pause(const ClientId& /*clientId*/, bool state) {
 	enqueueEvent(event);
 }
 
+inline void Server::setViewport(const ClientId& clientId, const glm::vec2& mins, const glm::vec2& maxs) {
+	_serializer.setViewport(clientId, mins, maxs);
+}
+
 inline void Server::step(int64_t stepMillis) {
 	Event event;
 	event.type = EV_STEP;
@@ -497,6 +531,12 @@ inline void Server::update(int64_t deltaTime) {
 		pause(1, false);
 		resetSelection();
 	}
+	if (_serializer.collect(_serializedStates)) {
+		for (const StateSerializer::Output& output : _serializedStates) {
+			_network.sendToClient(output.clientId, output.data.data(), output.data.size());
+		}
+		_serializedStates.clear();
+	}
 	_network.update(deltaTime);
 }
 
@@ -0,0 +1,350 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "AIStateMessage.h"
+#include "AIStateDeltaMessage.h"
+#include "IProtocolHandler.h"
+#include "common/Math.h"
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace ai {
+
+/**
+ * @brief The state of one @ai{ICharacter} at the time the snapshot was taken
+ *
+ * The attributes are shared between the snapshots as long as their revision doesn't change.
+ */
+struct AIStateSnapshotEntry {
+	CharacterId id;
+	glm::vec3 position;
+	float orientation;
+	uint32_t attributesRevision;
+	std::shared_ptr<const CharacterAttributes> attributes;
+};
+
+typedef std::vector<AIStateSnapshotEntry> AIStateSnapshot;
+typedef std::shared_ptr<const AIStateSnapshot> AIStateSnapshotPtr;
+
+/**
+ * @brief Serializes the world state snapshots of the debug server for each connected client.
+ *
+ * A client gets the full state (@c AIStateMessage) after it was added (or @c resetClients() was called) and
+ * only the changes since the last transferred state (@c AIStateDeltaMessage) afterwards. Entities outside of
+ * the viewport of a client are only transferred every @c OutsideViewportInterval snapshots.
+ *
+ * The serialization happens on a background thread once @c start() was called. If the thread can't keep
+ * up, only the most recent snapshot is serialized. The game thread submits the snapshots and collects the
+ * framed messages - they are ready to be queued for the client.
+ */
+class StateSerializer {
+public:
+	/**
+	 * @brief Outside of the viewport, only every n-th snapshot is transferred to the client
+	 */
+	static constexpr uint32_t OutsideViewportInterval = 10u;
+
+	struct Output {
+		ClientId clientId;
+		std::vector<uint8_t> data;
+	};
+private:
+	struct SentState {
+		glm::vec3 position;
+		float orientation;
+		uint32_t attributesRevision;
+		uint32_t sequence;
+		uint32_t seen;
+	};
+
+	struct ClientState {
+		bool full = true;
+		bool viewport = false;
+		glm::vec2 mins;
+		glm::vec2 maxs;
+		std::unordered_map<CharacterId, SentState> sent;
+	};
+
+	struct Command {
+		enum class Type : uint8_t {
+			Add, Remove, Reset, Viewport
+		};
+		Type type;
+		ClientId clientId;
+		glm::vec2 mins;
+		glm::vec2 maxs;
+	};
+
+	// only touched by the thread that serializes
+	std::unordered_map<ClientId, ClientState> _clients;
+	uint32_t _sequence = 0u;
+
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::vector<Command> _commands;
+	AIStateSnapshotPtr _pending;
+	std::vector<Output> _outputs;
+	bool _stop = false;
+	std::thread _thread;
+
+	void queueCommand(const Command& cmd);
+	void applyCommands(std::vector<Command>& commands);
+	void serializeClient(const AIStateSnapshot& snapshot, ClientState& client, streamContainer& out);
+	static void frame(const IProtocolMessage& msg, streamContainer& out);
+	void run();
+public:
+	StateSerializer() {
+	}
+
+	~StateSerializer() {
+		stop();
+	}
+
+	/**
+	 * @brief Starts the background thread
+	 */
+	void start();
+	void stop();
+
+	void addClient(ClientId clientId);
+	void removeClient(ClientId clientId);
+	/**
+	 * @brief The next snapshot is transferred completely to all clients - e.g. after the debugged zone changed
+	 */
+	void resetClients();
+	/**
+	 * @brief Set the area the client is interested in (x and z axis). If @c mins is bigger
+	 * than @c maxs, the whole world is treated as visible.
+	 */
+	void setViewport(ClientId clientId, const glm::vec2& mins, const glm::vec2& maxs);
+
+	/**
+	 * @brief Hands the snapshot over to the background thread. A snapshot that wasn't
+	 * serialized yet is replaced.
+	 */
+	void submit(const AIStateSnapshotPtr& snapshot);
+
+	/**
+	 * @brief Get the serialized messages
+	 * @return @c false if there was nothing to collect
+	 */
+	bool collect(std::vector<Output>& outputs);
+
+	/**
+	 * @brief Serializes the given snapshot for all clients on the calling thread. This is what the
+	 * background thread is doing for the submitted snapshots.
+	 * @note Must not be called while the background thread is running
+	 */
+	void serialize(const AIStateSnapshot& snapshot, std::vector<Output>& outputs);
+};
+
+inline void StateSerializer::start() {
+	if (_thread.joinable()) {
+		return;
+	}
+	_stop = false;
+	_thread = std::thread(&StateSerializer::run, this);
+}
+
+inline void StateSerializer::stop() {
+	if (!_thread.joinable()) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_condition.notify_one();
+	_thread.join();
+}
+
+inline void StateSerializer::queueCommand(const Command& cmd) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_commands.push_back(cmd);
+}
+
+inline void StateSerializer::addClient(ClientId clientId) {
+	queueCommand(Command{Command::Type::Add, clientId, glm::vec2(), glm::vec2()});
+}
+
+inline void StateSerializer::removeClient(ClientId clientId) {
+	queueCommand(Command{Command::Type::Remove, clientId, glm::vec2(), glm::vec2()});
+}
+
+inline void StateSerializer::resetClients() {
+	queueCommand(Command{Command::Type::Reset, 0u, glm::vec2(), glm::vec2()});
+}
+
+inline void StateSerializer::setViewport(ClientId clientId, const glm::vec2& mins, const glm::vec2& maxs) {
+	queueCommand(Command{Command::Type::Viewport, clientId, mins, maxs});
+}
+
+inline void StateSerializer::submit(const AIStateSnapshotPtr& snapshot) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_pending = snapshot;
+	}
+	_condition.notify_one();
+}
+
+inline bool StateSerializer::collect(std::vector<Output>& outputs) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_outputs.empty()) {
+		return false;
+	}
+	if (outputs.empty()) {
+		outputs.swap(_outputs);
+	} else {
+		std::move(_outputs.begin(), _outputs.end(), std::back_inserter(outputs));
+		_outputs.clear();
+	}
+	return true;
+}
+
+inline void StateSerializer::applyCommands(std::vector<Command>& commands) {
+	for (const Command& cmd : commands) {
+		switch (cmd.type) {
+		case Command::Type::Add:
+			_clients[cmd.clientId] = ClientState();
+			break;
+		case Command::Type::Remove:
+			_clients.erase(cmd.clientId);
+			break;
+		case Command::Type::Reset:
+			for (auto& e : _clients) {
+				e.second.full = true;
+				e.second.sent.clear();
+			}
+			break;
+		case Command::Type::Viewport: {
+			auto i = _clients.find(cmd.clientId);
+			if (i == _clients.end()) {
+				break;
+			}
+			ClientState& client = i->second;
+			client.viewport = cmd.mins.x <= cmd.maxs.x && cmd.mins.y <= cmd.maxs.y;
+			client.mins = cmd.mins;
+			client.maxs = cmd.maxs;
+			break;
+		}
+		}
+	}
+	commands.clear();
+}
+
+inline void StateSerializer::frame(const IProtocolMessage& msg, streamContainer& out) {
+	streamContainer data;
+	msg.serialize(data);
+	IProtocolMessage::addInt(out, static_cast<int32_t>(data.size()));
+	out.insert(out.end(), data.begin(), data.end());
+}
+
+inline void StateSerializer::serializeClient(const AIStateSnapshot& snapshot, ClientState& client, streamContainer& out) {
+	if (client.full) {
+		client.full = false;
+		client.sent.clear();
+		AIStateMessage msg;
+		for (const AIStateSnapshotEntry& e : snapshot) {
+			msg.addState(AIStateWorld(e.id, e.position, e.orientation, *e.attributes));
+			client.sent[e.id] = SentState{e.position, e.orientation, e.attributesRevision, _sequence, _sequence};
+		}
+		frame(msg, out);
+		return;
+	}
+
+	AIStateDeltaMessage msg;
+	for (const AIStateSnapshotEntry& e : snapshot) {
+		auto i = client.sent.find(e.id);
+		if (i == client.sent.end()) {
+			msg.addState(AIStateWorld(e.id, e.position, e.orientation, *e.attributes), true);
+			client.sent.emplace(e.id, SentState{e.position, e.orientation, e.attributesRevision, _sequence, _sequence});
+			continue;
+		}
+		SentState& sent = i->second;
+		sent.seen = _sequence;
+		if (client.viewport && _sequence - sent.sequence < OutsideViewportInterval) {
+			const bool visible = e.position.x >= client.mins.x && e.position.x <= client.maxs.x
+					&& e.position.z >= client.mins.y && e.position.z <= client.maxs.y;
+			if (!visible) {
+				continue;
+			}
+		}
+		const bool attributes = sent.attributesRevision != e.attributesRevision;
+		if (!attributes && sent.position == e.position && sent.orientation == e.orientation) {
+			continue;
+		}
+		if (attributes) {
+			msg.addState(AIStateWorld(e.id, e.position, e.orientation, *e.attributes), true);
+		} else {
+			msg.addState(AIStateWorld(e.id, e.position, e.orientation), false);
+		}
+		sent.position = e.position;
+		sent.orientation = e.orientation;
+		sent.attributesRevision = e.attributesRevision;
+		sent.sequence = _sequence;
+	}
+	for (auto i = client.sent.begin(); i != client.sent.end();) {
+		if (i->second.seen == _sequence) {
+			++i;
+			continue;
+		}
+		msg.addRemoved(i->first);
+		i = client.sent.erase(i);
+	}
+	if (msg.empty()) {
+		return;
+	}
+	frame(msg, out);
+}
+
+inline void StateSerializer::serialize(const AIStateSnapshot& snapshot, std::vector<Output>& outputs) {
+	std::vector<Command> commands;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		commands.swap(_commands);
+	}
+	applyCommands(commands);
+	++_sequence;
+	streamContainer out;
+	for (auto& e : _clients) {
+		serializeClient(snapshot, e.second, out);
+		if (out.empty()) {
+			continue;
+		}
+		outputs.push_back(Output{e.first, std::vector<uint8_t>(out.begin(), out.end())});
+		out.clear();
+	}
+}
+
+inline void StateSerializer::run() {
+	std::vector<Output> outputs;
+	for (;;) {
+		AIStateSnapshotPtr snapshot;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_condition.wait(lock, [this] () {
+				return _stop || _pending;
+			});
+			if (_stop) {
+				return;
+			}
+			snapshot = std::move(_pending);
+			_pending.reset();
+		}
+		serialize(*snapshot, outputs);
+		if (outputs.empty()) {
+			continue;
+		}
+		std::lock_guard<std::mutex> lock(_mutex);
+		std::move(outputs.begin(), outputs.end(), std::back_inserter(_outputs));
+		outputs.clear();
+	}
+}
+
+}
@@ -0,0 +1,27 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "IProtocolHandler.h"
+#include "AIViewportMessage.h"
+#include "Server.h"
+
+namespace ai {
+
+class Server;
+
+class ViewportHandler: public ai::IProtocolHandler {
+private:
+	Server& _server;
+public:
+	explicit ViewportHandler(Server& server) : _server(server) {
+	}
+
+	void execute(const ClientId& clientId, const IProtocolMessage& message) override {
+		const AIViewportMessage& msg = static_cast<const AIViewportMessage&>(message);
+		_server.setViewport(clientId, msg.getMins(), msg.getMaxs());
+	}
+};
+
+}
@@ -1,4 +1,6 @@
 #include "AggroTest.h"
+#include <map>
+#include <algorithm>
 
 class AggroTest: public TestSuite {
 public:
@@ -73,3 +75,54 @@ TEST_F(AggroTest, testAggroMgrDegradeValue) {
 	const float newAggro = entry->getAggro();
 	ASSERT_FLOAT_EQ(expected, newAggro);
 }
+
+TEST_F(AggroTest, testAggroMgrHighestEntry) {
+	ai::AggroMgr mgr;
+	std::map<ai::CharacterId, float> expected;
+	for (int i = 0; i < 1000; ++i) {
+		const ai::CharacterId id = ai::random(1, 100);
+		const float amount = ai::randomf(10.0f) - 2.0f;
+		mgr.addAggro(id, amount);
+		expected[id] += amount;
+		auto highest = std::max_element(expected.begin(), expected.end(), [] (const std::pair<const ai::CharacterId, float>& a, const std::pair<const ai::CharacterId, float>& b) {
+			return a.second < b.second;
+		});
+		const ai::EntryPtr entry = mgr.getHighestEntry();
+		ASSERT_TRUE(entry != nullptr);
+		ASSERT_FLOAT_EQ(highest->second, entry->getAggro()) << printAggroList(mgr);
+	}
+	ASSERT_EQ(expected.size(), mgr.getEntries().size());
+}
+
+TEST_F(AggroTest, testAggroMgrMaxEntries) {
+	ai::AggroMgr mgr;
+	mgr.setMaxEntries(3);
+	ASSERT_NE(nullptr, mgr.addAggro(1, 1.0f));
+	ASSERT_NE(nullptr, mgr.addAggro(2, 2.0f));
+	ASSERT_NE(nullptr, mgr.addAggro(3, 3.0f));
+	ASSERT_EQ(nullptr, mgr.addAggro(4, 0.5f)) << "Lower aggro than all tracked entries shouldn't be added";
+	ASSERT_EQ(3u, mgr.getEntries().size());
+	ASSERT_NE(nullptr, mgr.addAggro(5, 5.0f));
+	ASSERT_EQ(3u, mgr.getEntries().size());
+	for (const ai::Entry& e : mgr.getEntries()) {
+		ASSERT_NE(1, e.getCharacterId()) << "The entry with the lowest aggro should have been replaced";
+	}
+	ASSERT_EQ(5, mgr.getHighestEntry()->getCharacterId());
+	ASSERT_NE(nullptr, mgr.addAggro(2, 10.0f)) << "Existing entries can always be updated";
+	ASSERT_EQ(2, mgr.getHighestEntry()->getCharacterId());
+	mgr.setMaxEntries(1);
+	ASSERT_EQ(1u, mgr.getEntries().size());
+	ASSERT_EQ(2, mgr.getHighestEntry()->getCharacterId());
+}
+
+TEST_F(AggroTest, testAggroMgrDegradeOrder) {
+	ai::AggroMgr mgr;
+	mgr.addAggro(1, 10.0f)->setReduceByValue(1.0f);
+	mgr.addAggro(2, 8.0f);
+	mgr.addAggro(3, 0.5f)->setReduceByValue(1.0f);
+	ASSERT_EQ(1, mgr.getHighestEntry()->getCharacterId());
+	mgr.update(3000);
+	ASSERT_EQ(2u, mgr.getEntries().size()) << "The entry without aggro should have been removed";
+	ASSERT_EQ(2, mgr.getHighestEntry()->getCharacterId()) << printAggroList(mgr);
+	ASSERT_FLOAT_EQ(7.0f, mgr.addAggro(1, 0.0f)->getAggro());
+}
@@ -192,3 +192,54 @@ TEST_F(GroupTest, testGroupRemove) {
 	ASSERT_TRUE(groupMgr.remove(id, entity3));
 	ASSERT_EQ(0, groupMgr.getGroupSize(id));
 }
+
+TEST_F(GroupTest, testGroupRemoveFromAllGroups) {
+	ai::GroupMgr groupMgr;
+	ai::AIPtr entity1(new ai::AI(ai::TreeNodePtr()));
+	entity1->setCharacter(ai::ICharacterPtr(new ai::ICharacter(1)));
+	ai::AIPtr entity2(new ai::AI(ai::TreeNodePtr()));
+	entity2->setCharacter(ai::ICharacterPtr(new ai::ICharacter(2)));
+	for (ai::GroupId id = 1; id <= 3; ++id) {
+		ASSERT_TRUE(groupMgr.add(id, entity1));
+		ASSERT_TRUE(groupMgr.add(id, entity2));
+	}
+	ASSERT_FALSE(groupMgr.add(2, entity2));
+	ASSERT_TRUE(groupMgr.removeFromAllGroups(entity1));
+	ASSERT_FALSE(groupMgr.isInAnyGroup(entity1));
+	for (ai::GroupId id = 1; id <= 3; ++id) {
+		ASSERT_EQ(1, groupMgr.getGroupSize(id));
+		ASSERT_TRUE(groupMgr.isInGroup(id, entity2));
+		ASSERT_TRUE(groupMgr.isGroupLeader(id, entity2));
+	}
+}
+
+TEST_F(GroupTest, testGroupFrozen) {
+	const ai::GroupId id = 1;
+	ai::GroupMgr groupMgr;
+	ai::AIPtr entity1(new ai::AI(ai::TreeNodePtr()));
+	entity1->setCharacter(ai::ICharacterPtr(new ai::ICharacter(1)));
+	entity1->getCharacter()->setPosition(glm::vec3(1.0f, 1.0f, 0.0f));
+	ai::AIPtr entity2(new ai::AI(ai::TreeNodePtr()));
+	entity2->setCharacter(ai::ICharacterPtr(new ai::ICharacter(2)));
+	entity2->getCharacter()->setPosition(glm::vec3(3.0f, 3.0f, 0.0f));
+	ASSERT_TRUE(groupMgr.add(id, entity1));
+	groupMgr.update(0);
+
+	groupMgr.freeze();
+	ASSERT_TRUE(groupMgr.add(id, entity2));
+	ASSERT_TRUE(groupMgr.remove(id, entity1));
+	ASSERT_FALSE(groupMgr.remove(id, entity2)) << "entity2 is not yet part of the group";
+	ASSERT_EQ(1, groupMgr.getGroupSize(id)) << "Changes should be queued while the group manager is frozen";
+	ASSERT_TRUE(groupMgr.isGroupLeader(id, entity1));
+	ASSERT_FALSE(groupMgr.isInGroup(id, entity2));
+
+	groupMgr.update(0);
+	ASSERT_EQ(1, groupMgr.getGroupSize(id));
+	ASSERT_TRUE(groupMgr.isInGroup(id, entity2));
+	ASSERT_FALSE(groupMgr.isInGroup(id, entity1));
+	ASSERT_TRUE(groupMgr.isGroupLeader(id, entity2));
+	ASSERT_EQ(glm::vec3(3.0f, 3.0f, 0.0f), groupMgr.getPosition(id));
+
+	ASSERT_TRUE(groupMgr.remove(id, entity2));
+	ASSERT_EQ(0, groupMgr.getGroupSize(id));
+}
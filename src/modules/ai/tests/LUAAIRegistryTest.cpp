@@ -3,6 +3,8 @@
 #include <fstream>
 #include <streambuf>
 #include <unistd.h>
+#include <thread>
+#include <atomic>
 
 class LUAAIRegistryTest: public TestSuite {
 protected:
@@ -100,6 +102,38 @@ protected:
 		lua_gc(_registry.getLuaState(), LUA_GCCOLLECT, 0);
 		ASSERT_EQ(1, ai.use_count()) << "Someone is still referencing the AI instance";
 	}
+
+	/**
+	 * Executes the given node and condition on several threads at the same time - every
+	 * thread operates on its own lua state.
+	 */
+	void testParallel(const char* nodeName, const char* conditionName, int threads, int n) {
+		const ai::TreeNodeFactoryContext ctx = ai::TreeNodeFactoryContext("TreeNodeName", "", ai::True::get());
+		const ai::TreeNodePtr& node = _registry.createNode(nodeName, ctx);
+		ASSERT_TRUE((bool)node) << "Could not create lua provided node '" << nodeName << "'";
+		const ai::ConditionPtr& condition = _registry.createCondition(conditionName, ctxCondition);
+		ASSERT_TRUE((bool)condition) << "Could not create lua provided condition '" << conditionName << "'";
+		std::atomic_int failures(0);
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; ++t) {
+			workers.emplace_back([&, t] () {
+				const ai::AIPtr& ai = std::make_shared<ai::AI>(node);
+				ai->setCharacter(std::make_shared<TestEntity>(_id + 1 + t));
+				for (int i = 0; i < n; ++i) {
+					if (!condition->evaluate(ai)) {
+						++failures;
+					}
+					if (node->execute(ai, 1L) != ai::TreeNodeStatus::RUNNING) {
+						++failures;
+					}
+				}
+			});
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		ASSERT_EQ(0, failures.load()) << "Some of the parallel lua executions failed";
+	}
 };
 
 std::string LUAAIRegistryTest::_luaCode;
@@ -145,3 +179,18 @@ TEST_F(LUAAIRegistryTest, testFilter_100) {
 TEST_F(LUAAIRegistryTest, testSteeringEmpty) {
 	testSteering("LuaSteeringTest");
 }
+
+TEST_F(LUAAIRegistryTest, testParallelExecution) {
+	testParallel("LuaTest2", "LuaTestTrue", 4, 100);
+}
+
+TEST_F(LUAAIRegistryTest, testParallelExecutionLateScript) {
+	testParallel("LuaTest2", "LuaTestTrue", 4, 10);
+	const char* script = ""
+		"local late = REGISTRY.createCondition(\"LuaTestLate\")\n"
+		"function late:evaluate(ai)\n"
+		"  return true\n"
+		"end\n";
+	ASSERT_TRUE(_registry.evaluate(script, strlen(script)));
+	testParallel("LuaTest2", "LuaTestLate", 4, 10);
+}
@@ -112,3 +112,37 @@ TEST_F(MessageTest, testIProtocolMessageReset) {
 	ai::IProtocolMessage* d = serializeDeserialize(m);
 	ASSERT_EQ(m.getId(), d->getId());
 }
+
+TEST_F(MessageTest, testAIStateDeltaMessage) {
+	ai::CharacterAttributes attributes;
+	attributes.insert(std::make_pair<std::string, std::string>("Name", "Test"));
+
+	ai::AIStateDeltaMessage m;
+	ASSERT_TRUE(m.empty());
+	m.addState(ai::AIStateWorld(1, glm::vec3(1.0f, 2.0f, 3.0f), 1.0f, attributes), true);
+	m.addState(ai::AIStateWorld(2, ai::ZERO, 2.0f, attributes), false);
+	m.addRemoved(3);
+	ASSERT_FALSE(m.empty());
+
+	ai::AIStateDeltaMessage* d = serializeDeserialize(m);
+	ASSERT_EQ(m.getId(), d->getId());
+	ASSERT_EQ(2u, d->getStates().size());
+	ASSERT_EQ(1, d->getStates()[0].getId());
+	ASSERT_EQ(glm::vec3(1.0f, 2.0f, 3.0f), d->getStates()[0].getPosition());
+	ASSERT_TRUE(d->hasAttributes(0));
+	ASSERT_EQ("Test", d->getStates()[0].getAttributes().find("Name")->second);
+	ASSERT_EQ(2, d->getStates()[1].getId());
+	ASSERT_FLOAT_EQ(2.0f, d->getStates()[1].getOrientation());
+	ASSERT_FALSE(d->hasAttributes(1));
+	ASSERT_TRUE(d->getStates()[1].getAttributes().empty());
+	ASSERT_EQ(1u, d->getRemoved().size());
+	ASSERT_EQ(3, d->getRemoved()[0]);
+}
+
+TEST_F(MessageTest, testAIViewportMessage) {
+	const ai::AIViewportMessage m(glm::vec2(-1.0f, -2.0f), glm::vec2(3.0f, 4.0f));
+	ai::AIViewportMessage* d = serializeDeserialize(m);
+	ASSERT_EQ(m.getId(), d->getId());
+	ASSERT_EQ(glm::vec2(-1.0f, -2.0f), d->getMins());
+	ASSERT_EQ(glm::vec2(3.0f, 4.0f), d->getMaxs());
+}
@@ -1,6 +1,39 @@
 #include "NodeTest.h"
 
 class NodeTest: public TestSuite {
+protected:
+	ai::TreeNodePtr create(const ai::ITreeNodeFactory& factory, const char* name, const char* parameters,
+			std::vector<ai::TreeNodePtr>& nodes, const ai::ConditionPtr& condition = ai::True::get()) {
+		ai::TreeNodeFactoryContext ctx(name, parameters, condition);
+		const ai::TreeNodePtr& node = factory.create(&ctx);
+		nodes.push_back(node);
+		return node;
+	}
+
+	/**
+	 * @brief Creates a behaviour tree that is using most of the composite and decorator nodes
+	 * @param[out] nodes All the nodes of the tree in creation order
+	 */
+	ai::TreeNodePtr createTree(std::vector<ai::TreeNodePtr>& nodes) {
+		ai::Idle::Factory idle;
+		const ai::TreeNodePtr& root = create(ai::PrioritySelector::Factory(), "root", "", nodes);
+		const ai::TreeNodePtr& limit = create(ai::Limit::Factory(), "limit", "2", nodes);
+		const ai::TreeNodePtr& sequence = create(ai::Sequence::Factory(), "sequence", "", nodes);
+		sequence->addChild(create(idle, "idle1", "2", nodes));
+		sequence->addChild(create(idle, "idle2", "3", nodes));
+		limit->addChild(sequence);
+		root->addChild(limit);
+		const ai::TreeNodePtr& parallel = create(ai::Parallel::Factory(), "parallel", "", nodes);
+		parallel->addChild(create(idle, "idle3", "4", nodes));
+		const ai::TreeNodePtr& invert = create(ai::Invert::Factory(), "invert", "", nodes);
+		invert->addChild(create(idle, "idle4", "1", nodes));
+		parallel->addChild(invert);
+		root->addChild(parallel);
+		const ai::TreeNodePtr& succeed = create(ai::Succeed::Factory(), "succeed", "", nodes);
+		succeed->addChild(create(idle, "idle5", "2", nodes, ai::False::get()));
+		root->addChild(succeed);
+		return root;
+	}
 };
 
 TEST_F(NodeTest, testSequence) {
@@ -149,3 +182,120 @@ TEST_F(NodeTest, testPrioritySelectorWithCondition) {
 	ASSERT_EQ(ai::CANNOTEXECUTE, idle1->getLastStatus(e));
 	ASSERT_EQ(ai::FINISHED, idle2->getLastStatus(e));
 }
+
+TEST_F(NodeTest, testCompiledSequence) {
+	std::vector<ai::TreeNodePtr> nodes;
+	ai::Idle::Factory idleFac;
+	const ai::TreeNodePtr& node = create(ai::Sequence::Factory(), "testsequence", "", nodes);
+	const ai::TreeNodePtr& idle1 = create(idleFac, "testidle", "2", nodes);
+	const ai::TreeNodePtr& idle2 = create(idleFac, "testidle2", "2", nodes);
+	node->addChild(idle1);
+	node->addChild(idle2);
+
+	ai::AIPtr ai(new ai::AI(node));
+	ai::ICharacterPtr chr(new ai::ICharacter(1));
+	ai->setCharacter(chr);
+	const ai::TreeNodeStatus expected[][2] = {
+		{ai::RUNNING, ai::UNKNOWN},
+		{ai::RUNNING, ai::UNKNOWN},
+		{ai::FINISHED, ai::RUNNING},
+		{ai::FINISHED, ai::RUNNING},
+		{ai::FINISHED, ai::FINISHED},
+		{ai::RUNNING, ai::FINISHED}
+	};
+	for (const auto& e : expected) {
+		ai->update(1, true);
+		ai::CompiledTree::execute(ai, 1);
+		ASSERT_EQ(e[0], idle1->getLastStatus(ai));
+		ASSERT_EQ(e[1], idle2->getLastStatus(ai));
+	}
+}
+
+TEST_F(NodeTest, testCompiledTreeMatchesTreeNodes) {
+	std::vector<ai::TreeNodePtr> nodesA;
+	std::vector<ai::TreeNodePtr> nodesB;
+	ai::AIPtr a(new ai::AI(createTree(nodesA)));
+	a->setCharacter(std::make_shared<ai::ICharacter>(1));
+	ai::AIPtr b(new ai::AI(createTree(nodesB)));
+	b->setCharacter(std::make_shared<ai::ICharacter>(2));
+	ASSERT_EQ(nodesA.size(), nodesB.size());
+	for (int tick = 0; tick < 40; ++tick) {
+		a->update(1, true);
+		const ai::TreeNodeStatus statusA = a->getBehaviour()->execute(a, 1);
+		b->update(1, true);
+		const ai::TreeNodeStatus statusB = ai::CompiledTree::execute(b, 1);
+		ASSERT_EQ(statusA, statusB) << "tick " << tick;
+		for (size_t i = 0; i < nodesA.size(); ++i) {
+			ASSERT_EQ(nodesA[i]->getLastStatus(a), nodesB[i]->getLastStatus(b))
+				<< "tick " << tick << " node " << nodesA[i]->getName();
+		}
+	}
+}
+
+TEST_F(NodeTest, testCompiledProbabilitySelectorWithFewerWeights) {
+	// the first selector has no weights at all - it must not pick up the weights of the second one
+	auto createSelectors = [this] (std::vector<ai::TreeNodePtr>& nodes) {
+		ai::Idle::Factory idle;
+		const ai::TreeNodePtr& root = create(ai::Parallel::Factory(), "root", "", nodes);
+		const ai::TreeNodePtr& unweighted = create(ai::ProbabilitySelector::Factory(), "unweighted", "", nodes);
+		const ai::TreeNodePtr& weighted = create(ai::ProbabilitySelector::Factory(), "weighted", "0,0,1", nodes);
+		for (const ai::TreeNodePtr& selector : {unweighted, weighted}) {
+			for (const char* name : {"idle1", "idle2", "idle3"}) {
+				selector->addChild(create(idle, name, "10", nodes));
+			}
+			root->addChild(selector);
+		}
+		return root;
+	};
+	std::vector<ai::TreeNodePtr> nodesA;
+	std::vector<ai::TreeNodePtr> nodesB;
+	ai::AIPtr a(new ai::AI(createSelectors(nodesA)));
+	a->setCharacter(std::make_shared<ai::ICharacter>(1));
+	ai::AIPtr b(new ai::AI(createSelectors(nodesB)));
+	b->setCharacter(std::make_shared<ai::ICharacter>(2));
+	ASSERT_EQ(nodesA.size(), nodesB.size());
+	for (int tick = 0; tick < 3; ++tick) {
+		a->update(1, true);
+		a->getBehaviour()->execute(a, 1);
+		b->update(1, true);
+		ai::CompiledTree::execute(b, 1);
+		for (size_t i = 0; i < nodesA.size(); ++i) {
+			ASSERT_EQ(nodesA[i]->getLastStatus(a), nodesB[i]->getLastStatus(b))
+				<< "tick " << tick << " node " << nodesA[i]->getName() << " (" << i << ")";
+		}
+	}
+	// root, both selectors and the children of the unweighted and then of the weighted selector
+	ASSERT_EQ(9u, nodesB.size());
+	EXPECT_EQ(ai::RUNNING, nodesB[3]->getLastStatus(b)) << "The selector without weights should pick its first child";
+	EXPECT_EQ(ai::RUNNING, nodesB[8]->getLastStatus(b)) << "The weighted selector should pick its last child";
+}
+
+TEST_F(NodeTest, testCompiledTreeRecompile) {
+	std::vector<ai::TreeNodePtr> nodes;
+	ai::Idle::Factory idleFac;
+	const ai::TreeNodePtr& node = create(ai::Sequence::Factory(), "testsequence", "", nodes);
+	const ai::TreeNodePtr& idle1 = create(idleFac, "testidle", "1", nodes);
+	const ai::TreeNodePtr& idle2 = create(idleFac, "testidle2", "5", nodes);
+	node->addChild(idle1);
+	node->addChild(idle2);
+
+	ai::AIPtr ai(new ai::AI(node));
+	ai->setCharacter(std::make_shared<ai::ICharacter>(1));
+	ai->update(1, true);
+	ai::CompiledTree::execute(ai, 1);
+	ai->update(1, true);
+	ai::CompiledTree::execute(ai, 1);
+	ASSERT_EQ(ai::RUNNING, idle2->getLastStatus(ai));
+	const ai::CompiledTreePtr& compiled = ai::CompiledTree::get(node);
+	ASSERT_EQ(3u, compiled->size());
+	ASSERT_EQ(compiled, ai::CompiledTree::get(node)) << "The compiled tree should be cached";
+
+	const ai::TreeNodePtr& idle3 = create(idleFac, "testidle3", "1", nodes);
+	node->addChild(idle3);
+	ASSERT_FALSE(compiled->isValid());
+	ai->update(1, true);
+	ai::CompiledTree::execute(ai, 1);
+	ASSERT_EQ(4u, ai::CompiledTree::get(node)->size());
+	ASSERT_EQ(ai::RUNNING, idle2->getLastStatus(ai)) << "The sequence state should survive the recompilation";
+	ASSERT_EQ(ai::UNKNOWN, idle3->getLastStatus(ai));
+}
@@ -0,0 +1,156 @@
+#include "ServerTest.h"
+
+class ServerTest: public TestSuite {
+protected:
+	ai::AIStateSnapshotEntry entry(ai::CharacterId id, const glm::vec3& position, uint32_t revision = 0u) const {
+		std::shared_ptr<ai::CharacterAttributes> attributes = std::make_shared<ai::CharacterAttributes>();
+		attributes->insert(std::make_pair(std::string("Revision"), std::to_string(revision)));
+		return ai::AIStateSnapshotEntry{id, position, 0.0f, revision, attributes};
+	}
+
+	ai::IProtocolMessage* deserialize(const ai::StateSerializer::Output& output) const {
+		ai::streamContainer stream(output.data.begin(), output.data.end());
+		ai::ProtocolMessageFactory& f = ai::ProtocolMessageFactory::get();
+		if (!f.isNewMessageAvailable(stream)) {
+			return nullptr;
+		}
+		return f.create(stream);
+	}
+};
+
+TEST_F(ServerTest, testRingBuffer) {
+	ai::RingBuffer buffer;
+	ASSERT_TRUE(buffer.empty());
+	std::vector<uint8_t> data(1000);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = (uint8_t)i;
+	}
+	buffer.append(data.data(), data.size());
+	ASSERT_EQ(1000u, buffer.size());
+	const size_t capacity = buffer.capacity();
+	buffer.consume(900u);
+	// wraps around the end of the buffer without growing
+	buffer.append(data.data(), 500u);
+	ASSERT_EQ(600u, buffer.size());
+	ASSERT_EQ(capacity, buffer.capacity());
+
+	const uint8_t* spans[2];
+	size_t len[2];
+	ASSERT_EQ(2, buffer.spans(spans, len));
+	ASSERT_EQ(600u, len[0] + len[1]);
+	ASSERT_EQ((uint8_t)900, spans[0][0]);
+	ASSERT_EQ((uint8_t)499, spans[1][len[1] - 1u]);
+
+	// growing keeps the order of the pending data
+	std::vector<uint8_t> big(capacity, 1u);
+	buffer.append(big.data(), big.size());
+	ASSERT_EQ(600u + capacity, buffer.size());
+	ASSERT_EQ(1, buffer.spans(spans, len));
+	ASSERT_EQ((uint8_t)900, spans[0][0]);
+	ASSERT_EQ((uint8_t)999, spans[0][99]);
+	ASSERT_EQ((uint8_t)0, spans[0][100]);
+	ASSERT_EQ((uint8_t)1, spans[0][600]);
+	buffer.consume(buffer.size());
+	ASSERT_TRUE(buffer.empty());
+	ASSERT_EQ(0, buffer.spans(spans, len));
+}
+
+TEST_F(ServerTest, testStateSerializerDelta) {
+	ai::StateSerializer serializer;
+	serializer.addClient(1);
+	std::vector<ai::StateSerializer::Output> outputs;
+
+	ai::AIStateSnapshot snapshot;
+	snapshot.push_back(entry(1, glm::vec3(1.0f)));
+	snapshot.push_back(entry(2, glm::vec3(2.0f)));
+	serializer.serialize(snapshot, outputs);
+	ASSERT_EQ(1u, outputs.size());
+	ai::IProtocolMessage* msg = deserialize(outputs[0]);
+	ASSERT_NE(nullptr, msg);
+	ASSERT_EQ(ai::PROTO_STATE, msg->getId()) << "The first state should be complete";
+	ASSERT_EQ(2u, static_cast<ai::AIStateMessage*>(msg)->getStates().size());
+
+	outputs.clear();
+	serializer.serialize(snapshot, outputs);
+	ASSERT_TRUE(outputs.empty()) << "Nothing changed - nothing should be sent";
+
+	snapshot[0].position = glm::vec3(10.0f);
+	snapshot[1] = entry(2, glm::vec3(2.0f), 1u);
+	snapshot.push_back(entry(3, glm::vec3(3.0f)));
+	serializer.serialize(snapshot, outputs);
+	ASSERT_EQ(1u, outputs.size());
+	msg = deserialize(outputs[0]);
+	ASSERT_NE(nullptr, msg);
+	ASSERT_EQ(ai::PROTO_STATE_DELTA, msg->getId());
+	ai::AIStateDeltaMessage* delta = static_cast<ai::AIStateDeltaMessage*>(msg);
+	ASSERT_EQ(3u, delta->getStates().size());
+	ASSERT_EQ(glm::vec3(10.0f), delta->getStates()[0].getPosition());
+	ASSERT_FALSE(delta->hasAttributes(0));
+	ASSERT_TRUE(delta->hasAttributes(1));
+	ASSERT_EQ("1", delta->getStates()[1].getAttributes().find("Revision")->second);
+	ASSERT_TRUE(delta->hasAttributes(2)) << "New entities are transferred with their attributes";
+	ASSERT_TRUE(delta->getRemoved().empty());
+
+	outputs.clear();
+	snapshot.erase(snapshot.begin());
+	serializer.serialize(snapshot, outputs);
+	ASSERT_EQ(1u, outputs.size());
+	delta = static_cast<ai::AIStateDeltaMessage*>(deserialize(outputs[0]));
+	ASSERT_TRUE(delta->getStates().empty());
+	ASSERT_EQ(1u, delta->getRemoved().size());
+	ASSERT_EQ(1, delta->getRemoved()[0]);
+
+	outputs.clear();
+	serializer.resetClients();
+	serializer.serialize(snapshot, outputs);
+	ASSERT_EQ(1u, outputs.size());
+	ASSERT_EQ(ai::PROTO_STATE, deserialize(outputs[0])->getId());
+}
+
+TEST_F(ServerTest, testStateSerializerViewport) {
+	ai::StateSerializer serializer;
+	serializer.addClient(1);
+	serializer.setViewport(1, glm::vec2(0.0f), glm::vec2(10.0f));
+	std::vector<ai::StateSerializer::Output> outputs;
+
+	ai::AIStateSnapshot snapshot;
+	snapshot.push_back(entry(1, glm::vec3(1.0f)));
+	snapshot.push_back(entry(2, glm::vec3(100.0f)));
+	serializer.serialize(snapshot, outputs);
+	ASSERT_EQ(ai::PROTO_STATE, deserialize(outputs[0])->getId());
+
+	int outsideUpdates = 0;
+	for (uint32_t i = 0u; i < ai::StateSerializer::OutsideViewportInterval; ++i) {
+		outputs.clear();
+		snapshot[0].position.x += 0.1f;
+		snapshot[1].position.x += 1.0f;
+		serializer.serialize(snapshot, outputs);
+		ASSERT_EQ(1u, outputs.size());
+		const ai::AIStateDeltaMessage* delta = static_cast<ai::AIStateDeltaMessage*>(deserialize(outputs[0]));
+		ASSERT_EQ(1, delta->getStates()[0].getId()) << "Entities in the viewport should be updated every time";
+		if (delta->getStates().size() == 2u) {
+			++outsideUpdates;
+		}
+	}
+	ASSERT_EQ(1, outsideUpdates) << "Entities outside of the viewport should be throttled";
+}
+
+TEST_F(ServerTest, testStateSerializerThread) {
+	ai::StateSerializer serializer;
+	serializer.addClient(1);
+	serializer.addClient(2);
+	serializer.start();
+	std::shared_ptr<ai::AIStateSnapshot> snapshot = std::make_shared<ai::AIStateSnapshot>();
+	snapshot->push_back(entry(1, glm::vec3(1.0f)));
+	serializer.submit(snapshot);
+	std::vector<ai::StateSerializer::Output> outputs;
+	for (int i = 0; i < 1000 && outputs.size() < 2u; ++i) {
+		serializer.collect(outputs);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	serializer.stop();
+	ASSERT_EQ(2u, outputs.size());
+	for (const ai::StateSerializer::Output& output : outputs) {
+		ASSERT_EQ(ai::PROTO_STATE, deserialize(output)->getId());
+	}
+}
@@ -42,3 +42,103 @@ TEST_F(ZoneTest, testMassAdd1000000) {
 	zone.update(0l);
 	ASSERT_EQ(n, (int)zone.size());
 }
+
+TEST_F(ZoneTest, testExecuteParallel) {
+	const int threads = 4;
+	ai::Zone zone("test1", threads);
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	const int n = 1000;
+	for (int i = 0; i < n; ++i) {
+		ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		ASSERT_TRUE(zone.addAI(ai)) << "Could not add ai to the zone";
+	}
+	zone.update(0l);
+	ASSERT_EQ(n, (int)zone.size());
+
+	std::vector<std::atomic_int> executions(n);
+	for (auto& e : executions) {
+		e = 0;
+	}
+	std::mutex threadIdsMutex;
+	std::condition_variable threadIdsChanged;
+	std::unordered_set<std::thread::id> threadIds;
+	auto func = [&] (const ai::AIPtr& ai) {
+		++executions[ai->getId()];
+		std::unique_lock<std::mutex> lock(threadIdsMutex);
+		if (threadIds.insert(std::this_thread::get_id()).second) {
+			threadIdsChanged.notify_all();
+		}
+		// the first batches are waiting for a second worker - otherwise one worker might be fast
+		// enough to pick up all of them
+		threadIdsChanged.wait_for(lock, std::chrono::seconds(5), [&] () {
+			return threadIds.size() > 1u;
+		});
+	};
+	zone.executeParallel(func);
+	for (int i = 0; i < n; ++i) {
+		ASSERT_EQ(1, executions[i]) << "AI " << i << " was not executed exactly once";
+	}
+	ASSERT_GT((int)threadIds.size(), 1) << "The batches were not executed in parallel";
+	ASSERT_LE((int)threadIds.size(), threads);
+
+	for (int i = 0; i < n; i += 2) {
+		zone.destroyAI(i);
+	}
+	zone.update(0l);
+	ASSERT_EQ(n / 2, (int)zone.size());
+	int executed = 0;
+	zone.execute([&] (const ai::AIPtr& ai) {
+		ASSERT_EQ(1, ai->getId() % 2) << "Destroyed AI " << ai->getId() << " is still updated";
+		++executed;
+	});
+	ASSERT_EQ(n / 2, executed);
+}
+
+TEST_F(ZoneTest, testParallelAttacks) {
+	const int threads = 4;
+	ai::Zone zone("test1", threads);
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	const int n = 1000;
+	for (int i = 0; i < n; ++i) {
+		ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		ASSERT_TRUE(zone.addAI(ai)) << "Could not add ai to the zone";
+	}
+	zone.update(0l);
+
+	// every instance attacks the first one and its neighbour - the aggro of the attacked instances is
+	// only modified after the parallel phase
+	const std::thread::id updateThread = std::this_thread::get_id();
+	std::atomic_int wrongThread(0);
+	auto attack = [&] (ai::CharacterId attacker, ai::CharacterId target) {
+		zone.executeDeferred(target, [&, attacker] (const ai::AIPtr& targetAi) {
+			if (std::this_thread::get_id() != updateThread) {
+				++wrongThread;
+			}
+			targetAi->getAggroMgr().addAggro(attacker, 1.0f);
+		});
+	};
+	auto func = [&] (const ai::AIPtr& ai) {
+		const ai::CharacterId id = ai->getId();
+		if (id != 0) {
+			attack(id, 0);
+		}
+		attack(id, (id + 1) % n);
+	};
+	for (int tick = 0; tick < 2; ++tick) {
+		zone.executeParallelTick(func, 1l);
+	}
+	ASSERT_EQ(0, wrongThread.load()) << "The attacks were not applied by the updating thread";
+	const ai::AIPtr& first = zone.getAI(0);
+	ASSERT_EQ((size_t)n - 1u, first->getAggroMgr().getEntries().size());
+	// the first instance got attacked once per tick by everybody and twice by its predecessor
+	EXPECT_FLOAT_EQ(4.0f, first->getAggroMgr().getHighestEntry()->getAggro());
+	for (int i = 1; i < n; ++i) {
+		const ai::AIPtr& ai = zone.getAI(i);
+		ASSERT_EQ(1u, ai->getAggroMgr().getEntries().size()) << "AI " << i;
+		EXPECT_FLOAT_EQ(2.0f, ai->getAggroMgr().getEntries().front().getAggro()) << "AI " << i;
+	}
+}
@@ -0,0 +1,426 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "tree/TreeNode.h"
+#include "tree/TreeNodeImpl.h"
+#include "tree/Limit.h"
+#include "tree/ProbabilitySelector.h"
+#include "common/Random.h"
+#include "AI.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace ai {
+
+/**
+ * @brief The node types that are interpreted by the @c CompiledTree. Every other node is executed
+ * by calling its virtual @c TreeNode::execute() method.
+ */
+enum class CompiledNodeType : uint8_t {
+	Leaf,
+	Selector,
+	Sequence,
+	Parallel,
+	PrioritySelector,
+	ProbabilitySelector,
+	RandomSelector,
+	Limit,
+	Invert,
+	Fail,
+	Succeed
+};
+
+/**
+ * @brief A behaviour tree that is flattened into a contiguous node array.
+ *
+ * The nodes are stored in breadth first order - thus the children of each node are stored next to
+ * each other. The composite and decorator nodes of the library are interpreted here with exactly the
+ * same semantics as their @c TreeNode::execute() implementations, but they store the selector and
+ * limit states in a dense per @c AI buffer (indexed by the node index) instead of the hash maps of the
+ * @c AI. All the other nodes (tasks, timed nodes, lua nodes, ...) are treated as leaves and executed
+ * via their virtual @c TreeNode::execute() - this includes their children.
+ *
+ * The compiled trees are immutable and shared by all the @c AI instances that use the same behaviour
+ * tree root. Structural modifications (see @c TreeNode::addChild() and @c TreeNode::replaceChild())
+ * bump a global revision which leads to a recompilation on the next execution. The states of the nodes
+ * that survived the modification are taken over.
+ *
+ * @note The node types are detected by the type name - a derived class with its own type name (like
+ * all the classes that are using the @c SELECTOR_CLASS macro) is always executed as a leaf.
+ */
+class CompiledTree {
+private:
+	struct CompiledNode {
+		TreeNode* node;
+		CompiledNodeType type;
+		uint32_t firstChild;
+		uint32_t childCount;
+		// Limit: the amount of allowed executions - ProbabilitySelector: the offset in the weights
+		int32_t param;
+		// ProbabilitySelector: the amount of own weights - might differ from the amount of children
+		uint32_t weightCount;
+		float weightSum;
+	};
+
+	std::vector<CompiledNode> _nodes;
+	std::vector<float> _weights;
+	// keeps the raw pointers of the compiled nodes valid
+	TreeNodes _references;
+	// node id to node index - only used to map the states for the TreeNode api and for recompilation
+	std::unordered_map<int, int> _slots;
+	uint32_t _revision = 0u;
+
+	static CompiledNodeType compiledType(const TreeNode& node) {
+		static const struct {
+			const char* type;
+			CompiledNodeType compiledType;
+		} types[] = {
+			{"Selector", CompiledNodeType::Selector},
+			{"Sequence", CompiledNodeType::Sequence},
+			{"Parallel", CompiledNodeType::Parallel},
+			{"PrioritySelector", CompiledNodeType::PrioritySelector},
+			{"ProbabilitySelector", CompiledNodeType::ProbabilitySelector},
+			{"RandomSelector", CompiledNodeType::RandomSelector},
+			{"Limit", CompiledNodeType::Limit},
+			{"Invert", CompiledNodeType::Invert},
+			{"Fail", CompiledNodeType::Fail},
+			{"Succeed", CompiledNodeType::Succeed}
+		};
+		for (const auto& t : types) {
+			if (node.getType() == t.type) {
+				return t.compiledType;
+			}
+		}
+		return CompiledNodeType::Leaf;
+	}
+
+	static int initialState(const CompiledNode& node) {
+		return node.type == CompiledNodeType::Limit ? 0 : AI_NOTHING_SELECTED;
+	}
+
+	static std::mutex& compileMutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	explicit CompiledTree(const TreeNodePtr& root) :
+			_revision(TreeNode::getRevision()) {
+		_references.push_back(root);
+		// breadth first - the children of a node end up next to each other
+		for (size_t i = 0; i < _references.size(); ++i) {
+			// copy - the vector grows while iterating
+			const TreeNodePtr treeNode = _references[i];
+			CompiledNode node;
+			node.node = treeNode.get();
+			node.type = compiledType(*treeNode);
+			node.firstChild = 0u;
+			node.childCount = 0u;
+			node.param = 0;
+			node.weightCount = 0u;
+			node.weightSum = 0.0f;
+			if (node.type == CompiledNodeType::Limit) {
+				node.param = static_cast<const Limit*>(node.node)->getAmount();
+			} else if (node.type == CompiledNodeType::ProbabilitySelector) {
+				const ProbabilitySelector* selector = static_cast<const ProbabilitySelector*>(node.node);
+				node.param = static_cast<int32_t>(_weights.size());
+				node.weightCount = static_cast<uint32_t>(selector->getWeights().size());
+				node.weightSum = selector->getWeightSum();
+				_weights.insert(_weights.end(), selector->getWeights().begin(), selector->getWeights().end());
+			}
+			if (node.type != CompiledNodeType::Leaf) {
+				const TreeNodes& children = treeNode->getChildren();
+				node.firstChild = static_cast<uint32_t>(_references.size());
+				node.childCount = static_cast<uint32_t>(children.size());
+				_references.insert(_references.end(), children.begin(), children.end());
+			}
+			_slots.emplace(treeNode->getId(), static_cast<int>(_nodes.size()));
+			_nodes.push_back(node);
+		}
+	}
+
+	inline const CompiledNode& child(const CompiledNode& node, uint32_t n) const {
+		return _nodes[node.firstChild + n];
+	}
+
+	inline int& nodeState(int* states, const CompiledNode& node) const {
+		return states[&node - &_nodes.front()];
+	}
+
+	void resetState(const AIPtr& entity, int* states, const CompiledNode& node) const {
+		if (node.type == CompiledNodeType::Leaf) {
+			node.node->resetState(entity);
+			return;
+		}
+		// only the Sequence resets its own selector state - see Sequence::resetState()
+		if (node.type == CompiledNodeType::Sequence) {
+			nodeState(states, node) = AI_NOTHING_SELECTED;
+		}
+		for (uint32_t i = 0u; i < node.childCount; ++i) {
+			resetState(entity, states, child(node, i));
+		}
+	}
+
+	TreeNodeStatus executeNode(const AIPtr& entity, int* states, const CompiledNode& node, int64_t deltaMillis) const {
+		if (node.type == CompiledNodeType::Leaf) {
+			return node.node->execute(entity, deltaMillis);
+		}
+		// the condition and the debug information - this is the same for every node type
+		if (node.node->TreeNode::execute(entity, deltaMillis) == CANNOTEXECUTE) {
+			return CANNOTEXECUTE;
+		}
+
+		switch (node.type) {
+		case CompiledNodeType::Sequence: {
+			TreeNodeStatus result = FINISHED;
+			const uint32_t progress = static_cast<uint32_t>(std::max(0, nodeState(states, node)));
+			for (uint32_t i = progress; i < node.childCount; ++i) {
+				result = executeNode(entity, states, child(node, i), deltaMillis);
+				if (result == RUNNING) {
+					nodeState(states, node) = static_cast<int>(i);
+					break;
+				} else if (result == CANNOTEXECUTE || result == FAILED) {
+					resetState(entity, states, node);
+					break;
+				} else if (result == EXCEPTION) {
+					break;
+				}
+			}
+			if (result != RUNNING) {
+				resetState(entity, states, node);
+			}
+			return node.node->state(entity, result);
+		}
+		case CompiledNodeType::Parallel: {
+			bool totalStatus = false;
+			for (uint32_t i = 0u; i < node.childCount; ++i) {
+				const CompiledNode& c = child(node, i);
+				const bool isActive = executeNode(entity, states, c, deltaMillis) == RUNNING;
+				if (!isActive) {
+					resetState(entity, states, c);
+				}
+				totalStatus |= isActive;
+			}
+			if (!totalStatus) {
+				resetState(entity, states, node);
+			}
+			return node.node->state(entity, totalStatus ? RUNNING : FINISHED);
+		}
+		case CompiledNodeType::PrioritySelector: {
+			int& selectorState = nodeState(states, node);
+			uint32_t i = selectorState == AI_NOTHING_SELECTED ? 0u : static_cast<uint32_t>(selectorState);
+			TreeNodeStatus overallResult = FINISHED;
+			for (uint32_t j = 0u; j < i; ++j) {
+				resetState(entity, states, child(node, j));
+			}
+			for (; i < node.childCount; ++i) {
+				const CompiledNode& c = child(node, i);
+				const TreeNodeStatus result = executeNode(entity, states, c, deltaMillis);
+				if (result == RUNNING) {
+					selectorState = static_cast<int>(i);
+				} else if (result == CANNOTEXECUTE || result == FAILED) {
+					resetState(entity, states, c);
+					selectorState = AI_NOTHING_SELECTED;
+					continue;
+				} else {
+					selectorState = AI_NOTHING_SELECTED;
+				}
+				resetState(entity, states, c);
+				overallResult = result;
+				break;
+			}
+			for (++i; i < node.childCount; ++i) {
+				resetState(entity, states, child(node, i));
+			}
+			return node.node->state(entity, overallResult);
+		}
+		case CompiledNodeType::ProbabilitySelector: {
+			if (node.childCount == 0u) {
+				return node.node->state(entity, FINISHED);
+			}
+			int& selectorState = nodeState(states, node);
+			int index = selectorState;
+			if (index == AI_NOTHING_SELECTED) {
+				float rndIndex = ai::randomf(node.weightSum);
+				const int weightAmount = static_cast<int>(std::min(node.childCount, node.weightCount));
+				for (index = 0; index < weightAmount - 1; ++index) {
+					const float weight = _weights[node.param + index];
+					if (rndIndex < weight) {
+						break;
+					}
+					rndIndex -= weight;
+				}
+			}
+			const CompiledNode& c = child(node, static_cast<uint32_t>(index));
+			const TreeNodeStatus result = executeNode(entity, states, c, deltaMillis);
+			selectorState = result == RUNNING ? index : AI_NOTHING_SELECTED;
+			for (uint32_t i = 0u; i < node.childCount; ++i) {
+				resetState(entity, states, child(node, i));
+			}
+			return node.node->state(entity, result);
+		}
+		case CompiledNodeType::RandomSelector: {
+			uint32_t stackOrder[16];
+			std::vector<uint32_t> heapOrder;
+			uint32_t* order = stackOrder;
+			if (node.childCount > 16u) {
+				heapOrder.resize(node.childCount);
+				order = &heapOrder.front();
+			}
+			for (uint32_t i = 0u; i < node.childCount; ++i) {
+				order[i] = i;
+			}
+			ai::shuffle(order, order + node.childCount);
+			TreeNodeStatus overallResult = FINISHED;
+			for (uint32_t i = 0u; i < node.childCount; ++i) {
+				const CompiledNode& c = child(node, order[i]);
+				const TreeNodeStatus result = executeNode(entity, states, c, deltaMillis);
+				if (result == RUNNING) {
+					continue;
+				} else if (result == CANNOTEXECUTE || result == FAILED) {
+					overallResult = result;
+				}
+				resetState(entity, states, c);
+			}
+			return node.node->state(entity, overallResult);
+		}
+		case CompiledNodeType::Limit: {
+			ai_assert(node.childCount == 1, "Limit must have exactly one node");
+			int& alreadyExecuted = nodeState(states, node);
+			if (alreadyExecuted >= node.param) {
+				return node.node->state(entity, FINISHED);
+			}
+			const TreeNodeStatus status = executeNode(entity, states, child(node, 0u), deltaMillis);
+			++alreadyExecuted;
+			return node.node->state(entity, status == RUNNING ? RUNNING : FAILED);
+		}
+		case CompiledNodeType::Invert: {
+			ai_assert(node.childCount == 1, "Invert must have exactly one child");
+			const TreeNodeStatus status = executeNode(entity, states, child(node, 0u), deltaMillis);
+			if (status == FINISHED) {
+				return node.node->state(entity, FAILED);
+			} else if (status == FAILED) {
+				return node.node->state(entity, FINISHED);
+			} else if (status == EXCEPTION) {
+				return node.node->state(entity, EXCEPTION);
+			} else if (status == CANNOTEXECUTE) {
+				return node.node->state(entity, FINISHED);
+			}
+			return node.node->state(entity, RUNNING);
+		}
+		case CompiledNodeType::Fail:
+		case CompiledNodeType::Succeed: {
+			ai_assert(node.childCount == 1, "Decorator must have exactly one child");
+			const TreeNodeStatus status = executeNode(entity, states, child(node, 0u), deltaMillis);
+			if (status == RUNNING) {
+				return node.node->state(entity, RUNNING);
+			}
+			return node.node->state(entity, node.type == CompiledNodeType::Fail ? FAILED : FINISHED);
+		}
+		case CompiledNodeType::Selector:
+		case CompiledNodeType::Leaf:
+			break;
+		}
+		// a plain Selector doesn't execute its children
+		return node.node->state(entity, FINISHED);
+	}
+
+public:
+	/**
+	 * @brief Returns the compiled version of the given behaviour tree. The compiled tree is cached
+	 * at the root node as long as any @c AI is using it.
+	 */
+	static std::shared_ptr<const CompiledTree> get(const TreeNodePtr& root) {
+		std::lock_guard<std::mutex> lock(compileMutex());
+		std::shared_ptr<const CompiledTree> compiled = root->_compiledTree.lock();
+		if (compiled && compiled->isValid()) {
+			return compiled;
+		}
+		compiled = std::shared_ptr<const CompiledTree>(new CompiledTree(root));
+		root->_compiledTree = compiled;
+		return compiled;
+	}
+
+	/**
+	 * @brief Executes the behaviour of the given @c AI instance by using the compiled version of it.
+	 * This is the replacement for calling @c TreeNode::execute() on the behaviour root.
+	 */
+	static TreeNodeStatus execute(const AIPtr& entity, int64_t deltaMillis) {
+		const TreeNodePtr& behaviour = entity->getBehaviour();
+		if (!behaviour) {
+			return UNKNOWN;
+		}
+		const std::shared_ptr<const CompiledTree>& current = entity->_compiledTree;
+		if (!current || current->root() != behaviour.get() || !current->isValid()) {
+			entity->bindCompiledTree(get(behaviour));
+		}
+		const CompiledTree& tree = *entity->_compiledTree;
+		return tree.executeNode(entity, &entity->_nodeStates.front(), tree._nodes.front(), deltaMillis);
+	}
+
+	inline const TreeNode* root() const {
+		return _nodes.front().node;
+	}
+
+	inline size_t size() const {
+		return _nodes.size();
+	}
+
+	/**
+	 * @return @c false if the behaviour tree was modified after it was compiled
+	 */
+	inline bool isValid() const {
+		return _revision == TreeNode::getRevision();
+	}
+
+	/**
+	 * @return The index of the node in the per @c AI state buffer or @c -1 if the node is not part
+	 * of the compiled tree
+	 */
+	inline int slot(int nodeId) const {
+		auto i = _slots.find(nodeId);
+		if (i == _slots.end()) {
+			return -1;
+		}
+		return i->second;
+	}
+
+	/**
+	 * @brief Fills the per @c AI state buffer with the initial states of the nodes
+	 * @param[in] previous The tree the states in the given buffer belong to. The states of the
+	 * nodes that are part of both trees are taken over.
+	 */
+	void initStates(std::vector<int>& states, const CompiledTree* previous) const {
+		std::vector<int> newStates(_nodes.size());
+		for (size_t i = 0; i < _nodes.size(); ++i) {
+			newStates[i] = initialState(_nodes[i]);
+			if (previous == nullptr) {
+				continue;
+			}
+			const int oldSlot = previous->slot(_nodes[i].node->getId());
+			if (oldSlot >= 0 && oldSlot < (int)states.size()) {
+				newStates[i] = states[oldSlot];
+			}
+		}
+		states.swap(newStates);
+	}
+};
+
+inline void AI::bindCompiledTree(const CompiledTreePtr& compiledTree) {
+	const CompiledTree* previous = _nodeStates.empty() ? nullptr : _compiledTree.get();
+	compiledTree->initStates(_nodeStates, previous);
+	_compiledTree = compiledTree;
+}
+
+inline int AI::nodeStateSlot(int nodeId) const {
+	if (!_compiledTree) {
+		return -1;
+	}
+	return _compiledTree->slot(nodeId);
+}
+
+}
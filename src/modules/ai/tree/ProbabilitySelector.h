@@ -24,13 +24,14 @@ protected:
 public:
 	ProbabilitySelector(const std::string& name, const std::string& parameters, const ConditionPtr& condition) :
 			Selector(name, parameters, condition), _weightSum(0.0f) {
+		_type = "ProbabilitySelector";
 		std::vector<std::string> tokens;
 		Str::splitString(parameters, tokens, ",");
 		const int weightAmount = static_cast<int>(tokens.size());
 		for (int i = 0; i < weightAmount; i++) {
 			const float weight = Str::strToFloat(tokens[i]);
 			_weightSum += weight;
-			_weights[i] = weight;
+			_weights.push_back(weight);
 		}
 	}
 
@@ -39,6 +40,14 @@ public:
 
 	NODE_FACTORY(ProbabilitySelector)
 
+	inline const std::vector<float>& getWeights() const {
+		return _weights;
+	}
+
+	inline float getWeightSum() const {
+		return _weightSum;
+	}
+
 	TreeNodeStatus execute(const AIPtr& entity, int64_t deltaMillis) override {
 		if (Selector::execute(entity, deltaMillis) == CANNOTEXECUTE)
 			return CANNOTEXECUTE;
@@ -46,8 +55,8 @@ public:
 		int index = getSelectorState(entity);
 		if (index == AI_NOTHING_SELECTED) {
 			float rndIndex = ai::randomf(_weightSum);
-			const int weightAmount = static_cast<int>(_weights.size());
-			for (; index < weightAmount; ++index) {
+			const int weightAmount = std::min(static_cast<int>(_weights.size()), static_cast<int>(_children.size()));
+			for (index = 0; index < weightAmount - 1; ++index) {
 				if (rndIndex < _weights[index])
 					break;
 				rndIndex -= _weights[index];
@@ -11,11 +11,13 @@
 #include <string>
 #include <memory>
 #include <algorithm>
+#include <atomic>
 
 namespace ai {
 
 class TreeNode;
 typedef std::shared_ptr<TreeNode> TreeNodePtr;
+class CompiledTree;
 typedef std::vector<TreeNodePtr> TreeNodes;
 
 /**
@@ -86,12 +88,17 @@ enum TreeNodeStatus {
  * to store your state!
  */
 class TreeNode : public MemObject {
+	friend class CompiledTree;
 protected:
 	static int getNextId() {
 		static int _nextId;
 		const int nextId = _nextId++;
 		return nextId;
 	}
+	static std::atomic_uint& revision() {
+		static std::atomic_uint _revision(0u);
+		return _revision;
+	}
 	/**
 	 * @brief Every node has an id to identify it. It's unique per type.
 	 */
@@ -101,6 +108,10 @@ protected:
 	std::string _type;
 	std::string _parameters;
 	ConditionPtr _condition;
+	/**
+	 * @brief Only set for root nodes that were compiled - shared by all the @c AI instances that use this tree
+	 */
+	mutable std::weak_ptr<const CompiledTree> _compiledTree;
 
 	TreeNodeStatus state(const AIPtr& entity, TreeNodeStatus treeNodeState);
 	int getSelectorState(const AIPtr& entity) const;
@@ -123,6 +134,13 @@ public:
 	}
 
 	virtual ~TreeNode() {}
+
+	/**
+	 * @brief Every structural change of any behaviour tree increases the revision. This invalidates
+	 * the @c CompiledTree instances.
+	 * @note Modifying the children via the non-const @c getChildren() isn't detected.
+	 */
+	static uint32_t getRevision();
 	/**
 	 * @brief Return the unique id for this node.
 	 * @return unique id
@@ -8,6 +8,10 @@
 
 namespace ai {
 
+inline uint32_t TreeNode::getRevision() {
+	return revision().load(std::memory_order_acquire);
+}
+
 inline int TreeNode::getId() const {
 	return _id;
 }
@@ -49,6 +53,7 @@ inline TreeNodes& TreeNode::getChildren() {
 
 inline bool TreeNode::addChild(const TreeNodePtr& child) {
 	_children.push_back(child);
+	++revision();
 	return true;
 }
 
@@ -73,6 +78,10 @@ inline void TreeNode::setLastExecMillis(const AIPtr& entity) {
 }
 
 inline int TreeNode::getSelectorState(const AIPtr& entity) const {
+	const int slot = entity->nodeStateSlot(getId());
+	if (slot >= 0) {
+		return entity->_nodeStates[slot];
+	}
 	AI::SelectorStates::const_iterator i = entity->_selectorStates.find(getId());
 	if (i == entity->_selectorStates.end()) {
 		return AI_NOTHING_SELECTED;
@@ -81,10 +90,19 @@ inline int TreeNode::getSelectorState(const AIPtr& entity) const {
 }
 
 inline void TreeNode::setSelectorState(const AIPtr& entity, int selected) {
+	const int slot = entity->nodeStateSlot(getId());
+	if (slot >= 0) {
+		entity->_nodeStates[slot] = selected;
+		return;
+	}
 	entity->_selectorStates[getId()] = selected;
 }
 
 inline int TreeNode::getLimitState(const AIPtr& entity) const {
+	const int slot = entity->nodeStateSlot(getId());
+	if (slot >= 0) {
+		return entity->_nodeStates[slot];
+	}
 	AI::LimitStates::const_iterator i = entity->_limitStates.find(getId());
 	if (i == entity->_limitStates.end()) {
 		return 0;
@@ -93,6 +111,11 @@ inline int TreeNode::getLimitState(const AIPtr& entity) const {
 }
 
 inline void TreeNode::setLimitState(const AIPtr& entity, int amount) {
+	const int slot = entity->nodeStateSlot(getId());
+	if (slot >= 0) {
+		entity->_nodeStates[slot] = amount;
+		return;
+	}
 	entity->_limitStates[getId()] = amount;
 }
 
@@ -145,6 +168,7 @@ inline bool TreeNode::replaceChild(int id, const TreeNodePtr& newNode) {
 		return false;
 	}
 
+	++revision();
 	if (newNode) {
 		*i = newNode;
 		return true;
@@ -191,3 +215,6 @@ inline TreeNodeStatus TreeNode::execute(const AIPtr& entity, int64_t /*deltaMill
 }
 
 }
+
+// the AI methods that are used above are defined here
+#include "tree/CompiledTree.h"
@@ -15,13 +15,18 @@
 
 #include "ICharacter.h"
 #include "group/GroupMgr.h"
+#include "tree/CompiledTree.h"
 #include "common/Thread.h"
 #include "common/ThreadPool.h"
 #include "common/Types.h"
 #include "common/ExecutionTime.h"
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include <functional>
 #include <memory>
+#include <atomic>
+#include <algorithm>
 
 namespace ai {
 
@@ -36,6 +41,24 @@ typedef std::shared_ptr<AI> AIPtr;
  *
  * Zones should have unique names - otherwise the @c Server won't be able to
  * select a particular @c Zone to debug it.
+ *
+ * The behaviour ticks of the @c AI instances are executed in parallel - the instances are split
+ * into contiguous batches that the workers of the thread pool (and the calling thread) are picking
+ * up one after another. While this parallel phase is running, the following rules apply to the
+ * code that is executed for an @c AI instance (behaviour tree nodes, filters, movements and the
+ * @c ICharacter::update() implementation):
+ * - Everything that belongs to the @c AI instance itself may be written: the @c AI, its
+ *   @c ICharacter and its @c AggroMgr. Each instance is only handled by one worker per phase.
+ * - Shared structures may only be modified through their synchronized interfaces: the
+ *   @c GroupMgr (frozen during the parallel phase - the changes are applied at the end of the
+ *   update), @c Zone::addAI(), @c Zone::removeAI() and @c Zone::destroyAI() (which are
+ *   applied in the next @c Zone::update()).
+ * - Other @c AI and @c ICharacter instances must not be modified directly. They may be read, but only
+ *   the atomic values (e.g. orientation and speed) are consistent - a position might be in the middle
+ *   of being updated by another worker. Everything that modifies another instance or state that is
+ *   shared by the instances (e.g. damage and aggro, the cooldowns of others or spawning) must be handed
+ *   to @c Zone::executeDeferred() - it is executed one after another once all batches are done.
+ * - @c Zone::executeAsync() is no synchronization - the functor runs concurrently to the batches.
  */
 class Zone {
 public:
@@ -44,10 +67,16 @@ public:
 	typedef std::vector<CharacterId> CharacterIdList;
 	typedef AIMap::const_iterator AIMapConstIter;
 	typedef AIMap::iterator AIMapIter;
+	typedef std::function<void()> DeferredFunc;
+	typedef std::vector<DeferredFunc> DeferredList;
 
 protected:
 	const std::string _name;
 	AIMap _ais;
+	// dense list of the zone members that is used to split the parallel updates into batches
+	// only modified in @c Zone::update() while holding the write lock
+	AIScheduleList _aiList;
+	std::unordered_set<const AI*> _removedFromList;
 	AIScheduleList _scheduledAdd;
 	AIScheduleList _scheduledRemove;
 	CharacterIdList _scheduledDestroy;
@@ -55,8 +84,47 @@ protected:
 	ReadWriteLock _lock {"zone"};
 	ReadWriteLock _scheduleLock {"zone-schedulelock"};
 	ai::GroupMgr _groupManager;
+	const size_t _threadCount;
 	mutable ThreadPool _threadPool;
 
+	/**
+	 * @brief The minimum amount of @c AI instances that are handled by one batch
+	 */
+	static constexpr size_t MinBatchSize = 32u;
+	/**
+	 * @brief Every worker should get a few batches to be able to balance different behaviour costs
+	 */
+	static constexpr size_t BatchesPerWorker = 4u;
+
+	/**
+	 * @brief The deferred functors of the batch worker the calling thread is executing - @c nullptr if the
+	 * calling thread isn't executing a batch
+	 */
+	static DeferredList*& currentDeferred() {
+		AI_THREAD_LOCAL DeferredList* deferred = nullptr;
+		return deferred;
+	}
+
+	/**
+	 * @brief Collects the deferred functors of the calling thread while it executes batches
+	 */
+	class ScopedDeferred {
+	private:
+		DeferredList*& _current;
+		DeferredList* const _previous;
+	public:
+		explicit ScopedDeferred(DeferredList& deferred) :
+				_current(currentDeferred()), _previous(_current) {
+			_current = &deferred;
+		}
+		~ScopedDeferred() {
+			_current = _previous;
+		}
+	};
+
+	template<typename Func>
+	void executeBatches(Func& func) const;
+
 	/**
 	 * @brief called in the zone update to add new @c AI instances.
 	 *
@@ -76,10 +144,18 @@ protected:
 	 * @note This doesn't lock the zone - but because @c Zone::update already does it
 	 */
 	bool doDestroyAI(const CharacterId& id);
+	/**
+	 * @brief Removes the instances that were removed or destroyed in this update from the dense list
+	 */
+	void compactList();
 
 public:
-	Zone(const std::string& name, int threadCount = std::min(1u, std::thread::hardware_concurrency())) :
-			_name(name), _debug(false), _threadPool(threadCount) {
+	/**
+	 * @param[in] threadCount The amount of threads that are executing the @c AI ticks in parallel - this includes
+	 * the thread that calls @c Zone::update()
+	 */
+	Zone(const std::string& name, int threadCount = std::max(1u, std::thread::hardware_concurrency())) :
+			_name(name), _debug(false), _threadCount(std::max(1, threadCount)), _threadPool(_threadCount) {
 	}
 
 	virtual ~Zone() {}
@@ -183,7 +259,8 @@ public:
 	 *
 	 * @return @c true if the func is going to get called for the character, @c false if not
 	 * e.g. in the case the given @c CharacterId wasn't found in this zone.
-	 * @note This is executed in a thread pool - so make sure to synchronize your lambda or functor.
+	 * @note This is executed in a thread pool - so make sure to synchronize your lambda or functor. Use
+	 * @c executeDeferred() to modify other characters from within the behaviour ticks.
 	 * We also don't wait for the functor or lambda here, we are scheduling it in a worker in the
 	 * thread pool.
 	 *
@@ -213,6 +290,43 @@ public:
 		return _threadPool.enqueue(func, ai);
 	}
 
+	/**
+	 * @brief Executes a lambda or functor once all batches of the running parallel phase are done
+	 *
+	 * The deferred functors are executed one after another by the thread that started the parallel phase -
+	 * in the order of the batches. Use this to modify other @c AI instances or shared state from within a
+	 * behaviour tick. If the calling thread isn't executing a batch, the functor is executed immediately.
+	 */
+	inline void executeDeferred(DeferredFunc&& func) const {
+		DeferredList* deferred = currentDeferred();
+		if (deferred == nullptr) {
+			func();
+			return;
+		}
+		deferred->push_back(std::move(func));
+	}
+
+	/**
+	 * @brief Executes a lambda or functor for the given character once all batches of the running parallel
+	 * phase are done
+	 * @sa executeDeferred()
+	 *
+	 * @return @c true if the func is going to get called for the character, @c false if not
+	 * e.g. in the case the given @c CharacterId wasn't found in this zone.
+	 * @note This locks the zone for reading to perform the CharacterId lookup
+	 */
+	template<typename Func>
+	inline bool executeDeferred(CharacterId id, const Func& func) const {
+		const AIPtr& ai = getAI(id);
+		if (!ai) {
+			return false;
+		}
+		executeDeferred([=] () {
+			func(ai);
+		});
+		return true;
+	}
+
 	template<typename Func>
 	inline auto execute(const AIPtr& ai, const Func& func) const
 		-> typename std::result_of<Func(const AIPtr&)>::type {
@@ -249,46 +363,46 @@ public:
 
 	/**
 	 * @brief Executes a lambda or functor for all the @c AI instances in this zone
-	 * @note This is executed in a thread pool - so make sure to synchronize your lambda or functor.
-	 * We are waiting for the execution of this.
+	 * @note This is executed in contiguous batches in the thread pool and the calling thread - see the
+	 * rules in the @c Zone documentation for what the lambda or functor may access. We are waiting for
+	 * the execution of this and the functors that were handed to @c executeDeferred().
 	 *
-	 * @note This locks the zone for reading
+	 * @note This must not be called concurrently to @c Zone::update() - call it from the thread that
+	 * updates the zone.
 	 */
 	template<typename Func>
 	void executeParallel(Func& func) {
-		std::vector<std::future<void> > results;
-		_lock.lockRead();
-		AIMap copy(_ais);
-		_lock.unlockRead();
-		for (auto i = copy.begin(); i != _ais.end(); ++i) {
-			const AIPtr& ai = i->second;
-			results.emplace_back(executeAsync(ai, func));
-		}
-		for (auto & result: results) {
-			result.wait();
-		}
+		executeBatches(func);
 	}
 
 	/**
 	 * @brief Executes a lambda or functor for all the @c AI instances in this zone.
-	 * @note This is executed in a thread pool - so make sure to synchronize your lambda or functor.
-	 * We are waiting for the execution of this.
+	 * @note This is executed in contiguous batches in the thread pool and the calling thread - see the
+	 * rules in the @c Zone documentation for what the lambda or functor may access. We are waiting for
+	 * the execution of this and the functors that were handed to @c executeDeferred().
 	 *
-	 * @note This locks the zone for reading
+	 * @note This must not be called concurrently to @c Zone::update() - call it from the thread that
+	 * updates the zone.
 	 */
 	template<typename Func>
 	void executeParallel(const Func& func) const {
-		std::vector<std::future<void> > results;
-		_lock.lockRead();
-		AIMap copy(_ais);
-		_lock.unlockRead();
-		for (auto i = copy.begin(); i != copy.end(); ++i) {
-			const AIPtr& ai = i->second;
-			results.emplace_back(executeAsync(ai, func));
-		}
-		for (auto & result: results) {
-			result.wait();
-		}
+		executeBatches(func);
+	}
+
+	/**
+	 * @brief Executes a tick of the given lambda or functor for all the @c AI instances in this zone.
+	 * The group positions are frozen while the batches are executed and updated afterwards.
+	 * @note Use this instead of @c executeParallel() if the functor executes the behaviour trees - they
+	 * rely on the frozen group state.
+	 *
+	 * @note This must not be called concurrently to @c Zone::update() - call it from the thread that
+	 * updates the zone.
+	 */
+	template<typename Func>
+	void executeParallelTick(Func& func, int64_t dt) {
+		_groupManager.freeze();
+		executeParallel(func);
+		_groupManager.update(dt);
 	}
 
 	/**
@@ -300,10 +414,9 @@ public:
 	template<typename Func>
 	void execute(const Func& func) const {
 		_lock.lockRead();
-		AIMap copy(_ais);
+		const AIScheduleList copy(_aiList);
 		_lock.unlockRead();
-		for (auto i = copy.begin(); i != copy.end(); ++i) {
-			const AIPtr& ai = i->second;
+		for (const AIPtr& ai : copy) {
 			func(ai);
 		}
 	}
@@ -317,10 +430,9 @@ public:
 	template<typename Func>
 	void execute(Func& func) {
 		_lock.lockRead();
-		AIMap copy(_ais);
+		const AIScheduleList copy(_aiList);
 		_lock.unlockRead();
-		for (auto i = copy.begin(); i != copy.end(); ++i) {
-			const AIPtr& ai = i->second;
+		for (const AIPtr& ai : copy) {
 			func(ai);
 		}
 	}
@@ -331,6 +443,66 @@ public:
 	}
 };
 
+template<typename Func>
+inline void Zone::executeBatches(Func& func) const {
+	const size_t n = _aiList.size();
+	const size_t workers = std::max((size_t)1u, std::min(_threadCount, (n + MinBatchSize - 1) / MinBatchSize));
+	// the deferred functors of each worker - executed in worker order once all batches are done
+	std::vector<DeferredList> deferred(workers);
+	auto executeDeferredLists = [&] () {
+		for (DeferredList& list : deferred) {
+			for (DeferredFunc& deferredFunc : list) {
+				deferredFunc();
+			}
+		}
+	};
+	if (workers == 1u) {
+		{
+			ScopedDeferred scopedDeferred(deferred[0]);
+			for (const AIPtr& ai : _aiList) {
+				func(ai);
+			}
+		}
+		executeDeferredLists();
+		return;
+	}
+	const size_t batches = workers * BatchesPerWorker;
+	const size_t batchSize = std::max(MinBatchSize, (n + batches - 1) / batches);
+	std::atomic<size_t> next(0u);
+	auto worker = [&] (size_t index) {
+		ScopedDeferred scopedDeferred(deferred[index]);
+		for (;;) {
+			const size_t start = next.fetch_add(batchSize);
+			if (start >= n) {
+				return;
+			}
+			const size_t end = std::min(n, start + batchSize);
+			for (size_t i = start; i < end; ++i) {
+				func(_aiList[i]);
+			}
+		}
+	};
+	// the calling thread is one of the workers
+	std::vector<std::future<void> > results;
+	results.reserve(workers - 1u);
+	for (size_t i = 1u; i < workers; ++i) {
+		results.emplace_back(_threadPool.enqueue(worker, i));
+	}
+	try {
+		worker(0u);
+	} catch (...) {
+		// the workers are referencing this stack frame
+		for (auto& result : results) {
+			result.wait();
+		}
+		throw;
+	}
+	for (auto& result : results) {
+		result.get();
+	}
+	executeDeferredLists();
+}
+
 inline void Zone::setDebug (bool debug) {
 	_debug = debug;
 }
@@ -360,6 +532,7 @@ inline bool Zone::doAddAI(const AIPtr& ai) {
 		return false;
 	}
 	_ais.insert(std::make_pair(id, ai));
+	_aiList.push_back(ai);
 	ai->setZone(this);
 	return true;
 }
@@ -375,6 +548,7 @@ inline bool Zone::doRemoveAI(const AIPtr& ai) {
 	}
 	i->second->setZone(nullptr);
 	_groupManager.removeFromAllGroups(i->second);
+	_removedFromList.insert(i->second.get());
 	_ais.erase(i);
 	return true;
 }
@@ -384,10 +558,22 @@ inline bool Zone::doDestroyAI(const CharacterId& id) {
 	if (i == _ais.end()) {
 		return false;
 	}
+	_removedFromList.insert(i->second.get());
 	_ais.erase(i);
 	return true;
 }
 
+inline void Zone::compactList() {
+	if (_removedFromList.empty()) {
+		return;
+	}
+	// one pass over the list for all the removals of this update
+	_aiList.erase(std::remove_if(_aiList.begin(), _aiList.end(), [this] (const AIPtr& ai) {
+		return _removedFromList.find(ai.get()) != _removedFromList.end();
+	}), _aiList.end());
+	_removedFromList.clear();
+}
+
 inline bool Zone::addAI(const AIPtr& ai) {
 	if (!ai) {
 		return false;
@@ -436,6 +622,7 @@ inline void Zone::update(int64_t dt) {
 		for (auto id : scheduledDestroy) {
 			doDestroyAI(id);
 		}
+		compactList();
 	}
 
 	auto func = [&] (const AIPtr& ai) {
@@ -443,10 +630,9 @@ inline void Zone::update(int64_t dt) {
 			return;
 		}
 		ai->update(dt, _debug);
-		ai->getBehaviour()->execute(ai, dt);
+		CompiledTree::execute(ai, dt);
 	};
-	executeParallel(func);
-	_groupManager.update(dt);
+	executeParallelTick(func, dt);
 }
 
 }
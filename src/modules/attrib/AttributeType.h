@@ -6,6 +6,7 @@
 
 #include "network/ProtocolEnum.h"
 #include <string>
+#include <stdint.h>
 
 namespace attrib {
 
@@ -15,6 +16,21 @@ namespace attrib {
  */
 using Type = network::AttribType;
 
+/**
+ * @brief The amount of attribute types - the types can be used as index into arrays of this size
+ * @ingroup Attributes
+ */
+static constexpr int TypeCount = static_cast<int>(Type::MAX) + 1;
+static_assert(TypeCount <= 32, "Type masks are stored in 32 bits");
+
+/**
+ * @return The bit of the given type in a type mask
+ * @ingroup Attributes
+ */
+inline constexpr uint32_t typeMask(Type type) {
+	return 1u << static_cast<int>(type);
+}
+
 /**
  * @brief Converts a string into the enum value
  * @ingroup Attributes
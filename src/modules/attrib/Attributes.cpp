@@ -3,176 +3,202 @@
  */
 
 #include "Attributes.h"
-#include "core/Set.h"
-#include <unordered_set>
+#include <algorithm>
 
 namespace attrib {
 
 Attributes::Attributes(Attributes* parent) :
-		_dirty(false), _lock("Attributes"), _attribLock("Attributes2"), _parent(parent) {
+		_dirty(false), _dirtyTypes(0u), _lock("Attributes"), _attribLock("Attributes2"), _parent(parent) {
+	for (int i = 0; i < TypeCount; ++i) {
+		_current[i] = 0.0;
+		_max[i] = 0.0;
+	}
+}
+
+void Attributes::markDirty(uint32_t types) {
+	_dirtyTypes.fetch_or(types);
+	_dirty = true;
 }
 
 bool Attributes::onFrame(long dt) {
+	uint32_t types = 0u;
 	bool updated = false;
 	if (_parent != nullptr) {
 		updated = _parent->onFrame(dt);
 		if (updated) {
-			_dirty = true;
+			// we don't know which of the parent values changed
+			types = ~0u;
 		}
 	}
-	if (!_dirty.exchange(false)) {
-		return updated;
+	if (!_dirty.exchange(false) && !updated) {
+		return false;
 	}
+	types |= _dirtyTypes.exchange(0u);
 
-	Values max;
-	Values percentages;
-	calculateMax(max, percentages);
+	double absolutes[TypeCount] = { 0.0 };
+	double percentages[TypeCount] = { 0.0 };
+	const uint32_t present = calculateMax(types, absolutes, percentages);
 
-	for (const auto& p : percentages) {
-		max[p.first] *= 1.0 + (p.second * 0.01);
-	}
-
-	core::ScopedReadLock scopedLock(_attribLock);
-	if (!_listeners.empty()) {
-		const TypeSet& diff = core::mapFindChangedValues(_max, max);
-		for (const auto& listener : _listeners) {
-			for (const Type& e : diff) {
-				listener(DirtyValue{e, false, max[e]});
+	core::ScopedWriteLock scopedLock(_attribLock);
+	for (int i = 0; i < TypeCount; ++i) {
+		const uint32_t mask = 1u << i;
+		if ((types & mask) == 0u) {
+			continue;
+		}
+		const bool hasMax = (present & mask) != 0u;
+		const double max = hasMax ? absolutes[i] * (1.0 + (percentages[i] * 0.01)) : 0.0;
+		const bool hadMax = (_maxTypes & mask) != 0u;
+		const double oldMax = _max[i].load(std::memory_order_relaxed);
+		_max[i].store(max, std::memory_order_relaxed);
+		if (hasMax) {
+			_maxTypes |= mask;
+		} else {
+			_maxTypes &= ~mask;
+		}
+		if (oldMax != max || (hasMax && !hadMax)) {
+			for (const auto& listener : _listeners) {
+				listener(DirtyValue{static_cast<Type>(i), false, max});
 			}
 		}
-	}
-	_max = max;
-
-	// cap your currents to the max allowed value
-	for (ValuesIter i = _current.begin(); i != _current.end(); ++i) {
-		ValuesIter mi = _max.find(i->first);
-		if (mi == _max.end()) {
-			continue;
+		// cap your currents to the max allowed value
+		if (hasMax && (_currentTypes & mask) != 0u) {
+			const double current = _current[i].load(std::memory_order_relaxed);
+			_current[i].store(std::min(max, current), std::memory_order_relaxed);
 		}
-		i->second = std::min(mi->second, i->second);
 	}
 	return true;
 }
 
-void Attributes::calculateMax(Values& absolutes, Values& percentages) const {
+uint32_t Attributes::calculateMax(uint32_t types, double absolutes[TypeCount], double percentages[TypeCount]) const {
+	uint32_t present = 0u;
 	if (_parent != nullptr) {
-		_parent->calculateMax(absolutes, percentages);
+		present |= _parent->calculateMax(types, absolutes, percentages);
 	}
 
-	Containers containers;
-	{
-		core::ScopedReadLock scopedLock(_lock);
-		containers = _containers;
-	}
-	for (const auto& e : containers) {
-		const Container& c = e.second;
-		const double stackCount = c.stackCount();
-		const Values& abs = c.absolute();
-		for (ValuesConstIter i = abs.begin(); i != abs.end(); ++i) {
-			absolutes[i->first] += i->second * stackCount;
+	core::ScopedReadLock scopedLock(_lock);
+	for (const AppliedContainer& e : _containers) {
+		const Container& c = *e.container;
+		const uint32_t relevant = c.types() & types;
+		if (relevant == 0u) {
+			continue;
 		}
-		const Values& rel = c.percentage();
-		for (ValuesConstIter i = rel.begin(); i != rel.end(); ++i) {
-			percentages[i->first] += i->second * stackCount;
+		present |= relevant;
+		const double stackCount = e.stackCount;
+		for (int i = 0; i < TypeCount; ++i) {
+			if ((relevant & (1u << i)) == 0u) {
+				continue;
+			}
+			const Type type = static_cast<Type>(i);
+			absolutes[i] += c.absolute(type) * stackCount;
+			percentages[i] += c.percentage(type) * stackCount;
 		}
 	}
+	return present;
 }
 
-void Attributes::add(const Container& container) {
+void Attributes::add(const ContainerPtr& container, int stackCount) {
 	core::ScopedWriteLock scopedLock(_lock);
-	const auto& i = _containers.insert(std::make_pair(container.name(), container));
-	if (i.second) {
-		_dirty = true;
+	for (AppliedContainer& e : _containers) {
+		if (!e.container->same(*container)) {
+			continue;
+		}
+		if (e.stackCount >= e.container->stackLimit()) {
+			return;
+		}
+		++e.stackCount;
+		markDirty(e.container->types());
 		return;
 	}
-	if (i.first->second.increaseStackCount()) {
-		_dirty = true;
-	}
+	_containers.push_back(AppliedContainer{container, stackCount});
+	markDirty(container->types());
+}
+
+void Attributes::add(const Container& container) {
+	add(std::make_shared<Container>(container), container.stackCount());
 }
 
 void Attributes::add(Container&& container) {
-	core::ScopedWriteLock scopedLock(_lock);
-	const auto& i = _containers.insert(std::make_pair(container.name(), container));
-	if (i.second) {
-		_dirty = true;
-		return;
-	}
-	if (i.first->second.increaseStackCount()) {
-		_dirty = true;
-	}
+	const int stackCount = container.stackCount();
+	add(std::make_shared<Container>(std::move(container)), stackCount);
 }
 
 void Attributes::add(const ContainerPtr& container) {
 	if (!container) {
 		return;
 	}
-	core::ScopedWriteLock scopedLock(_lock);
-	_containerPtrs.insert(std::make_pair(container->name(), container));
-	const auto& i = _containers.insert(std::make_pair(container->name(), *container.get()));
-	if (i.second) {
-		_dirty = true;
-		return;
-	}
-	if (i.first->second.increaseStackCount()) {
-		_dirty = true;
-	}
+	add(container, container->stackCount());
 }
 
 void Attributes::remove(const Container& container) {
-	remove(container.name());
+	core::ScopedWriteLock scopedLock(_lock);
+	for (auto i = _containers.begin(); i != _containers.end(); ++i) {
+		if (!i->container->same(container)) {
+			continue;
+		}
+		markDirty(i->container->types());
+		if (--i->stackCount <= 0) {
+			*i = std::move(_containers.back());
+			_containers.pop_back();
+		}
+		return;
+	}
 }
 
 void Attributes::remove(const ContainerPtr& container) {
 	if (!container) {
 		return;
 	}
-	remove(container->name());
+	remove(*container);
 }
 
 void Attributes::remove(const std::string& name) {
+	const size_t hash = std::hash<std::string>{}(name);
 	core::ScopedWriteLock scopedLock(_lock);
-	_containerPtrs.erase(name);
-	const auto& i = _containers.find(name);
-	if (i == _containers.end()) {
-		return;
-	}
-	if (i->second.decreaseStackCount()) {
-		_dirty = true;
+	for (auto i = _containers.begin(); i != _containers.end(); ++i) {
+		const Container& c = *i->container;
+		if (c.hash() != hash || c.name() != name) {
+			continue;
+		}
+		markDirty(c.types());
+		if (--i->stackCount <= 0) {
+			*i = std::move(_containers.back());
+			_containers.pop_back();
+		}
 		return;
 	}
-	const auto& erased = _containers.erase(i);
-	if (erased != _containers.end()) {
-		_dirty = true;
-	}
 }
 
 double Attributes::setCurrent(Type type, double value) {
+	const int idx = static_cast<int>(type);
+	const uint32_t mask = typeMask(type);
 	core::ScopedWriteLock scopedLock(_attribLock);
-	auto i = _max.find(type);
-	if (i == _max.end()) {
-		_current[type] = value;
-		for (const auto& listener : _listeners) {
-			listener(DirtyValue{type, true, value});
-		}
-		return value;
+	if ((_maxTypes & mask) != 0u) {
+		value = std::min(_max[idx].load(std::memory_order_relaxed), value);
 	}
-	const double max = std::min(i->second, value);
-	_current[type] = max;
+	_current[idx].store(value, std::memory_order_relaxed);
+	_currentTypes |= mask;
 	for (const auto& listener : _listeners) {
-		listener(DirtyValue{type, true, max});
+		listener(DirtyValue{type, true, value});
 	}
-	return max;
+	return value;
 }
 
 void Attributes::markAsDirty() {
-	for (ValuesIter i = _current.begin(); i != _current.end(); ++i) {
+	core::ScopedReadLock scopedLock(_attribLock);
+	for (int i = 0; i < TypeCount; ++i) {
+		if ((_currentTypes & (1u << i)) == 0u) {
+			continue;
+		}
 		for (const auto& listener : _listeners) {
-			listener(DirtyValue{i->first, true, i->second});
+			listener(DirtyValue{static_cast<Type>(i), true, current(static_cast<Type>(i))});
 		}
 	}
-	for (ValuesIter i = _max.begin(); i != _max.end(); ++i) {
+	for (int i = 0; i < TypeCount; ++i) {
+		if ((_maxTypes & (1u << i)) == 0u) {
+			continue;
+		}
 		for (const auto& listener : _listeners) {
-			listener(DirtyValue{i->first, false, i->second});
+			listener(DirtyValue{static_cast<Type>(i), false, max(static_cast<Type>(i))});
 		}
 	}
 }
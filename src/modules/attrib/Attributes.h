@@ -6,8 +6,9 @@
 
 #include "Container.h"
 #include "core/ReadWriteLock.h"
-#include <queue>
+#include <atomic>
 #include <functional>
+#include <vector>
 
 namespace attrib {
 
@@ -56,28 +57,45 @@ namespace attrib {
  * your max allowed hit points. The current hit points must be maintained by your game logic. E.g. you take
  * damage, so make sure to update your current hit points.
  *
- * The system is thread safe. There are two looks in the system - one that is locked if you modify attributes,
- * and one for adding and removing containers. The added/removed containers only lead to a re-evaluation of
- * the max values if @c Attributes::onFrame() was called.
+ * The current and max values are stored in arrays indexed by the @c attrib::Type. Adding and removing containers
+ * marks the types they provide as dirty, and only those are recalculated in the next @c Attributes::onFrame() call.
+ *
+ * The system is thread safe. Reading values never locks. There are two locks in the system - one that is locked if
+ * you modify attributes, and one for adding and removing containers. The added/removed containers only lead to a
+ * re-evaluation of the max values if @c Attributes::onFrame() was called.
  *
  * @sa ContainerProvider
  * @sa ShadowAttributes
  */
 class Attributes {
 protected:
+	struct AppliedContainer {
+		ContainerPtr container;
+		int stackCount;
+	};
 	std::atomic_bool _dirty;
-	Values _current;
-	Values _max;
-	Containers _containers;
-	// keep them here for ref counting
-	std::unordered_map<std::string, ContainerPtr> _containerPtrs;
+	// the types that must be recalculated in the next onFrame() call
+	std::atomic<uint32_t> _dirtyTypes;
+	std::atomic<double> _current[TypeCount];
+	std::atomic<double> _max[TypeCount];
+	// the types that have a current value - guarded by _attribLock
+	uint32_t _currentTypes = 0u;
+	// the types that have a max value, the currents of these types are capped - guarded by _attribLock
+	uint32_t _maxTypes = 0u;
+	std::vector<AppliedContainer> _containers;
 	core::ReadWriteLock _lock;
 	core::ReadWriteLock _attribLock;
 	Attributes* _parent;
 	std::string _name = "unnamed";
 	std::vector<std::function<void(const DirtyValue&)> > _listeners;
 
-	void calculateMax(Values& absolutes, Values& percentages) const;
+	/**
+	 * @brief Sums up the values of all containers of this and the parent instances for the given types
+	 * @return The mask of the types that any container provides a value for
+	 */
+	uint32_t calculateMax(uint32_t types, double absolutes[TypeCount], double percentages[TypeCount]) const;
+	void add(const ContainerPtr& container, int stackCount);
+	void markDirty(uint32_t types);
 
 public:
 	/**
@@ -160,13 +178,13 @@ public:
 	 */
 	double setCurrent(Type type, double value);
 	/**
-	 * @note Locks the object (attrib)
+	 * @note Doesn't lock
 	 *
 	 * @return The capped current value for the specified type
 	 */
 	double current(Type type) const;
 	/**
-	 * @note Locks the object (attrib)
+	 * @note Doesn't lock
 	 *
 	 * @return The current calculated max value for the specified type. This value is computed by the
 	 * @c Container's that were added before the last @c update() call happened.
@@ -175,21 +193,11 @@ public:
 };
 
 inline double Attributes::current(Type type) const {
-	core::ScopedReadLock scopedLock(_attribLock);
-	auto i = _current.find(type);
-	if (i == _current.end()) {
-		return 0.0;
-	}
-	return i->second;
+	return _current[static_cast<int>(type)].load(std::memory_order_relaxed);
 }
 
 inline double Attributes::max(Type type) const {
-	core::ScopedReadLock scopedLock(_attribLock);
-	auto i = _max.find(type);
-	if (i == _max.end()) {
-		return 0.0;
-	}
-	return i->second;
+	return _max[static_cast<int>(type)].load(std::memory_order_relaxed);
 }
 
 inline void Attributes::setName(const std::string& name) {
@@ -15,7 +15,6 @@ namespace attrib {
 
 class Container;
 
-typedef std::unordered_map<std::string, Container> Containers;
 typedef std::unordered_map<Type, double, network::EnumHash<Type> > Values;
 typedef std::unordered_set<Type, network::EnumHash<Type> > TypeSet;
 typedef Values::const_iterator ValuesConstIter;
@@ -36,16 +35,40 @@ protected:
 	int _stackCount;
 	int _stackLimit;
 	size_t _hash;
+	// the id that was assigned by the ContainerProvider - or -1
+	int _id = -1;
+	// the values of _percentage and _absolute indexed by the type
+	double _percentageValues[TypeCount];
+	double _absoluteValues[TypeCount];
+	// the types that this container provides values for
+	uint32_t _types = 0u;
+
+	void index() {
+		for (int i = 0; i < TypeCount; ++i) {
+			_percentageValues[i] = 0.0;
+			_absoluteValues[i] = 0.0;
+		}
+		for (const auto& e : _percentage) {
+			_percentageValues[static_cast<int>(e.first)] = e.second;
+			_types |= typeMask(e.first);
+		}
+		for (const auto& e : _absolute) {
+			_absoluteValues[static_cast<int>(e.first)] = e.second;
+			_types |= typeMask(e.first);
+		}
+	}
 
 public:
 	Container(const std::string& name, const Values& percentage, const Values& absolute, int stackCount = 1, int stackLimit = 1) :
 			_name(name), _percentage(percentage), _absolute(absolute),
 			_stackCount(stackCount), _stackLimit(stackLimit), _hash(std::hash<std::string>{}(_name)) {
+		index();
 	}
 
 	Container(std::string&& name, Values&& percentage, Values&& absolute, int stackCount = 1, int stackLimit = 1) :
 			_name(std::move(name)), _percentage(std::move(percentage)), _absolute(std::move(absolute)),
 			_stackCount(stackCount), _stackLimit(stackLimit), _hash(std::hash<std::string>{}(_name)) {
+		index();
 	}
 
 	/**
@@ -55,6 +78,48 @@ public:
 		return _name;
 	}
 
+	inline size_t hash() const {
+		return _hash;
+	}
+
+	/**
+	 * @return The id that the @c ContainerProvider assigned when the container was registered,
+	 * @c -1 for containers that are not known to a provider.
+	 */
+	inline int id() const {
+		return _id;
+	}
+
+	inline void setId(int id) {
+		_id = id;
+	}
+
+	/**
+	 * @return @c true if both containers are the same - compares the ids if both have one and
+	 * the names otherwise.
+	 */
+	inline bool same(const Container& other) const {
+		if (_id >= 0 && other._id >= 0) {
+			return _id == other._id;
+		}
+		return _hash == other._hash && _name == other._name;
+	}
+
+	/**
+	 * @return Bit mask (see @c typeMask()) of the types this container provides values for
+	 */
+	inline uint32_t types() const {
+		return _types;
+	}
+
+	inline double percentage(Type type) const {
+		return _percentageValues[static_cast<int>(type)];
+	}
+
+	inline double absolute(Type type) const {
+		return _absoluteValues[static_cast<int>(type)];
+	}
+
 	/**
 	 * @return The percentage values that this container provides
 	 * @sa absolute()
@@ -53,10 +53,15 @@ void ContainerProvider::addContainer(const ContainerPtr& container) {
 		return;
 	}
 	Log::trace("register container %s", container->name().c_str());
-	if (_containers.find(container->name()) != _containers.end()) {
+	auto i = _containers.find(container->name());
+	if (i != _containers.end()) {
 		Log::warn("overriding already existing container for %s", container->name().c_str());
+		container->setId(i->second->id());
+		i->second = container;
+		return;
 	}
-	_containers[container->name()] = container;
+	container->setId(_nextId++);
+	_containers.insert(std::make_pair(container->name(), container));
 }
 
 ContainerPtr ContainerProvider::container(const std::string& name) const {
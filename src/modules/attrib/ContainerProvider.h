@@ -30,6 +30,7 @@ public:
 private:
 	Containers _containers;
 	std::string _error;
+	int _nextId = 0;
 public:
 	/**
 	 * @param luaScript The lua script string to load
@@ -50,6 +51,10 @@ public:
 	 */
 	const Containers& containers() const;
 
+	/**
+	 * @brief Registers the container and assigns the id to it. A container that overrides an
+	 * already existing one with the same name gets the id of the existing one.
+	 */
 	void addContainer(const ContainerPtr& container);
 	ContainerPtr container(const std::string& name) const;
 
@@ -66,6 +71,7 @@ typedef std::shared_ptr<ContainerProvider> ContainerProviderPtr;
 inline void ContainerProvider::reset() {
 	_error = "";
 	_containers.clear();
+	_nextId = 0;
 }
 
 inline const ContainerProvider::Containers& ContainerProvider::containers() const {
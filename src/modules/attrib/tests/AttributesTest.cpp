@@ -155,4 +155,57 @@ TEST_F(AttributesTest, testListeners) {
 	ASSERT_EQ(changes[static_cast<int>(Type::SPEED)], 1);
 }
 
+TEST_F(AttributesTest, testOnlyChangedTypesAreNotified) {
+	Attributes attributes;
+	int changes[TypeCount];
+	SDL_zero(changes);
+	attributes.addListener([&] (const DirtyValue& v) {
+		if (!v.current) {
+			++changes[static_cast<int>(v.type)];
+		}
+	});
+	ContainerBuilder test1("test1");
+	test1.addAbsolute(Type::HEALTH, 10);
+	attributes.add(test1.create());
+	ContainerBuilder test2("test2");
+	test2.addAbsolute(Type::SPEED, 5);
+	attributes.add(test2.create());
+	ASSERT_TRUE(attributes.onFrame(1L));
+	ASSERT_EQ(1, changes[static_cast<int>(Type::HEALTH)]);
+	ASSERT_EQ(1, changes[static_cast<int>(Type::SPEED)]);
+
+	attributes.remove("test2");
+	ASSERT_TRUE(attributes.onFrame(1L));
+	ASSERT_EQ(1, changes[static_cast<int>(Type::HEALTH)]) << "The health values were not touched";
+	ASSERT_EQ(2, changes[static_cast<int>(Type::SPEED)]);
+	ASSERT_EQ(0, attributes.max(Type::SPEED));
+	ASSERT_EQ(10, attributes.max(Type::HEALTH));
+	ASSERT_FALSE(attributes.onFrame(1L));
+}
+
+TEST_F(AttributesTest, testContainerIds) {
+	Attributes attributes;
+	ContainerBuilder builder("test1");
+	builder.addAbsolute(Type::HEALTH, 1);
+	const ContainerPtr& c = std::make_shared<Container>(builder.create());
+	c->setId(1);
+	attributes.add(c);
+	ASSERT_TRUE(attributes.onFrame(1L));
+	ASSERT_EQ(1, attributes.max(Type::HEALTH));
+
+	// another container instance with the same id
+	Container other = builder.create();
+	other.setId(1);
+	attributes.remove(other);
+	ASSERT_TRUE(attributes.onFrame(1L));
+	ASSERT_EQ(0, attributes.max(Type::HEALTH));
+}
+
+TEST_F(AttributesTest, testUncappedCurrent) {
+	Attributes attributes;
+	ASSERT_EQ(0, attributes.current(Type::STRENGTH));
+	ASSERT_EQ(100, attributes.setCurrent(Type::STRENGTH, 100));
+	ASSERT_EQ(100, attributes.current(Type::STRENGTH));
+}
+
 }
@@ -22,4 +22,18 @@ TEST_F(ContainerProviderTest, testLoadingUnknownType) {
 	ASSERT_FALSE(p.init(attributes)) << p.error();
 }
 
+TEST_F(ContainerProviderTest, testContainerIds) {
+	ContainerProvider p;
+	const ContainerPtr a = std::make_shared<Container>(ContainerBuilder("a").create());
+	const ContainerPtr b = std::make_shared<Container>(ContainerBuilder("b").create());
+	const ContainerPtr a2 = std::make_shared<Container>(ContainerBuilder("a").create());
+	p.addContainer(a);
+	p.addContainer(b);
+	EXPECT_EQ(0, a->id());
+	EXPECT_EQ(1, b->id());
+	p.addContainer(a2);
+	EXPECT_EQ(0, a2->id()) << "Overriding a container should keep the id";
+	EXPECT_EQ(a2, p.container("a"));
+}
+
 }
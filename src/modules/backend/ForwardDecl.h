@@ -7,6 +7,8 @@ namespace voxel {
 
 class World;
 typedef std::shared_ptr<World> WorldPtr;
+class Path;
+typedef std::shared_ptr<Path> PathPtr;
 
 }
 
@@ -61,6 +63,9 @@ typedef std::shared_ptr<EntityStorage> EntityStoragePtr;
 class PoiProvider;
 typedef std::shared_ptr<PoiProvider> PoiProviderPtr;
 
+class InterestProvider;
+typedef std::shared_ptr<InterestProvider> InterestProviderPtr;
+
 }
 
 namespace core {
@@ -9,6 +9,9 @@
 
 namespace backend {
 
+// entities within this fraction of the view distance are sent with a higher priority
+static constexpr float NearViewDistanceFraction = 0.5f;
+
 Entity::Entity(EntityId id, const network::MessageSenderPtr& messageSender, const core::TimeProviderPtr& timeProvider, const attrib::ContainerProviderPtr& containerProvider, const cooldown::CooldownProviderPtr& cooldownProvider) :
 		_visibleLock("Entity"), _entityId(id), _messageSender(messageSender), _containerProvider(containerProvider), _cooldowns(timeProvider, cooldownProvider) {
 	_attribs.addListener(std::bind(&Entity::onAttribChange, this, std::placeholders::_1));
@@ -79,9 +82,11 @@ void Entity::sendAttribUpdate() {
 	// TODO: collect which of them are dirty, and maintain a list of
 	// those that are for the owning client only or which of them must be broadcasted
 	std::vector<ENetPeer*> peers;
+	std::vector<uint32_t> connectIDs;
 	ENetPeer* p = peer();
 	if (p != nullptr) {
 		peers.push_back(p);
+		connectIDs.push_back(_connectID);
 	}
 
 	// TODO: broadcast to visible users
@@ -103,7 +108,8 @@ void Entity::sendAttribUpdate() {
 				const bool current = dirtyValue.current;
 				return network::CreateAttribEntry(fbb, dirtyValue.type, value, mode, current);
 			});
-		_messageSender->sendServerMessage(peers, fbb, network::ServerMsgType::AttribUpdate, network::CreateAttribUpdate(fbb, id(), attribs).Union());
+		_messageSender->sendServerMessage(peers, connectIDs, fbb, network::ServerMsgType::AttribUpdate, network::CreateAttribUpdate(fbb, id(), attribs).Union(),
+				network::SendPriority::Attribute);
 	}
 }
 
@@ -113,11 +119,10 @@ bool Entity::update(long dt) {
 		sendAttribUpdate();
 		_dirtyTypes.clear();
 	}
-	_cooldowns.update();
 	return true;
 }
 
-void Entity::updateVisible(const EntitySet& set) {
+void Entity::updateVisible(const EntitySet& set, const InterestProvider& interestProvider) {
 	_visibleLock.lockWrite();
 	const auto& stillVisible = core::setIntersection(set, _visible);
 	const EntitySet& remove = core::setDifference(stillVisible, _visible);
@@ -126,8 +131,13 @@ void Entity::updateVisible(const EntitySet& set) {
 	core_assert(stillVisible.size() + add.size() == _visible.size());
 	_visibleLock.unlockWrite();
 
-	for (const auto& e : _visible) {
-		sendEntityUpdate(e);
+	for (const EntityPtr& e : remove) {
+		_interest.erase(e->id());
+	}
+
+	// npcs don't have a peer - no need to check the interest tiers at all
+	if (_peer != nullptr) {
+		sendEntityUpdates(interestProvider);
 	}
 
 	if (!add.empty()) {
@@ -138,14 +148,69 @@ void Entity::updateVisible(const EntitySet& set) {
 	}
 }
 
-void Entity::sendEntityUpdate(const EntityPtr& entity) const {
+void Entity::resetInterest() {
+	_interest.clear();
+}
+
+bool Entity::needsUpdate(const InterestProvider& interestProvider, const EntityPtr& entity, InterestTier tier, const InterestState& state) const {
+	const glm::vec3& entityPos = entity->pos();
+	const float orientation = entity->orientation();
+	if (entityPos == state.pos && orientation == state.orientation) {
+		return false;
+	}
+	const Interest& interest = interestProvider.interest(entity->entityType());
+	switch (tier) {
+	case InterestTier::Near:
+		return true;
+	case InterestTier::Mid:
+		return _visibleTick - state.tick >= (uint32_t)interest.midInterval;
+	case InterestTier::Far:
+		break;
+	}
+	if (glm::distance2(entityPos, state.pos) >= interest.significantDistance * interest.significantDistance) {
+		return true;
+	}
+	// the shortest angle between both orientations
+	const float delta = glm::abs(glm::mod(orientation - state.orientation + glm::pi<float>(), glm::two_pi<float>()) - glm::pi<float>());
+	return delta >= interest.significantOrientation;
+}
+
+void Entity::sendEntityUpdates(const InterestProvider& interestProvider) {
+	++_visibleTick;
+	const glm::vec3& ownPos = pos();
+	const float viewDistance = current(attrib::Type::VIEWDISTANCE);
+	for (const EntityPtr& e : _visible) {
+		const InterestTier tier = interestProvider.tier(e->entityType(), glm::distance2(ownPos, e->pos()), viewDistance);
+		auto i = _interest.find(e->id());
+		bool reliable = true;
+		if (i != _interest.end()) {
+			const InterestState& state = i->second;
+			if (e->pos() == state.pos && e->orientation() == state.orientation) {
+				// the entity came to rest - the last unreliable update is repeated reliably once
+				if (state.reliable) {
+					continue;
+				}
+			} else if (needsUpdate(interestProvider, e, tier, state)) {
+				reliable = false;
+			} else {
+				continue;
+			}
+		}
+		const network::SendPriority priority = tier == InterestTier::Near ? network::SendPriority::NearEntity : network::SendPriority::FarEntity;
+		sendEntityUpdate(e, priority, reliable);
+		_interest[e->id()] = InterestState { e->pos(), e->orientation(), _visibleTick, reliable };
+	}
+}
+
+void Entity::sendEntityUpdate(const EntityPtr& entity, network::SendPriority priority, bool reliable) const {
 	if (_peer == nullptr) {
 		return;
 	}
 	flatbuffers::FlatBufferBuilder fbb;
 	const glm::vec3& _pos = entity->pos();
 	const network::Vec3 pos { _pos.x, _pos.y, _pos.z };
-	_messageSender->sendServerMessage(_peer, fbb, network::ServerMsgType::EntityUpdate, network::CreateEntityUpdate(fbb, entity->id(), &pos, entity->orientation()).Union());
+	_messageSender->sendServerMessage(_peer, _connectID, fbb, network::ServerMsgType::EntityUpdate, network::CreateEntityUpdate(fbb, entity->id(), &pos, entity->orientation()).Union(),
+			priority, reliable ? ENET_PACKET_FLAG_RELIABLE : 0u);
 }
 
 void Entity::sendEntitySpawn(const EntityPtr& entity) const {
@@ -156,7 +221,8 @@ void Entity::sendEntitySpawn(const EntityPtr& entity) const {
 	const glm::vec3& pos = entity->pos();
 	const network::Vec3 vec3 { pos.x, pos.y, pos.z };
 	const EntityId entityId = id();
-	_messageSender->sendServerMessage(_peer, fbb, network::ServerMsgType::EntitySpawn, network::CreateEntitySpawn(fbb, entity->id(), entity->entityType(), &vec3, entityId).Union());
+	_messageSender->sendServerMessage(_peer, _connectID, fbb, network::ServerMsgType::EntitySpawn, network::CreateEntitySpawn(fbb, entity->id(), entity->entityType(), &vec3, entityId).Union(),
+			sendPriority(entity));
 }
 
 void Entity::sendEntityRemove(const EntityPtr& entity) const {
@@ -164,7 +230,19 @@ void Entity::sendEntityRemove(const EntityPtr& entity) const {
 		return;
 	}
 	flatbuffers::FlatBufferBuilder fbb;
-	_messageSender->sendServerMessage(_peer, fbb, network::ServerMsgType::EntityRemove, network::CreateEntityRemove(fbb, entity->id()).Union());
+	_messageSender->sendServerMessage(_peer, _connectID, fbb, network::ServerMsgType::EntityRemove, network::CreateEntityRemove(fbb, entity->id()).Union(),
+			sendPriority(entity));
+}
+
+network::SendPriority Entity::sendPriority(const EntityPtr& entity) const {
+	if (entity.get() == this) {
+		return network::SendPriority::Player;
+	}
+	const float nearDistance = current(attrib::Type::VIEWDISTANCE) * NearViewDistanceFraction;
+	if (glm::distance2(pos(), entity->pos()) <= nearDistance * nearDistance) {
+		return network::SendPriority::NearEntity;
+	}
+	return network::SendPriority::FarEntity;
 }
 
 bool Entity::inFrustum(const glm::vec3& position) const {
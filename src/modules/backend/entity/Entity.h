@@ -14,6 +14,8 @@
 #include "cooldown/CooldownMgr.h"
 #include "network/MessageSender.h"
 #include "EntityId.h"
+#include "InterestProvider.h"
+#include <unordered_map>
 
 namespace voxel {
 class World;
@@ -39,6 +41,22 @@ private:
 	core::ReadWriteLock _visibleLock;
 	EntitySet _visible;
 
+	/**
+	 * @brief The state of a visible entity that was last sent to the peer of this entity
+	 */
+	struct InterestState {
+		glm::vec3 pos;
+		float orientation;
+		uint32_t tick;
+		// unreliable updates might get lost - the state an entity comes to rest with is sent reliably
+		bool reliable;
+	};
+	std::unordered_map<EntityId, InterestState> _interest;
+	uint32_t _visibleTick = 0u;
+
+	bool needsUpdate(const InterestProvider& interestProvider, const EntityPtr& entity, InterestTier tier, const InterestState& state) const;
+	void sendEntityUpdates(const InterestProvider& interestProvider);
+
 protected:
 	EntityId _entityId;
 	network::MessageSenderPtr _messageSender;
@@ -49,6 +67,8 @@ protected:
 	cooldown::CooldownMgr _cooldowns;
 	network::EntityType _entityType = network::EntityType::NONE;
 	ENetPeer *_peer = nullptr;
+	// identifies the connection of the peer - the messages for a connection that is gone are dropped
+	uint32_t _connectID = 0u;
 
 	glm::vec3 _pos;
 	float _orientation = 0.0f;
@@ -63,11 +83,27 @@ protected:
 	 */
 	virtual void visibleRemove(const EntitySet& entities);
 
+	/**
+	 * @brief The priority of the messages about the given entity that are sent to the peer of this entity
+	 */
+	network::SendPriority sendPriority(const EntityPtr& entity) const;
 	void sendAttribUpdate();
-	void sendEntityUpdate(const EntityPtr& entity) const;
+	/**
+	 * @brief Sends the current position and orientation of the given entity to the peer of this entity
+	 * @param[in] reliable The updates of moving entities are sent unreliable - the send scheduler may
+	 * drop or reorder them by their priority. The first and the last state of a movement are sent reliably.
+	 * @note Only called for the entities that pass the interest tier throttling
+	 */
+	virtual void sendEntityUpdate(const EntityPtr& entity, network::SendPriority priority, bool reliable) const;
 	void sendEntitySpawn(const EntityPtr& entity) const;
 	void sendEntityRemove(const EntityPtr& entity) const;
 
+	/**
+	 * @brief Forgets about the entity states that were already sent to the peer - the next
+	 * visibility tick sends updates for all the visible entities again.
+	 */
+	void resetInterest();
+
 	void onAttribChange(const attrib::DirtyValue& v);
 public:
 	Entity(EntityId id, const network::MessageSenderPtr& messageSender, const core::TimeProviderPtr& timeProvider,
@@ -85,6 +121,8 @@ public:
 
 	ENetPeer* peer() const;
 
+	uint32_t connectID() const;
+
 	/**
 	 * @note The implementation behind this must ensure thread safety
 	 * @return the current position in world coordinates
@@ -129,11 +167,18 @@ public:
 
 	/**
 	 * @brief This will inform the entity about all the other entities that it can see.
+	 *
+	 * If this entity has a peer, the visible entities are sent to it according to their
+	 * interest tier: near entities are updated on every call, mid range entities only every
+	 * @c Interest::midInterval calls and far entities only if they changed significantly since
+	 * the last update that was sent. Entities that didn't change at all are never sent again.
+	 *
 	 * @param[in] set The entities that are currently visible
+	 * @param[in] interestProvider The interest tier settings per entity type
 	 * @note All entities have the same view range - see @c Entity::regionRect
 	 * @note This is thread safe
 	 */
-	void updateVisible(const EntitySet& set);
+	void updateVisible(const EntitySet& set, const InterestProvider& interestProvider);
 
 	/**
 	 * @brief The tick of the entity
@@ -216,12 +261,13 @@ inline bool Entity::dead() const {
 }
 
 inline ENetPeer* Entity::peer() const {
-	if (_peer != nullptr && _peer->state == ENET_PEER_STATE_DISCONNECTED) {
-		return nullptr;
-	}
 	return _peer;
 }
 
+inline uint32_t Entity::connectID() const {
+	return _connectID;
+}
+
 inline bool Entity::inFrustum(const Entity& other) const {
 	return inFrustum(other.pos());
 }
@@ -7,15 +7,29 @@
 #include "User.h"
 #include "DatabaseModels.h"
 #include "Npc.h"
+#include "InterestProvider.h"
+#include "voxel/World.h"
+#include "network/MessageSender.h"
 
 #define broadcastMsg(msg, type) _messageSender->broadcastServerMessage(fbb, network::type, network::msg.Union());
 
 namespace backend {
 
 EntityStorage::EntityStorage(const network::MessageSenderPtr& messageSender, const voxel::WorldPtr& world, const core::TimeProviderPtr& timeProvider,
-		const attrib::ContainerProviderPtr& containerProvider, const PoiProviderPtr& poiProvider, const cooldown::CooldownProviderPtr& cooldownProvider) :
+		const attrib::ContainerProviderPtr& containerProvider, const PoiProviderPtr& poiProvider, const cooldown::CooldownProviderPtr& cooldownProvider,
+		const InterestProviderPtr& interestProvider, const ::persistence::ExecutorPtr& executor) :
 		_quadTree(core::RectFloat::getMaxRect(), 100.0f), _quadTreeCache(_quadTree), _messageSender(messageSender), _world(world), _timeProvider(
-				timeProvider), _containerProvider(containerProvider), _poiProvider(poiProvider), _cooldownProvider(cooldownProvider), _time(0L) {
+				timeProvider), _containerProvider(containerProvider), _poiProvider(poiProvider), _cooldownProvider(cooldownProvider),
+				_interestProvider(interestProvider), _executor(executor), _time(0L) {
+	_loginsPerTick = core::Var::get(cfg::ServerLoginsPerTick, "10");
+}
+
+bool EntityStorage::init() {
+	if (!_interestProvider->init("interest.lua")) {
+		Log::error("Failed to load the interest configuration: %s", _interestProvider->error().c_str());
+		return false;
+	}
+	return true;
 }
 
 core::RectFloat EntityStorage::QuadTreeNode::getRect() const {
@@ -30,39 +44,101 @@ void EntityStorage::registerUser(const UserPtr& user) {
 	_users[user->id()] = user;
 }
 
-EntityId EntityStorage::getUserId(const std::string& email, const std::string& password) const {
+EntityId EntityStorage::getUserId(const std::string& email, const std::string& password, bool autoRegister) {
 	persistence::UserStore userStore(&email, &password, nullptr);
 	EntityId checkId = userStore.userid();
 
-	if (checkId == 0) {
-		const core::VarPtr& autoReg = core::Var::getSafe(cfg::ServerAutoRegister);
-		if (autoReg->boolVal()) {
-			userStore.insert(email, password, ::persistence::Timestamp::now());
-			checkId = userStore.userid();
-		}
+	if (checkId == 0 && autoRegister) {
+		userStore.insert(email, password, ::persistence::Timestamp::now());
+		checkId = userStore.userid();
 	}
 	return checkId;
 }
 
-UserPtr EntityStorage::login(ENetPeer* peer, const std::string& email, const std::string& passwd) {
-	EntityId id = getUserId(email, passwd);
-	if (id <= 0) {
-		Log::warn("Could not get user id for email: %s", email.c_str());
-		return UserPtr();
+void EntityStorage::login(ENetPeer* peer, uint32_t connectID, const ENetAddress& address, const std::string& email, const std::string& passwd) {
+	_loginConnections[peer] = connectID;
+	_loginQueue.push_back(PendingLogin{peer, connectID, address, email, passwd, 0});
+}
+
+void EntityStorage::disconnect(ENetPeer* peer, uint32_t connectID) {
+	auto i = _loginConnections.find(peer);
+	if (i != _loginConnections.end() && i->second == connectID) {
+		_loginConnections.erase(i);
+	}
+}
+
+int EntityStorage::pendingLogins() const {
+	return (int)(_loginQueue.size() + _loginResults.size()) + _loginsInFlight;
+}
+
+void EntityStorage::admitLogins() {
+	const int loginsPerTick = _loginsPerTick->intVal();
+	const bool autoRegister = core::Var::getSafe(cfg::ServerAutoRegister)->boolVal();
+	for (int i = 0; i < loginsPerTick && !_loginQueue.empty(); ++i) {
+		PendingLogin login = std::move(_loginQueue.front());
+		_loginQueue.pop_front();
+		++_loginsInFlight;
+		// the copies of the credentials are only used by the database thread
+		const std::string email = login.email;
+		const std::string password = login.password;
+		_executor->submit([email, password, autoRegister] () {
+			return getUserId(email, password, autoRegister);
+		}, [this, login] (EntityId id) mutable {
+			--_loginsInFlight;
+			login.userId = id;
+			_loginResults.push_back(std::move(login));
+		});
 	}
+}
+
+void EntityStorage::finishLogins() {
+	std::vector<PendingLogin> results;
+	results.swap(_loginResults);
+	for (const PendingLogin& login : results) {
+		ENetPeer* peer = login.peer;
+		auto i = _loginConnections.find(peer);
+		if (i == _loginConnections.end() || i->second != login.connectID) {
+			Log::info("Peer of user %s disconnected while logging in", login.email.c_str());
+			continue;
+		}
+		if (login.userId <= 0) {
+			Log::warn("Could not get user id for email: %s", login.email.c_str());
+			sendAuthFailed(peer, login.connectID);
+			continue;
+		}
+		const UserPtr& user = spawnUser(login);
+		if (!user) {
+			sendAuthFailed(peer, login.connectID);
+			continue;
+		}
+		Log::info("User '%s' logged into the gameserver", login.email.c_str());
+		user->sendSeed(_world->seed());
+		user->sendUserSpawn();
+	}
+}
+
+void EntityStorage::sendAuthFailed(ENetPeer* peer, uint32_t connectID) {
+	flatbuffers::FlatBufferBuilder fbb;
+	_messageSender->sendServerMessage(peer, connectID, fbb, network::ServerMsgType::AuthFailed, network::CreateAuthFailed(fbb).Union());
+}
+
+UserPtr EntityStorage::spawnUser(const PendingLogin& login) {
+	const EntityId id = login.userId;
+	const ENetAddress& address = login.address;
 	auto i = _users.find(id);
 	if (i == _users.end()) {
 		static const std::string name = "NONAME";
-		Log::info("user %i connects with host %i on port %i", (int) id, peer->address.host, peer->address.port);
-		const UserPtr& u = std::make_shared<User>(peer, id, name, _messageSender, _world, _timeProvider, _containerProvider, _cooldownProvider, _poiProvider);
+		Log::info("user %i connects with host %i on port %i", (int) id, address.host, address.port);
+		const UserPtr& u = std::make_shared<User>(login.peer, login.connectID, address.host, id, name, _messageSender, _world, _timeProvider,
+				_containerProvider, _cooldownProvider, _poiProvider);
 		u->init();
 		registerUser(u);
 		return u;
 	}
 	const UserPtr& u = i->second;
-	if (u->host() == peer->address.host) {
-		Log::info("user %i reconnects with host %i on port %i", (int) id, peer->address.host, peer->address.port);
-		i->second->setPeer(peer);
+	if (u->host() == address.host) {
+		Log::info("user %i reconnects with host %i on port %i", (int) id, address.host, address.port);
+		i->second->setPeer(login.peer, login.connectID, address.host);
 		i->second->reconnect();
 		return i->second;
 	}
@@ -107,6 +183,12 @@ void EntityStorage::onFrame(long dt) {
 	static long lastFrame = _time;
 	_time += dt;
 
+	_cooldownProvider->wheel().update(_timeProvider->tickTime());
+
+	// the results arrived in the last frame - the new logins are checked until the next frame
+	finishLogins();
+	admitLogins();
+
 	// let this run at 4 frames per second
 	const long deltaLastTick = _time - lastFrame;
 	const long delayBetweenTicks = 250L;
@@ -162,7 +244,7 @@ bool EntityStorage::updateEntity(const EntityPtr& entity, long dt) {
 		}
 	}
 	set.erase(entity);
-	entity->updateVisible(set);
+	entity->updateVisible(set, *_interestProvider);
 	return true;
 }
 
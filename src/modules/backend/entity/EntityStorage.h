@@ -8,15 +8,24 @@
 #include "network/Network.h"
 #include "core/QuadTree.h"
 #include "core/TimeProvider.h"
+#include "core/Var.h"
 #include "ai/common/Types.h"
+#include "persistence/Executor.h"
 #include <unordered_map>
+#include <deque>
+#include <vector>
 
 namespace backend {
 
 /**
  * @brief Manages the Entity instances of the backend.
  *
- * This includes calling the Entity::update() method as well as performing the visibility calculations.
+ * This includes calling the Entity::update() method as well as performing the visibility calculations. The
+ * entity updates that are sent to the users are throttled by the distance tiers of the InterestProvider.
+ *
+ * Logins are a pipeline that never blocks the frame: @c cfg::ServerLoginsPerTick queued logins are admitted
+ * per frame, their credentials are checked on the database threads and the users are spawned in the frame
+ * after the result arrived.
  */
 class EntityStorage {
 private:
@@ -44,8 +53,28 @@ private:
 	attrib::ContainerProviderPtr _containerProvider;
 	PoiProviderPtr _poiProvider;
 	cooldown::CooldownProviderPtr _cooldownProvider;
+	InterestProviderPtr _interestProvider;
+	::persistence::ExecutorPtr _executor;
 	long _time;
 
+	struct PendingLogin {
+		ENetPeer* peer;
+		// enet reuses the peer for new connections
+		uint32_t connectID;
+		ENetAddress address;
+		std::string email;
+		std::string password;
+		EntityId userId;
+	};
+	// waiting for admission
+	std::deque<PendingLogin> _loginQueue;
+	// the credentials were checked - the users are spawned with the next frame
+	std::vector<PendingLogin> _loginResults;
+	// the connection of every peer that logged in - results for a connection that is gone are dropped
+	std::unordered_map<ENetPeer*, uint32_t> _loginConnections;
+	int _loginsInFlight = 0;
+	core::VarPtr _loginsPerTick;
+
 	void registerUser(const UserPtr& user);
 	// users are controlling npcs - and here we update them and send the messages to
 	// the users that are seeing this npc entity.
@@ -53,12 +82,43 @@ private:
 	bool updateEntity(const EntityPtr& entity, long dt);
 	void updateQuadTree();
 
-	EntityId getUserId(const std::string& email, const std::string& password) const;
+	/**
+	 * @note Executed on the database threads
+	 */
+	static EntityId getUserId(const std::string& email, const std::string& password, bool autoRegister);
+	void admitLogins();
+	void finishLogins();
+	UserPtr spawnUser(const PendingLogin& login);
 public:
 	EntityStorage(const network::MessageSenderPtr& messageSender, const voxel::WorldPtr& world, const core::TimeProviderPtr& timeProvider,
-			const attrib::ContainerProviderPtr& containerProvider, const PoiProviderPtr& poiProvider, const cooldown::CooldownProviderPtr& cooldownProvider);
-
-	UserPtr login(ENetPeer* peer, const std::string& email, const std::string& password);
+			const attrib::ContainerProviderPtr& containerProvider, const PoiProviderPtr& poiProvider, const cooldown::CooldownProviderPtr& cooldownProvider,
+			const InterestProviderPtr& interestProvider, const ::persistence::ExecutorPtr& executor);
+
+	/**
+	 * @brief Loads the interest management settings
+	 */
+	bool init();
+
+	/**
+	 * @brief Queues the login of the given peer. The seed and the user spawn are sent once the login
+	 * is finished - or an auth failed message if the credentials were not accepted.
+	 * @param[in] connectID The connection of the peer as it was handed out by the @c network::NewConnectionEvent
+	 * @param[in] address The address the connection came from
+	 */
+	void login(ENetPeer* peer, uint32_t connectID, const ENetAddress& address, const std::string& email, const std::string& password);
+	/**
+	 * @return The amount of logins that are queued, checked or waiting to get spawned
+	 */
+	int pendingLogins() const;
+	/**
+	 * @brief The connection of the peer is gone - the logins that are still pending for it are dropped
+	 * @note Must be called for every @c network::DisconnectEvent
+	 */
+	void disconnect(ENetPeer* peer, uint32_t connectID);
+	/**
+	 * @brief Informs the client that its credentials were not accepted
+	 */
+	void sendAuthFailed(ENetPeer* peer, uint32_t connectID);
 	bool logout(EntityId userId);
 
 	void addNpc(const NpcPtr& npc);
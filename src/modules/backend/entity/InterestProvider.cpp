@@ -0,0 +1,63 @@
+/**
+ * @file
+ */
+#include "InterestProvider.h"
+
+#include "commonlua/LUA.h"
+#include "core/App.h"
+#include "io/Filesystem.h"
+
+namespace backend {
+
+bool InterestProvider::init(const std::string& filename) {
+	if (filename.empty()) {
+		_error = "";
+		return true;
+	}
+
+	const std::string& interest = core::App::getInstance()->filesystem()->load(filename);
+	if (interest.empty()) {
+		_error = "Could not load file " + filename;
+		return false;
+	}
+
+	_error = "";
+
+	lua::LUA lua;
+	lua.newGlobalData<InterestProvider>("Provider", this);
+
+	// setInterest(type, nearFraction, midFraction, midInterval, significantDistance, significantOrientation)
+	lua.registerGlobal("setInterest", [] (lua_State* s) {
+		InterestProvider* data = lua::LUA::globalData<InterestProvider>(s, "Provider");
+		const char *typeStr = luaL_checkstring(s, 1);
+		const network::EntityType type = network::getEnum<network::EntityType>(typeStr, network::EnumNamesEntityType());
+		if (type == network::EntityType::NONE) {
+			luaL_error(s, "%s is an invalid entity type", typeStr);
+		}
+		Interest interest;
+		interest.nearFraction = luaL_checknumber(s, 2);
+		interest.midFraction = luaL_checknumber(s, 3);
+		interest.midInterval = luaL_optinteger(s, 4, interest.midInterval);
+		interest.significantDistance = luaL_optnumber(s, 5, interest.significantDistance);
+		interest.significantOrientation = luaL_optnumber(s, 6, interest.significantOrientation);
+		if (interest.nearFraction > interest.midFraction) {
+			luaL_error(s, "the near fraction of %s is bigger than the mid fraction", typeStr);
+		}
+		if (interest.midInterval < 1) {
+			luaL_error(s, "the mid interval of %s must be at least 1", typeStr);
+		}
+		Log::debug("set interest for %s to near: %f, mid: %f (every %i ticks)", typeStr,
+				interest.nearFraction, interest.midFraction, interest.midInterval);
+		data->setInterest(type, interest);
+		return 0;
+	});
+
+	if (!lua.load(interest)) {
+		_error = lua.error();
+		return false;
+	}
+
+	return true;
+}
+
+}
@@ -0,0 +1,107 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "core/Common.h"
+#include "network/ProtocolEnum.h"
+#include <memory>
+#include <string>
+
+namespace backend {
+
+/**
+ * @brief The distance tiers that define how often an entity update is sent to an observer.
+ */
+enum class InterestTier : uint8_t {
+	/** updated every visibility tick */
+	Near,
+	/** updated every @c Interest::midInterval visibility ticks */
+	Mid,
+	/** only updated on significant changes - see @c Interest::significantDistance */
+	Far
+};
+
+/**
+ * @brief The interest management settings for one entity type.
+ *
+ * The tier distances are fractions of the view distance of the observing entity.
+ */
+struct Interest {
+	float nearFraction = 0.25f;
+	float midFraction = 0.6f;
+	/** the amount of visibility ticks between two updates of mid range entities */
+	int midInterval = 2;
+	/** the distance a far entity must have moved since the last update that was sent */
+	float significantDistance = 4.0f;
+	/** the orientation delta (in radians) a far entity must have turned since the last update that was sent */
+	float significantOrientation = 0.5f;
+};
+
+/**
+ * @brief Manages the interest management settings per entity type.
+ */
+class InterestProvider {
+private:
+	Interest _interests[std::enum_value(network::EntityType::MAX) + 1];
+	std::string _error;
+public:
+	/**
+	 * @brief Returns the tier the given entity type is in for an observer at the given squared distance
+	 * @param[in] type The type of the observed entity
+	 * @param[in] distance2 The squared distance between the observer and the observed entity
+	 * @param[in] viewDistance The view distance of the observer
+	 */
+	InterestTier tier(network::EntityType type, float distance2, float viewDistance) const;
+
+	const Interest& interest(network::EntityType type) const;
+
+	/**
+	 * @brief Allow to manually override the settings for an entity type
+	 */
+	void setInterest(network::EntityType type, const Interest& interest);
+
+	/**
+	 * @brief Initializes the interest settings.
+	 * @param[in] filename If this string is not empty, it is taken as a filename to the lua script
+	 * that contains the interest settings. Entity types that are not configured keep the defaults.
+	 * @return @c false in case of an error, @c true if the initialization was successful.
+	 * @sa error()
+	 */
+	bool init(const std::string& filename);
+
+	/**
+	 * @brief Access to the last error that was reported in case the @c init() call failed.
+	 * @sa init()
+	 */
+	const std::string& error() const;
+};
+
+inline const std::string& InterestProvider::error() const {
+	return _error;
+}
+
+inline const Interest& InterestProvider::interest(network::EntityType type) const {
+	return _interests[std::enum_value(type)];
+}
+
+inline void InterestProvider::setInterest(network::EntityType type, const Interest& interest) {
+	_interests[std::enum_value(type)] = interest;
+}
+
+inline InterestTier InterestProvider::tier(network::EntityType type, float distance2, float viewDistance) const {
+	const Interest& i = interest(type);
+	const float nearDistance = viewDistance * i.nearFraction;
+	if (distance2 <= nearDistance * nearDistance) {
+		return InterestTier::Near;
+	}
+	const float midDistance = viewDistance * i.midFraction;
+	if (distance2 <= midDistance * midDistance) {
+		return InterestTier::Mid;
+	}
+	return InterestTier::Far;
+}
+
+typedef std::shared_ptr<InterestProvider> InterestProviderPtr;
+
+}
@@ -2,7 +2,6 @@
  * @file
  */
 
-#include "voxel/polyvox/AStarPathfinder.h"
 #include "Npc.h"
 #include "EntityStorage.h"
 #include "backend/poi/PoiProvider.h"
@@ -21,6 +20,7 @@ Npc::Npc(network::EntityType type, const EntityStoragePtr& entityStorage, const
 }
 
 Npc::~Npc() {
+	_world->cancelPath(_path);
 	ai::Zone* zone = _ai->getZone();
 	if (zone == nullptr) {
 		return;
@@ -75,7 +75,8 @@ bool Npc::attack(ai::CharacterId id) {
 	if (strength <= 0.0) {
 		return false;
 	}
-	return _ai->getZone()->executeAsync(id, [=] (const ai::AIPtr & targetAi) {
+	// the target is modified after the parallel behaviour ticks - it might be ticked by another worker right now
+	return _ai->getZone()->executeDeferred(id, [=] (const ai::AIPtr & targetAi) {
 		AICharacter& targetChr = ai::character_cast<AICharacter>(targetAi->getCharacter());
 		targetChr.getNpc().applyDamage(this, strength);
 	});
@@ -92,12 +93,22 @@ bool Npc::update(long dt) {
 }
 
 bool Npc::route(const glm::ivec3& target) {
-	std::list<glm::ivec3> result;
+	if (_path) {
+		if (_path->end() == target) {
+			const voxel::Path::State state = _path->state();
+			if (state == voxel::Path::State::Pending || state == voxel::Path::State::Found) {
+				// TODO: use the route
+				return true;
+			}
+			_path.reset();
+			return false;
+		}
+		_world->cancelPath(_path);
+	}
 	const glm::vec3& pos = _ai->getCharacter()->getPosition();
 	const glm::ivec3 start(pos);
-	const glm::ivec3 end(target.x, target.y, target.z);
-	// TODO: use the route
-	return _world->findPath(start, end, result);
+	_path = _world->requestPath(start, target);
+	return (bool)_path;
 }
 
 void Npc::moveToGround() {
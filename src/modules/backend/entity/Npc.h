@@ -20,6 +20,8 @@ private:
 	PoiProviderPtr _poiProvider;
 	glm::ivec3 _homePosition;
 	ai::AIPtr _ai;
+	// the current route - see route()
+	voxel::PathPtr _path;
 
 	void moveToGround();
 
@@ -39,6 +41,11 @@ public:
 	 */
 	void setPointOfInterest();
 	const glm::ivec3& homePosition() const;
+	/**
+	 * @brief Requests a path to the given target. The search is executed asynchronously, a route
+	 * to a different target cancels the previous one.
+	 * @return @c false if no path to the target could be found
+	 */
 	bool route(const glm::ivec3& target);
 	const ai::AIPtr& ai();
 
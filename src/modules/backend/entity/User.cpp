@@ -8,12 +8,12 @@
 
 namespace backend {
 
-User::User(ENetPeer* peer, EntityId id, const std::string& name, const network::MessageSenderPtr& messageSender,
+User::User(ENetPeer* peer, uint32_t connectID, uint32_t host, EntityId id, const std::string& name, const network::MessageSenderPtr& messageSender,
 		const voxel::WorldPtr& world, const core::TimeProviderPtr& timeProvider, const attrib::ContainerProviderPtr& containerProvider,
 		const cooldown::CooldownProviderPtr& cooldownProvider, const PoiProviderPtr& poiProvider) :
 		Entity(id, messageSender, timeProvider, containerProvider, cooldownProvider),
 		_name(name), _world(world), _poiProvider(poiProvider) {
-	setPeer(peer);
+	setPeer(peer, connectID, host);
 	const glm::vec3& poi = _poiProvider->getPointOfInterest();
 	_pos = poi;
 	_entityType = network::EntityType::PLAYER;
@@ -34,14 +34,16 @@ void User::visibleRemove(const EntitySet& entities) {
 	}
 }
 
-ENetPeer* User::setPeer(ENetPeer* peer) {
+ENetPeer* User::setPeer(ENetPeer* peer, uint32_t connectID, uint32_t host) {
 	ENetPeer* old = _peer;
+	if (old != nullptr && old->data == this) {
+		old->data = nullptr;
+	}
 	_peer = peer;
-	if (_peer) {
-		_host = _peer->address.host;
+	_connectID = connectID;
+	_host = host;
+	if (_peer != nullptr) {
 		_peer->data = this;
-	} else {
-		_host = 0u;
 	}
 	return old;
 }
@@ -57,6 +59,7 @@ void User::disconnect() {
 void User::reconnect() {
 	Log::trace("reconnect user");
 	_attribs.markAsDirty();
+	resetInterest();
 	visitVisible([&] (const EntityPtr& e) {
 		sendEntitySpawn(e);
 	});
@@ -107,7 +110,7 @@ bool User::update(long dt) {
 	Log::trace("move: dt %li, speed: %f p(%f:%f:%f), pitch: %f, yaw: %f", dt, speed, _pos.x, _pos.y, _pos.z, orientation(), _yaw);
 
 	const network::Vec3 pos { _pos.x, _pos.y, _pos.z };
-	_messageSender->sendServerMessage(_peer, _entityUpdateFbb,
+	_messageSender->sendServerMessage(_peer, _connectID, _entityUpdateFbb,
 			network::ServerMsgType::EntityUpdate,
 			network::CreateEntityUpdate(_entityUpdateFbb, id(), &pos, orientation()).Union());
 
@@ -116,7 +119,7 @@ bool User::update(long dt) {
 
 void User::sendSeed(long seed) const {
 	flatbuffers::FlatBufferBuilder fbb;
-	_messageSender->sendServerMessage(_peer, fbb, network::ServerMsgType::Seed, network::CreateSeed(fbb, seed).Union());
+	_messageSender->sendServerMessage(_peer, _connectID, fbb, network::ServerMsgType::Seed, network::CreateSeed(fbb, seed).Union());
 }
 
 void User::sendUserSpawn() const {
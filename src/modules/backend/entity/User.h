@@ -35,7 +35,7 @@ protected:
 	void visibleRemove(const EntitySet& entities) override;
 
 public:
-	User(ENetPeer* peer, EntityId id, const std::string& name, const network::MessageSenderPtr& messageSender, const voxel::WorldPtr& world,
+	User(ENetPeer* peer, uint32_t connectID, uint32_t host, EntityId id, const std::string& name, const network::MessageSenderPtr& messageSender, const voxel::WorldPtr& world,
 			const core::TimeProviderPtr& timeProvider, const attrib::ContainerProviderPtr& containerProvider, const cooldown::CooldownProviderPtr& cooldownProvider,
 			const PoiProviderPtr& poiProvider);
 
@@ -67,8 +67,11 @@ public:
 
 	/**
 	 * @brief Sets a new ENetPeer and returns the old one.
+	 * @param[in] connectID The connection of the peer as it was handed out by the @c network::NewConnectionEvent
+	 * @param[in] host The address the connection came from - a reconnect is only accepted from the same host
+	 * @note The host is kept if the peer is reset to @c nullptr
 	 */
-	ENetPeer* setPeer(ENetPeer* peer);
+	ENetPeer* setPeer(ENetPeer* peer, uint32_t connectID, uint32_t host);
 
 	uint32_t host() const {
 		return _host;
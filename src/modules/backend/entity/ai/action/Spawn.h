@@ -44,11 +44,18 @@ public:
 
 	TreeNodeStatus doAction(backend::AICharacter& chr, int64_t deltaMillis) override {
 		backend::Npc& npc = chr.getNpc();
-		const glm::ivec3 pos = glm::ivec3(npc.pos());
-		if (_spawnMgr->spawn(*npc.ai()->getZone(), npc.entityType(), 1, &pos) == 1) {
-			return FINISHED;
+		ai::Zone* zone = npc.ai()->getZone();
+		if (zone == nullptr) {
+			return FAILED;
 		}
-		return FAILED;
+		const glm::ivec3 pos = glm::ivec3(npc.pos());
+		const network::EntityType type = npc.entityType();
+		const backend::SpawnMgrPtr spawnMgr = _spawnMgr;
+		// the entity storage isn't synchronized - spawn after the parallel behaviour ticks
+		zone->executeDeferred([=] () {
+			spawnMgr->spawn(*zone, type, 1, &pos);
+		});
+		return FINISHED;
 	}
 };
 
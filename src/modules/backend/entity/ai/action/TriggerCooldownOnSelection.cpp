@@ -28,7 +28,7 @@ TreeNodeStatus TriggerCooldownOnSelection::doAction(backend::AICharacter& chr, i
 			Npc& npc = ai->getCharacterCast<AICharacter>().getNpc();
 			npc.cooldownMgr().triggerCooldown(_cooldownId);
 		};
-		zone->executeAsync(id, func);
+		zone->executeDeferred(id, func);
 	}
 	return FINISHED;
 }
@@ -29,27 +29,38 @@ constexpr int aiDebugServerPort = 11338;
 constexpr const char* aiDebugServerInterface = "127.0.0.1";
 
 ServerLoop::ServerLoop(const network::NetworkPtr& network, const SpawnMgrPtr& spawnMgr, const voxel::WorldPtr& world, const EntityStoragePtr& entityStorage, const core::EventBusPtr& eventBus, const AIRegistryPtr& registry,
-		const attrib::ContainerProviderPtr& containerProvider, const PoiProviderPtr& poiProvider, const cooldown::CooldownProviderPtr& cooldownProvider) :
+		const attrib::ContainerProviderPtr& containerProvider, const PoiProviderPtr& poiProvider, const cooldown::CooldownProviderPtr& cooldownProvider,
+		const ::persistence::ExecutorPtr& executor) :
 		_network(network), _spawnMgr(spawnMgr), _world(world),
-		_entityStorage(entityStorage), _eventBus(eventBus), _registry(registry), _containerProvider(containerProvider), _poiProvider(poiProvider), _cooldownProvider(cooldownProvider) {
+		_entityStorage(entityStorage), _eventBus(eventBus), _registry(registry), _containerProvider(containerProvider), _poiProvider(poiProvider), _cooldownProvider(cooldownProvider), _executor(executor) {
 	_world->setClientData(false);
 	_eventBus->subscribe<network::NewConnectionEvent>(*this);
 	_eventBus->subscribe<network::DisconnectEvent>(*this);
 }
 
 bool ServerLoop::init() {
-	if (core::Singleton<::persistence::ConnectionPool>::getInstance().init() <= 0) {
+	if (::persistence::ConnectionPool::get().init() <= 0) {
 		Log::error("Failed to init the connection pool");
 		return false;
 	}
 	persistence::UserStore u;
 	u.createTable();
 
+	if (!_executor->init()) {
+		Log::error("Failed to init the database executor");
+		return false;
+	}
+
 	if (!_cooldownProvider->init("cooldowns.lua")) {
 		Log::error("Failed to load the cooldown configuration: %s", _cooldownProvider->error().c_str());
 		return false;
 	}
 
+	if (!_entityStorage->init()) {
+		Log::error("Failed to init the entity storage");
+		return false;
+	}
+
 	_zone = new ai::Zone("Zone");
 	_aiServer = new ai::Server(*_registry, aiDebugServerPort, aiDebugServerInterface);
 
@@ -65,7 +76,7 @@ bool ServerLoop::init() {
 	}
 
 	const network::ProtocolHandlerRegistryPtr& r = _network->registry();
-	r->registerHandler(network::EnumNameClientMsgType(network::ClientMsgType::UserConnect), std::make_shared<UserConnectHandler>(_network, _entityStorage, _world));
+	r->registerHandler(network::EnumNameClientMsgType(network::ClientMsgType::UserConnect), std::make_shared<UserConnectHandler>(_network, _entityStorage));
 	r->registerHandler(network::EnumNameClientMsgType(network::ClientMsgType::UserConnected), std::make_shared<UserConnectedHandler>());
 	r->registerHandler(network::EnumNameClientMsgType(network::ClientMsgType::UserDisconnect), std::make_shared<UserDisconnectHandler>());
 	r->registerHandler(network::EnumNameClientMsgType(network::ClientMsgType::Attack), std::make_shared<AttackHandler>());
@@ -95,7 +106,9 @@ bool ServerLoop::init() {
 
 void ServerLoop::shutdown() {
 	_world->shutdown();
-	core::Singleton<::persistence::ConnectionPool>::getInstance().shutdown();
+	// writes the queued rows - needs the connection pool
+	_executor->shutdown();
+	::persistence::ConnectionPool::get().shutdown();
 	_spawnMgr->shutdown();
 	delete _zone;
 	delete _aiServer;
@@ -140,21 +153,30 @@ void ServerLoop::onFrame(long dt) {
 		core_trace_scoped(EntityStorage);
 		_entityStorage->onFrame(dt);
 	}
+	{
+		core_trace_scoped(DatabaseExecutor);
+		_executor->update(core::App::getInstance()->timeProvider()->tickTime());
+	}
+	// hand everything that was produced in this frame over to the send scheduler
+	_network->flush();
 }
 
 void ServerLoop::onEvent(const network::DisconnectEvent& event) {
 	ENetPeer* peer = event.peer();
-	Log::info("disconnect peer: %u", peer->connectID);
+	Log::info("disconnect peer: %u", event.connectID());
+	_entityStorage->disconnect(peer, event.connectID());
 	User* user = reinterpret_cast<User*>(peer->data);
-	if (user == nullptr) {
+	if (user == nullptr || user->connectID() != event.connectID()) {
 		return;
 	}
+	// enet reuses the peer - the next connection must not be able to act as this user
+	user->setPeer(nullptr, 0u, user->host());
 	// TODO: handle this and abort on re-login
 	user->cooldownMgr().triggerCooldown(cooldown::Type::LOGOUT);
 }
 
 void ServerLoop::onEvent(const network::NewConnectionEvent& event) {
-	Log::info("new connection - waiting for login request from %u", event.peer()->connectID);
+	Log::info("new connection - waiting for login request from %u", event.connectID());
 }
 
 }
@@ -13,6 +13,7 @@
 #include "core/Input.h"
 #include "network/ProtocolHandlerRegistry.h"
 #include "backend/entity/EntityStorage.h"
+#include "persistence/Executor.h"
 #include "core/EventBus.h"
 
 #include <memory>
@@ -37,6 +38,7 @@ private:
 	attrib::ContainerProviderPtr _containerProvider;
 	PoiProviderPtr _poiProvider;
 	cooldown::CooldownProviderPtr _cooldownProvider;
+	::persistence::ExecutorPtr _executor;
 	core::Input _input;
 
 	void readInput();
@@ -44,7 +46,7 @@ public:
 	ServerLoop(const network::NetworkPtr& network, const SpawnMgrPtr& spawnMgr, const voxel::WorldPtr& world,
 			const EntityStoragePtr& entityStorage, const core::EventBusPtr& eventBus, const AIRegistryPtr& registry,
 			const attrib::ContainerProviderPtr& containerProvider, const PoiProviderPtr& poiProvider,
-			const cooldown::CooldownProviderPtr& cooldownProvider);
+			const cooldown::CooldownProviderPtr& cooldownProvider, const ::persistence::ExecutorPtr& executor);
 
 	bool init();
 	void shutdown();
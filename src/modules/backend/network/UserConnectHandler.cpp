@@ -5,22 +5,13 @@
 #include "UserConnectHandler.h"
 #include "ClientMessages_generated.h"
 #include "ServerMessages_generated.h"
-#include "backend/entity/User.h"
 #include "core/Var.h"
 #include "util/EMailValidator.h"
 
 namespace backend {
 
-UserConnectHandler::UserConnectHandler(network::NetworkPtr network, backend::EntityStoragePtr entityStorage, voxel::WorldPtr world) :
-		_network(network), _entityStorage(entityStorage), _world(world) {
-	auto data = network::CreateAuthFailed(_authFailed);
-	auto msg = network::CreateServerMessage(_authFailed, network::ServerMsgType::AuthFailed, data.Union());
-	network::FinishServerMessageBuffer(_authFailed, msg);
-}
-
-void UserConnectHandler::sendAuthFailed(ENetPeer* peer) {
-	ENetPacket* packet = enet_packet_create(_authFailed.GetBufferPointer(), _authFailed.GetSize(), ENET_PACKET_FLAG_RELIABLE);
-	_network->sendMessage(peer, packet);
+UserConnectHandler::UserConnectHandler(network::NetworkPtr network, backend::EntityStoragePtr entityStorage) :
+		_network(network), _entityStorage(entityStorage) {
 }
 
 void UserConnectHandler::execute(ENetPeer* peer, const void* raw) {
@@ -28,27 +19,19 @@ void UserConnectHandler::execute(ENetPeer* peer, const void* raw) {
 
 	const std::string& email = message->email()->str();
 	if (!util::isValidEmail(email)) {
-		sendAuthFailed(peer);
+		_entityStorage->sendAuthFailed(peer, _network->connectID(peer));
 		Log::warn("Invalid email given: '%s', %c", email.c_str(), email[0]);
 		return;
 	}
 	const std::string& password = message->password()->str();
 	if (password.empty()) {
 		Log::warn("User tries to log into the gameserver without providing a password");
-		sendAuthFailed(peer);
+		_entityStorage->sendAuthFailed(peer, _network->connectID(peer));
 		return;
 	}
 	Log::info("User %s tries to log into the gameserver", email.c_str());
 
-	UserPtr user = _entityStorage->login(peer, email, password);
-	if (!user) {
-		sendAuthFailed(peer);
-		return;
-	}
-
-	Log::info("User '%s' logged into the gameserver", email.c_str());
-	user->sendSeed(_world->seed());
-	user->sendUserSpawn();
+	_entityStorage->login(peer, _network->connectID(peer), _network->address(peer), email, password);
 }
 
 }
@@ -21,12 +21,12 @@ public:
 		core::Var::get(cfg::DatabaseUser, "engine");
 		core::Var::get(cfg::DatabasePassword, "engine");
 
-		core::Singleton<::persistence::ConnectionPool>::getInstance().init();
+		::persistence::ConnectionPool::get().init();
 	}
 
 	void TearDown() override {
 		Super::TearDown();
-		core::Singleton<::persistence::ConnectionPool>::getInstance().shutdown();
+		::persistence::ConnectionPool::get().shutdown();
 	}
 };
 
@@ -49,4 +49,21 @@ TEST_F(DatabaseModelTest, testWrite) {
 	ASSERT_EQ(u2nd.userid(), u.userid());
 }
 
+TEST_F(DatabaseModelTest, testSelect) {
+	ASSERT_TRUE(persistence::UserStore::createTable()) << "Could not create table";
+	persistence::UserStore::truncate();
+	const std::string password = "secret";
+	const ::persistence::Timestamp ts = ::persistence::Timestamp::now();
+	persistence::UserStore u;
+	ASSERT_TRUE(u.insert("a@b.c.d", password, ts));
+	ASSERT_TRUE(u.insert("e@f.g.h", password, ts));
+
+	int rows = 0;
+	ASSERT_TRUE(persistence::UserStore::select(nullptr, &password, nullptr, [&] (const persistence::UserStore& model) {
+		EXPECT_NE(0, model.userid());
+		++rows;
+	}));
+	ASSERT_EQ(2, rows);
+}
+
 }
@@ -0,0 +1,105 @@
+/**
+ * @file
+ */
+
+#include "core/tests/AbstractTest.h"
+#include "backend/entity/EntityStorage.h"
+#include "backend/entity/InterestProvider.h"
+#include "backend/poi/PoiProvider.h"
+#include "network/MessageSender.h"
+#include "network/ProtocolHandlerRegistry.h"
+#include "attrib/ContainerProvider.h"
+#include "cooldown/CooldownProvider.h"
+#include "persistence/ConnectionPool.h"
+#include "voxel/World.h"
+#include "DatabaseModels.h"
+#include <chrono>
+
+namespace backend {
+
+class EntityStorageTest: public core::AbstractTest {
+	using Super = core::AbstractTest;
+protected:
+	::persistence::ExecutorPtr _executor;
+	EntityStoragePtr _entityStorage;
+public:
+	void SetUp() override {
+		Super::SetUp();
+		core::Var::get(cfg::DatabaseMinConnections, "1");
+		core::Var::get(cfg::DatabaseMaxConnections, "4");
+		core::Var::get(cfg::DatabaseName, "engine");
+		core::Var::get(cfg::DatabaseHost, "localhost");
+		core::Var::get(cfg::DatabaseUser, "engine");
+		core::Var::get(cfg::DatabasePassword, "engine");
+		core::Var::get(cfg::DatabaseThreads, "4");
+		core::Var::get(cfg::ServerAutoRegister, "true");
+		core::Var::get(cfg::ServerUserTimeout, "60000");
+		core::Var::get(cfg::ServerLoginsPerTick, "20");
+
+		::persistence::ConnectionPool::get().init();
+		ASSERT_TRUE(persistence::UserStore::createTable());
+		persistence::UserStore::truncate();
+
+		_executor = std::make_shared<::persistence::Executor>();
+		ASSERT_TRUE(_executor->init());
+
+		const core::EventBusPtr eventBus = std::make_shared<core::EventBus>();
+		const network::NetworkPtr network = std::make_shared<network::Network>(std::make_shared<network::ProtocolHandlerRegistry>(), eventBus);
+		const network::MessageSenderPtr messageSender = std::make_shared<network::MessageSender>(network);
+		const voxel::WorldPtr world = std::make_shared<voxel::World>();
+		const core::TimeProviderPtr timeProvider = std::make_shared<core::TimeProvider>();
+		const PoiProviderPtr poiProvider = std::make_shared<PoiProvider>(world, timeProvider);
+		poiProvider->addPointOfInterest(glm::vec3(1.0f));
+		_entityStorage = std::make_shared<EntityStorage>(messageSender, world, timeProvider,
+				std::make_shared<attrib::ContainerProvider>(), poiProvider, std::make_shared<cooldown::CooldownProvider>(),
+				std::make_shared<InterestProvider>(), _executor);
+	}
+
+	void TearDown() override {
+		_executor->shutdown();
+		::persistence::ConnectionPool::get().shutdown();
+		Super::TearDown();
+	}
+};
+
+TEST_F(EntityStorageTest, testLoginPipeline) {
+	const int logins = 500;
+	std::vector<ENetPeer> peers(logins);
+	for (int i = 0; i < logins; ++i) {
+		ENetPeer& peer = peers[i];
+		peer.address.host = i + 1;
+		_entityStorage->login(&peer, i + 1, peer.address, "user" + std::to_string(i) + "@b.c.d", "secret");
+	}
+	ASSERT_EQ(logins, _entityStorage->pendingLogins());
+
+	// the frame must not wait for the database - even with all logins at once
+	long maxFrameMillis = 0l;
+	for (int frame = 0; frame < 100000 && _entityStorage->pendingLogins() > 0; ++frame) {
+		const auto start = std::chrono::steady_clock::now();
+		_entityStorage->onFrame(0l);
+		_executor->update(frame);
+		const auto end = std::chrono::steady_clock::now();
+		maxFrameMillis = std::max(maxFrameMillis, (long)std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	ASSERT_EQ(0, _entityStorage->pendingLogins());
+	EXPECT_LT(maxFrameMillis, 50l);
+	for (const ENetPeer& peer : peers) {
+		EXPECT_NE(nullptr, peer.data) << "No user was spawned for the peer";
+	}
+}
+
+TEST_F(EntityStorageTest, testLoginOfDisconnectedPeer) {
+	ENetPeer peer {};
+	_entityStorage->login(&peer, 1u, peer.address, "a@b.c.d", "secret");
+	// the connection is gone while the credentials are checked - enet might reuse the peer
+	_entityStorage->disconnect(&peer, 1u);
+	for (int frame = 0; frame < 100000 && _entityStorage->pendingLogins() > 0; ++frame) {
+		_entityStorage->onFrame(0l);
+		_executor->update(frame);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(nullptr, peer.data);
+}
+
+}
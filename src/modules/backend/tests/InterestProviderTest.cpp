@@ -0,0 +1,138 @@
+/**
+ * @file
+ */
+
+#include "core/tests/AbstractTest.h"
+#include "backend/entity/InterestProvider.h"
+#include "backend/entity/Entity.h"
+#include "attrib/ContainerProvider.h"
+#include "cooldown/CooldownProvider.h"
+#include "core/TimeProvider.h"
+
+namespace backend {
+
+class InterestProviderTest: public core::AbstractTest {
+protected:
+	/**
+	 * @brief Counts the entity updates that passed the interest tier throttling
+	 */
+	class ObserverEntity: public Entity {
+	private:
+		ENetPeer _fakePeer {};
+	public:
+		mutable std::unordered_map<EntityId, int> updates;
+		mutable std::unordered_map<EntityId, int> reliableUpdates;
+
+		ObserverEntity(EntityId id, float viewDistance) :
+				Entity(id, network::MessageSenderPtr(), std::make_shared<core::TimeProvider>(),
+						std::make_shared<attrib::ContainerProvider>(), std::make_shared<cooldown::CooldownProvider>()) {
+			// the updates are only sent to entities with a peer
+			_peer = &_fakePeer;
+			_attribs.setCurrent(attrib::Type::VIEWDISTANCE, viewDistance);
+		}
+
+	protected:
+		void sendEntityUpdate(const EntityPtr& entity, network::SendPriority priority, bool reliable) const override {
+			++updates[entity->id()];
+			if (reliable) {
+				++reliableUpdates[entity->id()];
+			}
+		}
+	};
+
+	EntityPtr createEntity(EntityId id, const glm::vec3& pos) const {
+		const EntityPtr& entity = std::make_shared<Entity>(id, network::MessageSenderPtr(), std::make_shared<core::TimeProvider>(),
+				std::make_shared<attrib::ContainerProvider>(), std::make_shared<cooldown::CooldownProvider>());
+		entity->setPos(pos);
+		return entity;
+	}
+};
+
+TEST_F(InterestProviderTest, testDefaultTiers) {
+	InterestProvider provider;
+	const float viewDistance = 100.0f;
+	const network::EntityType type = network::EntityType::ANIMAL_WOLF;
+	const Interest& interest = provider.interest(type);
+	const float near = viewDistance * interest.nearFraction;
+	const float mid = viewDistance * interest.midFraction;
+	EXPECT_EQ(InterestTier::Near, provider.tier(type, 0.0f, viewDistance));
+	EXPECT_EQ(InterestTier::Near, provider.tier(type, near * near, viewDistance));
+	EXPECT_EQ(InterestTier::Mid, provider.tier(type, (near + 1.0f) * (near + 1.0f), viewDistance));
+	EXPECT_EQ(InterestTier::Mid, provider.tier(type, mid * mid, viewDistance));
+	EXPECT_EQ(InterestTier::Far, provider.tier(type, (mid + 1.0f) * (mid + 1.0f), viewDistance));
+}
+
+TEST_F(InterestProviderTest, testPerEntityType) {
+	InterestProvider provider;
+	Interest interest;
+	interest.nearFraction = 0.5f;
+	interest.midFraction = 0.9f;
+	provider.setInterest(network::EntityType::PLAYER, interest);
+	const float distance = 40.0f;
+	EXPECT_EQ(InterestTier::Near, provider.tier(network::EntityType::PLAYER, distance * distance, 100.0f));
+	EXPECT_EQ(InterestTier::Mid, provider.tier(network::EntityType::ANIMAL_RABBIT, distance * distance, 100.0f));
+}
+
+TEST_F(InterestProviderTest, testUpdateThrottling) {
+	InterestProvider provider;
+	const Interest& interest = provider.interest(network::EntityType::NONE);
+	ASSERT_EQ(2, interest.midInterval);
+	ASSERT_FLOAT_EQ(4.0f, interest.significantDistance);
+	const float viewDistance = 100.0f;
+	ObserverEntity observer(1, viewDistance);
+	const EntityPtr& nearEntity = createEntity(2, glm::vec3(10.0f, 0.0f, 0.0f));
+	const EntityPtr& midEntity = createEntity(3, glm::vec3(40.0f, 0.0f, 0.0f));
+	const EntityPtr& farEntity = createEntity(4, glm::vec3(80.0f, 0.0f, 0.0f));
+	const EntityPtr& idleEntity = createEntity(5, glm::vec3(5.0f, 0.0f, 0.0f));
+	ASSERT_EQ(InterestTier::Near, provider.tier(network::EntityType::NONE, 10.5f * 10.5f, viewDistance));
+	ASSERT_EQ(InterestTier::Mid, provider.tier(network::EntityType::NONE, 45.0f * 45.0f, viewDistance));
+	ASSERT_EQ(InterestTier::Far, provider.tier(network::EntityType::NONE, 80.0f * 80.0f, viewDistance));
+	const EntitySet visible { nearEntity, midEntity, farEntity, idleEntity };
+
+	const int ticks = 10;
+	for (int tick = 0; tick < ticks; ++tick) {
+		observer.updateVisible(visible, provider);
+		// every moving entity moves half a unit per tick - they all stay in their tiers
+		for (const EntityPtr& e : { nearEntity, midEntity, farEntity }) {
+			e->setPos(e->pos() + glm::vec3(0.5f, 0.0f, 0.0f));
+		}
+	}
+
+	// the first tick sends everything, near entities are updated on every tick
+	EXPECT_EQ(ticks, observer.updates[nearEntity->id()]);
+	// mid range entities every midInterval ticks: 1, 3, 5, 7 and 9
+	EXPECT_EQ(5, observer.updates[midEntity->id()]);
+	// far entities once they moved the significant distance: tick 1 and 9
+	EXPECT_EQ(2, observer.updates[farEntity->id()]);
+	// entities that don't change are not sent again
+	EXPECT_EQ(1, observer.updates[idleEntity->id()]);
+}
+
+TEST_F(InterestProviderTest, testRestingEntityIsSentReliably) {
+	InterestProvider provider;
+	ObserverEntity observer(1, 100.0f);
+	const EntityPtr& entity = createEntity(2, glm::vec3(10.0f, 0.0f, 0.0f));
+	const EntitySet visible { entity };
+
+	// the first state is sent reliably
+	observer.updateVisible(visible, provider);
+	EXPECT_EQ(1, observer.updates[entity->id()]);
+	EXPECT_EQ(1, observer.reliableUpdates[entity->id()]);
+
+	// the movement is sent unreliable
+	for (int tick = 0; tick < 3; ++tick) {
+		entity->setPos(entity->pos() + glm::vec3(0.5f, 0.0f, 0.0f));
+		observer.updateVisible(visible, provider);
+	}
+	EXPECT_EQ(4, observer.updates[entity->id()]);
+	EXPECT_EQ(1, observer.reliableUpdates[entity->id()]);
+
+	// the state the entity came to rest with is repeated reliably - but only once
+	for (int tick = 0; tick < 3; ++tick) {
+		observer.updateVisible(visible, provider);
+	}
+	EXPECT_EQ(5, observer.updates[entity->id()]);
+	EXPECT_EQ(2, observer.reliableUpdates[entity->id()]);
+}
+
+}
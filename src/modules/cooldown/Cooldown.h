@@ -8,88 +8,83 @@
 #include "CooldownType.h"
 #include "CooldownTriggerState.h"
 
-#include <memory>
+#include <atomic>
 
 namespace cooldown {
 
+class CooldownWheel;
+
 /**
  * @defgroup Cooldowns
  * @{
  */
+
+/**
+ * @brief A cooldown of one type for one entity.
+ *
+ * The instances live in the pool of the @c CooldownWheel and are only modified by it. The
+ * start and expire times may be read from any thread.
+ */
 class Cooldown {
+	friend class CooldownWheel;
 private:
-	Type _type;
-	unsigned long _durationMillis;
-	unsigned long _startMillis;
-	unsigned long _expireMillis;
-	core::TimeProviderPtr _timeProvider;
-
-public:
-	Cooldown(Type type, unsigned long durationMillis, const core::TimeProviderPtr& timeProvider) :
-			_type(type), _durationMillis(durationMillis), _startMillis(0ul), _expireMillis(0ul), _timeProvider(timeProvider) {
+	Type _type = Type::NONE;
+	unsigned long _durationMillis = 0ul;
+	std::atomic<unsigned long> _startMillis { 0ul };
+	std::atomic<unsigned long> _expireMillis { 0ul };
+	const core::TimeProvider* _timeProvider = nullptr;
+
+	inline void init(Type type, unsigned long durationMillis, const core::TimeProvider* timeProvider) {
+		_type = type;
+		_durationMillis = durationMillis;
+		_timeProvider = timeProvider;
+		reset();
 	}
 
 	inline void start() {
-		_startMillis = _timeProvider->tickTime();
-		_expireMillis = _startMillis + _durationMillis;
+		const unsigned long startMillis = _timeProvider->tickTime();
+		_startMillis.store(startMillis, std::memory_order_relaxed);
+		_expireMillis.store(startMillis + _durationMillis, std::memory_order_relaxed);
 	}
 
 	inline void reset() {
-		_startMillis = 0ul;
-		_expireMillis = 0ul;
-	}
-
-	inline void expire() {
-		// TODO: eventbus or state
-		reset();
-	}
-
-	inline void cancel() {
-		// TODO: eventbus or state
-		reset();
+		_startMillis.store(0ul, std::memory_order_relaxed);
+		_expireMillis.store(0ul, std::memory_order_relaxed);
 	}
 
+public:
 	unsigned long durationMillis() const {
 		return _durationMillis;
 	}
 
 	inline bool started() const {
-		return _expireMillis > 0ul;
+		return expireMillis() > 0ul;
 	}
 
 	inline bool running() const {
-		return _expireMillis > 0ul && _timeProvider->tickTime() < _expireMillis;
+		const unsigned long expire = expireMillis();
+		return expire > 0ul && _timeProvider->tickTime() < expire;
 	}
 
 	inline unsigned long duration() const {
-		return _expireMillis - _startMillis;
+		return expireMillis() - startMillis();
 	}
 
 	inline unsigned long startMillis() const {
-		return _startMillis;
+		return _startMillis.load(std::memory_order_relaxed);
 	}
 
-	inline Type type() const {
-		return _type;
+	inline unsigned long expireMillis() const {
+		return _expireMillis.load(std::memory_order_relaxed);
 	}
 
-	inline bool operator<(const Cooldown& rhs) const {
-		return _expireMillis < rhs._expireMillis;
+	inline Type type() const {
+		return _type;
 	}
 };
 
-typedef std::shared_ptr<Cooldown> CooldownPtr;
-
 /**
  * @}
  */
 
 }
-
-namespace std {
-template<> struct hash<cooldown::Cooldown> {
-	inline size_t operator()(const cooldown::Cooldown &c) const {
-		return std::hash<size_t>()(static_cast<size_t>(c.type()));
-	}
-};
-}
@@ -4,39 +4,55 @@
 
 #include "CooldownMgr.h"
 #include "core/Common.h"
-#include "core/Singleton.h"
 
 namespace cooldown {
 
 CooldownMgr::CooldownMgr(const core::TimeProviderPtr& timeProvider, const cooldown::CooldownProviderPtr& cooldownProvider) :
-		_timeProvider(timeProvider), _cooldownProvider(cooldownProvider), _lock("CooldownMgr") {
+		_timeProvider(timeProvider), _cooldownProvider(cooldownProvider), _wheel(cooldownProvider->wheel()) {
+	for (std::atomic<CooldownWheel::Handle>& h : _handles) {
+		h = CooldownWheel::InvalidHandle;
+	}
+}
+
+CooldownMgr::~CooldownMgr() {
+	for (std::atomic<CooldownWheel::Handle>& h : _handles) {
+		if (h != CooldownWheel::InvalidHandle) {
+			_wheel.release(h);
+		}
+	}
 }
 
 CooldownTriggerState CooldownMgr::triggerCooldown(Type type) {
-	core::ScopedWriteLock lock(_lock);
-	CooldownPtr cooldown = _cooldowns[type];
-	if (!cooldown) {
-		// TODO: use a pool here
-		cooldown = std::make_shared<Cooldown>(type, defaultDuration(type), _timeProvider);
-		_cooldowns[type] = cooldown;
-	} else if (cooldown->running()) {
+	std::atomic<CooldownWheel::Handle>& slot = _handles[std::enum_value<Type>(type)];
+	CooldownWheel::Handle h = slot.load(std::memory_order_acquire);
+	if (h == CooldownWheel::InvalidHandle) {
+		const CooldownWheel::Handle acquired = _wheel.acquire(type, defaultDuration(type), _timeProvider.get());
+		if (acquired == CooldownWheel::InvalidHandle) {
+			return CooldownTriggerState::FAILED;
+		}
+		if (slot.compare_exchange_strong(h, acquired, std::memory_order_acq_rel)) {
+			h = acquired;
+		} else {
+			// another thread was faster
+			_wheel.release(acquired);
+		}
+	}
+	if (!_wheel.start(h)) {
 		Log::error("Failed to trigger the cooldown of type %i: already running", std::enum_value(type));
 		return CooldownTriggerState::ALREADY_RUNNING;
 	}
-	cooldown->start();
-	_queue.push(cooldown);
+	const Cooldown& cooldown = _wheel.cooldown(h);
 	Log::debug("Triggered the cooldown of type %i (expires in %lims, started at %li)",
-			std::enum_value(type), cooldown->duration(), cooldown->startMillis());
+			std::enum_value(type), cooldown.duration(), cooldown.startMillis());
 	return CooldownTriggerState::SUCCESS;
 }
 
-CooldownPtr CooldownMgr::cooldown(Type type) const {
-	core::ScopedReadLock lock(_lock);
-	auto i = _cooldowns.find(type);
-	if (i == _cooldowns.end()) {
-		return CooldownPtr();
+const Cooldown* CooldownMgr::cooldown(Type type) const {
+	const CooldownWheel::Handle h = handle(type);
+	if (h == CooldownWheel::InvalidHandle) {
+		return nullptr;
 	}
-	return i->second;
+	return &_wheel.cooldown(h);
 }
 
 unsigned long CooldownMgr::defaultDuration(Type type) const {
@@ -44,26 +60,26 @@ unsigned long CooldownMgr::defaultDuration(Type type) const {
 }
 
 bool CooldownMgr::resetCooldown(Type type) {
-	const CooldownPtr& c = cooldown(type);
-	if (!c) {
+	const CooldownWheel::Handle h = handle(type);
+	if (h == CooldownWheel::InvalidHandle) {
 		return false;
 	}
-	c->reset();
+	_wheel.cancel(h);
 	return true;
 }
 
 bool CooldownMgr::cancelCooldown(Type type) {
-	const CooldownPtr& c = cooldown(type);
-	if (!c) {
+	const CooldownWheel::Handle h = handle(type);
+	if (h == CooldownWheel::InvalidHandle) {
 		return false;
 	}
-	c->cancel();
+	_wheel.cancel(h);
 	return true;
 }
 
-bool CooldownMgr::isCooldown(Type type) {
-	const CooldownPtr& c = cooldown(type);
-	if (!c || !c->running()) {
+bool CooldownMgr::isCooldown(Type type) const {
+	const Cooldown* c = cooldown(type);
+	if (c == nullptr || !c->running()) {
 		Log::trace("Cooldown of type %i is not running", std::enum_value(type));
 		return false;
 	}
@@ -72,25 +88,4 @@ bool CooldownMgr::isCooldown(Type type) {
 	return true;
 }
 
-void CooldownMgr::update() {
-	for (;;) {
-		_lock.lockRead();
-		if (_queue.empty()) {
-			_lock.unlockRead();
-			break;
-		}
-		CooldownPtr cooldown = _queue.top();
-		_lock.unlockRead();
-		if (cooldown->running()) {
-			break;
-		}
-
-		_lock.lockWrite();
-		_queue.pop();
-		_lock.unlockWrite();
-		Log::debug("Cooldown of type %i has just expired at %li",
-				std::enum_value(cooldown->type()), _timeProvider->tickTime());
-		cooldown->expire();
-	}
-}
 }
@@ -4,43 +4,35 @@
 
 #pragma once
 
-#include "core/ReadWriteLock.h"
 #include "Cooldown.h"
+#include "CooldownWheel.h"
 #include "core/NonCopyable.h"
 #include "core/TimeProvider.h"
-#include "core/ReadWriteLock.h"
 #include "CooldownProvider.h"
 
 #include <memory>
-#include <unordered_map>
-#include <queue>
-#include <functional>
-#include <vector>
+#include <atomic>
 
 namespace cooldown {
 
 /**
  * @brief Cooldown manager that handles cooldowns for one entity
+ *
+ * The cooldowns are taken from the pool of the @c CooldownWheel of the @c CooldownProvider - the
+ * wheel also expires them. There is no per entity lock, the cooldowns may be queried from any thread.
  * @ingroup Cooldowns
  */
 class CooldownMgr: public core::NonCopyable {
 private:
 	core::TimeProviderPtr _timeProvider;
 	cooldown::CooldownProviderPtr _cooldownProvider;
-	core::ReadWriteLock _lock;
+	CooldownWheel& _wheel;
+	std::atomic<CooldownWheel::Handle> _handles[std::enum_value<Type>(Type::MAX) + 1];
 
-	struct CooldownComparatorLess: public std::binary_function<CooldownPtr, CooldownPtr, bool> {
-		inline bool operator()(const CooldownPtr& x, const CooldownPtr& y) const {
-			return std::less<Cooldown>()(*x.get(), *y.get());
-		}
-	};
-
-	typedef std::priority_queue<CooldownPtr, std::vector<CooldownPtr>, CooldownComparatorLess> CooldownQueue;
-	CooldownQueue _queue;
-	typedef std::unordered_map<Type, CooldownPtr, network::EnumHash<Type> > Cooldowns;
-	Cooldowns _cooldowns;
+	CooldownWheel::Handle handle(Type type) const;
 public:
 	CooldownMgr(const core::TimeProviderPtr& timeProvider, const cooldown::CooldownProviderPtr& cooldownProvider);
+	~CooldownMgr();
 
 	/**
 	 * @brief Tries to trigger the specified cooldown for the given entity
@@ -48,12 +40,15 @@ public:
 	CooldownTriggerState triggerCooldown(Type type);
 
 	/**
-	 * @brief Reset a cooldown and restart it
+	 * @brief Reset a cooldown
 	 */
 	bool resetCooldown(Type type);
 
 	unsigned long defaultDuration(Type type) const;
-	CooldownPtr cooldown(Type type) const;
+	/**
+	 * @return @c nullptr if the cooldown was never triggered
+	 */
+	const Cooldown* cooldown(Type type) const;
 
 	/**
 	 * @brief Cancel an already running cooldown
@@ -63,14 +58,13 @@ public:
 	/**
 	 * @brief Checks whether a user has the given cooldown running
 	 */
-	bool isCooldown(Type type);
-
-	/**
-	 * @brief Update cooldown states
-	 */
-	void update();
+	bool isCooldown(Type type) const;
 };
 
+inline CooldownWheel::Handle CooldownMgr::handle(Type type) const {
+	return _handles[std::enum_value<Type>(type)].load(std::memory_order_acquire);
+}
+
 typedef std::shared_ptr<CooldownMgr> CooldownMgrPtr;
 
 }
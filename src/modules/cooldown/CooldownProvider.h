@@ -5,6 +5,7 @@
 
 #include "core/Common.h"
 #include "CooldownType.h"
+#include "CooldownWheel.h"
 #include <memory>
 
 namespace cooldown {
@@ -15,7 +16,7 @@ namespace cooldown {
 static constexpr int DefaultDuration = 1000;
 
 /**
- * @brief Manages the cooldown durations
+ * @brief Manages the cooldown durations and the @c CooldownWheel that is shared by all @c CooldownMgr instances
  * @ingroup Cooldowns
  */
 class CooldownProvider {
@@ -23,6 +24,7 @@ private:
 	bool _initialized = false;
 	long _durations[std::enum_value<Type>(Type::MAX) + 1];
 	std::string _error;
+	CooldownWheel _wheel;
 public:
 	/**
 	 * @brief Ctor to init all available cooldowns to the DefaultDuration
@@ -56,8 +58,17 @@ public:
 	 * @sa init()
 	 */
 	const std::string& error() const;
+
+	/**
+	 * @brief The pool and timer wheel of the cooldowns - @c CooldownWheel::update() must be called once per frame
+	 */
+	CooldownWheel& wheel();
 };
 
+inline CooldownWheel& CooldownProvider::wheel() {
+	return _wheel;
+}
+
 inline const std::string& CooldownProvider::error() const {
 	return _error;
 }
@@ -18,7 +18,11 @@ enum CooldownTriggerState {
 	/**
 	 * @brief There is already a cooldown of the same type running.
 	 */
-	ALREADY_RUNNING
+	ALREADY_RUNNING,
+	/**
+	 * @brief The cooldown couldn't get allocated.
+	 */
+	FAILED
 };
 
 }
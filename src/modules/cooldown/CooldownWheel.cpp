@@ -0,0 +1,165 @@
+/**
+ * @file
+ */
+
+#include "CooldownWheel.h"
+#include "core/Common.h"
+#include <algorithm>
+
+namespace cooldown {
+
+constexpr CooldownWheel::Handle CooldownWheel::InvalidHandle;
+
+CooldownWheel::CooldownWheel() :
+		_lock("CooldownWheel") {
+	std::fill(std::begin(_slots), std::end(_slots), InvalidHandle);
+}
+
+CooldownWheel::Handle CooldownWheel::acquire(Type type, unsigned long durationMillis, const core::TimeProvider* timeProvider) {
+	core::ScopedWriteLock lock(_lock);
+	Handle handle = _freeList;
+	if (handle != InvalidHandle) {
+		_freeList = entry(handle).next;
+	} else {
+		if (_nextHandle == _blockCount * BlockSize) {
+			if (_blockCount >= MaxBlocks) {
+				Log::error("The cooldown pool is exhausted");
+				return InvalidHandle;
+			}
+			_blocks[_blockCount++].reset(new Entry[BlockSize]);
+		}
+		handle = _nextHandle++;
+	}
+	Entry& e = entry(handle);
+	e.next = InvalidHandle;
+	e.prev = InvalidHandle;
+	e.slot = -1;
+	e.cooldown.init(type, durationMillis, timeProvider);
+	return handle;
+}
+
+void CooldownWheel::release(Handle handle) {
+	core::ScopedWriteLock lock(_lock);
+	Entry& e = entry(handle);
+	if (e.slot != -1) {
+		unlink(handle);
+	}
+	e.cooldown.reset();
+	e.next = _freeList;
+	_freeList = handle;
+}
+
+bool CooldownWheel::start(Handle handle) {
+	core::ScopedWriteLock lock(_lock);
+	Entry& e = entry(handle);
+	if (e.cooldown.running()) {
+		return false;
+	}
+	if (e.slot != -1) {
+		// expired, but the wheel didn't get there yet
+		unlink(handle);
+	}
+	e.cooldown.start();
+	if (_scheduled == 0u) {
+		// nothing to advance over
+		_time = std::max(_time, e.cooldown.startMillis());
+	}
+	link(handle, _time + 1ul);
+	return true;
+}
+
+void CooldownWheel::cancel(Handle handle) {
+	core::ScopedWriteLock lock(_lock);
+	Entry& e = entry(handle);
+	if (e.slot != -1) {
+		unlink(handle);
+	}
+	e.cooldown.reset();
+}
+
+void CooldownWheel::link(Handle handle, unsigned long earliest) {
+	Entry& e = entry(handle);
+	unsigned long when = std::max(e.cooldown.expireMillis(), earliest);
+	const unsigned long range = 1ul << (Levels * SlotBits);
+	if (when - _time >= range) {
+		// out of range - the cooldown is linked again once the last level is cascaded
+		when = _time + range - 1ul;
+	}
+	const unsigned long delta = when - _time;
+	int level = 0;
+	while (level < Levels - 1 && delta >= (1ul << ((level + 1) * SlotBits))) {
+		++level;
+	}
+	const int slot = level * Slots + (int)((when >> (level * SlotBits)) & (Slots - 1));
+	e.slot = slot;
+	e.prev = InvalidHandle;
+	e.next = _slots[slot];
+	if (e.next != InvalidHandle) {
+		entry(e.next).prev = handle;
+	}
+	_slots[slot] = handle;
+	++_scheduled;
+}
+
+void CooldownWheel::unlink(Handle handle) {
+	Entry& e = entry(handle);
+	if (e.prev == InvalidHandle) {
+		_slots[e.slot] = e.next;
+	} else {
+		entry(e.prev).next = e.next;
+	}
+	if (e.next != InvalidHandle) {
+		entry(e.next).prev = e.prev;
+	}
+	e.slot = -1;
+	e.next = InvalidHandle;
+	e.prev = InvalidHandle;
+	--_scheduled;
+}
+
+void CooldownWheel::cascade(int level) {
+	const int slot = level * Slots + (int)((_time >> (level * SlotBits)) & (Slots - 1));
+	Handle handle = _slots[slot];
+	_slots[slot] = InvalidHandle;
+	while (handle != InvalidHandle) {
+		Entry& e = entry(handle);
+		const Handle next = e.next;
+		e.slot = -1;
+		--_scheduled;
+		link(handle, _time);
+		handle = next;
+	}
+}
+
+int CooldownWheel::update(unsigned long nowMillis) {
+	core::ScopedWriteLock lock(_lock);
+	int expired = 0;
+	while (_time < nowMillis) {
+		if (_scheduled == 0u) {
+			_time = nowMillis;
+			break;
+		}
+		++_time;
+		// move the cooldowns of the higher levels down - the highest level first
+		int levels = 1;
+		while (levels < Levels && (_time & ((1ul << (levels * SlotBits)) - 1ul)) == 0ul) {
+			++levels;
+		}
+		for (int level = levels - 1; level >= 1; --level) {
+			cascade(level);
+		}
+		Handle& head = _slots[_time & (Slots - 1)];
+		while (head != InvalidHandle) {
+			const Handle handle = head;
+			unlink(handle);
+			Cooldown& cooldown = entry(handle).cooldown;
+			Log::debug("Cooldown of type %i has just expired at %li",
+					std::enum_value(cooldown.type()), _time);
+			cooldown.reset();
+			++expired;
+		}
+	}
+	return expired;
+}
+
+}
@@ -0,0 +1,121 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "Cooldown.h"
+#include "core/NonCopyable.h"
+#include "core/ReadWriteLock.h"
+
+#include <memory>
+#include <limits>
+#include <stdint.h>
+
+namespace cooldown {
+
+/**
+ * @brief Stores the cooldowns of all @c CooldownMgr instances and drives their expiration.
+ *
+ * The cooldowns are allocated from a pool of fixed size blocks and addressed by a handle. The blocks
+ * are never moved or freed, so a handle stays valid (and may be read from any thread) until it is released.
+ *
+ * Running cooldowns are linked into the slots of a hierarchical timer wheel with a resolution of one
+ * millisecond. Each level has @c Slots slots, the first level covers the next @c Slots milliseconds, every
+ * further level covers @c Slots times the range of the previous one. @c update() advances the wheel once
+ * per frame for all entities and expires the cooldowns without looking at the ones that are still running.
+ *
+ * @ingroup Cooldowns
+ */
+class CooldownWheel : public core::NonCopyable {
+public:
+	typedef uint32_t Handle;
+	static constexpr Handle InvalidHandle = std::numeric_limits<Handle>::max();
+
+	static constexpr int SlotBits = 6;
+	static constexpr int Slots = 1 << SlotBits;
+	static constexpr int Levels = 4;
+
+	static constexpr int BlockBits = 10;
+	static constexpr uint32_t BlockSize = 1u << BlockBits;
+	static constexpr uint32_t MaxBlocks = 1024u;
+private:
+	struct Entry {
+		Cooldown cooldown;
+		// the next entry in the slot - or in the free list
+		Handle next = InvalidHandle;
+		Handle prev = InvalidHandle;
+		// the index into _slots - or -1 if the cooldown isn't scheduled
+		int slot = -1;
+	};
+
+	core::ReadWriteLock _lock;
+	std::unique_ptr<Entry[]> _blocks[MaxBlocks];
+	uint32_t _blockCount = 0u;
+	Handle _nextHandle = 0u;
+	Handle _freeList = InvalidHandle;
+	Handle _slots[Levels * Slots];
+	// the amount of scheduled cooldowns
+	uint32_t _scheduled = 0u;
+	// the time in millis the wheel was advanced to
+	unsigned long _time = 0ul;
+
+	inline Entry& entry(Handle handle) const {
+		return _blocks[handle >> BlockBits][handle & (BlockSize - 1u)];
+	}
+
+	/**
+	 * @param[in] earliest The tick the cooldown is expired at the earliest - @c update() already
+	 * processed the current tick when a cooldown is started.
+	 */
+	void link(Handle handle, unsigned long earliest);
+	void unlink(Handle handle);
+	void cascade(int level);
+public:
+	CooldownWheel();
+
+	/**
+	 * @brief Allocates a cooldown from the pool
+	 * @return @c InvalidHandle if the pool is exhausted
+	 */
+	Handle acquire(Type type, unsigned long durationMillis, const core::TimeProvider* timeProvider);
+	/**
+	 * @brief Gives the cooldown back to the pool - the handle may not be used afterwards
+	 */
+	void release(Handle handle);
+
+	/**
+	 * @brief Starts the cooldown and schedules its expiration
+	 * @return @c false if the cooldown is already running
+	 */
+	bool start(Handle handle);
+	/**
+	 * @brief Resets the cooldown and removes it from the wheel
+	 */
+	void cancel(Handle handle);
+
+	/**
+	 * @note Doesn't lock
+	 */
+	inline const Cooldown& cooldown(Handle handle) const {
+		return entry(handle).cooldown;
+	}
+
+	/**
+	 * @brief Advances the wheel to the given time and expires all cooldowns that are due.
+	 * @return The amount of expired cooldowns
+	 */
+	int update(unsigned long nowMillis);
+
+	/**
+	 * @return The amount of cooldowns that are scheduled for expiration
+	 */
+	uint32_t scheduled() const;
+};
+
+inline uint32_t CooldownWheel::scheduled() const {
+	core::ScopedReadLock lock(_lock);
+	return _scheduled;
+}
+
+}
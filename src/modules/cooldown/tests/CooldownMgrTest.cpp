@@ -45,13 +45,13 @@ TEST_F(CooldownMgrTest, testExpireCooldown) {
 	ASSERT_TRUE(_mgr.cooldown(Type::LOGOUT)->started()) << "Cooldown is not started";
 	ASSERT_TRUE(_mgr.cooldown(Type::LOGOUT)->running()) << "Cooldown is not running";
 	ASSERT_TRUE(_mgr.isCooldown(Type::LOGOUT));
-	_mgr.update();
+	_cooldownProvider->wheel().update(_timeProvider->tickTime());
 	ASSERT_TRUE(_mgr.cooldown(Type::LOGOUT)->started()) << "Cooldown is not started";
 	ASSERT_TRUE(_mgr.cooldown(Type::LOGOUT)->running()) << "Cooldown is not running";
 	ASSERT_TRUE(_mgr.isCooldown(Type::LOGOUT));
 	_timeProvider->update(_mgr.defaultDuration(Type::LOGOUT));
 	ASSERT_FALSE(_mgr.isCooldown(Type::LOGOUT));
-	_mgr.update();
+	_cooldownProvider->wheel().update(_timeProvider->tickTime());
 	ASSERT_FALSE(_mgr.cooldown(Type::LOGOUT)->running()) << "Cooldown is still running";
 	ASSERT_FALSE(_mgr.isCooldown(Type::LOGOUT));
 	ASSERT_TRUE(_mgr.resetCooldown(Type::LOGOUT)) << "Failed to reset the logout cooldown";
@@ -63,7 +63,7 @@ TEST_F(CooldownMgrTest, testMultipleCooldown) {
 	ASSERT_EQ(CooldownTriggerState::SUCCESS, _mgr.triggerCooldown(Type::INCREASE)) << "Increase cooldown couldn't get triggered";
 	ASSERT_TRUE(_mgr.isCooldown(Type::LOGOUT));
 	ASSERT_TRUE(_mgr.isCooldown(Type::INCREASE));
-	_mgr.update();
+	_cooldownProvider->wheel().update(_timeProvider->tickTime());
 	ASSERT_TRUE(_mgr.isCooldown(Type::LOGOUT));
 	ASSERT_TRUE(_mgr.isCooldown(Type::INCREASE));
 
@@ -72,12 +72,12 @@ TEST_F(CooldownMgrTest, testMultipleCooldown) {
 
 	if (logoutDuration > increaseDuration) {
 		_timeProvider->update(increaseDuration);
-		_mgr.update();
+		_cooldownProvider->wheel().update(_timeProvider->tickTime());
 		ASSERT_TRUE(_mgr.isCooldown(Type::LOGOUT));
 		ASSERT_FALSE(_mgr.isCooldown(Type::INCREASE));
 	} else {
 		_timeProvider->update(logoutDuration);
-		_mgr.update();
+		_cooldownProvider->wheel().update(_timeProvider->tickTime());
 		ASSERT_TRUE(_mgr.isCooldown(Type::INCREASE));
 		ASSERT_FALSE(_mgr.isCooldown(Type::LOGOUT));
 	}
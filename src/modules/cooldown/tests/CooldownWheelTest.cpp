@@ -0,0 +1,79 @@
+/**
+ * @file
+ */
+
+#include "core/tests/AbstractTest.h"
+#include "cooldown/CooldownWheel.h"
+
+namespace cooldown {
+
+class CooldownWheelTest : public core::AbstractTest {
+protected:
+	core::TimeProvider _timeProvider;
+	CooldownWheel _wheel;
+
+	CooldownWheel::Handle start(unsigned long durationMillis) {
+		const CooldownWheel::Handle handle = _wheel.acquire(Type::LOGOUT, durationMillis, &_timeProvider);
+		EXPECT_NE(CooldownWheel::InvalidHandle, handle);
+		EXPECT_TRUE(_wheel.start(handle));
+		return handle;
+	}
+
+	/**
+	 * @return The time in millis the cooldown expired at
+	 */
+	unsigned long expireTime(CooldownWheel::Handle handle, unsigned long stepMillis) {
+		for (unsigned long time = _timeProvider.tickTime(); _wheel.cooldown(handle).started(); time += stepMillis) {
+			_timeProvider.update(time);
+			_wheel.update(time);
+		}
+		return _timeProvider.tickTime();
+	}
+};
+
+TEST_F(CooldownWheelTest, testExpire) {
+	_timeProvider.update(1000ul);
+	const CooldownWheel::Handle handle = start(10ul);
+	EXPECT_EQ(1u, _wheel.scheduled());
+	EXPECT_EQ(0, _wheel.update(1009ul));
+	EXPECT_TRUE(_wheel.cooldown(handle).started());
+	EXPECT_EQ(1, _wheel.update(1010ul));
+	EXPECT_FALSE(_wheel.cooldown(handle).started());
+	EXPECT_EQ(0u, _wheel.scheduled());
+}
+
+TEST_F(CooldownWheelTest, testCascade) {
+	_timeProvider.update(12345ul);
+	// every level of the wheel and one that exceeds the range of the wheel
+	const unsigned long durations[] = { 3ul, 100ul, 5000ul, 300000ul, 20000000ul };
+	for (unsigned long duration : durations) {
+		_timeProvider.update(12345ul);
+		const CooldownWheel::Handle handle = start(duration);
+		const unsigned long step = duration > 100000ul ? 1000ul : 1ul;
+		EXPECT_EQ(12345ul + duration, expireTime(handle, step)) << "duration: " << duration;
+		_wheel.release(handle);
+	}
+}
+
+TEST_F(CooldownWheelTest, testCancel) {
+	_timeProvider.update(0ul);
+	const CooldownWheel::Handle handle = start(100ul);
+	EXPECT_FALSE(_wheel.start(handle)) << "The cooldown is already running";
+	_wheel.cancel(handle);
+	EXPECT_FALSE(_wheel.cooldown(handle).started());
+	EXPECT_EQ(0u, _wheel.scheduled());
+	EXPECT_TRUE(_wheel.start(handle));
+	_wheel.release(handle);
+	EXPECT_EQ(0u, _wheel.scheduled());
+}
+
+TEST_F(CooldownWheelTest, testReuseHandles) {
+	const CooldownWheel::Handle handle1 = _wheel.acquire(Type::LOGOUT, 1ul, &_timeProvider);
+	const CooldownWheel::Handle handle2 = _wheel.acquire(Type::INCREASE, 1ul, &_timeProvider);
+	EXPECT_NE(handle1, handle2);
+	_wheel.release(handle1);
+	EXPECT_EQ(handle1, _wheel.acquire(Type::INCREASE, 1ul, &_timeProvider));
+	EXPECT_EQ(Type::INCREASE, _wheel.cooldown(handle1).type());
+}
+
+}
@@ -18,6 +18,9 @@ constexpr const char *ClientVSync = "cl_vsync";
 constexpr const char *ClientPort = "cl_port";
 // the host where the server is running on that the client wants to connect to
 constexpr const char *ClientHost = "cl_host";
+// the incoming and outgoing bandwidth of the client host in bytes per second - 0 means unlimited
+constexpr const char *ClientIncomingBandwidth = "cl_bandwidthin";
+constexpr const char *ClientOutgoingBandwidth = "cl_bandwidthout";
 constexpr const char *ClientFullscreen = "cl_fullscreen";
 constexpr const char *ClientMultiSampleSamples = "cl_multisamplesamples";
 constexpr const char *ClientMultiSampleBuffers = "cl_multisamplebuffers";
@@ -31,6 +34,8 @@ constexpr const char *ClientWindowHeight = "cl_height";
 constexpr const char *ClientGamma = "cl_gamma";
 constexpr const char *ClientShadowMap = "cl_shadowmap";
 constexpr const char *ClientCameraMaxTargetDistance = "cl_cameramaxtargetdistance";
+// the mesh extractions that are queued, running or waiting for the upload at the same time
+constexpr const char *ClientMaxPendingExtractions = "r_maxpendingextractions";
 
 constexpr const char *ClientShadowMapShow = "cl_debug_shadowmapshow";
 constexpr const char *ClientDebugShadowMapCascade = "cl_debug_cascade";
@@ -43,13 +48,29 @@ constexpr const char *ServerSeed = "sv_seed";
 constexpr const char *ServerHost = "sv_host";
 constexpr const char *ServerPort = "sv_port";
 constexpr const char *ServerMaxClients = "sv_maxclients";
+// The amount of queued logins whose credentials are checked per frame
+constexpr const char *ServerLoginsPerTick = "sv_loginspertick";
+// the incoming and outgoing bandwidth of the server host in bytes per second - 0 means unlimited
+constexpr const char *ServerIncomingBandwidth = "sv_bandwidthin";
+constexpr const char *ServerOutgoingBandwidth = "sv_bandwidthout";
+// the bytes per second the send scheduler hands over to a single client - 0 disables the scheduler
+constexpr const char *ServerPeerBandwidth = "sv_peerbandwidth";
 
 constexpr const char *ShapeToolExtractRadius = "sh_extractradius";
 
+// the amount of simulated clients the load test connects to the server
+constexpr const char *LoadTestClients = "lt_clients";
+// the amount of simulated clients that are connected per second
+constexpr const char *LoadTestRampUp = "lt_rampup";
+// the duration of the load test in seconds - 0 runs until the process is terminated
+constexpr const char *LoadTestDuration = "lt_duration";
+
 constexpr const char *CoreLogLevel = "core_loglevel";
 
 // The size of the chunk that is extracted with each step
 constexpr const char *VoxelMeshSize = "voxel_meshsize";
+// The maximum amount of nodes a single path search may touch before it gives up
+constexpr const char *VoxelPathNodeBudget = "voxel_pathnodebudget";
 
 constexpr const char *DatabaseName = "db_name";
 constexpr const char *DatabaseHost = "db_host";
@@ -57,6 +78,12 @@ constexpr const char *DatabasePassword = "db_pw";
 constexpr const char *DatabaseUser = "db_user";
 constexpr const char *DatabaseMinConnections = "db_minconnections";
 constexpr const char *DatabaseMaxConnections = "db_maxconnections";
+// The time in millis to wait for a free pooled connection once the max connections are in use
+constexpr const char *DatabaseConnectionTimeout = "db_connectiontimeout";
+// The amount of threads that execute the asynchronous database jobs
+constexpr const char *DatabaseThreads = "db_threads";
+// The time in millis batched writes are collected before they are written to the database
+constexpr const char *DatabaseBatchDelay = "db_batchdelay";
 
 constexpr const char *AppHomePath = "app_homepath";
 constexpr const char *AppBasePath = "app_basepath";
@@ -0,0 +1,82 @@
+/**
+ * @file
+ */
+
+#include "RangeAllocator.h"
+#include "core/Common.h"
+#include <iterator>
+
+namespace core {
+
+RangeAllocator::RangeAllocator(int32_t capacity) {
+	grow(capacity);
+}
+
+int32_t RangeAllocator::allocate(int32_t size) {
+	if (size <= 0) {
+		return -1;
+	}
+	for (auto i = _free.begin(); i != _free.end(); ++i) {
+		if (i->second < size) {
+			continue;
+		}
+		const int32_t offset = i->first;
+		const int32_t remaining = i->second - size;
+		_free.erase(i);
+		if (remaining > 0) {
+			_free.emplace(offset + size, remaining);
+		}
+		_used += size;
+		return offset;
+	}
+	return -1;
+}
+
+void RangeAllocator::free(int32_t offset, int32_t size) {
+	if (size <= 0) {
+		return;
+	}
+	core_assert(offset >= 0 && offset + size <= _capacity);
+	_used -= size;
+	core_assert(_used >= 0);
+	auto next = _free.lower_bound(offset);
+	core_assert_msg(next == _free.end() || next->first >= offset + size, "Range %i:%i is already free", offset, size);
+	if (next != _free.end() && next->first == offset + size) {
+		size += next->second;
+		next = _free.erase(next);
+	}
+	if (next != _free.begin()) {
+		auto prev = std::prev(next);
+		core_assert_msg(prev->first + prev->second <= offset, "Range %i:%i is already free", offset, size);
+		if (prev->first + prev->second == offset) {
+			prev->second += size;
+			return;
+		}
+	}
+	_free.emplace_hint(next, offset, size);
+}
+
+bool RangeAllocator::grow(int32_t capacity) {
+	if (capacity < _capacity) {
+		return false;
+	}
+	if (capacity == _capacity) {
+		return true;
+	}
+	const int32_t oldCapacity = _capacity;
+	_capacity = capacity;
+	// the new space is handed in as one free range - this merges it with a free range at the end
+	_used += capacity - oldCapacity;
+	free(oldCapacity, capacity - oldCapacity);
+	return true;
+}
+
+void RangeAllocator::clear() {
+	_free.clear();
+	_used = 0;
+	if (_capacity > 0) {
+		_free.emplace(0, _capacity);
+	}
+}
+
+}
@@ -0,0 +1,69 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+namespace core {
+
+/**
+ * @brief Suballocates ranges of elements from one big block - e.g. a gpu buffer.
+ *
+ * The allocator only does the bookkeeping, it doesn't own any memory. Free neighbouring
+ * ranges are merged when a range is given back. Growing the capacity doesn't move any of
+ * the allocated ranges.
+ */
+class RangeAllocator {
+private:
+	// free ranges by offset - the value is the size of the range
+	std::map<int32_t, int32_t> _free;
+	int32_t _capacity = 0;
+	int32_t _used = 0;
+public:
+	RangeAllocator(int32_t capacity = 0);
+
+	/**
+	 * @return The offset of the allocated range or @c -1 if there is no free range with the given size
+	 */
+	int32_t allocate(int32_t size);
+	/**
+	 * @brief Gives back a range that was allocated with @c allocate()
+	 */
+	void free(int32_t offset, int32_t size);
+	/**
+	 * @brief Increases the capacity - the already allocated ranges are kept
+	 * @return @c false if the given capacity is smaller than the current one
+	 */
+	bool grow(int32_t capacity);
+	/**
+	 * @brief Frees all ranges
+	 */
+	void clear();
+
+	int32_t capacity() const;
+	/**
+	 * @return The amount of allocated elements
+	 */
+	int32_t used() const;
+	/**
+	 * @return The amount of free ranges - a measure for the fragmentation
+	 */
+	int32_t freeRanges() const;
+};
+
+inline int32_t RangeAllocator::capacity() const {
+	return _capacity;
+}
+
+inline int32_t RangeAllocator::used() const {
+	return _used;
+}
+
+inline int32_t RangeAllocator::freeRanges() const {
+	return (int32_t)_free.size();
+}
+
+}
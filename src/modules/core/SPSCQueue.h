@@ -0,0 +1,120 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <utility>
+
+namespace core {
+
+/**
+ * @brief Bounded lock-free queue for exactly one producer and one consumer thread.
+ *
+ * The capacity is rounded up to the next power of two. Neither @c push() nor @c pop()
+ * ever blocks - a full queue rejects the new element, which allows the caller to
+ * apply its own backpressure strategy.
+ *
+ * @note If more than one thread should produce or consume, those threads have to be
+ * serialized by the caller (e.g. by a mutex) - the queue itself only guarantees
+ * correctness for one producer and one consumer at a time.
+ */
+template<class Data>
+class SPSCQueue {
+private:
+	static constexpr size_t CacheLineSize = 64;
+
+	std::vector<Data> _buffer;
+	const size_t _mask;
+	char _pad0[CacheLineSize];
+	// only written by the consumer
+	std::atomic<size_t> _head { 0u };
+	char _pad1[CacheLineSize - sizeof(std::atomic<size_t>)];
+	// only written by the producer
+	std::atomic<size_t> _tail { 0u };
+	char _pad2[CacheLineSize - sizeof(std::atomic<size_t>)];
+
+	static size_t roundCapacity(size_t capacity) {
+		size_t c = 1u;
+		while (c < capacity) {
+			c <<= 1;
+		}
+		return c;
+	}
+
+	template<class T>
+	bool pushInternal(T&& data) {
+		const size_t tail = _tail.load(std::memory_order_relaxed);
+		const size_t head = _head.load(std::memory_order_acquire);
+		if (tail - head > _mask) {
+			return false;
+		}
+		_buffer[tail & _mask] = std::forward<T>(data);
+		_tail.store(tail + 1u, std::memory_order_release);
+		return true;
+	}
+public:
+	explicit SPSCQueue(size_t capacity) :
+			_buffer(roundCapacity(capacity)), _mask(_buffer.size() - 1u) {
+	}
+
+	/**
+	 * @return @c false if the queue is full. Only call this from the producer thread.
+	 */
+	inline bool push(const Data& data) {
+		return pushInternal(data);
+	}
+
+	/**
+	 * @return @c false if the queue is full. Only call this from the producer thread.
+	 */
+	inline bool push(Data&& data) {
+		return pushInternal(std::move(data));
+	}
+
+	/**
+	 * @return @c false if the queue is empty. Only call this from the consumer thread.
+	 */
+	bool pop(Data& poppedValue) {
+		const size_t head = _head.load(std::memory_order_relaxed);
+		const size_t tail = _tail.load(std::memory_order_acquire);
+		if (head == tail) {
+			return false;
+		}
+		poppedValue = std::move(_buffer[head & _mask]);
+		_head.store(head + 1u, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @return The amount of elements that can be pushed without failing. If called from
+	 * the producer thread this is a lower bound, because the consumer can only free slots.
+	 */
+	inline size_t freeSlots() const {
+		return capacity() - size();
+	}
+
+	/**
+	 * @note This is only a snapshot if called while the other side is active.
+	 */
+	inline size_t size() const {
+		// the head is loaded first - the tail can only grow afterwards
+		const size_t head = _head.load(std::memory_order_acquire);
+		const size_t tail = _tail.load(std::memory_order_acquire);
+		return tail - head;
+	}
+
+	inline bool empty() const {
+		return size() == 0u;
+	}
+
+	inline size_t capacity() const {
+		return _buffer.size();
+	}
+};
+
+}
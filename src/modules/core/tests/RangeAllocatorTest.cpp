@@ -0,0 +1,70 @@
+/**
+ * @file
+ */
+
+#include "AbstractTest.h"
+#include "core/RangeAllocator.h"
+
+namespace core {
+
+class RangeAllocatorTest: public AbstractTest {
+};
+
+TEST_F(RangeAllocatorTest, testAllocate) {
+	core::RangeAllocator allocator(100);
+	EXPECT_EQ(0, allocator.allocate(10));
+	EXPECT_EQ(10, allocator.allocate(20));
+	EXPECT_EQ(30, allocator.used());
+	EXPECT_EQ(-1, allocator.allocate(71)) << "There should be no range left that is big enough";
+	EXPECT_EQ(30, allocator.allocate(70));
+	EXPECT_EQ(-1, allocator.allocate(1));
+	EXPECT_EQ(-1, allocator.allocate(0));
+	EXPECT_EQ(0, allocator.freeRanges());
+}
+
+TEST_F(RangeAllocatorTest, testFreeMerge) {
+	core::RangeAllocator allocator(30);
+	const int32_t a = allocator.allocate(10);
+	const int32_t b = allocator.allocate(10);
+	const int32_t c = allocator.allocate(10);
+	allocator.free(a, 10);
+	allocator.free(c, 10);
+	EXPECT_EQ(2, allocator.freeRanges());
+	EXPECT_EQ(-1, allocator.allocate(20)) << "The free ranges are not adjacent";
+	allocator.free(b, 10);
+	EXPECT_EQ(1, allocator.freeRanges()) << "The free ranges should have been merged";
+	EXPECT_EQ(0, allocator.used());
+	EXPECT_EQ(0, allocator.allocate(30));
+}
+
+TEST_F(RangeAllocatorTest, testReuseFirstFit) {
+	core::RangeAllocator allocator(40);
+	allocator.allocate(10);
+	const int32_t b = allocator.allocate(10);
+	allocator.allocate(10);
+	allocator.free(b, 10);
+	EXPECT_EQ(b, allocator.allocate(5));
+	EXPECT_EQ(b + 5, allocator.allocate(5));
+	EXPECT_EQ(30, allocator.allocate(10));
+}
+
+TEST_F(RangeAllocatorTest, testGrow) {
+	core::RangeAllocator allocator(20);
+	allocator.allocate(5);
+	const int32_t b = allocator.allocate(15);
+	EXPECT_EQ(-1, allocator.allocate(10));
+	EXPECT_FALSE(allocator.grow(10));
+	EXPECT_TRUE(allocator.grow(40));
+	EXPECT_EQ(20, allocator.allocate(10));
+	allocator.free(b, 15);
+	EXPECT_EQ(2, allocator.freeRanges());
+	EXPECT_EQ(15, allocator.used());
+	EXPECT_TRUE(allocator.grow(60));
+	EXPECT_EQ(2, allocator.freeRanges()) << "The new space should have been merged with the free range at the end";
+	EXPECT_EQ(30, allocator.allocate(30));
+	allocator.clear();
+	EXPECT_EQ(0, allocator.used());
+	EXPECT_EQ(0, allocator.allocate(60));
+}
+
+}
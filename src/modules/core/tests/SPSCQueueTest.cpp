@@ -0,0 +1,62 @@
+/**
+ * @file
+ */
+
+#include "AbstractTest.h"
+#include "core/SPSCQueue.h"
+#include <thread>
+
+namespace core {
+
+class SPSCQueueTest: public AbstractTest {
+};
+
+TEST_F(SPSCQueueTest, testCapacity) {
+	core::SPSCQueue<int> queue(5);
+	EXPECT_EQ(8u, queue.capacity());
+	EXPECT_TRUE(queue.empty());
+	EXPECT_EQ(8u, queue.freeSlots());
+}
+
+TEST_F(SPSCQueueTest, testPushPop) {
+	core::SPSCQueue<int> queue(4);
+	for (int i = 0; i < 4; ++i) {
+		ASSERT_TRUE(queue.push(i)) << "Failed to push element " << i;
+	}
+	EXPECT_FALSE(queue.push(4)) << "The queue should be full";
+	EXPECT_EQ(0u, queue.freeSlots());
+	for (int i = 0; i < 4; ++i) {
+		int val = -1;
+		ASSERT_TRUE(queue.pop(val));
+		EXPECT_EQ(i, val) << "The queue doesn't keep the insertion order";
+	}
+	int val = -1;
+	EXPECT_FALSE(queue.pop(val));
+	EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(SPSCQueueTest, testProducerConsumer) {
+	const int n = 100000;
+	core::SPSCQueue<int> queue(64);
+	std::thread producer([&] () {
+		for (int i = 0; i < n; ++i) {
+			while (!queue.push(i)) {
+				std::this_thread::yield();
+			}
+		}
+	});
+	int expected = 0;
+	while (expected < n) {
+		int val;
+		if (!queue.pop(val)) {
+			std::this_thread::yield();
+			continue;
+		}
+		ASSERT_EQ(expected, val);
+		++expected;
+	}
+	producer.join();
+	EXPECT_TRUE(queue.empty());
+}
+
+}
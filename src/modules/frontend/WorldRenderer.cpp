@@ -8,6 +8,7 @@
 #include "voxel/Spiral.h"
 #include "voxel/Constants.h"
 #include "core/App.h"
+#include "core/TimeProvider.h"
 #include "core/Var.h"
 #include "voxel/MaterialColor.h"
 #include "frontend/PlantDistributor.h"
@@ -18,21 +19,31 @@
 
 constexpr int MinCullingDistance = 500;
 constexpr int MinExtractionCullingDistance = 1000;
+// initial sizes of the persistent chunk mesh buffers - they are enlarged if needed
+constexpr int32_t OpaqueBufferVertices = 1 << 20;
+constexpr int32_t WaterBufferVertices = 1 << 16;
+// a quad is made of four vertices and six indices - rounded up
+constexpr int32_t IndicesPerVertex = 2;
 
 namespace config {
 constexpr const char *RenderAABB = "r_renderaabb";
 constexpr const char *OcclusionThreshold = "r_occlusionthreshold";
 constexpr const char *OcclusionQuery = "r_occlusionquery";
 constexpr const char *RenderOccluded = "r_renderoccluded";
+constexpr const char *MeshUploadMillis = "r_meshuploadmillis";
+constexpr const char *MeshUploadBytes = "r_meshuploadbytes";
 }
 
 namespace frontend {
 
 const std::string MaxDepthBufferUniformName = "u_cascades";
 
-// TODO: respect max vertex/index size of the one-big-vbo/ibo
 WorldRenderer::WorldRenderer(const voxel::WorldPtr& world) :
 		_octree(core::AABB<int>(), 30), _viewDistance(MinCullingDistance), _world(world) {
+	_freeChunkBuffers.reserve(MAX_CHUNKBUFFERS);
+	for (int i = MAX_CHUNKBUFFERS - 1; i >= 0; --i) {
+		_freeChunkBuffers.push_back(i);
+	}
 }
 
 WorldRenderer::~WorldRenderer() {
@@ -41,6 +52,24 @@ WorldRenderer::~WorldRenderer() {
 void WorldRenderer::reset() {
 	for (ChunkBuffer& chunkBuffer : _chunkBuffers) {
 		chunkBuffer.inuse = false;
+		chunkBuffer.opaqueRange = MeshRange();
+		chunkBuffer.waterRange = MeshRange();
+		for (std::vector<int32_t>& instances : chunkBuffer.plantInstances) {
+			instances.clear();
+		}
+	}
+	for (PlantBuffer& vbo : _meshPlantList) {
+		vbo.clearInstances();
+	}
+	_chunkBufferSlots.clear();
+	_freeChunkBuffers.clear();
+	for (int i = MAX_CHUNKBUFFERS - 1; i >= 0; --i) {
+		_freeChunkBuffers.push_back(i);
+	}
+	for (ChunkMeshBuffer* buffer : {&_opaqueBuffer, &_waterBuffer}) {
+		buffer->vertices.clear();
+		buffer->indices.clear();
+		buffer->clearDraws();
 	}
 	_octree.clear();
 	_activeChunkBuffers = 0;
@@ -63,8 +92,8 @@ void WorldRenderer::shutdown() {
 	reset();
 	_colorTexture.shutdown();
 	_entities.clear();
-	_opaqueBuffer.shutdown();
-	_waterBuffer.shutdown();
+	_opaqueBuffer.vb.shutdown();
+	_waterBuffer.vb.shutdown();
 	_shapeRenderer.shutdown();
 	_shapeBuilder.shutdown();
 	_shapeRendererOcclusionQuery.shutdown();
@@ -106,33 +135,84 @@ bool WorldRenderer::removeEntity(ClientEntityId id) {
 	return true;
 }
 
-void WorldRenderer::fillPlantPositionsFromMeshes() {
-	const int plantMeshAmount = SDL_arraysize(_meshPlantList);
-	for (PlantBuffer& vbo : _meshPlantList) {
-		vbo.instancedPositions.clear();
+void WorldRenderer::addPlants(ChunkBuffer& chunkBuffer) {
+	_plantPositions.clear();
+	distributePlants(_world, chunkBuffer.translation(), _plantPositions);
+	if (_plantPositions.empty()) {
+		return;
 	}
-	for (const ChunkBuffer& chunkBuffer : _chunkBuffers) {
-		if (!chunkBuffer.inuse) {
-			continue;
+	std::vector<glm::vec3>& p = _plantPositions;
+	core::Random rnd(_world->seed() + chunkBuffer.translation().x + chunkBuffer.translation().y + chunkBuffer.translation().z);
+	rnd.shuffle(p.begin(), p.end());
+	const int plantMeshAmount = SDL_arraysize(_meshPlantList);
+	const int plantMeshes = p.size() / plantMeshAmount;
+	const int slot = (int)(&chunkBuffer - _chunkBuffers);
+	int delta = p.size() - plantMeshes * plantMeshAmount;
+	int start = 0;
+	for (int i = 0; i < plantMeshAmount; ++i) {
+		PlantBuffer& vbo = _meshPlantList[i];
+		std::vector<int32_t>& instances = chunkBuffer.plantInstances[i];
+		const int end = start + plantMeshes + delta;
+		const int32_t first = (int32_t)vbo.instancedPositions.size();
+		for (int n = start; n < end; ++n) {
+			vbo.owners.push_back(PlantBuffer::InstanceOwner{slot, (int32_t)instances.size()});
+			instances.push_back((int32_t)vbo.instancedPositions.size());
+			vbo.instancedPositions.push_back(p[n]);
 		}
-		if (chunkBuffer.instancedPositions.empty()) {
-			continue;
+		if (end > start && (vbo.dirtyStart == -1 || vbo.dirtyStart > first)) {
+			vbo.dirtyStart = first;
 		}
-		std::vector<glm::vec3> p = chunkBuffer.instancedPositions;
-		core::Random rnd(_world->seed() + chunkBuffer.translation().x + chunkBuffer.translation().y + chunkBuffer.translation().z);
-		rnd.shuffle(p.begin(), p.end());
-		const int plantMeshes = p.size() / plantMeshAmount;
-		int delta = p.size() - plantMeshes * plantMeshAmount;
-		for (PlantBuffer& vbo : _meshPlantList) {
-			auto it = std::next(p.begin(), plantMeshes + delta);
-			std::move(p.begin(), it, std::back_inserter(vbo.instancedPositions));
-			p.erase(p.begin(), it);
-			delta = 0;
+		start = end;
+		delta = 0;
+	}
+}
+
+void WorldRenderer::removePlants(ChunkBuffer& chunkBuffer) {
+	const int plantMeshAmount = SDL_arraysize(_meshPlantList);
+	for (int i = 0; i < plantMeshAmount; ++i) {
+		PlantBuffer& vbo = _meshPlantList[i];
+		std::vector<int32_t>& instances = chunkBuffer.plantInstances[i];
+		// the highest index first - if the last instance belongs to this chunk, it's the current one
+		std::sort(instances.begin(), instances.end(), std::greater<int32_t>());
+		for (int32_t index : instances) {
+			const int32_t last = (int32_t)vbo.instancedPositions.size() - 1;
+			if (index != last) {
+				const PlantBuffer::InstanceOwner& owner = vbo.owners[last];
+				_chunkBuffers[owner.chunkBuffer].plantInstances[i][owner.index] = index;
+				vbo.instancedPositions[index] = vbo.instancedPositions[last];
+				vbo.owners[index] = owner;
+			}
+			vbo.instancedPositions.pop_back();
+			vbo.owners.pop_back();
+			if (vbo.dirtyStart == -1 || vbo.dirtyStart > index) {
+				vbo.dirtyStart = index;
+			}
 		}
+		instances.clear();
 	}
+}
+
+void WorldRenderer::uploadPlantInstances() {
 	for (PlantBuffer& vbo : _meshPlantList) {
+		if (vbo.dirtyStart == -1) {
+			continue;
+		}
+		core_trace_gl_scoped(WorldRendererUploadPlantInstances);
 		const std::vector<glm::vec3>& positions = vbo.instancedPositions;
-		vbo.vb.update(vbo.offsetBuffer, positions);
+		size_t start = (size_t)vbo.dirtyStart;
+		vbo.dirtyStart = -1;
+		if (positions.size() > vbo.capacity) {
+			const size_t capacity = glm::max(vbo.capacity * 2, positions.size());
+			if (!vbo.vb.reserve(vbo.offsetBuffer, capacity * sizeof(glm::vec3))) {
+				continue;
+			}
+			vbo.capacity = capacity;
+			start = 0u;
+		}
+		if (start >= positions.size()) {
+			continue;
+		}
+		vbo.vb.update(vbo.offsetBuffer, start * sizeof(glm::vec3), &positions[start], (positions.size() - start) * sizeof(glm::vec3));
 	}
 }
 
@@ -154,53 +234,94 @@ void WorldRenderer::updateAABB(ChunkBuffer& chunkBuffer) const {
 }
 
 void WorldRenderer::handleMeshQueue() {
-	voxel::ChunkMeshes meshes(0, 0, 0, 0);
-	if (!_world->pop(meshes)) {
-		return;
-	}
-	// Now add the mesh to the list of meshes to render.
 	core_trace_gl_scoped(WorldRendererHandleMeshQueue);
+	const double start = core::TimeProvider::currentNanos();
+	const double maxSeconds = _meshUploadMillis->floatVal() / 1000.0;
+	const size_t maxBytes = (size_t)glm::max(0, _meshUploadBytes->intVal());
+	size_t bytes = 0u;
 
-	ChunkBuffer* freeChunkBuffer = nullptr;
-	for (ChunkBuffer& chunkBuffer : _chunkBuffers) {
-		if (freeChunkBuffer == nullptr && !chunkBuffer.inuse) {
-			freeChunkBuffer = &chunkBuffer;
-		}
-		// check whether we update an existing one
-		if (chunkBuffer.translation() == meshes.translation()) {
-			freeChunkBuffer = &chunkBuffer;
+	// at least one mesh is handled per frame - no matter how big it is
+	voxel::ChunkMeshes meshes(0, 0, 0, 0);
+	while (_world->pop(meshes)) {
+		bytes += meshes.opaqueMesh.getNoOfVertices() * sizeof(voxel::VoxelVertex)
+				+ meshes.opaqueMesh.getNoOfIndices() * sizeof(voxel::IndexType)
+				+ meshes.waterMesh.getNoOfVertices() * sizeof(voxel::VoxelVertex)
+				+ meshes.waterMesh.getNoOfIndices() * sizeof(voxel::IndexType);
+		addMeshes(std::move(meshes));
+		if (bytes >= maxBytes || core::TimeProvider::currentNanos() - start >= maxSeconds) {
 			break;
 		}
 	}
+}
 
-	if (freeChunkBuffer == nullptr) {
-		Log::warn("Could not find free chunk buffer slot");
-		return;
-	}
-	if (!freeChunkBuffer->inuse) {
-		freeChunkBuffer->inuse = true;
+bool WorldRenderer::addMeshes(voxel::ChunkMeshes&& meshes) {
+	// check whether we update an existing one
+	ChunkBuffer* chunkBuffer = findChunkBuffer(meshes.translation());
+	if (chunkBuffer != nullptr) {
+		// the aabb is used to find the chunk in the octree - so remove it before the aabb changes
+		_octree.remove(chunkBuffer);
+	} else {
+		chunkBuffer = findFreeChunkBuffer();
+		if (chunkBuffer == nullptr) {
+			Log::warn("Could not find free chunk buffer slot");
+			return false;
+		}
+		chunkBuffer->inuse = true;
 		++_activeChunkBuffers;
+		_chunkBufferSlots[meshes.translation()] = (int)(chunkBuffer - _chunkBuffers);
 	}
-	if (freeChunkBuffer->occlusionQueryId == video::InvalidId) {
-		freeChunkBuffer->occlusionQueryId = video::genOcclusionQuery();
+	if (chunkBuffer->occlusionQueryId == video::InvalidId) {
+		chunkBuffer->occlusionQueryId = video::genOcclusionQuery();
 	}
 
-	freeChunkBuffer->meshes = std::move(meshes);
-	updateAABB(*freeChunkBuffer);
-	distributePlants(_world, freeChunkBuffer->translation(), freeChunkBuffer->instancedPositions);
-	fillPlantPositionsFromMeshes();
-	if (!_octree.insert(freeChunkBuffer)) {
+	chunkBuffer->meshes = std::move(meshes);
+	updateAABB(*chunkBuffer);
+	if (!uploadChunkMesh(_opaqueBuffer, *chunkBuffer)) {
+		Log::warn("Failed to upload the opaque mesh");
+	}
+	if (!uploadChunkMesh(_waterBuffer, *chunkBuffer)) {
+		Log::warn("Failed to upload the water mesh");
+	}
+	removePlants(*chunkBuffer);
+	addPlants(*chunkBuffer);
+	if (!_octree.insert(chunkBuffer)) {
 		Log::warn("Failed to insert into octree");
 	}
+	return true;
+}
+
+WorldRenderer::ChunkBuffer* WorldRenderer::findChunkBuffer(const glm::ivec3& translation) {
+	auto i = _chunkBufferSlots.find(translation);
+	if (i == _chunkBufferSlots.end()) {
+		return nullptr;
+	}
+	return &_chunkBuffers[i->second];
 }
 
 WorldRenderer::ChunkBuffer* WorldRenderer::findFreeChunkBuffer() {
-	for (int i = 0; i < (int)SDL_arraysize(_chunkBuffers); ++i) {
-		if (!_chunkBuffers[i].inuse) {
-			return &_chunkBuffers[i];
-		}
+	if (_freeChunkBuffers.empty()) {
+		return nullptr;
 	}
-	return nullptr;
+	const int slot = _freeChunkBuffers.back();
+	_freeChunkBuffers.pop_back();
+	core_assert(!_chunkBuffers[slot].inuse);
+	return &_chunkBuffers[slot];
+}
+
+void WorldRenderer::releaseChunkBuffer(ChunkBuffer& chunkBuffer) {
+	core_assert(chunkBuffer.inuse);
+	_world->allowReExtraction(chunkBuffer.translation());
+	chunkBuffer.inuse = false;
+	--_activeChunkBuffers;
+	_octree.remove(&chunkBuffer);
+	freeChunkMesh(_opaqueBuffer, chunkBuffer);
+	freeChunkMesh(_waterBuffer, chunkBuffer);
+	removePlants(chunkBuffer);
+	video::deleteOcclusionQuery(chunkBuffer.occlusionQueryId);
+	chunkBuffer.pendingResult = false;
+	chunkBuffer.occludedLastFrame = false;
+	_chunkBufferSlots.erase(chunkBuffer.translation());
+	_freeChunkBuffers.push_back((int)(&chunkBuffer - _chunkBuffers));
 }
 
 bool WorldRenderer::checkShaders() const {
@@ -213,18 +334,96 @@ bool WorldRenderer::checkShaders() const {
 	return same;
 }
 
-static size_t transform(size_t indexOffset, const voxel::Mesh& mesh, std::vector<voxel::VoxelVertex>& verts, std::vector<voxel::IndexType>& idxs) {
-	const std::vector<voxel::IndexType>& indices = mesh.getIndexVector();
-	std::transform(indices.begin(), indices.end(),
-		std::back_inserter(idxs),
-		[=] (voxel::IndexType index) {
-			return index + indexOffset;
+bool WorldRenderer::uploadChunkMesh(ChunkMeshBuffer& buffer, ChunkBuffer& chunkBuffer) {
+	freeChunkMesh(buffer, chunkBuffer);
+	const voxel::Mesh& mesh = chunkBuffer.meshes.*buffer.mesh;
+	const int32_t vertices = (int32_t)mesh.getNoOfVertices();
+	const int32_t indices = (int32_t)mesh.getNoOfIndices();
+	if (vertices == 0 || indices == 0) {
+		return true;
+	}
+	core_trace_gl_scoped(WorldRendererUploadChunkMesh);
+
+	int32_t baseVertex = buffer.vertices.allocate(vertices);
+	if (baseVertex == -1) {
+		if (!growVertexBuffer(buffer, vertices)) {
+			return false;
+		}
+		baseVertex = buffer.vertices.allocate(vertices);
+	}
+	int32_t baseIndex = buffer.indices.allocate(indices);
+	if (baseIndex == -1) {
+		if (!growIndexBuffer(buffer, indices)) {
+			buffer.vertices.free(baseVertex, vertices);
+			return false;
 		}
-	);
+		baseIndex = buffer.indices.allocate(indices);
+	}
+	core_assert(baseVertex != -1 && baseIndex != -1);
 
-	const std::vector<voxel::VoxelVertex>& vertices = mesh.getVertexVector();
-	verts.insert(verts.end(), vertices.begin(), vertices.end());
-	return vertices.size();
+	if (!buffer.vb.update(buffer.vbo, baseVertex * sizeof(voxel::VoxelVertex), &mesh.getVertexVector().front(), vertices * sizeof(voxel::VoxelVertex))
+	 || !buffer.vb.update(buffer.ibo, baseIndex * sizeof(voxel::IndexType), &mesh.getIndexVector().front(), indices * sizeof(voxel::IndexType))) {
+		buffer.vertices.free(baseVertex, vertices);
+		buffer.indices.free(baseIndex, indices);
+		return false;
+	}
+
+	MeshRange& range = chunkBuffer.*buffer.range;
+	range.baseVertex = baseVertex;
+	range.vertices = vertices;
+	range.baseIndex = baseIndex;
+	range.indices = indices;
+	return true;
+}
+
+void WorldRenderer::freeChunkMesh(ChunkMeshBuffer& buffer, ChunkBuffer& chunkBuffer) {
+	MeshRange& range = chunkBuffer.*buffer.range;
+	if (range.vertices > 0) {
+		buffer.vertices.free(range.baseVertex, range.vertices);
+		buffer.indices.free(range.baseIndex, range.indices);
+	}
+	range = MeshRange();
+}
+
+bool WorldRenderer::growVertexBuffer(ChunkMeshBuffer& buffer, int32_t vertices) {
+	const int32_t capacity = buffer.vertices.capacity();
+	const int32_t newCapacity = glm::max(capacity * 2, capacity + vertices);
+	if (!buffer.vb.reserve(buffer.vbo, newCapacity * sizeof(voxel::VoxelVertex))) {
+		Log::error("Failed to resize the chunk vertex buffer to %i vertices", newCapacity);
+		return false;
+	}
+	buffer.vertices.grow(newCapacity);
+	Log::debug("Resized the chunk vertex buffer to %i vertices", newCapacity);
+	// the content of the buffer is gone - upload the meshes again at their old location
+	for (const ChunkBuffer& chunkBuffer : _chunkBuffers) {
+		const MeshRange& range = chunkBuffer.*buffer.range;
+		if (range.vertices == 0) {
+			continue;
+		}
+		const voxel::Mesh& mesh = chunkBuffer.meshes.*buffer.mesh;
+		buffer.vb.update(buffer.vbo, range.baseVertex * sizeof(voxel::VoxelVertex), &mesh.getVertexVector().front(), range.vertices * sizeof(voxel::VoxelVertex));
+	}
+	return true;
+}
+
+bool WorldRenderer::growIndexBuffer(ChunkMeshBuffer& buffer, int32_t indices) {
+	const int32_t capacity = buffer.indices.capacity();
+	const int32_t newCapacity = glm::max(capacity * 2, capacity + indices);
+	if (!buffer.vb.reserve(buffer.ibo, newCapacity * sizeof(voxel::IndexType))) {
+		Log::error("Failed to resize the chunk index buffer to %i indices", newCapacity);
+		return false;
+	}
+	buffer.indices.grow(newCapacity);
+	Log::debug("Resized the chunk index buffer to %i indices", newCapacity);
+	for (const ChunkBuffer& chunkBuffer : _chunkBuffers) {
+		const MeshRange& range = chunkBuffer.*buffer.range;
+		if (range.indices == 0) {
+			continue;
+		}
+		const voxel::Mesh& mesh = chunkBuffer.meshes.*buffer.mesh;
+		buffer.vb.update(buffer.ibo, range.baseIndex * sizeof(voxel::IndexType), &mesh.getIndexVector().front(), range.indices * sizeof(voxel::IndexType));
+	}
+	return true;
 }
 
 bool WorldRenderer::occluded(ChunkBuffer * chunkBuffer) const {
@@ -234,6 +433,11 @@ bool WorldRenderer::occluded(ChunkBuffer * chunkBuffer) const {
 		// having occlusion queries disabled.
 		return chunkBuffer->occludedLastFrame;
 	}
+	// there is no result for a query that wasn't issued yet (e.g. for a chunk that was just added) - reading
+	// it is an error. Such chunks are visible until their first query finished.
+	if (!chunkBuffer->pendingResult) {
+		return chunkBuffer->occludedLastFrame;
+	}
 	const video::Id queryId = chunkBuffer->occlusionQueryId;
 	const int samples = video::getOcclusionQueryResult(queryId);
 	if (samples == -1) {
@@ -245,12 +449,9 @@ bool WorldRenderer::occluded(ChunkBuffer * chunkBuffer) const {
 }
 
 void WorldRenderer::cull(const video::Camera& camera) {
-	_opaqueIndices.clear();
-	_opaqueVertices.clear();
-	_waterIndices.clear();
-	_waterVertices.clear();
-	size_t opaqueIndexOffset = 0;
-	size_t waterIndexOffset = 0;
+	_opaqueBuffer.clearDraws();
+	_waterBuffer.clearDraws();
+	_visibleVertices = 0;
 	_visibleChunks = 0;
 	_occludedChunks = 0;
 
@@ -260,56 +461,70 @@ void WorldRenderer::cull(const video::Camera& camera) {
 	// TODO: calculate whether the sides of a chunk are completely filled - can be done with a bitmask of uint8_t for each chunk.
 	// this can help culling later on.
 
-	// TODO: the first few entries should get lesser chunk in the multi query than the ones that are
-	// far away from the camera - it's more likely that the far away chunks are occluded.
-	// doing one query per chunk is most likely a little bit overkill.
 	const bool occlusionQuery = _occlusionQuery->boolVal();
 
-	std::vector<ChunkBuffer*> contents;
-	contents.reserve(_activeChunkBuffers);
-	_octree.query(camera.frustum(), contents);
-	_queryResults = contents.size();
-
-#if 0
-	class VisibleSorter {
-	private:
-		const glm::vec3 _pos;
-	public:
-		VisibleSorter(const glm::vec3& pos) :
-				_pos(pos) {
-		}
+	_frustumChunkBuffers.clear();
+	_visibleChunkBuffers.clear();
+	_occludedChunkBuffers.clear();
+	_octree.query(camera.frustum(), _frustumChunkBuffers);
+	_queryResults = _frustumChunkBuffers.size();
+
+	// render front to back - this reduces the overdraw and the chunks that are rendered first occlude
+	// the ones that are further away
+	const glm::vec3& cameraPos = camera.position();
+	std::sort(_frustumChunkBuffers.begin(), _frustumChunkBuffers.end(), [&] (const ChunkBuffer* lhs, const ChunkBuffer* rhs) {
+		const glm::vec3 lhsDelta = glm::vec3(lhs->aabb().getCenter()) - cameraPos;
+		const glm::vec3 rhsDelta = glm::vec3(rhs->aabb().getCenter()) - cameraPos;
+		return glm::dot(lhsDelta, lhsDelta) < glm::dot(rhsDelta, rhsDelta);
+	});
 
-		inline float dist(const glm::vec3& pos) const {
-			return glm::distance2(_pos, pos);
+	const bool renderOccluded = _renderOccluded->boolVal();
+	_shapeBuilder.clear();
+	for (ChunkBuffer* chunkBuffer : _frustumChunkBuffers) {
+		if (!chunkBuffer->aabb().containsPoint(cameraPos) && occluded(chunkBuffer)) {
+			++_occludedChunks;
+			if (!renderOccluded) {
+				// rendered with the result of the occlusion query of this frame
+				if (occlusionQuery) {
+					_occludedChunkBuffers.push_back(chunkBuffer);
+				}
+				continue;
+			}
+		} else {
+			++_visibleChunks;
+			if (renderOccluded) {
+				continue;
+			}
+			_visibleChunkBuffers.push_back(chunkBuffer);
 		}
-
-		inline bool operator()(const ChunkBuffer* lhs, const ChunkBuffer* rhs) const {
-			const float lhsDist = dist(lhs->translation());
-			const float rhsDist = dist(rhs->translation());
-			return lhsDist < rhsDist;
+		if (_renderAABBs->boolVal()) {
+			_shapeBuilder.setColor(core::Color::Green);
+			_shapeBuilder.aabb(chunkBuffer->aabb());
 		}
-	};
-	std::sort(contents.begin(), contents.end(), VisibleSorter(camera.position()));
-#endif
-
-	if (occlusionQuery) {
-		// disable writing to the color buffer
-		// We just want to check whether they would be rendered, not actually render them
-		video::colorMask(false, false, false, false);
+		_opaqueBuffer.addDraw(chunkBuffer->opaqueRange);
+		_waterBuffer.addDraw(chunkBuffer->waterRange);
+		_visibleVertices += chunkBuffer->opaqueRange.vertices + chunkBuffer->waterRange.vertices;
+	}
+}
 
-		for (ChunkBuffer* chunkBuffer : contents) {
+void WorldRenderer::occlusionQueries(const video::Camera& camera) {
+	if (!_occlusionQuery->boolVal()) {
+		return;
+	}
+	core_trace_gl_scoped(WorldRendererOcclusionQueries);
+	// We just want to check whether the bounding boxes would be rendered against the depth buffer
+	// of the chunks that were visible - not actually render them
+	video::colorMask(false, false, false, false);
+	video::disable(video::State::DepthMask);
+	const glm::vec3& cameraPos = camera.position();
+	for (const std::vector<ChunkBuffer*>* chunkBuffers : {&_visibleChunkBuffers, &_occludedChunkBuffers}) {
+		for (ChunkBuffer* chunkBuffer : *chunkBuffers) {
+			// the query object is still in use - the result is fetched in one of the next frames
 			if (chunkBuffer->pendingResult) {
-#if 0
-				const core::AABB<int>& aabb = chunkBuffer->aabb();
-				const glm::vec3& center = glm::vec3(aabb.getCenter());
-				const glm::mat4& translate = glm::translate(center);
-				const glm::mat4& model = glm::scale(translate, glm::vec3(aabb.getWidth()));
-				_shapeRendererOcclusionQuery.render(_aabbMeshesOcclusionQuery, camera, model);
-#endif
 				continue;
 			}
 			const core::AABB<int>& aabb = chunkBuffer->aabb();
-			if (aabb.containsPoint(camera.position())) {
+			if (aabb.containsPoint(cameraPos)) {
 				continue;
 			}
 			const video::Id queryId = chunkBuffer->occlusionQueryId;
@@ -322,55 +537,42 @@ void WorldRenderer::cull(const video::Camera& camera) {
 			core_assert_always(video::endOcclusionQuery(queryId));
 			chunkBuffer->pendingResult = true;
 		}
-		video::flush();
-	}
-
-	// TODO: maybe fill the shapebuilder before waiting for the query result - measure measure measure...
-	const bool renderOccluded = _renderOccluded->boolVal();
-	_shapeBuilder.clear();
-	for (ChunkBuffer* chunkBuffer : contents) {
-		if (occluded(chunkBuffer)) {
-			 ++_occludedChunks;
-			 if (!renderOccluded) {
-				 continue;
-			 }
-		} else if (renderOccluded) {
-			++_visibleChunks;
-			continue;
-		} else {
-			++_visibleChunks;
-		}
-		if (_renderAABBs->boolVal()) {
-			_shapeBuilder.setColor(core::Color::Green);
-			_shapeBuilder.aabb(chunkBuffer->aabb());
-		}
-		const voxel::ChunkMeshes& meshes = chunkBuffer->meshes;
-		opaqueIndexOffset += transform(opaqueIndexOffset, meshes.opaqueMesh, _opaqueVertices, _opaqueIndices);
-		waterIndexOffset += transform(waterIndexOffset, meshes.waterMesh, _waterVertices, _waterIndices);
 	}
-
+	video::flush();
+	video::enable(video::State::DepthMask);
 	video::colorMask(true, true, true, true);
 }
 
-bool WorldRenderer::renderOpaqueBuffers() {
-	const uint32_t numIndices = _opaqueBuffer.elements(_opaqueIbo, 1, sizeof(voxel::IndexType));
-	if (numIndices == 0u) {
-		return false;
+int WorldRenderer::renderOccludedChunkMeshes(const ChunkMeshBuffer& buffer) {
+	if (_occludedChunkBuffers.empty()) {
+		return 0;
 	}
-	_opaqueBuffer.bind();
-	video::drawElements<voxel::IndexType>(video::Primitive::Triangles, numIndices);
-	_opaqueBuffer.unbind();
-	return true;
+	int drawCalls = 0;
+	buffer.vb.bind();
+	for (const ChunkBuffer* chunkBuffer : _occludedChunkBuffers) {
+		const MeshRange& range = chunkBuffer->*buffer.range;
+		if (range.indices == 0) {
+			continue;
+		}
+		// the gpu decides whether the chunk is rendered - we don't wait for the query result
+		video::beginConditionalRender(chunkBuffer->occlusionQueryId);
+		video::drawElementsBaseVertex<voxel::IndexType>(video::Primitive::Triangles, range.indices, range.baseIndex, range.baseVertex);
+		video::endConditionalRender();
+		++drawCalls;
+	}
+	buffer.vb.unbind();
+	return drawCalls;
 }
 
-bool WorldRenderer::renderWaterBuffers() {
-	const uint32_t numIndices = _waterBuffer.elements(_waterIbo, 1, sizeof(voxel::IndexType));
-	if (numIndices == 0u) {
+bool WorldRenderer::renderChunkMeshes(const ChunkMeshBuffer& buffer) {
+	const int draws = (int)buffer.drawIndices.size();
+	if (draws == 0) {
 		return false;
 	}
-	_waterBuffer.bind();
-	video::drawElements<voxel::IndexType>(video::Primitive::Triangles, numIndices);
-	_waterBuffer.unbind();
+	buffer.vb.bind();
+	video::multiDrawElementsBaseVertex<voxel::IndexType>(video::Primitive::Triangles,
+			&buffer.drawIndices.front(), &buffer.drawOffsets.front(), &buffer.drawBaseVertices.front(), draws);
+	buffer.vb.unbind();
 	return true;
 }
 
@@ -399,23 +601,16 @@ int WorldRenderer::renderPlants(const std::list<PlantBuffer*>& vbos, int* vertic
 
 int WorldRenderer::renderWorld(const video::Camera& camera, int* vertices) {
 	handleMeshQueue();
+	uploadPlantInstances();
 
 	cull(camera);
 	if (vertices != nullptr) {
-		*vertices = _opaqueVertices.size() + _waterVertices.size();
-	}
-	if (_visibleChunks == 0) {
-		return 0;
+		*vertices = _visibleVertices;
 	}
-	if (_opaqueIndices.empty() && _waterIndices.empty()) {
+	if (_opaqueBuffer.drawIndices.empty() && _waterBuffer.drawIndices.empty() && _occludedChunkBuffers.empty()) {
 		return 0;
 	}
 
-	core_assert_always(_opaqueBuffer.update(_opaqueVbo, _opaqueVertices));
-	core_assert_always(_opaqueBuffer.update(_opaqueIbo, _opaqueIndices));
-	core_assert_always(_waterBuffer.update(_waterVbo, _waterVertices));
-	core_assert_always(_waterBuffer.update(_waterIbo, _waterIndices));
-
 	const bool shadowMap = _shadowMap->boolVal();
 
 	{
@@ -499,7 +694,7 @@ int WorldRenderer::renderWorld(const video::Camera& camera, int* vertices) {
 				video::ScopedShader scoped(_shadowMapShader);
 				_shadowMapShader.setLightviewprojection(cascades[i]);
 				_shadowMapShader.setModel(glm::mat4());
-				renderOpaqueBuffers();
+				renderChunkMeshes(_opaqueBuffer);
 				++drawCallsWorld;
 			}
 			{
@@ -530,10 +725,15 @@ int WorldRenderer::renderWorld(const video::Camera& camera, int* vertices) {
 			_worldShader.setCascades(cascades);
 			_worldShader.setDistances(distances);
 		}
-		if (renderOpaqueBuffers()) {
+		if (renderChunkMeshes(_opaqueBuffer)) {
 			++drawCallsWorld;
 		}
 	}
+	occlusionQueries(camera);
+	if (!_occludedChunkBuffers.empty()) {
+		video::ScopedShader scoped(_worldShader);
+		drawCallsWorld += renderOccludedChunkMeshes(_opaqueBuffer);
+	}
 	{
 		video::ScopedShader scoped(_worldInstancedShader);
 		_worldInstancedShader.setModel(glm::scale(glm::vec3(0.4f)));
@@ -550,9 +750,10 @@ int WorldRenderer::renderWorld(const video::Camera& camera, int* vertices) {
 			_waterShader.setCascades(cascades);
 			_waterShader.setDistances(distances);
 		}
-		if (renderWaterBuffers()) {
+		if (renderChunkMeshes(_waterBuffer)) {
 			++drawCallsWorld;
 		}
+		drawCallsWorld += renderOccludedChunkMeshes(_waterBuffer);
 	}
 
 	video::bindVertexArray(video::InvalidId);
@@ -669,6 +870,8 @@ bool WorldRenderer::createInstancedVertexBuffer(const voxel::Mesh &mesh, int amo
 		Log::error("Failed to create index buffer");
 		return false;
 	}
+	// the instances are updated in parts
+	vbo.vb.setMode(video::VertexBufferMode::Dynamic);
 	vbo.offsetBuffer = vbo.vb.create();
 	if (vbo.offsetBuffer == -1) {
 		Log::error("Failed to create offset buffer");
@@ -704,27 +907,72 @@ bool WorldRenderer::createInstancedVertexBuffer(const voxel::Mesh &mesh, int amo
 	return true;
 }
 
+void WorldRenderer::extractMeshes(const video::Camera& camera, int radius) {
+	scheduleExtractions(camera.position(), &camera, radius);
+}
+
 void WorldRenderer::extractMeshes(const glm::vec3& p, int radius) {
-	core_trace_scoped(WorldRendererOnSpawn);
-	const glm::ivec3& meshGridPos = _world->meshPos(p);
+	scheduleExtractions(p, nullptr, radius);
+}
+
+int WorldRenderer::extractionPriority(const glm::ivec3& distance, bool visible, bool hidden) {
+	// the tiles in the view frustum are scheduled before all others, the hidden ones after everything else
+	static constexpr int OutsideFrustumPriority = 1 << 23;
+	static constexpr int HiddenPriority = 1 << 24;
+	int priority = distance.x * distance.x + distance.y * distance.y + distance.z * distance.z;
+	if (hidden) {
+		priority += HiddenPriority;
+	} else if (!visible) {
+		priority += OutsideFrustumPriority;
+	}
+	return priority;
+}
+
+void WorldRenderer::scheduleExtractions(const glm::vec3& p, const video::Camera* camera, int radius) {
 	core_trace_scoped(WorldRendererExtractAroundCamera);
+	int meshes, extracted, pending;
+	_world->stats(meshes, extracted, pending);
+	// the extracted meshes that weren't uploaded yet count, too - otherwise a slow upload lets them pile up
+	const int inFlight = pending + meshes;
+	const int maxPending = _maxPendingExtractions->intVal();
+	if (inFlight >= maxPending) {
+		return;
+	}
+	const glm::ivec3 center(p);
+	const glm::ivec3& meshGridPos = _world->meshPos(center);
 	const int sideLength = radius * 2 + 1;
-	const int amount = sideLength * (sideLength - 1) + sideLength;
+	const int amount = sideLength * sideLength;
 	const int meshSize = _world->meshSize();
-	glm::ivec3 pos = meshGridPos;
-	pos.y = 0;
+	const int topY = (voxel::MAX_HEIGHT - 2) / meshSize * meshSize;
+	const glm::ivec3 halfMeshSize(meshSize / 2);
+	_extractionCandidates.clear();
 	voxel::Spiral o;
 	for (int i = 0; i < amount; ++i) {
-		_world->scheduleMeshExtraction(pos);
+		glm::ivec3 pos(meshGridPos.x + o.x() * meshSize, topY, meshGridPos.z + o.z() * meshSize);
 		o.next();
-		pos.y = 0;
-		pos.x = meshGridPos.x + o.x() * meshSize;
-		pos.z = meshGridPos.z + o.z() * meshSize;
-		while (pos.y < voxel::MAX_HEIGHT - 1) {
-			_world->scheduleMeshExtraction(pos);
-			pos.y += meshSize;
+		// the column is walked from the top - nothing below an enclosed tile is visible from above
+		bool hidden = false;
+		for (; pos.y >= 0; pos.y -= meshSize) {
+			if (_world->isMeshExtractionScheduled(pos)) {
+				if (!hidden && center.y >= pos.y + meshSize) {
+					hidden = _world->isMeshEnclosed(pos);
+				}
+				continue;
+			}
+			const bool visible = hidden || camera == nullptr || camera->isVisible(glm::vec3(pos), glm::vec3(pos + meshSize));
+			const int priority = extractionPriority(pos + halfMeshSize - center, visible, hidden);
+			_extractionCandidates.push_back(ExtractionCandidate{pos, priority});
 		}
 	}
+	const int schedule = std::min(maxPending - inFlight, (int)_extractionCandidates.size());
+	std::partial_sort(_extractionCandidates.begin(), _extractionCandidates.begin() + schedule, _extractionCandidates.end(),
+			[] (const ExtractionCandidate& lhs, const ExtractionCandidate& rhs) {
+		return lhs.priority < rhs.priority;
+	});
+	for (int i = 0; i < schedule; ++i) {
+		const ExtractionCandidate& candidate = _extractionCandidates[i];
+		_world->scheduleMeshExtraction(candidate.pos, candidate.priority);
+	}
 }
 
 void WorldRenderer::stats(Stats& stats) const {
@@ -744,68 +992,77 @@ void WorldRenderer::onConstruct() {
 	_occlusionThreshold = core::Var::get(config::OcclusionThreshold, "20");
 	_occlusionQuery = core::Var::get(config::OcclusionQuery, "false");
 	_renderOccluded = core::Var::get(config::RenderOccluded, "false");
+	_meshUploadMillis = core::Var::get(config::MeshUploadMillis, "2");
+	_meshUploadBytes = core::Var::get(config::MeshUploadBytes, "8388608");
+	_maxPendingExtractions = core::Var::get(cfg::ClientMaxPendingExtractions, "64");
 }
 
 bool WorldRenderer::initOpaqueBuffer() {
-	_opaqueVbo = _opaqueBuffer.create();
-	if (_opaqueVbo == -1) {
+	video::VertexBuffer& vb = _opaqueBuffer.vb;
+	vb.setMode(video::VertexBufferMode::Dynamic);
+	_opaqueBuffer.vbo = vb.create();
+	if (_opaqueBuffer.vbo == -1) {
 		Log::error("Failed to create vertex buffer");
 		return false;
 	}
-	_opaqueIbo = _opaqueBuffer.create(nullptr, 0, video::VertexBufferType::IndexBuffer);
-	if (_opaqueIbo == -1) {
+	_opaqueBuffer.ibo = vb.create(nullptr, 0, video::VertexBufferType::IndexBuffer);
+	if (_opaqueBuffer.ibo == -1) {
 		Log::error("Failed to create index buffer");
 		return false;
 	}
 
 	const int locationPos = _worldShader.getLocationPos();
 	_worldShader.enableVertexAttributeArray(locationPos);
-	const video::Attribute& posAttrib = getPositionVertexAttribute(_opaqueVbo, locationPos, _worldShader.getAttributeComponents(locationPos));
-	if (!_opaqueBuffer.addAttribute(posAttrib)) {
+	const video::Attribute& posAttrib = getPositionVertexAttribute(_opaqueBuffer.vbo, locationPos, _worldShader.getAttributeComponents(locationPos));
+	if (!vb.addAttribute(posAttrib)) {
 		Log::error("Failed to add position attribute");
 		return false;
 	}
 
 	const int locationInfo = _worldShader.getLocationInfo();
 	_worldShader.enableVertexAttributeArray(locationInfo);
-	const video::Attribute& infoAttrib = getInfoVertexAttribute(_opaqueVbo, locationInfo, _worldShader.getAttributeComponents(locationInfo));
-	if (!_opaqueBuffer.addAttribute(infoAttrib)) {
+	const video::Attribute& infoAttrib = getInfoVertexAttribute(_opaqueBuffer.vbo, locationInfo, _worldShader.getAttributeComponents(locationInfo));
+	if (!vb.addAttribute(infoAttrib)) {
 		Log::error("Failed to add info attribute");
 		return false;
 	}
 
-	return true;
+	return growVertexBuffer(_opaqueBuffer, OpaqueBufferVertices)
+		&& growIndexBuffer(_opaqueBuffer, OpaqueBufferVertices * IndicesPerVertex);
 }
 
 bool WorldRenderer::initWaterBuffer() {
-	_waterVbo = _waterBuffer.create();
-	if (_waterVbo == -1) {
+	video::VertexBuffer& vb = _waterBuffer.vb;
+	vb.setMode(video::VertexBufferMode::Dynamic);
+	_waterBuffer.vbo = vb.create();
+	if (_waterBuffer.vbo == -1) {
 		Log::error("Failed to create water vertex buffer");
 		return false;
 	}
-	_waterIbo = _waterBuffer.create(nullptr, 0, video::VertexBufferType::IndexBuffer);
-	if (_waterIbo == -1) {
+	_waterBuffer.ibo = vb.create(nullptr, 0, video::VertexBufferType::IndexBuffer);
+	if (_waterBuffer.ibo == -1) {
 		Log::error("Failed to create water index buffer");
 		return false;
 	}
 
 	const int locationPos = _waterShader.getLocationPos();
 	_waterShader.enableVertexAttributeArray(locationPos);
-	const video::Attribute& posAttrib = getPositionVertexAttribute(_waterVbo, locationPos, _waterShader.getAttributeComponents(locationPos));
-	if (!_waterBuffer.addAttribute(posAttrib)) {
+	const video::Attribute& posAttrib = getPositionVertexAttribute(_waterBuffer.vbo, locationPos, _waterShader.getAttributeComponents(locationPos));
+	if (!vb.addAttribute(posAttrib)) {
 		Log::error("Failed to add water position attribute");
 		return false;
 	}
 
 	const int locationInfo = _waterShader.getLocationInfo();
 	_waterShader.enableVertexAttributeArray(locationInfo);
-	const video::Attribute& infoAttrib = getInfoVertexAttribute(_waterVbo, locationInfo, _waterShader.getAttributeComponents(locationInfo));
-	if (!_waterBuffer.addAttribute(infoAttrib)) {
+	const video::Attribute& infoAttrib = getInfoVertexAttribute(_waterBuffer.vbo, locationInfo, _waterShader.getAttributeComponents(locationInfo));
+	if (!vb.addAttribute(infoAttrib)) {
 		Log::error("Failed to add water info attribute");
 		return false;
 	}
 
-	return true;
+	return growVertexBuffer(_waterBuffer, WaterBufferVertices)
+		&& growIndexBuffer(_waterBuffer, WaterBufferVertices * IndicesPerVertex);
 }
 
 bool WorldRenderer::init(const glm::ivec2& position, const glm::ivec2& dimension) {
@@ -919,11 +1176,7 @@ void WorldRenderer::onRunning(const video::Camera& camera, long dt) {
 		const int distance = getDistanceSquare(chunkBuffer.translation(), glm::ivec3(camera.position()));
 		Log::trace("distance is: %i (%i)", distance, maxAllowedDistance);
 		if (distance >= maxAllowedDistance) {
-			_world->allowReExtraction(chunkBuffer.translation());
-			chunkBuffer.inuse = false;
-			--_activeChunkBuffers;
-			_octree.remove(&chunkBuffer);
-			video::deleteOcclusionQuery(chunkBuffer.occlusionQueryId);
+			releaseChunkBuffer(chunkBuffer);
 			Log::trace("Remove mesh from %i:%i", chunkBuffer.translation().x, chunkBuffer.translation().z);
 		}
 	}
@@ -16,6 +16,7 @@
 #include "FrontendShaders.h"
 #include "core/GLM.h"
 #include "core/Octree.h"
+#include "core/RangeAllocator.h"
 #include "core/Var.h"
 #include "core/Color.h"
 #include "ClientEntity.h"
@@ -43,14 +44,43 @@ protected:
 			offsetBuffer = -1;
 			indexBuffer = -1;
 			vertexBuffer = -1;
+			clearInstances();
+			capacity = 0u;
+		}
+		void clearInstances() {
 			instancedPositions.clear();
+			owners.clear();
+			dirtyStart = 0;
 		}
+		/**
+		 * @brief The chunk buffer slot and the index in the plant instances of that chunk
+		 */
+		struct InstanceOwner {
+			int32_t chunkBuffer;
+			int32_t index;
+		};
 		int32_t offsetBuffer = -1;
 		int32_t indexBuffer = -1;
 		int32_t vertexBuffer = -1;
 		uint32_t amount = 1u;
 		video::VertexBuffer vb;
+		// the instances of all chunks without any gaps - removed instances are replaced by the last one
 		std::vector<glm::vec3> instancedPositions;
+		std::vector<InstanceOwner> owners;
+		// the first instance that was changed since the last upload - -1 if nothing changed
+		int32_t dirtyStart = -1;
+		// the amount of instances the offset buffer has room for
+		size_t capacity = 0u;
+	};
+
+	/**
+	 * @brief The part of a ChunkMeshBuffer that holds the mesh of one chunk
+	 */
+	struct MeshRange {
+		int32_t baseVertex = -1;
+		int32_t vertices = 0;
+		int32_t baseIndex = -1;
+		int32_t indices = 0;
 	};
 
 	struct ChunkBuffer {
@@ -60,9 +90,13 @@ protected:
 		bool inuse = false;
 		core::AABB<int> _aabb = {glm::zero<glm::ivec3>(), glm::zero<glm::ivec3>()};
 		voxel::ChunkMeshes meshes {0, 0, 0, 0};
-		std::vector<glm::vec3> instancedPositions;
+		MeshRange opaqueRange;
+		MeshRange waterRange;
+		// the indices of the plant instances of this chunk in the plant buffers
+		std::vector<int32_t> plantInstances[(int)voxel::PlantType::MaxPlantTypes];
 		video::Id occlusionQueryId = video::InvalidId;
 		bool occludedLastFrame = false;
+		// the occlusion query was issued and its result wasn't read yet
 		bool pendingResult = false;
 
 		inline const glm::ivec3& translation() const {
@@ -74,26 +108,74 @@ protected:
 		}
 	};
 
+	/**
+	 * @brief Persistent vertex and index buffer that holds the meshes of all chunks of one type.
+	 *
+	 * The chunk meshes are only uploaded once - culling collects the ranges of the visible
+	 * chunks which are then rendered with one multi draw call.
+	 */
+	struct ChunkMeshBuffer {
+		ChunkMeshBuffer(voxel::Mesh voxel::ChunkMeshes::* _mesh, MeshRange ChunkBuffer::* _range) :
+				mesh(_mesh), range(_range) {
+		}
+		void clearDraws() {
+			drawIndices.clear();
+			drawOffsets.clear();
+			drawBaseVertices.clear();
+		}
+		void addDraw(const MeshRange& r) {
+			if (r.indices == 0) {
+				return;
+			}
+			drawIndices.push_back(r.indices);
+			drawOffsets.push_back((intptr_t)(r.baseIndex * sizeof(voxel::IndexType)));
+			drawBaseVertices.push_back(r.baseVertex);
+		}
+		// the mesh of the chunk that is stored in this buffer
+		voxel::Mesh voxel::ChunkMeshes::* const mesh;
+		MeshRange ChunkBuffer::* const range;
+		video::VertexBuffer vb;
+		int32_t vbo = -1;
+		int32_t ibo = -1;
+		core::RangeAllocator vertices;
+		core::RangeAllocator indices;
+		std::vector<int32_t> drawIndices;
+		std::vector<intptr_t> drawOffsets;
+		std::vector<int32_t> drawBaseVertices;
+	};
+
 	core::Octree<ChunkBuffer*> _octree;
 	static constexpr int MAX_CHUNKBUFFERS = 4096;
 	ChunkBuffer _chunkBuffers[MAX_CHUNKBUFFERS];
+	// the slots of the chunk buffers in use by the translation of their meshes
+	std::unordered_map<glm::ivec3, int, std::hash<glm::ivec3> > _chunkBufferSlots;
+	// the slots that are not in use - the next free slot is at the end
+	std::vector<int> _freeChunkBuffers;
 	int _activeChunkBuffers = 0;
 	int _visibleChunks = 0;
 	int _occludedChunks = 0;
 	int _queryResults = 0;
+	int _visibleVertices = 0;
 	PlantBuffer _meshPlantList[(int)voxel::PlantType::MaxPlantTypes];
 
 	std::list<PlantBuffer*> _visiblePlant;
-	std::vector<voxel::VoxelVertex> _opaqueVertices;
-	std::vector<voxel::IndexType> _opaqueIndices;
-	video::VertexBuffer _opaqueBuffer;
-	int32_t _opaqueIbo = -1;
-	int32_t _opaqueVbo = -1;
-	std::vector<voxel::VoxelVertex> _waterVertices;
-	std::vector<voxel::IndexType> _waterIndices;
-	video::VertexBuffer _waterBuffer;
-	int32_t _waterIbo = -1;
-	int32_t _waterVbo = -1;
+	std::vector<glm::vec3> _plantPositions;
+	/**
+	 * @brief A mesh tile around the camera that is not yet extracted
+	 */
+	struct ExtractionCandidate {
+		glm::ivec3 pos;
+		// the candidates with the lowest value are scheduled first
+		int priority;
+	};
+	std::vector<ExtractionCandidate> _extractionCandidates;
+	// the chunks in the view frustum - sorted front to back
+	std::vector<ChunkBuffer*> _frustumChunkBuffers;
+	std::vector<ChunkBuffer*> _visibleChunkBuffers;
+	// the chunks that were occluded in the last frame - they are rendered depending on the occlusion query result
+	std::vector<ChunkBuffer*> _occludedChunkBuffers;
+	ChunkMeshBuffer _opaqueBuffer {&voxel::ChunkMeshes::opaqueMesh, &ChunkBuffer::opaqueRange};
+	ChunkMeshBuffer _waterBuffer {&voxel::ChunkMeshes::waterMesh, &ChunkBuffer::waterRange};
 
 	typedef std::unordered_map<ClientEntityId, ClientEntityPtr> Entities;
 	Entities _entities;
@@ -109,6 +191,9 @@ protected:
 	core::VarPtr _occlusionThreshold;
 	core::VarPtr _occlusionQuery;
 	core::VarPtr _renderOccluded;
+	core::VarPtr _meshUploadMillis;
+	core::VarPtr _meshUploadBytes;
+	core::VarPtr _maxPendingExtractions;
 
 	video::ShapeBuilder _shapeBuilderOcclusionQuery;
 	frontend::ShapeRenderer _shapeRendererOcclusionQuery;
@@ -144,25 +229,67 @@ protected:
 	 */
 	bool createVertexBufferInternal(const video::Shader& shader, const voxel::Mesh &mesh, PlantBuffer& vbo);
 	bool createInstancedVertexBuffer(const voxel::Mesh &mesh, int amount, PlantBuffer& vbo);
+	/**
+	 * @brief Uploads the extracted meshes until the time or byte budget of the frame is used up
+	 */
 	void handleMeshQueue();
+	bool addMeshes(voxel::ChunkMeshes&& meshes);
 	void updateAABB(ChunkBuffer& chunkBuffer) const;
 	/**
-	 * @brief Redistribute the plants on the meshes that are already extracted
+	 * @brief Distributes the plants of the given chunk over the plant buffers
 	 */
-	void fillPlantPositionsFromMeshes();
+	void addPlants(ChunkBuffer& chunkBuffer);
+	void removePlants(ChunkBuffer& chunkBuffer);
+	/**
+	 * @brief Uploads the plant instances that were changed since the last call
+	 */
+	void uploadPlantInstances();
 
 	int getDistanceSquare(const glm::ivec3& pos, const glm::ivec3& pos2) const;
 
 	void cull(const video::Camera& camera);
+	/**
+	 * @brief Issues the occlusion queries for the bounding boxes of the culled chunks against the depth
+	 * of the chunks that were rendered so far. The results are used in the next frames.
+	 */
+	void occlusionQueries(const video::Camera& camera);
 	bool occluded(ChunkBuffer * chunkBuffer) const;
 	int renderPlants(const std::list<PlantBuffer*>& vbos, int* vertices);
-	bool renderOpaqueBuffers();
-	bool renderWaterBuffers();
+	bool renderChunkMeshes(const ChunkMeshBuffer& buffer);
+	int renderOccludedChunkMeshes(const ChunkMeshBuffer& buffer);
+	ChunkBuffer* findChunkBuffer(const glm::ivec3& translation);
 	ChunkBuffer* findFreeChunkBuffer();
+	void releaseChunkBuffer(ChunkBuffer& chunkBuffer);
 	bool checkShaders() const;
 
 	bool initOpaqueBuffer();
 	bool initWaterBuffer();
+	/**
+	 * @brief Uploads the mesh of the given chunk into the free space of the buffer
+	 * @note The buffer is enlarged if there is not enough free space left
+	 */
+	bool uploadChunkMesh(ChunkMeshBuffer& buffer, ChunkBuffer& chunkBuffer);
+	void freeChunkMesh(ChunkMeshBuffer& buffer, ChunkBuffer& chunkBuffer);
+	bool growVertexBuffer(ChunkMeshBuffer& buffer, int32_t vertices);
+	bool growIndexBuffer(ChunkMeshBuffer& buffer, int32_t indices);
+	/**
+	 * @brief Schedules the extraction of the mesh tiles around the given position that are not yet extracted
+	 *
+	 * The tiles in the view frustum of the camera come first, the nearest ones before the others. Tiles below
+	 * an enclosed tile can't be seen from above and are scheduled last. Only up to @c r_maxpendingextractions
+	 * extractions are queued, running or waiting for the upload at the same time - the remaining tiles are
+	 * scheduled in the following calls.
+	 *
+	 * @param[in] camera The camera to prioritize the view frustum for - may be @c nullptr
+	 */
+	void scheduleExtractions(const glm::vec3& pos, const video::Camera* camera, int radius);
+	/**
+	 * @param[in] distance The distance of the tile center to the position the extractions are scheduled around
+	 * @param[in] visible @c true if the tile is in the view frustum of the camera
+	 * @param[in] hidden @c true if the tile is below an enclosed tile
+	 * @return The priority of the mesh tile extraction - the candidates with the lowest value are scheduled first
+	 */
+	static int extractionPriority(const glm::ivec3& distance, bool visible, bool hidden);
 
 public:
 	WorldRenderer(const voxel::WorldPtr& world);
@@ -175,6 +302,8 @@ public:
 	void onRunning(const video::Camera& camera, long dt);
 	void shutdown();
 
+	/** @brief extract meshes around the camera - the meshes in the view frustum are extracted first */
+	void extractMeshes(const video::Camera& camera, int radius = 5);
 	/** @brief extract meshes around the given position */
 	void extractMeshes(const glm::vec3& pos, int radius = 5);
 
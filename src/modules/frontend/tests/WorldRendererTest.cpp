@@ -4,6 +4,7 @@
 
 #include "core/tests/AbstractTest.h"
 #include "frontend/WorldRenderer.h"
+#include "video/Camera.h"
 
 namespace frontend {
 
@@ -11,6 +12,8 @@ class WorldRendererTest: public core::AbstractTest {
 public:
 	class T_WorldRenderer: public WorldRenderer {
 		FRIEND_TEST(WorldRendererTest, testDistanceCulling);
+		FRIEND_TEST(WorldRendererTest, testExtractionFrustumFirst);
+		FRIEND_TEST(WorldRendererTest, testExtractionEnclosedLast);
 	};
 	voxel::WorldPtr _world;
 	T_WorldRenderer* _renderer;
@@ -26,6 +29,8 @@ public:
 
 		_worldRenderer = new WorldRenderer(_world);
 		_renderer = static_cast<T_WorldRenderer*>(_worldRenderer);
+		core::Var::get(cfg::ClientShadowMap, "false");
+		_renderer->onConstruct();
 	}
 
 	virtual void TearDown() override {
@@ -51,4 +56,55 @@ TEST_F(WorldRendererTest, testCreate) {
 	ASSERT_GT(mesh.opaqueMesh.getNoOfIndices(), 0u);
 }
 
+TEST_F(WorldRendererTest, testMaxPendingExtractions) {
+	_world->setPersist(false);
+	core::Var::get(cfg::ClientMaxPendingExtractions, "4")->setVal("4");
+	_renderer->extractMeshes(glm::ivec3(0));
+	int meshes, extracted, pending;
+	_world->stats(meshes, extracted, pending);
+	EXPECT_EQ(4, extracted) << "Only the allowed amount of extractions should have been scheduled";
+	EXPECT_LE(pending, 4);
+}
+
+TEST_F(WorldRendererTest, testExtractionFrustumFirst) {
+	_world->setPersist(false);
+	core::Var::get(cfg::ClientMaxPendingExtractions, "4")->setVal("4");
+	// looking along the x axis - the tile behind the camera is nearer than the one in front of it
+	const glm::vec3 position(8.0f, 136.0f, 8.0f);
+	video::Camera camera;
+	camera.setNearPlane(0.1f);
+	camera.setFarPlane(500.0f);
+	camera.init(glm::ivec2(), glm::ivec2(1024, 768));
+	camera.setPosition(position);
+	camera.lookAt(position + glm::vec3(100.0f, 0.0f, 0.0f));
+	camera.update(0l);
+	const glm::ivec3 front(32, 128, 0);
+	const glm::ivec3 behind(-16, 128, 0);
+	ASSERT_TRUE(camera.isVisible(glm::vec3(front), glm::vec3(front + 16)));
+	ASSERT_FALSE(camera.isVisible(glm::vec3(behind), glm::vec3(behind + 16)));
+
+	_renderer->scheduleExtractions(position, &camera, 2);
+	int frontPriority = -1;
+	int behindPriority = -1;
+	for (const WorldRenderer::ExtractionCandidate& candidate : _renderer->_extractionCandidates) {
+		if (candidate.pos == front) {
+			frontPriority = candidate.priority;
+		} else if (candidate.pos == behind) {
+			behindPriority = candidate.priority;
+		}
+	}
+	ASSERT_NE(-1, frontPriority) << "The tile in front of the camera should be a candidate";
+	ASSERT_NE(-1, behindPriority) << "The tile behind the camera should be a candidate";
+	EXPECT_LT(frontPriority, behindPriority) << "The tile in the view frustum should be scheduled before the nearer one outside of it";
+}
+
+TEST_F(WorldRendererTest, testExtractionEnclosedLast) {
+	const glm::ivec3 near(0, -16, 0);
+	const glm::ivec3 far(64, 64, 64);
+	const int below = WorldRenderer::extractionPriority(near, true, true);
+	EXPECT_LT(WorldRenderer::extractionPriority(far, true, false), below) << "A visible tile should be scheduled before the ones below an enclosed tile";
+	EXPECT_LT(WorldRenderer::extractionPriority(far, false, false), below) << "A tile outside of the view frustum should be scheduled before the ones below an enclosed tile";
+	EXPECT_LT(WorldRenderer::extractionPriority(near, false, true), WorldRenderer::extractionPriority(far, false, true)) << "The nearest hidden tile should be scheduled first";
+}
+
 }
@@ -28,21 +28,17 @@ MessageSender::MessageSender(NetworkPtr network) :
 		_network(network) {
 }
 
-void MessageSender::sendServerMessage(ENetPeer* peer, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, uint32_t flags) {
+void MessageSender::sendServerMessage(ENetPeer* peer, uint32_t connectID, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, SendPriority priority, uint32_t flags) {
 	core_assert(peer != nullptr);
-	sendServerMessage(&peer, 1, fbb, type, data, flags);
+	sendServerMessage(&peer, &connectID, 1, fbb, type, data, priority, flags);
 }
 
-void MessageSender::sendServerMessage(ENetPeer** peers, int numPeers, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, uint32_t flags) {
+void MessageSender::sendServerMessage(ENetPeer* const* peers, const uint32_t* connectIDs, int numPeers, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, SendPriority priority, uint32_t flags) {
 	Log::debug("Send %s", EnumNameServerMsgType(type));
 	core_assert(numPeers > 0);
 	auto packet = createServerPacket(fbb, type, data, flags);
-	for (int i = 0; i < numPeers; ++i) {
-		const bool success = _network->sendMessage(peers[i], packet);
-		if (success) {
-			continue;
-		}
-		Log::debug("Failed to send the message %s to peer %i (State: %i)", EnumNameServerMsgType(type), i, peers[i]->state);
+	if (!_network->sendMessage(peers, connectIDs, numPeers, packet, 0, priority)) {
+		Log::debug("Failed to queue the message %s for %i peers", EnumNameServerMsgType(type), numPeers);
 	}
 	fbb.Clear();
 }
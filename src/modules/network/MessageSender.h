@@ -7,7 +7,9 @@
 #include "Network.h"
 #include "ServerMessages_generated.h"
 #include "ClientMessages_generated.h"
+#include "core/Common.h"
 #include <memory>
+#include <vector>
 
 namespace network {
 
@@ -20,9 +22,14 @@ private:
 public:
 	MessageSender(NetworkPtr network);
 
-	void sendServerMessage(ENetPeer* peer, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, uint32_t flags = ENET_PACKET_FLAG_RELIABLE);
-	void sendServerMessage(std::vector<ENetPeer*> peers, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, uint32_t flags = ENET_PACKET_FLAG_RELIABLE);
-	void sendServerMessage(ENetPeer** peers, int numPeers, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, uint32_t flags = ENET_PACKET_FLAG_RELIABLE);
+	/**
+	 * @param[in] priority Defines the order in which the send scheduler hands the messages of a tick over to the peer
+	 * @param[in] connectID The connection the message is meant for - it's dropped if the peer was disconnected in the meantime
+	 * @sa Network::setPeerBandwidth()
+	 */
+	void sendServerMessage(ENetPeer* peer, uint32_t connectID, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, SendPriority priority = SendPriority::Player, uint32_t flags = ENET_PACKET_FLAG_RELIABLE);
+	void sendServerMessage(const std::vector<ENetPeer*>& peers, const std::vector<uint32_t>& connectIDs, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, SendPriority priority = SendPriority::Player, uint32_t flags = ENET_PACKET_FLAG_RELIABLE);
+	void sendServerMessage(ENetPeer* const* peers, const uint32_t* connectIDs, int numPeers, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, SendPriority priority = SendPriority::Player, uint32_t flags = ENET_PACKET_FLAG_RELIABLE);
 	void broadcastServerMessage(FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, int channel = 0, uint32_t flags = ENET_PACKET_FLAG_RELIABLE);
 	/**
 	 * @brief Sends a message to the client
@@ -32,8 +39,9 @@ public:
 
 typedef std::shared_ptr<MessageSender> MessageSenderPtr;
 
-inline void MessageSender::sendServerMessage(std::vector<ENetPeer*> peers, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, uint32_t flags) {
-	sendServerMessage(&peers.front(), peers.size(), fbb, type, data, flags);
+inline void MessageSender::sendServerMessage(const std::vector<ENetPeer*>& peers, const std::vector<uint32_t>& connectIDs, FlatBufferBuilder& fbb, ServerMsgType type, Offset<void> data, SendPriority priority, uint32_t flags) {
+	core_assert(peers.size() == connectIDs.size());
+	sendServerMessage(peers.data(), connectIDs.data(), peers.size(), fbb, type, data, priority, flags);
 }
 
 
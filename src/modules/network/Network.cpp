@@ -12,11 +12,30 @@
 #include "core/Log.h"
 
 #include <memory>
+#include <chrono>
 
 namespace network {
 
+constexpr size_t Network::MaxQueuedCommandsPerPeer;
+constexpr size_t Network::IncomingQueueSize;
+constexpr size_t Network::OutgoingQueueSize;
+constexpr uint32_t Network::MaxBurstMillis;
+constexpr uint32_t Network::DisconnectTimeoutMillis;
+
+/**
+ * @brief Executed on the io thread to not let the game thread deal with garbage
+ */
+static bool verifyPacket(const ENetPacket* packet, bool server) {
+	flatbuffers::Verifier v(packet->data, packet->dataLength);
+	if (server) {
+		return VerifyClientMessageBuffer(v);
+	}
+	return VerifyServerMessageBuffer(v);
+}
+
 Network::Network(ProtocolHandlerRegistryPtr protocolHandlerRegistry, core::EventBusPtr eventBus) :
-		_protocolHandlerRegistry(protocolHandlerRegistry), _eventBus(eventBus), _server(nullptr), _client(nullptr) {
+		_protocolHandlerRegistry(protocolHandlerRegistry), _eventBus(eventBus), _server(nullptr), _client(nullptr),
+		_outgoing(OutgoingQueueSize), _incoming(IncomingQueueSize) {
 }
 
 Network::~Network() {
@@ -24,13 +43,46 @@ Network::~Network() {
 }
 
 void Network::shutdown() {
-	disconnect();
-	if (_server != nullptr) {
-		enet_host_flush(_server);
-		enet_host_destroy(_server);
+	stopIOThread();
+	{
+		std::lock_guard<std::mutex> lock(_hostMutex);
+		// the io thread is gone - we are the consumer of both queues now
+		for (;;) {
+			const bool drained = drainSpilled();
+			processOutgoing();
+			if (drained) {
+				break;
+			}
+		}
+		closeClient();
+		// there is nobody left to wait for the acknowledgements
+		for (ClosingHost& closing : _closingClients) {
+			ENetHost* host = closing.host;
+			if (!closing.started) {
+				dispatchScheduled(host, closing.sendState, 0u, true);
+			}
+			for (size_t i = 0; i < host->peerCount; ++i) {
+				enet_peer_disconnect_now(&host->peers[i], 0);
+			}
+			enet_host_destroy(host);
+		}
+		_closingClients.clear();
+		if (_server != nullptr) {
+			dispatchScheduled(_server, _serverSendState, 0u, true);
+			enet_host_flush(_server);
+			enet_host_destroy(_server);
+		}
+		_server = nullptr;
+		_serverSendState = HostSendState();
+		IncomingEvent event;
+		while (_incoming.pop(event)) {
+			if (event.packet != nullptr) {
+				enet_packet_destroy(event.packet);
+			}
+		}
 	}
+	_connections.clear();
 	enet_deinitialize();
-	_server = nullptr;
 }
 
 bool Network::init() {
@@ -38,10 +90,66 @@ bool Network::init() {
 		return false;
 	}
 	enet_time_set(0);
+	startIOThread();
 	return true;
 }
 
-bool Network::bind(uint16_t port, const std::string& hostname, int maxPeers, int maxChannels) {
+void Network::startIOThread() {
+	if (_ioThread.joinable()) {
+		return;
+	}
+	_ioStop = false;
+	_ioThread = std::thread(&Network::ioThread, this);
+}
+
+void Network::stopIOThread() {
+	if (!_ioThread.joinable()) {
+		return;
+	}
+	_ioStop = true;
+	wakeupIOThread();
+	_ioThread.join();
+}
+
+void Network::wakeupIOThread() {
+	if (!_ioIdle) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(_wakeupMutex);
+	_wakeup.notify_one();
+}
+
+void Network::ioThread() {
+	core_trace_thread("NetworkIO");
+	while (!_ioStop) {
+		bool active;
+		{
+			std::lock_guard<std::mutex> lock(_hostMutex);
+			++_ioEpoch;
+			active = processOutgoing();
+			if (_server != nullptr) {
+				active |= updateHost(_server, _serverSendState, _serverStats, true, 0u, false);
+			}
+			if (_client != nullptr) {
+				active |= updateHost(_client, _clientSendState, _clientStats, false, _clientGeneration, false);
+			}
+			active |= updateClosingClients();
+		}
+		if (active) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(_wakeupMutex);
+		_ioIdle = true;
+		_wakeup.wait_for(lock, std::chrono::milliseconds(1), [this] {
+			return _ioStop || !_outgoing.empty();
+		});
+		_ioIdle = false;
+	}
+}
+
+bool Network::bind(uint16_t port, const std::string& hostname, int maxPeers, int maxChannels,
+		uint32_t incomingBandwidth, uint32_t outgoingBandwidth) {
+	std::lock_guard<std::mutex> lock(_hostMutex);
 	if (_server) {
 		return false;
 	}
@@ -62,31 +170,59 @@ bool Network::bind(uint16_t port, const std::string& hostname, int maxPeers, int
 			&address,
 			maxPeers,
 			maxChannels,
-			0, /* assume any amount of incoming bandwidth */
-			0 /* assume any amount of outgoing bandwidth */
+			incomingBandwidth,
+			outgoingBandwidth
 			);
 	if (_server == nullptr) {
 		return false;
 	}
 	enet_host_compress_with_range_coder(_server);
+	_serverSendState = HostSendState();
+	_serverSendState.peers.resize(_server->peerCount);
 	return true;
 }
 
-ENetPeer* Network::connect(uint16_t port, const std::string& hostname, int maxChannels) {
+ENetPeer* Network::connect(uint16_t port, const std::string& hostname, int maxChannels,
+		uint32_t incomingBandwidth, uint32_t outgoingBandwidth) {
+	/* only allow 1 outgoing connection */
+	if (!initClient(1, maxChannels, incomingBandwidth, outgoingBandwidth)) {
+		return nullptr;
+	}
+	return connectPeer(port, hostname, maxChannels);
+}
+
+bool Network::initClient(int maxConnections, int maxChannels, uint32_t incomingBandwidth, uint32_t outgoingBandwidth) {
 	if (_client) {
 		disconnect();
 	}
+	if (maxConnections <= 0) {
+		return false;
+	}
+	if (maxChannels <= 0) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(_hostMutex);
 	_client = enet_host_create(
 			nullptr,
-			1, /* only allow 1 outgoing connection */
+			maxConnections,
 			maxChannels,
-			57600 / 8, /* 56K modem with 56 Kbps downstream bandwidth */
-			14400 / 8 /* 56K modem with 14 Kbps upstream bandwidth */
+			incomingBandwidth,
+			outgoingBandwidth
 			);
 	if (_client == nullptr) {
-		return nullptr;
+		return false;
 	}
 	enet_host_compress_with_range_coder(_client);
+	_clientSendState = HostSendState();
+	_clientSendState.peers.resize(_client->peerCount);
+	return true;
+}
+
+ENetPeer* Network::connectPeer(uint16_t port, const std::string& hostname, int maxChannels) {
+	std::lock_guard<std::mutex> lock(_hostMutex);
+	if (_client == nullptr) {
+		return nullptr;
+	}
 
 	ENetAddress address;
 	enet_address_set_host(&address, hostname.c_str());
@@ -103,61 +239,433 @@ ENetPeer* Network::connect(uint16_t port, const std::string& hostname, int maxCh
 }
 
 void Network::disconnect() {
+	{
+		std::lock_guard<std::mutex> lock(_hostMutex);
+		closeClient();
+	}
+	wakeupIOThread();
+}
+
+void Network::closeClient() {
 	if (_client == nullptr) {
 		return;
 	}
+	ClosingHost closing;
+	closing.host = _client;
+	closing.sendState = std::move(_clientSendState);
+	closing.generation = _clientGeneration;
+	_closingClients.push_back(std::move(closing));
+	// the io thread doesn't service the host as active client anymore after we release the lock
+	_client = nullptr;
+	_clientSendState = HostSendState();
+	++_clientGeneration;
+}
 
-	enet_host_flush(_client);
+bool Network::updateClosingClients() {
+	bool active = false;
+	const uint32_t now = enet_time_get();
+	for (ClosingHost& closing : _closingClients) {
+		if (closing.closed) {
+			continue;
+		}
+		ENetHost* host = closing.host;
+		HostSendState& hostState = closing.sendState;
+		if (!closing.started) {
+			// everything that was queued before the disconnect is sent first
+			closing.started = true;
+			closing.deadline = now + DisconnectTimeoutMillis;
+			dispatchScheduled(host, hostState, 0u, true);
+			for (size_t i = 0; i < host->peerCount; ++i) {
+				ENetPeer* peer = &host->peers[i];
+				if (peer->state == ENET_PEER_STATE_DISCONNECTED) {
+					continue;
+				}
+				PeerSendState& state = hostState.peers[i];
+				// pending connects were never reported - but their disconnect is
+				state.connectID = peer->connectID;
+				state.closing = true;
+				enet_peer_disconnect_later(peer, 0);
+			}
+			enet_host_flush(host);
+		}
+		active |= updateHost(host, hostState, _clientStats, false, closing.generation, true);
+		const bool timeout = (int32_t)(now - closing.deadline) >= 0;
+		bool done = true;
+		for (size_t i = 0; i < host->peerCount; ++i) {
+			PeerSendState& state = hostState.peers[i];
+			if (!state.closing) {
+				continue;
+			}
+			ENetPeer* peer = &host->peers[i];
+			if (peer->state != ENET_PEER_STATE_DISCONNECTED) {
+				if (!timeout) {
+					done = false;
+					continue;
+				}
+				enet_peer_reset(peer);
+			}
+			// the peer was reset without a disconnect event
+			if (!queueDisconnect(peer, state, false, closing.generation)) {
+				done = false;
+				break;
+			}
+		}
+		if (!done || _incoming.freeSlots() == 0u) {
+			continue;
+		}
+		IncomingEvent event;
+		event.closedHost = host;
+		_incoming.push(event);
+		closing.closed = true;
+		active = true;
+	}
+	return active;
+}
 
-	for (size_t i = 0; i < _client->peerCount; ++i) {
-		ENetPeer *peer = &_client->peers[i];
-		disconnectPeer(peer);
+void Network::destroyClosedHost(ENetHost* host) {
+	std::lock_guard<std::mutex> lock(_hostMutex);
+	for (auto i = _closingClients.begin(); i != _closingClients.end(); ++i) {
+		if (i->host != host) {
+			continue;
+		}
+		enet_host_destroy(host);
+		_closingClients.erase(i);
+		return;
 	}
-	enet_host_destroy(_client);
-	_client = nullptr;
 }
 
-void Network::disconnectPeer(ENetPeer *peer, uint32_t timeout) {
+bool Network::disconnectPeerAsync(ENetPeer* peer) {
 	if (peer == nullptr) {
+		return false;
+	}
+	OutgoingCommand cmd;
+	cmd.type = OutgoingCommand::Type::Disconnect;
+	cmd.peer = peer;
+	cmd.connectID = connectID(peer);
+	pushOutgoing(cmd);
+	return true;
+}
+
+uint32_t Network::connectID(ENetPeer* peer) const {
+	auto i = _connections.find(peer);
+	if (i == _connections.end()) {
+		return 0u;
+	}
+	return i->second.connectID;
+}
+
+ENetAddress Network::address(ENetPeer* peer) const {
+	auto i = _connections.find(peer);
+	if (i == _connections.end()) {
+		return ENetAddress {0u, 0u};
+	}
+	return i->second.address;
+}
+
+bool Network::drainSpilled() {
+	while (!_spilled.empty()) {
+		if (!_outgoing.push(_spilled.front())) {
+			return false;
+		}
+		_spilled.pop_front();
+	}
+	return true;
+}
+
+bool Network::hasOutgoingSlots(size_t amount) {
+	return drainSpilled() && _outgoing.freeSlots() >= amount;
+}
+
+void Network::queueOutgoing(const OutgoingCommand& cmd) {
+	// nothing may overtake the commands that are still waiting for a free slot
+	if (drainSpilled() && _outgoing.push(cmd)) {
 		return;
 	}
-	Log::info("trying to disconnect peer: %u", peer->connectID);
-	ENetEvent event;
-	enet_peer_disconnect(peer, 0);
-	bool success = false;
-	/* Wait some time for the disconnect to succeed
-	 * and drop any packets received packets. */
-	while (enet_host_service(_client, &event, timeout) > 0) {
-		switch (event.type) {
-		case ENET_EVENT_TYPE_RECEIVE:
-			enet_packet_destroy(event.packet);
+	if (_spilled.empty()) {
+		Log::warn("Outgoing network queue is full - keeping the commands until the io thread caught up");
+	}
+	_spilled.push_back(cmd);
+}
+
+void Network::pushOutgoing(const OutgoingCommand& cmd) {
+	queueOutgoing(cmd);
+	wakeupIOThread();
+}
+
+bool Network::broadcast(ENetPacket* packet, int channel) {
+	if ((packet->flags & ENET_PACKET_FLAG_RELIABLE) == 0u && !hasOutgoingSlots(1u)) {
+		Log::debug("Outgoing network queue is full - dropping unreliable broadcast packet");
+		enet_packet_destroy(packet);
+		return false;
+	}
+	OutgoingCommand cmd;
+	cmd.type = OutgoingCommand::Type::Broadcast;
+	cmd.channel = (uint8_t)channel;
+	cmd.packet = packet;
+	pushOutgoing(cmd);
+	return true;
+}
+
+void Network::flush() {
+	OutgoingCommand cmd;
+	cmd.type = OutgoingCommand::Type::Tick;
+	pushOutgoing(cmd);
+}
+
+bool Network::sendMessage(ENetPeer* const* peers, const uint32_t* connectIDs, int numPeers, ENetPacket* packet, int channel, SendPriority priority) {
+	// the packet wasn't handed over to the io thread yet - so we are still the only owner here
+	if (numPeers <= 0) {
+		enet_packet_destroy(packet);
+		return false;
+	}
+	// only unreliable packets may be dropped - the reliable ones are kept until the io thread caught up.
+	// reserve one slot for the release command - check in advance to either queue all or nothing
+	if ((packet->flags & ENET_PACKET_FLAG_RELIABLE) == 0u && !hasOutgoingSlots((size_t)numPeers + 1u)) {
+		Log::debug("Outgoing network queue is full - dropping unreliable packet for %i peers", numPeers);
+		enet_packet_destroy(packet);
+		return false;
+	}
+	// hold a reference until all peers got the packet - otherwise the io thread could destroy the
+	// packet after sending it to the first peer, but before it is queued for the second one.
+	++packet->referenceCount;
+	OutgoingCommand cmd;
+	cmd.type = OutgoingCommand::Type::Send;
+	cmd.channel = (uint8_t)channel;
+	cmd.priority = priority;
+	cmd.packet = packet;
+	for (int i = 0; i < numPeers; ++i) {
+		cmd.peer = peers[i];
+		cmd.connectID = connectIDs[i];
+		queueOutgoing(cmd);
+	}
+	cmd.type = OutgoingCommand::Type::Release;
+	cmd.peer = nullptr;
+	cmd.connectID = 0u;
+	pushOutgoing(cmd);
+	return true;
+}
+
+bool Network::processOutgoing() {
+	bool active = false;
+	OutgoingCommand cmd;
+	while (_outgoing.pop(cmd)) {
+		active = true;
+		switch (cmd.type) {
+		case OutgoingCommand::Type::Send:
+			sendPacket(cmd);
 			break;
-		case ENET_EVENT_TYPE_DISCONNECT:
-			_eventBus->publish(DisconnectEvent(event.peer));
-			success = true;
+		case OutgoingCommand::Type::Broadcast:
+			if (_server != nullptr) {
+				enet_host_broadcast(_server, cmd.channel, cmd.packet);
+			} else if (cmd.packet->referenceCount == 0) {
+				enet_packet_destroy(cmd.packet);
+			}
 			break;
-		case ENET_EVENT_TYPE_CONNECT:
-		case ENET_EVENT_TYPE_NONE:
+		case OutgoingCommand::Type::Release:
+			if (--cmd.packet->referenceCount == 0) {
+				enet_packet_destroy(cmd.packet);
+			}
 			break;
+		case OutgoingCommand::Type::Disconnect:
+			if (cmd.connectID != 0u && cmd.peer->connectID == cmd.connectID) {
+				enet_peer_disconnect(cmd.peer, 0);
+			}
+			break;
+		case OutgoingCommand::Type::Tick:
+			tick();
+			break;
+		}
+	}
+	return active;
+}
+
+Network::HostSendState* Network::hostSendState(ENetHost* host) {
+	if (host == _server) {
+		return &_serverSendState;
+	}
+	if (host == _client) {
+		return &_clientSendState;
+	}
+	for (ClosingHost& closing : _closingClients) {
+		if (closing.host == host) {
+			return &closing.sendState;
 		}
 	}
-	if (!success) {
-		/* We've arrived here, so the disconnect attempt didn't */
-		/* succeed yet. Force the connection down. */
-		enet_peer_reset(peer);
-		_eventBus->publish(DisconnectEvent(event.peer));
+	return nullptr;
+}
+
+Network::PeerSendState* Network::peerSendState(ENetPeer* peer) {
+	ENetHost* host = peer->host;
+	HostSendState* hostState = hostSendState(host);
+	if (hostState == nullptr) {
+		return nullptr;
+	}
+	const size_t index = peer - host->peers;
+	if (index >= hostState->peers.size()) {
+		return nullptr;
 	}
+	return &hostState->peers[index];
 }
 
-bool Network::packetReceived(ENetEvent& event, bool server) {
-	flatbuffers::Verifier v(event.packet->data, event.packet->dataLength);
+bool Network::canQueue(ENetPeer* peer, PeerSendState& state, const ENetPacket* packet) {
+	if (state.epoch != _ioEpoch) {
+		// enet_list_size is walking the list - so only do this once per peer and io loop
+		state.epoch = _ioEpoch;
+		state.queuedCommands = enet_list_size(&peer->outgoingReliableCommands) + enet_list_size(&peer->outgoingUnreliableCommands);
+	}
+	if (state.queuedCommands + state.scheduledCount < MaxQueuedCommandsPerPeer) {
+		++state.queuedCommands;
+		return true;
+	}
+	if ((packet->flags & ENET_PACKET_FLAG_RELIABLE) == 0) {
+		Log::trace("Drop unreliable packet for peer %u - send queue is full", peer->connectID);
+		return false;
+	}
+	// we can't drop reliable packets without breaking the state on the other side
+	Log::warn("Peer %u doesn't keep up with the sent data - disconnecting", peer->connectID);
+	enet_peer_disconnect(peer, 0);
+	return false;
+}
 
-	if (!server) {
-		if (!VerifyServerMessageBuffer(v)) {
-			Log::error("Illegal server packet received with length: %i", (int)event.packet->dataLength);
-			return false;
+void Network::sendPacket(const OutgoingCommand& cmd) {
+	if (cmd.peer == nullptr) {
+		return;
+	}
+	if (cmd.connectID == 0u || cmd.peer->connectID != cmd.connectID) {
+		Log::trace("Drop packet for connection %u - the peer is disconnected or was reused", cmd.connectID);
+		return;
+	}
+	PeerSendState* state = peerSendState(cmd.peer);
+	if (state == nullptr) {
+		return;
+	}
+	if (!canQueue(cmd.peer, *state, cmd.packet)) {
+		return;
+	}
+	if (_peerBandwidth == 0u) {
+		if (enet_peer_send(cmd.peer, cmd.channel, cmd.packet) != 0) {
+			Log::debug("Failed to send a packet to peer %u (State: %i)", cmd.peer->connectID, cmd.peer->state);
+		}
+		return;
+	}
+	// the scheduler holds an own reference until the packet was handed over to enet
+	++cmd.packet->referenceCount;
+	const ScheduledPacket scheduled {cmd.packet, cmd.channel, cmd.priority};
+	if (cmd.packet->flags & ENET_PACKET_FLAG_RELIABLE) {
+		if (state->reliable.size() <= cmd.channel) {
+			state->reliable.resize(cmd.channel + 1);
+		}
+		state->reliable[cmd.channel].push_back(scheduled);
+	} else {
+		state->unreliable[(int)cmd.priority].push_back(scheduled);
+	}
+	++state->scheduledCount;
+	if (!state->pending) {
+		state->pending = true;
+		hostSendState(cmd.peer->host)->pending.push_back(cmd.peer - cmd.peer->host->peers);
+	}
+}
+
+void Network::tick() {
+	const uint32_t now = enet_time_get();
+	const uint32_t elapsed = now - _lastTick;
+	_lastTick = now;
+	if (_server != nullptr) {
+		dispatchScheduled(_server, _serverSendState, elapsed, false);
+	}
+	if (_client != nullptr) {
+		dispatchScheduled(_client, _clientSendState, elapsed, false);
+	}
+}
+
+void Network::dispatchScheduled(ENetHost* host, HostSendState& hostState, uint32_t elapsedMillis, bool ignoreBudget) {
+	const uint32_t bandwidth = _peerBandwidth;
+	const bool unlimited = ignoreBudget || bandwidth == 0u;
+	if (!unlimited) {
+		const int64_t refill = (int64_t)bandwidth * elapsedMillis / 1000;
+		const int64_t maxBudget = (int64_t)bandwidth * MaxBurstMillis / 1000;
+		for (PeerSendState& state : hostState.peers) {
+			state.budget = std::min(state.budget + refill, maxBudget);
+		}
+	}
+	size_t stillPending = 0u;
+	for (size_t i = 0u; i < hostState.pending.size(); ++i) {
+		const size_t index = hostState.pending[i];
+		PeerSendState& state = hostState.peers[index];
+		ENetPeer* peer = &host->peers[index];
+		// a packet is sent as long as there is any budget left - the budget might get negative
+		// for large packets, this is paid back with the following ticks
+		while (unlimited || state.budget > 0) {
+			// only the heads of the reliable channels compete - on equal priority they win
+			std::deque<ScheduledPacket>* queue = nullptr;
+			int priority = (int)SendPriority::Max;
+			for (std::deque<ScheduledPacket>& channel : state.reliable) {
+				if (!channel.empty() && (int)channel.front().priority < priority) {
+					priority = (int)channel.front().priority;
+					queue = &channel;
+				}
+			}
+			for (int p = 0; p < priority; ++p) {
+				if (!state.unreliable[p].empty()) {
+					queue = &state.unreliable[p];
+					break;
+				}
+			}
+			if (queue == nullptr) {
+				break;
+			}
+			const ScheduledPacket scheduled = queue->front();
+			queue->pop_front();
+			--state.scheduledCount;
+			state.budget -= (int64_t)scheduled.packet->dataLength;
+			if (enet_peer_send(peer, scheduled.channel, scheduled.packet) != 0) {
+				Log::debug("Failed to send a packet to peer %u (State: %i)", peer->connectID, peer->state);
+			}
+			if (--scheduled.packet->referenceCount == 0) {
+				enet_packet_destroy(scheduled.packet);
+			}
+		}
+		// unreliable packets are outdated if they didn't make it into their tick
+		for (std::deque<ScheduledPacket>& queue : state.unreliable) {
+			for (const ScheduledPacket& scheduled : queue) {
+				if (--scheduled.packet->referenceCount == 0) {
+					enet_packet_destroy(scheduled.packet);
+				}
+			}
+			state.scheduledCount -= queue.size();
+			queue.clear();
 		}
-		const ServerMessage *req = GetServerMessage(event.packet->data);
+		if (state.scheduledCount > 0u) {
+			hostState.pending[stillPending++] = index;
+		} else {
+			state.pending = false;
+		}
+	}
+	hostState.pending.resize(stillPending);
+}
+
+void Network::releaseScheduled(PeerSendState& state) {
+	auto release = [] (std::deque<ScheduledPacket>& queue) {
+		for (const ScheduledPacket& scheduled : queue) {
+			if (--scheduled.packet->referenceCount == 0) {
+				enet_packet_destroy(scheduled.packet);
+			}
+		}
+		queue.clear();
+	};
+	for (std::deque<ScheduledPacket>& queue : state.reliable) {
+		release(queue);
+	}
+	for (std::deque<ScheduledPacket>& queue : state.unreliable) {
+		release(queue);
+	}
+	state.scheduledCount = 0u;
+}
+
+bool Network::packetReceived(const IncomingEvent& event) {
+	const ENetPacket* packet = event.packet;
+	if (!event.server) {
+		const ServerMessage *req = GetServerMessage(packet->data);
 		ServerMsgType type = req->data_type();
 		ProtocolHandlerPtr handler = _protocolHandlerRegistry->getHandler(EnumNameServerMsgType(type));
 		if (!handler) {
@@ -169,11 +677,7 @@ bool Network::packetReceived(ENetEvent& event, bool server) {
 		return true;
 	}
 
-	if (!VerifyClientMessageBuffer(v)) {
-		Log::error("Illegal client packet received with length: %i", (int)event.packet->dataLength);
-		return false;
-	}
-	const ClientMessage *req = GetClientMessage(event.packet->data);
+	const ClientMessage *req = GetClientMessage(packet->data);
 	ClientMsgType type = req->data_type();
 	ProtocolHandlerPtr handler = _protocolHandlerRegistry->getHandler(EnumNameClientMsgType(type));
 	if (!handler) {
@@ -185,28 +689,156 @@ bool Network::packetReceived(ENetEvent& event, bool server) {
 	return true;
 }
 
-void Network::updateHost(ENetHost* host, bool server) {
-	if (host == nullptr) {
-		return;
-	}
-	enet_host_flush(host);
+bool Network::updateHost(ENetHost* host, HostSendState& hostState, HostStats& stats, bool server, uint32_t generation, bool closing) {
+	bool active = false;
 	ENetEvent event;
-	while (enet_host_service(host, &event, 0) > 0) {
+	for (;;) {
+		if (_incoming.freeSlots() == 0u) {
+			// backpressure: the game thread doesn't keep up - keep sending, but stop receiving
+			enet_host_flush(host);
+			break;
+		}
+		if (enet_host_service(host, &event, 0) <= 0) {
+			break;
+		}
+		active = true;
+		const size_t index = event.peer - host->peers;
+		PeerSendState* state = index < hostState.peers.size() ? &hostState.peers[index] : nullptr;
+		IncomingEvent incoming;
+		incoming.type = event.type;
+		incoming.peer = event.peer;
+		incoming.server = server;
+		incoming.generation = generation;
+		switch (event.type) {
+		case ENET_EVENT_TYPE_CONNECT: {
+			if (state != nullptr) {
+				releaseScheduled(*state);
+				state->budget = 0;
+				state->connectID = event.peer->connectID;
+			}
+			incoming.connectID = event.peer->connectID;
+			incoming.address = event.peer->address;
+			if (closing) {
+				// the disconnect of this connection is still reported
+				if (state != nullptr) {
+					state->closing = true;
+				}
+				enet_peer_disconnect(event.peer, 0);
+				continue;
+			}
+			break;
+		}
+		case ENET_EVENT_TYPE_RECEIVE: {
+			if (closing) {
+				enet_packet_destroy(event.packet);
+				continue;
+			}
+			if (!verifyPacket(event.packet, server)) {
+				Log::error("Illegal %s packet received with length: %i - disconnecting now...",
+						server ? "client" : "server", (int)event.packet->dataLength);
+				enet_packet_destroy(event.packet);
+				enet_peer_disconnect(event.peer, 0);
+				continue;
+			}
+			incoming.connectID = event.peer->connectID;
+			incoming.packet = event.packet;
+			break;
+		}
+		case ENET_EVENT_TYPE_DISCONNECT: {
+			if (state != nullptr) {
+				// can't fail - we've checked the free slots above
+				queueDisconnect(event.peer, *state, server, generation);
+			}
+			continue;
+		}
+		case ENET_EVENT_TYPE_NONE:
+			continue;
+		}
+		// can't fail - we've checked the free slots above and we are the only producer
+		_incoming.push(incoming);
+	}
+	collectStats(host, stats);
+	return active;
+}
+
+bool Network::queueDisconnect(ENetPeer* peer, PeerSendState& state, bool server, uint32_t generation) {
+	if (_incoming.freeSlots() == 0u) {
+		return false;
+	}
+	IncomingEvent incoming;
+	incoming.type = ENET_EVENT_TYPE_DISCONNECT;
+	incoming.peer = peer;
+	incoming.connectID = state.connectID;
+	incoming.server = server;
+	incoming.generation = generation;
+	_incoming.push(incoming);
+	releaseScheduled(state);
+	state.connectID = 0u;
+	state.closing = false;
+	return true;
+}
+
+void Network::collectStats(ENetHost* host, HostStats& stats) {
+	// enet leaves it up to the application to reset these counters
+	stats.sentBytes.fetch_add(host->totalSentData, std::memory_order_relaxed);
+	stats.receivedBytes.fetch_add(host->totalReceivedData, std::memory_order_relaxed);
+	stats.sentPackets.fetch_add(host->totalSentPackets, std::memory_order_relaxed);
+	stats.receivedPackets.fetch_add(host->totalReceivedPackets, std::memory_order_relaxed);
+	host->totalSentData = 0u;
+	host->totalReceivedData = 0u;
+	host->totalSentPackets = 0u;
+	host->totalReceivedPackets = 0u;
+}
+
+NetworkStats Network::stats(const HostStats& stats) {
+	NetworkStats s;
+	s.sentBytes = stats.sentBytes.load(std::memory_order_relaxed);
+	s.receivedBytes = stats.receivedBytes.load(std::memory_order_relaxed);
+	s.sentPackets = stats.sentPackets.load(std::memory_order_relaxed);
+	s.receivedPackets = stats.receivedPackets.load(std::memory_order_relaxed);
+	return s;
+}
+
+void Network::update() {
+	core_trace_scoped(Network);
+	const uint32_t clientGeneration = _clientGeneration;
+	// only handle what is available now - the io thread keeps on filling the queue
+	size_t n = _incoming.size();
+	IncomingEvent event;
+	while (n-- > 0u && _incoming.pop(event)) {
+		if (event.closedHost != nullptr) {
+			// all the disconnects of the host were handled before
+			destroyClosedHost(event.closedHost);
+			continue;
+		}
+		if (!event.server && event.generation != clientGeneration && event.type != ENET_EVENT_TYPE_DISCONNECT) {
+			if (event.packet != nullptr) {
+				enet_packet_destroy(event.packet);
+			}
+			continue;
+		}
 		switch (event.type) {
 		case ENET_EVENT_TYPE_CONNECT: {
-			_eventBus->publish(NewConnectionEvent(event.peer));
+			_connections[event.peer] = Connection{event.connectID, event.address};
+			_eventBus->publish(NewConnectionEvent(event.peer, event.connectID));
 			break;
 		}
 		case ENET_EVENT_TYPE_RECEIVE: {
-			if (!packetReceived(event, server)) {
+			if (connectID(event.peer) != event.connectID) {
+				Log::debug("Skip packet of connection %u - it is already gone", event.connectID);
+			} else if (!packetReceived(event)) {
 				Log::error("Failure while receiving a package - disconnecting now...");
-				disconnectPeer(event.peer, 10);
+				disconnectPeerAsync(event.peer);
 			}
 			enet_packet_destroy(event.packet);
 			break;
 		}
 		case ENET_EVENT_TYPE_DISCONNECT: {
-			_eventBus->publish(DisconnectEvent(event.peer));
+			auto i = _connections.find(event.peer);
+			if (i != _connections.end() && i->second.connectID == event.connectID) {
+				_connections.erase(i);
+			}
+			_eventBus->publish(DisconnectEvent(event.peer, event.connectID));
 			break;
 		}
 		case ENET_EVENT_TYPE_NONE: {
@@ -216,10 +848,4 @@ void Network::updateHost(ENetHost* host, bool server) {
 	}
 }
 
-void Network::update() {
-	core_trace_scoped(Network);
-	updateHost(_server, true);
-	updateHost(_client, false);
-}
-
 }
@@ -7,49 +7,380 @@
 #include "ProtocolHandlerRegistry.h"
 #include "IMsgProtocolHandler.h"
 #include "core/EventBus.h"
+#include "core/SPSCQueue.h"
 #include <string>
 #include <stdint.h>
 #include <list>
 #include <memory>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
 
 namespace network {
 
+/**
+ * @brief The order in which the per peer send scheduler dispatches the queued packets.
+ * @sa Network::setPeerBandwidth()
+ */
+enum class SendPriority : uint8_t {
+	/** messages about the own player and the session (login, seed, spawn) */
+	Player,
+	/** updates of entities that are close to the receiving player */
+	NearEntity,
+	/** updates of entities that are visible but far away */
+	FarEntity,
+	/** attribute updates */
+	Attribute,
+
+	Max
+};
+
+/**
+ * @brief Accumulated traffic of a host since it was created - this is measured on the
+ * UDP datagram level and thus includes the protocol overhead of ENet.
+ */
+struct NetworkStats {
+	uint64_t sentBytes = 0u;
+	uint64_t receivedBytes = 0u;
+	uint64_t sentPackets = 0u;
+	uint64_t receivedPackets = 0u;
+};
+
+/**
+ * @brief Runs the ENet hosts on a dedicated I/O thread.
+ *
+ * The game thread and the I/O thread exchange verified incoming packets and
+ * outgoing send commands through two lock-free single-producer/single-consumer
+ * queues. Protocol handlers and the network events are still executed on the
+ * thread that calls @c update().
+ *
+ * If a peer bandwidth is configured, the packets that are queued for a peer during
+ * a tick (see @c flush()) are sent ordered by their @c SendPriority as long as the
+ * byte budget of the peer lasts. Everything else is deferred to the next tick -
+ * unreliable packets that didn't make it into their tick are dropped. Reliable packets
+ * keep their order per channel - the priority only decides between the channels and
+ * the unreliable packets.
+ *
+ * ENet reuses its peers for new connections and the I/O thread keeps on writing their
+ * fields - the game thread never reads them. A connection is identified by the peer and
+ * the connect id that was captured when its connect event was handled (see @c connectID()).
+ * Every send carries this id, packets for a connection that is already gone are dropped.
+ *
+ * @note Creating and destroying the hosts (@c bind(), @c connect(), @c disconnect()
+ * and @c shutdown()) takes a mutex that the I/O thread holds while servicing them.
+ * Everything that happens per frame is lock-free.
+ * @note All the other public methods are meant to be called from the game thread only.
+ */
 class Network {
+public:
+	/**
+	 * @brief The amount of outgoing commands that may be queued in ENet for a single peer
+	 * before further unreliable packets are dropped and the peer is disconnected for
+	 * further reliable ones.
+	 */
+	static constexpr size_t MaxQueuedCommandsPerPeer = 1024u;
+	static constexpr size_t IncomingQueueSize = 4096u;
+	static constexpr size_t OutgoingQueueSize = 16384u;
+	/**
+	 * @brief The amount of milliseconds of unused peer bandwidth that may be saved up for later ticks
+	 */
+	static constexpr uint32_t MaxBurstMillis = 250u;
+	/**
+	 * @brief The amount of milliseconds the peers of a disconnected client host get to acknowledge
+	 * the disconnect before they are reset
+	 */
+	static constexpr uint32_t DisconnectTimeoutMillis = 3000u;
 private:
+	struct IncomingEvent {
+		ENetEventType type = ENET_EVENT_TYPE_NONE;
+		ENetPeer* peer = nullptr;
+		ENetPacket* packet = nullptr;
+		// the connection the event belongs to - captured by the io thread
+		uint32_t connectID = 0u;
+		ENetAddress address {0u, 0u};
+		// set if the io thread is done with a disconnected client host - the game thread destroys it
+		ENetHost* closedHost = nullptr;
+		uint32_t generation = 0u;
+		bool server = false;
+	};
+
+	struct OutgoingCommand {
+		enum class Type : uint8_t {
+			Send, Broadcast, Release, Disconnect, Tick
+		};
+		Type type = Type::Send;
+		uint8_t channel = 0u;
+		SendPriority priority = SendPriority::Player;
+		ENetPeer* peer = nullptr;
+		// the command is dropped if the peer was reused for another connection in the meantime
+		uint32_t connectID = 0u;
+		ENetPacket* packet = nullptr;
+	};
+
+	struct ScheduledPacket {
+		ENetPacket* packet;
+		uint8_t channel;
+		SendPriority priority;
+	};
+
+	/**
+	 * @brief Per peer bookkeeping of the I/O thread - indexed by the peer slot in the host
+	 */
+	struct PeerSendState {
+		// enet already reset the peer when its disconnect event is handled - so we keep the id here
+		uint32_t connectID = 0u;
+		// waiting for the disconnect of a closing client host
+		bool closing = false;
+		uint32_t epoch = 0u;
+		size_t queuedCommands = 0u;
+		size_t scheduledCount = 0u;
+		int64_t budget = 0;
+		bool pending = false;
+		// fifo per channel - a reliable packet must never overtake an earlier one of the same channel
+		std::vector<std::deque<ScheduledPacket>> reliable;
+		std::deque<ScheduledPacket> unreliable[(int)SendPriority::Max];
+	};
+
+	struct HostSendState {
+		std::vector<PeerSendState> peers;
+		// indices of the peers with scheduled packets
+		std::vector<size_t> pending;
+	};
+
+	/**
+	 * @brief A client host that is gracefully disconnected by the io thread
+	 */
+	struct ClosingHost {
+		ENetHost* host = nullptr;
+		HostSendState sendState;
+		uint32_t generation = 0u;
+		// enet time after which the remaining peers are reset
+		uint32_t deadline = 0u;
+		bool started = false;
+		// all disconnects were reported - waiting for the game thread to destroy the host
+		bool closed = false;
+	};
+
+	/**
+	 * @brief The connection of a peer as the game thread knows it
+	 */
+	struct Connection {
+		uint32_t connectID;
+		ENetAddress address;
+	};
+
+	// written by the io thread - read by the game thread
+	struct HostStats {
+		std::atomic<uint64_t> sentBytes { 0u };
+		std::atomic<uint64_t> receivedBytes { 0u };
+		std::atomic<uint64_t> sentPackets { 0u };
+		std::atomic<uint64_t> receivedPackets { 0u };
+	};
+
 	ProtocolHandlerRegistryPtr _protocolHandlerRegistry;
 	core::EventBusPtr _eventBus;
 	ENetHost* _server;
 	ENetHost* _client;
 
-	bool packetReceived(ENetEvent& event, bool server);
-	void disconnectPeer(ENetPeer *peer, uint32_t timeout = 3000);
-	void updateHost(ENetHost* host, bool server);
+	// game thread is the producer, the io thread is the consumer
+	core::SPSCQueue<OutgoingCommand> _outgoing;
+	// the commands that didn't fit into the outgoing queue - only touched by the game thread. They are
+	// handed over before any newer command.
+	std::deque<OutgoingCommand> _spilled;
+	// the io thread is the producer, the game thread is the consumer
+	core::SPSCQueue<IncomingEvent> _incoming;
+
+	std::thread _ioThread;
+	std::mutex _hostMutex;
+	std::mutex _wakeupMutex;
+	std::condition_variable _wakeup;
+	std::atomic_bool _ioStop { false };
+	std::atomic_bool _ioIdle { false };
+	// incoming events of a client host that was disconnected are skipped - except for the disconnects
+	std::atomic_uint _clientGeneration { 0u };
+	// bytes per second per peer - 0 means that the send scheduler is disabled
+	std::atomic_uint _peerBandwidth { 0u };
+
+	// only touched by the io thread (or while holding the host mutex)
+	HostSendState _serverSendState;
+	HostSendState _clientSendState;
+	std::vector<ClosingHost> _closingClients;
+	HostStats _serverStats;
+	HostStats _clientStats;
+	uint32_t _ioEpoch = 0u;
+	uint32_t _lastTick = 0u;
+
+	// only touched by the game thread - updated by the connect and disconnect events
+	std::unordered_map<ENetPeer*, Connection> _connections;
+
+	bool packetReceived(const IncomingEvent& event);
+
+	void ioThread();
+	bool updateHost(ENetHost* host, HostSendState& hostState, HostStats& stats, bool server, uint32_t generation, bool closing);
+	/**
+	 * @brief Gracefully disconnects the peers of the client hosts that were handed over by @c disconnect()
+	 */
+	bool updateClosingClients();
+	bool queueDisconnect(ENetPeer* peer, PeerSendState& state, bool server, uint32_t generation);
+	/**
+	 * @brief Hands the client host over to the io thread to disconnect it
+	 * @note The host mutex must be held
+	 */
+	void closeClient();
+	void destroyClosedHost(ENetHost* host);
+	void collectStats(ENetHost* host, HostStats& stats);
+	static NetworkStats stats(const HostStats& stats);
+	bool processOutgoing();
+	HostSendState* hostSendState(ENetHost* host);
+	PeerSendState* peerSendState(ENetPeer* peer);
+	bool canQueue(ENetPeer* peer, PeerSendState& state, const ENetPacket* packet);
+	void sendPacket(const OutgoingCommand& cmd);
+	void tick();
+	void dispatchScheduled(ENetHost* host, HostSendState& hostState, uint32_t elapsedMillis, bool ignoreBudget);
+	void releaseScheduled(PeerSendState& state);
+	void startIOThread();
+	void stopIOThread();
+	void wakeupIOThread();
+	/**
+	 * @brief Hands the spilled commands over to the io thread as far as the outgoing queue has room
+	 * @return @c true if no spilled command is left
+	 */
+	bool drainSpilled();
+	bool hasOutgoingSlots(size_t amount);
+	/**
+	 * @brief Queues the command for the io thread - if the outgoing queue is full, it is spilled and
+	 * handed over with one of the next commands
+	 */
+	void queueOutgoing(const OutgoingCommand& cmd);
+	void pushOutgoing(const OutgoingCommand& cmd);
 public:
 	Network(ProtocolHandlerRegistryPtr protocolHandlerRegistry, core::EventBusPtr eventBus);
 	virtual ~Network();
 
 	bool init();
 	void shutdown();
+	/**
+	 * @brief Dispatches all the packets and events that the I/O thread received since the last call
+	 * @note Call @c flush() once the messages of the frame were queued
+	 */
 	void update();
+	/**
+	 * @brief Ends the current send tick - all the packets that were queued since the last flush
+	 * are handed over to the peers according to their priority and the peer bandwidth.
+	 */
+	void flush();
+
+	/**
+	 * @brief Limits the amount of bytes per second that the send scheduler hands over to a single peer.
+	 * @param[in] bytesPerSecond @c 0 disables the scheduler - all packets are sent immediately.
+	 */
+	void setPeerBandwidth(uint32_t bytesPerSecond);
 
 	// Server related methods
-	bool bind(uint16_t port, const std::string& hostname = "", int maxPeers = 1024, int maxChannels = 1);
-	inline void broadcast(ENetPacket* packet, int channel = 0) { enet_host_broadcast(_server, channel, packet); }
+	/**
+	 * @param[in] incomingBandwidth bytes per second - @c 0 means unlimited
+	 * @param[in] outgoingBandwidth bytes per second - @c 0 means unlimited
+	 */
+	bool bind(uint16_t port, const std::string& hostname = "", int maxPeers = 1024, int maxChannels = 1,
+			uint32_t incomingBandwidth = 0u, uint32_t outgoingBandwidth = 0u);
+	bool broadcast(ENetPacket* packet, int channel = 0);
+
+	NetworkStats serverStats() const;
 
 	// Client related methods
-	ENetPeer* connect(uint16_t port, const std::string& hostname, int maxChannels = 1);
+	/**
+	 * @brief Creates the client host and connects it to the given server
+	 * @param[in] incomingBandwidth bytes per second - @c 0 means unlimited
+	 * @param[in] outgoingBandwidth bytes per second - @c 0 means unlimited
+	 */
+	ENetPeer* connect(uint16_t port, const std::string& hostname, int maxChannels = 1,
+			uint32_t incomingBandwidth = 0u, uint32_t outgoingBandwidth = 0u);
+	/**
+	 * @brief Creates a client host that is able to keep up to @c maxConnections connections at
+	 * the same time. Use @c connectPeer() to establish them.
+	 * @note An already existing client host is disconnected.
+	 */
+	bool initClient(int maxConnections, int maxChannels = 1,
+			uint32_t incomingBandwidth = 0u, uint32_t outgoingBandwidth = 0u);
+	/**
+	 * @brief Establishes another connection with the client host that was created by @c initClient()
+	 * @return @c nullptr if there is no client host or all of its connections are in use.
+	 */
+	ENetPeer* connectPeer(uint16_t port, const std::string& hostname, int maxChannels = 1);
+	/**
+	 * @brief Disconnects all the connections of the client host. This doesn't block - the disconnects
+	 * are reported as @c DisconnectEvent once the peers acknowledged them or @c DisconnectTimeoutMillis
+	 * passed. The host is destroyed afterwards.
+	 */
 	void disconnect();
+	NetworkStats clientStats() const;
 
 	const ProtocolHandlerRegistryPtr& registry();
 
 	// Shared methods
-	inline bool sendMessage(ENetPeer* peer, ENetPacket* packet, int channel = 0) { return enet_peer_send(peer, channel, packet) == 0; }
+	/**
+	 * @return The connect id of the current connection of the peer as it was handed out with the
+	 * @c NewConnectionEvent - @c 0 if the peer isn't connected.
+	 */
+	uint32_t connectID(ENetPeer* peer) const;
+	/**
+	 * @return The address of the current connection of the peer - the host is @c 0 if the peer isn't connected.
+	 */
+	ENetAddress address(ENetPeer* peer) const;
+	/**
+	 * @brief Queues the packet for the current connection of the given peer.
+	 * @return @c false if the packet is unreliable and the outgoing queue is full - the packet is destroyed
+	 * in this case. Reliable packets are never dropped here - they wait on the game thread until the I/O
+	 * thread caught up.
+	 */
+	bool sendMessage(ENetPeer* peer, ENetPacket* packet, int channel = 0, SendPriority priority = SendPriority::Player);
+	/**
+	 * @brief Queues the packet for the given connection. The packet is dropped if the connection is gone
+	 * once the I/O thread sends it - even if ENet already reused the peer for a new connection.
+	 * @return @c false if the packet is unreliable and the outgoing queue is full - the packet is destroyed
+	 * in this case.
+	 */
+	bool sendMessage(ENetPeer* peer, uint32_t connectID, ENetPacket* packet, int channel = 0, SendPriority priority = SendPriority::Player);
+	/**
+	 * @brief Queues the same packet for several connections. Either all or none of the sends are queued.
+	 * @return @c false if the packet is unreliable and the outgoing queue is full - the packet is destroyed
+	 * in this case.
+	 */
+	bool sendMessage(ENetPeer* const* peers, const uint32_t* connectIDs, int numPeers, ENetPacket* packet, int channel = 0, SendPriority priority = SendPriority::Player);
+	/**
+	 * @brief Asks the I/O thread to gracefully disconnect the current connection of the given peer.
+	 */
+	bool disconnectPeerAsync(ENetPeer* peer);
 };
 
 inline const ProtocolHandlerRegistryPtr& Network::registry() {
 	return _protocolHandlerRegistry;
 }
 
+inline bool Network::sendMessage(ENetPeer* peer, ENetPacket* packet, int channel, SendPriority priority) {
+	return sendMessage(peer, connectID(peer), packet, channel, priority);
+}
+
+inline bool Network::sendMessage(ENetPeer* peer, uint32_t connectID, ENetPacket* packet, int channel, SendPriority priority) {
+	return sendMessage(&peer, &connectID, 1, packet, channel, priority);
+}
+
+inline void Network::setPeerBandwidth(uint32_t bytesPerSecond) {
+	_peerBandwidth = bytesPerSecond;
+}
+
+inline NetworkStats Network::serverStats() const {
+	return stats(_serverStats);
+}
+
+inline NetworkStats Network::clientStats() const {
+	return stats(_clientStats);
+}
+
 typedef std::shared_ptr<Network> NetworkPtr;
 
 }
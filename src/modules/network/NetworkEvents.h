@@ -12,24 +12,32 @@ namespace network {
 class NewConnectionEvent: public core::IEventBusEvent {
 private:
 	ENetPeer* _peer;
+	uint32_t _connectID;
 public:
-	NewConnectionEvent(ENetPeer* peer) :
-			_peer(peer) {
-		Log::trace("Connect peer event %u", peer->connectID);
+	NewConnectionEvent(ENetPeer* peer, uint32_t connectID) :
+			_peer(peer), _connectID(connectID) {
+		Log::trace("Connect peer event %u", connectID);
 	}
 	inline ENetPeer* peer() const {
 		return _peer;
 	}
+	/**
+	 * @brief Identifies the connection - ENet reuses the peer for later connections
+	 */
+	inline uint32_t connectID() const {
+		return _connectID;
+	}
 };
 
 class DisconnectEvent: public core::IEventBusEvent {
 private:
 	ENetPeer* _peer;
+	uint32_t _connectID;
 public:
-	DisconnectEvent(ENetPeer* peer) :
-			_peer(peer) {
+	DisconnectEvent(ENetPeer* peer, uint32_t connectID) :
+			_peer(peer), _connectID(connectID) {
 		if (peer != nullptr) {
-			Log::trace("Disconnect peer event %u", peer->connectID);
+			Log::trace("Disconnect peer event %u", connectID);
 		} else {
 			Log::trace("Could not connect");
 		}
@@ -37,6 +45,12 @@ public:
 	inline ENetPeer* peer() const {
 		return _peer;
 	}
+	/**
+	 * @brief The connection that is gone - @c 0 if the connection was never established
+	 */
+	inline uint32_t connectID() const {
+		return _connectID;
+	}
 };
 
 }
@@ -0,0 +1,148 @@
+/**
+ * @file
+ */
+
+#include "core/tests/AbstractTest.h"
+#include "network/Network.h"
+#include "network/NetworkEvents.h"
+#include "network/MessageSender.h"
+#include "network/ProtocolHandlerRegistry.h"
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace network {
+
+class NetworkTest: public core::AbstractTest {
+protected:
+	static constexpr uint16_t Port = 17923;
+
+	/**
+	 * @brief Remembers the connections of the server and the client host
+	 */
+	class ConnectionHandler: public core::IEventBusHandler<NewConnectionEvent> {
+	public:
+		std::vector<NewConnectionEvent> connections;
+
+		void onEvent(const NewConnectionEvent& event) override {
+			connections.push_back(event);
+		}
+	};
+
+	/**
+	 * @brief Records the entity ids of the received entity updates in the order they arrived
+	 */
+	class EntityUpdateHandler: public IProtocolHandler {
+	public:
+		std::vector<int64_t> ids;
+
+		void execute(ENetPeer* peer, const void* raw) override {
+			const EntityUpdate* message = getMsg<EntityUpdate>(raw);
+			ids.push_back(message->id());
+		}
+	};
+
+	template<typename Func>
+	bool waitFor(Func&& condition) {
+		for (int i = 0; i < 500; ++i) {
+			_network->update();
+			if (condition()) {
+				return true;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		return false;
+	}
+
+	// the server and the client host are handled by the same instance
+	NetworkPtr _network;
+	core::EventBusPtr _eventBus;
+	std::shared_ptr<EntityUpdateHandler> _entityUpdateHandler;
+	ConnectionHandler _connectionHandler;
+
+public:
+	void SetUp() override {
+		core::AbstractTest::SetUp();
+		_eventBus = std::make_shared<core::EventBus>();
+		_eventBus->subscribe<NewConnectionEvent>(_connectionHandler);
+		const ProtocolHandlerRegistryPtr& registry = std::make_shared<ProtocolHandlerRegistry>();
+		_entityUpdateHandler = std::make_shared<EntityUpdateHandler>();
+		registry->registerHandler(EnumNameServerMsgType(ServerMsgType::EntityUpdate), _entityUpdateHandler);
+		_network = std::make_shared<Network>(registry, _eventBus);
+		ASSERT_TRUE(_network->init());
+	}
+
+	void TearDown() override {
+		_network->shutdown();
+		_eventBus->unsubscribe<NewConnectionEvent>(_connectionHandler);
+		core::AbstractTest::TearDown();
+	}
+};
+
+constexpr uint16_t NetworkTest::Port;
+
+TEST_F(NetworkTest, testPriorityOvertakesQueueOrder) {
+	ASSERT_TRUE(_network->bind(Port, "127.0.0.1"));
+	ENetPeer* clientPeer = _network->connect(Port, "127.0.0.1");
+	ASSERT_NE(nullptr, clientPeer);
+	ASSERT_TRUE(waitFor([&] () {
+		return _connectionHandler.connections.size() >= 2u;
+	})) << "The client didn't connect";
+	ASSERT_EQ(2u, _connectionHandler.connections.size());
+	// the connection event of the client host is the one with the client peer
+	const NewConnectionEvent& server = _connectionHandler.connections[0].peer() == clientPeer
+			? _connectionHandler.connections[1] : _connectionHandler.connections[0];
+	ASSERT_NE(clientPeer, server.peer());
+
+	// enables the send scheduler - the budget is large enough for both packets
+	_network->setPeerBandwidth(1024u * 1024u);
+	MessageSender sender(_network);
+	const Vec3 pos { 0.0f, 0.0f, 0.0f };
+	flatbuffers::FlatBufferBuilder fbb;
+	// the far entity update is queued first - but the near entity update leaves first
+	sender.sendServerMessage(server.peer(), server.connectID(), fbb, ServerMsgType::EntityUpdate,
+			CreateEntityUpdate(fbb, 1, &pos, 0.0f).Union(), SendPriority::FarEntity, 0u);
+	sender.sendServerMessage(server.peer(), server.connectID(), fbb, ServerMsgType::EntityUpdate,
+			CreateEntityUpdate(fbb, 2, &pos, 0.0f).Union(), SendPriority::NearEntity, 0u);
+	_network->flush();
+
+	ASSERT_TRUE(waitFor([&] () {
+		return _entityUpdateHandler->ids.size() >= 2u;
+	})) << "The entity updates didn't arrive";
+	ASSERT_EQ(2u, _entityUpdateHandler->ids.size());
+	EXPECT_EQ(2, _entityUpdateHandler->ids[0]) << "The near entity update should overtake the earlier far entity update";
+	EXPECT_EQ(1, _entityUpdateHandler->ids[1]);
+}
+
+static int destroyedPackets = 0;
+
+static void countDestroyedPacket(ENetPacket*) {
+	++destroyedPackets;
+}
+
+TEST_F(NetworkTest, testReliablePacketsAreNotDroppedIfTheQueueIsFull) {
+	// without the io thread nobody is consuming the outgoing queue
+	Network network(std::make_shared<ProtocolHandlerRegistry>(), std::make_shared<core::EventBus>());
+	destroyedPackets = 0;
+	ENetPeer* peer = nullptr;
+	// the io thread drops the packets for a connect id of 0 - the peer is never touched
+	const uint32_t connectID = 0u;
+	const uint8_t data[] = {0u};
+	// every send needs a second slot to release the packet again
+	const int packets = (int)Network::OutgoingQueueSize;
+	for (int i = 0; i < packets; ++i) {
+		ENetPacket* packet = enet_packet_create(data, sizeof(data), ENET_PACKET_FLAG_RELIABLE);
+		packet->freeCallback = countDestroyedPacket;
+		ASSERT_TRUE(network.sendMessage(&peer, &connectID, 1, packet)) << "Reliable packet " << i << " was dropped";
+	}
+	ENetPacket* unreliable = enet_packet_create(data, sizeof(data), 0u);
+	unreliable->freeCallback = countDestroyedPacket;
+	EXPECT_FALSE(network.sendMessage(&peer, &connectID, 1, unreliable)) << "Unreliable packets should be dropped if the queue is full";
+	EXPECT_EQ(1, destroyedPackets);
+
+	// the kept packets are handed over once there is room again
+	network.shutdown();
+	EXPECT_EQ(packets + 1, destroyedPackets);
+}
+
+}
@@ -5,7 +5,6 @@
 #include "Connection.h"
 #include "ConnectionPool.h"
 #include "core/Log.h"
-#include "core/Singleton.h"
 #include "config.h"
 
 namespace persistence {
@@ -39,6 +38,7 @@ static void defaultNoticeProcessor(void *arg, const char *message) {
 }
 
 bool Connection::connect() {
+	disconnect();
 	std::string conninfo;
 
 	const char *host = nullptr;
@@ -89,8 +89,37 @@ void Connection::disconnect() {
 	_preparedStatements.clear();
 }
 
+bool Connection::checkHealth(bool ping) {
+	if (PQstatus(_connection) != CONNECTION_OK) {
+		return connect();
+	}
+	if (!ping) {
+		return true;
+	}
+	PGresult* res = PQexec(_connection, "");
+	const bool alive = PQresultStatus(res) == PGRES_EMPTY_QUERY;
+	PQclear(res);
+	if (alive) {
+		return true;
+	}
+	Log::warn("Lost connection to the database - reconnect");
+	return connect();
+}
+
+void Connection::resetTransaction() {
+	if (_connection == nullptr) {
+		return;
+	}
+	const PGTransactionStatusType status = PQtransactionStatus(_connection);
+	if (status == PQTRANS_IDLE || status == PQTRANS_UNKNOWN) {
+		return;
+	}
+	Log::warn("Connection was given back with an open transaction - rollback");
+	PQclear(PQexec(_connection, "ROLLBACK;"));
+}
+
 void Connection::close() {
-	core::Singleton<ConnectionPool>::getInstance().giveBack(this);
+	ConnectionPool::get().giveBack(this);
 }
 
 }
@@ -24,6 +24,9 @@ private:
 	std::string _password;
 	uint16_t _port;
 	std::unordered_set<std::string> _preparedStatements;
+	// the time in millis the connection was given back to the pool
+	uint64_t _idleSince = 0u;
+	uint32_t _generation = 0u;
 	Connection();
 
 	~Connection();
@@ -43,6 +46,17 @@ private:
 
 	bool connect();
 
+	/**
+	 * @brief Makes sure the connection can be used - reconnects if needed
+	 * @param[in] ping Send an empty query to the server to detect connections that were closed by the server
+	 */
+	bool checkHealth(bool ping);
+
+	/**
+	 * @brief Rolls back a transaction that wasn't finished
+	 */
+	void resetTransaction();
+
 public:
 	void close();
 
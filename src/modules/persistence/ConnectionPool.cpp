@@ -2,9 +2,17 @@
 #include "core/Log.h"
 #include "core/Common.h"
 #include "core/GameConfig.h"
+#include <chrono>
 
 namespace persistence {
 
+constexpr uint64_t ConnectionPool::PingIdleMillis;
+constexpr uint64_t ConnectionPool::CloseIdleMillis;
+
+static inline uint64_t millis() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 ConnectionPool::ConnectionPool() {
 }
 
@@ -12,9 +20,16 @@ ConnectionPool::~ConnectionPool() {
 	shutdown();
 }
 
+ConnectionPool& ConnectionPool::get() {
+	static ConnectionPool pool;
+	return pool;
+}
+
 int ConnectionPool::init() {
+	std::lock_guard<std::mutex> lock(_mutex);
 	_min = core::Var::getSafe(cfg::DatabaseMinConnections)->intVal();
 	_max = core::Var::getSafe(cfg::DatabaseMaxConnections)->intVal();
+	_timeout = core::Var::get(cfg::DatabaseConnectionTimeout, "1000")->intVal();
 
 	core_assert_always(_min <= _max);
 
@@ -25,70 +40,132 @@ int ConnectionPool::init() {
 
 	Log::debug("Connect to %s@%s to database %s", _dbUser->strVal().c_str(), _dbHost->strVal().c_str(), _dbName->strVal().c_str());
 
-	for (int i = 0; i < _min; ++i) {
-		addConnection();
+	// the connections are established once they are used the first time
+	for (int i = (int)_connections.size(); i < _min; ++i) {
+		_connections.push_back(createConnection());
+		++_connectionAmount;
 	}
+	_initialized = true;
 
 	return _connectionAmount;
 }
 
 void ConnectionPool::shutdown() {
-	while (!_connections.empty()) {
-		Connection* c = _connections.front();
+	std::vector<Connection*> connections;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		connections.swap(_connections);
+		// connections that are still in use are closed once they are given back
+		_connectionAmount = 0;
+		++_generation;
+		_initialized = false;
+
+		_dbName = core::VarPtr();
+		_dbHost = core::VarPtr();
+		_dbUser = core::VarPtr();
+		_dbPw = core::VarPtr();
+	}
+	_condition.notify_all();
+	for (Connection* c : connections) {
 		c->disconnect();
-		_connections.pop();
 		delete c;
 	}
-	_connectionAmount = 0;
+}
 
-	_dbName = core::VarPtr();
-	_dbHost = core::VarPtr();
-	_dbUser = core::VarPtr();
-	_dbPw = core::VarPtr();
+int ConnectionPool::connectionAmount() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _connectionAmount;
 }
 
-Connection* ConnectionPool::addConnection() {
+Connection* ConnectionPool::createConnection() const {
 	Connection* c = new Connection();
+	c->_generation = _generation;
 
 	c->changeDb(_dbName->strVal());
 	c->changeHost(_dbHost->strVal());
 	c->setLoginData(_dbUser->strVal(), _dbPw->strVal());
 
-	_connections.push(c);
-	++_connectionAmount;
 	return c;
 }
 
 void ConnectionPool::giveBack(Connection* c) {
-	_connections.push(c);
+	c->resetTransaction();
+	Connection* closeIdle = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (c->_generation != _generation) {
+			// the pool was shut down while the connection was in use
+			closeIdle = c;
+		} else {
+			const uint64_t now = millis();
+			c->_idleSince = now;
+			_connections.push_back(c);
+			// the front is the connection that is idle for the longest time
+			Connection* oldest = _connections.front();
+			if (_connectionAmount > _min && now - oldest->_idleSince > CloseIdleMillis) {
+				_connections.erase(_connections.begin());
+				--_connectionAmount;
+				closeIdle = oldest;
+			}
+		}
+	}
+	_condition.notify_one();
+	if (closeIdle != nullptr) {
+		closeIdle->disconnect();
+		delete closeIdle;
+	}
 }
 
 Connection* ConnectionPool::connection() {
-	if (_connections.empty()) {
-		if (_connectionAmount >= _max) {
-			Log::warn("Could not aquire pooled connection, max limit hit");
+	std::unique_lock<std::mutex> lock(_mutex);
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(_timeout);
+	bool timedOut = false;
+	for (;;) {
+		if (!_initialized) {
+			Log::error("Connection pool is not initialized");
 			return nullptr;
 		}
-		Connection* newC = addConnection();
-		if (!newC->connect()) {
+		if (!_connections.empty()) {
+			Connection* c = _connections.back();
+			_connections.pop_back();
+			const bool ping = millis() - c->_idleSince > PingIdleMillis;
+			// don't block the other threads while talking to the database
+			lock.unlock();
+			if (c->checkHealth(ping)) {
+				return c;
+			}
 			Log::error("Could not connect to database");
+			c->disconnect();
+			delete c;
+			lock.lock();
+			--_connectionAmount;
+			lock.unlock();
+			_condition.notify_one();
 			return nullptr;
 		}
+		if (_connectionAmount < _max) {
+			// reserve the slot
+			++_connectionAmount;
+			Connection* c = createConnection();
+			lock.unlock();
+			if (c->connect()) {
+				return c;
+			}
+			Log::error("Could not connect to database");
+			delete c;
+			lock.lock();
+			--_connectionAmount;
+			lock.unlock();
+			_condition.notify_one();
+			return nullptr;
+		}
+		if (timedOut) {
+			Log::warn("Could not acquire pooled connection, max limit hit");
+			return nullptr;
+		}
+		// check the pool one last time after the timeout
+		timedOut = _condition.wait_until(lock, deadline) == std::cv_status::timeout;
 	}
-	Connection* c = _connections.front();
-	_connections.pop();
-	// TODO: hide postgres here - move into connection
-	if (PQstatus(c->connection()) == CONNECTION_OK) {
-		return c;
-	}
-
-	if (c->connect()) {
-		return c;
-	}
-
-	delete c;
-	--_connectionAmount;
-	return connection();
 }
 
 }
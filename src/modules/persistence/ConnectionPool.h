@@ -1,46 +1,75 @@
 #pragma once
 
-#include <queue>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
 #include "Connection.h"
 #include "ScopedConnection.h"
 #include "core/Var.h"
-#include "core/Singleton.h"
 
 namespace persistence {
 
 /**
- * One connection pool per thread
+ * @brief Pool of database connections that may be used from any thread.
+ *
+ * At least @c cfg::DatabaseMinConnections connections are kept open. If all connections are in use, new
+ * ones are opened up to @c cfg::DatabaseMaxConnections. Once this limit is hit, @c connection() waits up
+ * to @c cfg::DatabaseConnectionTimeout millis for a connection to be given back.
+ *
+ * Connections are checked before they are handed out - a connection that was idle for longer than
+ * @c PingIdleMillis is pinged, broken connections are reestablished. Idle connections above the minimum
+ * are closed after @c CloseIdleMillis.
+ *
+ * There is one pool for the whole process - a connection may be given back from another thread.
  */
 class ConnectionPool {
 	friend class Connection;
-	friend class core::Singleton<ConnectionPool>;
+public:
+	static constexpr uint64_t PingIdleMillis = 30000u;
+	static constexpr uint64_t CloseIdleMillis = 60000u;
 protected:
 	int _min = -1;
 	int _max = -1;
+	int _timeout = 0;
+	// connections in use and idle ones
 	int _connectionAmount = 0;
+	// increased with every shutdown - connections of a previous generation are not taken back
+	uint32_t _generation = 0u;
+	bool _initialized = false;
 	core::VarPtr _dbName;
 	core::VarPtr _dbHost;
 	core::VarPtr _dbUser;
 	core::VarPtr _dbPw;
 
-	std::queue<Connection*> _connections;
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	// the connections that were given back last are at the end
+	std::vector<Connection*> _connections;
 
 	ConnectionPool();
 public:
 	~ConnectionPool();
 
+	static ConnectionPool& get();
+
 	int init();
 	void shutdown();
 
 	/**
 	 * @brief Gets one connection from the pool
 	 * @note Make sure to call @c Connection::close() to give the connection back to the pool.
-	 * @return @c Connection object
+	 * @return @c Connection object or @c nullptr if no connection could get established or all
+	 * connections are still in use after the timeout
 	 */
 	Connection* connection();
 
+	/**
+	 * @return The amount of open connections - in use or idle
+	 */
+	int connectionAmount();
+
 private:
-	Connection* addConnection();
+	Connection* createConnection() const;
 	void giveBack(Connection* c);
 };
 
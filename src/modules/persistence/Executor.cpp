@@ -0,0 +1,298 @@
+/**
+ * @file
+ */
+
+#include "Executor.h"
+#include "core/Log.h"
+#include "core/Var.h"
+#include "core/Trace.h"
+#include "core/GameConfig.h"
+#include <algorithm>
+
+namespace persistence {
+
+constexpr int Executor::MaxBatchRows;
+
+Executor::~Executor() {
+	shutdown();
+}
+
+bool Executor::init() {
+	const int threads = core::Var::get(cfg::DatabaseThreads, "1")->intVal();
+	_batchDelay = (uint64_t)std::max(0, core::Var::get(cfg::DatabaseBatchDelay, "1000")->intVal());
+	if (threads <= 0) {
+		Log::error("At least one database thread is needed");
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(_jobMutex);
+	if (!_threads.empty()) {
+		Log::error("The database executor is already running");
+		return false;
+	}
+	_stop = false;
+	{
+		std::lock_guard<std::mutex> batchLock(_batchMutex);
+		_flushQueued = false;
+	}
+	for (int i = 0; i < threads; ++i) {
+		_threads.emplace_back([this] () {
+			run();
+		});
+	}
+	return true;
+}
+
+int Executor::shutdown() {
+	if (_threads.empty()) {
+		return pendingWrites();
+	}
+	// the last job - everything that was queued until now is written
+	enqueue([this] () {
+		flush();
+	});
+	{
+		std::lock_guard<std::mutex> lock(_jobMutex);
+		_stop = true;
+	}
+	_jobCondition.notify_all();
+	for (std::thread& thread : _threads) {
+		thread.join();
+	}
+	_threads.clear();
+
+	{
+		std::lock_guard<std::mutex> lock(_callbackMutex);
+		_callbacks.clear();
+	}
+	const int unwritten = pendingWrites();
+	if (unwritten > 0) {
+		Log::error("Failed to write %i queued rows before the shutdown", unwritten);
+	}
+	return unwritten;
+}
+
+void Executor::run() {
+	for (;;) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(_jobMutex);
+			_jobCondition.wait(lock, [this] () {
+				return _stop || !_jobs.empty();
+			});
+			// the remaining jobs are executed before the threads are stopped
+			if (_jobs.empty()) {
+				return;
+			}
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+		}
+		core_trace_scoped(DatabaseJob);
+		job();
+	}
+}
+
+void Executor::enqueue(std::function<void()>&& job) {
+	{
+		std::lock_guard<std::mutex> lock(_jobMutex);
+		if (_stop) {
+			Log::warn("The database executor is not running - the job is dropped");
+			return;
+		}
+		_jobs.push_back(std::move(job));
+	}
+	_jobCondition.notify_one();
+}
+
+void Executor::enqueueCallback(std::function<void()>&& callback) {
+	std::lock_guard<std::mutex> lock(_callbackMutex);
+	_callbacks.push_back(std::move(callback));
+}
+
+void Executor::update(uint64_t nowMillis) {
+	std::vector<std::function<void()> > callbacks;
+	{
+		std::lock_guard<std::mutex> lock(_callbackMutex);
+		callbacks.swap(_callbacks);
+	}
+	for (std::function<void()>& callback : callbacks) {
+		callback();
+	}
+
+	if (_lastFlush == 0u) {
+		_lastFlush = nowMillis;
+	}
+	if (nowMillis - _lastFlush >= _batchDelay) {
+		_lastFlush = nowMillis;
+		queueFlush();
+	}
+}
+
+bool Executor::registerBatch(const std::string& table, const std::vector<std::string>& columns, const std::string& keyColumn) {
+	if (columns.empty()) {
+		Log::error("No columns given for the batch of table %s", table.c_str());
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(_batchMutex);
+	if (_batches.find(table) != _batches.end()) {
+		Log::error("The batch for table %s is already registered", table.c_str());
+		return false;
+	}
+	Batch& batch = _batches[table];
+	batch.table = table;
+	batch.columns = columns;
+	batch.keyColumn = keyColumn;
+	batch.statements.resize(MaxBatchRows + 1);
+	return true;
+}
+
+bool Executor::write(const std::string& table, int64_t key, Model::PreparedStatement&& values) {
+	bool full = false;
+	{
+		std::lock_guard<std::mutex> lock(_batchMutex);
+		auto i = _batches.find(table);
+		if (i == _batches.end()) {
+			Log::error("There is no batch registered for table %s", table.c_str());
+			return false;
+		}
+		Batch& batch = i->second;
+		if (values.params() != (int)batch.columns.size()) {
+			Log::error("Expected %i values for the batch of table %s, got %i",
+					(int)batch.columns.size(), table.c_str(), values.params());
+			return false;
+		}
+		auto existing = batch.index.find(key);
+		if (existing != batch.index.end()) {
+			batch.rows[existing->second] = std::move(values);
+			return true;
+		}
+		batch.index.emplace(key, (int)batch.rows.size());
+		batch.rows.push_back(std::move(values));
+		batch.keys.push_back(key);
+		full = (int)batch.rows.size() >= MaxBatchRows;
+	}
+	if (full) {
+		queueFlush();
+	}
+	return true;
+}
+
+int Executor::pendingWrites() {
+	std::lock_guard<std::mutex> lock(_batchMutex);
+	int pending = 0;
+	for (const auto& entry : _batches) {
+		pending += (int)entry.second.rows.size();
+	}
+	return pending;
+}
+
+void Executor::queueFlush() {
+	{
+		std::lock_guard<std::mutex> lock(_batchMutex);
+		if (_flushQueued) {
+			return;
+		}
+		_flushQueued = true;
+	}
+	enqueue([this] () {
+		flush();
+	});
+}
+
+void Executor::flush() {
+	std::lock_guard<std::mutex> flushLock(_flushMutex);
+	struct FlushRows {
+		Batch* batch;
+		std::vector<Model::PreparedStatement> rows;
+		std::vector<int64_t> keys;
+	};
+	std::vector<FlushRows> batches;
+	{
+		std::lock_guard<std::mutex> lock(_batchMutex);
+		_flushQueued = false;
+		for (auto& entry : _batches) {
+			Batch& batch = entry.second;
+			if (batch.rows.empty()) {
+				continue;
+			}
+			batches.push_back(FlushRows{&batch, std::move(batch.rows), std::move(batch.keys)});
+			batch.rows.clear();
+			batch.keys.clear();
+			batch.index.clear();
+		}
+	}
+	for (FlushRows& entry : batches) {
+		const int size = (int)entry.rows.size();
+		for (int start = 0; start < size; start += MaxBatchRows) {
+			const int count = std::min(MaxBatchRows, size - start);
+			if (!flush(*entry.batch, entry.rows, start, count)) {
+				requeue(*entry.batch, entry.rows, entry.keys, start, count);
+			}
+		}
+	}
+}
+
+void Executor::requeue(Batch& batch, std::vector<Model::PreparedStatement>& rows, const std::vector<int64_t>& keys, int start, int count) {
+	std::lock_guard<std::mutex> lock(_batchMutex);
+	int requeued = 0;
+	for (int r = start; r < start + count; ++r) {
+		// a row that was queued while we were writing is newer
+		if (batch.index.find(keys[r]) != batch.index.end()) {
+			continue;
+		}
+		batch.index.emplace(keys[r], (int)batch.rows.size());
+		batch.rows.push_back(std::move(rows[r]));
+		batch.keys.push_back(keys[r]);
+		++requeued;
+	}
+	Log::warn("Retry %i rows of table %s with the next flush", requeued, batch.table.c_str());
+}
+
+bool Executor::flush(Batch& batch, const std::vector<Model::PreparedStatement>& rows, int start, int count) {
+	core_trace_scoped(DatabaseBatchWrite);
+	std::string& statement = batch.statements[count];
+	if (statement.empty()) {
+		const int columns = (int)batch.columns.size();
+		statement = "INSERT INTO " + batch.table + " (";
+		for (int c = 0; c < columns; ++c) {
+			if (c > 0) {
+				statement += ", ";
+			}
+			statement += batch.columns[c];
+		}
+		statement += ") VALUES ";
+		int param = 1;
+		for (int r = 0; r < count; ++r) {
+			statement += r > 0 ? ", (" : "(";
+			for (int c = 0; c < columns; ++c) {
+				if (c > 0) {
+					statement += ", ";
+				}
+				statement += "$" + std::to_string(param++);
+			}
+			statement += ")";
+		}
+		statement += " ON CONFLICT (" + batch.keyColumn + ") DO ";
+		std::string update;
+		for (const std::string& column : batch.columns) {
+			if (column == batch.keyColumn) {
+				continue;
+			}
+			update += update.empty() ? "UPDATE SET " : ", ";
+			update += column + " = EXCLUDED." + column;
+		}
+		statement += update.empty() ? "NOTHING" : update;
+	}
+
+	Model model(batch.table);
+	Model::PreparedStatement stmt = model.prepare("Batch" + batch.table + std::to_string(count), statement);
+	for (int r = start; r < start + count; ++r) {
+		stmt.append(rows[r]);
+	}
+	if (!stmt.exec().result) {
+		Log::error("Failed to write %i rows to table %s", count, batch.table.c_str());
+		return false;
+	}
+	return true;
+}
+
+}
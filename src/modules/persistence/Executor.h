@@ -0,0 +1,146 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "Model.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace persistence {
+
+/**
+ * @brief Executes database jobs on dedicated threads - the game thread never waits for the database.
+ *
+ * Results are either handed out as @c std::future or given to a callback that is executed on the thread
+ * that calls @c update().
+ *
+ * Frequent small writes (positions, attributes, inventories) are queued with @c write() and collected per
+ * table. A row that is queued for a key replaces the row that is still queued for the same key. The rows
+ * are written with multi row upserts every @c cfg::DatabaseBatchDelay millis or once a batch is full.
+ * Rows that failed to be written are queued again - unless a newer row for the same key was queued in the
+ * meantime - and retried with the next flush. Everything that was queued before @c shutdown() is written.
+ */
+class Executor {
+public:
+	static constexpr int MaxBatchRows = 64;
+private:
+	struct Batch {
+		std::string table;
+		std::vector<std::string> columns;
+		std::string keyColumn;
+		// the rows in the order they were queued - the index is looked up by key
+		std::vector<Model::PreparedStatement> rows;
+		std::vector<int64_t> keys;
+		std::unordered_map<int64_t, int> index;
+		// the statement texts by row count - only accessed while flushing
+		std::vector<std::string> statements;
+	};
+	std::unordered_map<std::string, Batch> _batches;
+	std::mutex _batchMutex;
+	// flushes are serialized to keep the order of writes for the same key
+	std::mutex _flushMutex;
+	bool _flushQueued = false;
+
+	std::vector<std::thread> _threads;
+	std::deque<std::function<void()> > _jobs;
+	std::mutex _jobMutex;
+	std::condition_variable _jobCondition;
+	bool _stop = true;
+
+	std::vector<std::function<void()> > _callbacks;
+	std::mutex _callbackMutex;
+
+	uint64_t _batchDelay = 0u;
+	uint64_t _lastFlush = 0u;
+
+	void enqueue(std::function<void()>&& job);
+	void enqueueCallback(std::function<void()>&& callback);
+	void queueFlush();
+	void flush();
+	bool flush(Batch& batch, const std::vector<Model::PreparedStatement>& rows, int start, int count);
+	void requeue(Batch& batch, std::vector<Model::PreparedStatement>& rows, const std::vector<int64_t>& keys, int start, int count);
+	void run();
+public:
+	~Executor();
+
+	/**
+	 * @brief Starts @c cfg::DatabaseThreads threads
+	 */
+	bool init();
+	/**
+	 * @brief Writes all queued rows and waits until all jobs are executed
+	 * @note The callbacks of the executed jobs are not called anymore
+	 * @return The amount of rows that couldn't be written
+	 */
+	int shutdown();
+
+	/**
+	 * @brief Executes the callbacks of the finished jobs and queues the batched writes once they are due
+	 */
+	void update(uint64_t nowMillis);
+
+	/**
+	 * @brief Executes the given function on one of the database threads
+	 */
+	template<class FUNC>
+	auto submit(FUNC&& func) -> std::future<decltype(func())>;
+
+	/**
+	 * @brief Executes the given function on one of the database threads and hands the result
+	 * over to the callback in the next @c update() call
+	 */
+	template<class FUNC, class CALLBACK>
+	void submit(FUNC&& func, CALLBACK&& callback);
+
+	/**
+	 * @brief Registers a table for batched writes. Existing rows are updated on conflicts with the key column.
+	 */
+	bool registerBatch(const std::string& table, const std::vector<std::string>& columns, const std::string& keyColumn);
+
+	/**
+	 * @brief Queues a row for the given batch
+	 * @param[in] values The values in the order of the registered columns
+	 * @return @c false if the batch wasn't registered or the amount of values doesn't match the columns
+	 */
+	bool write(const std::string& table, int64_t key, Model::PreparedStatement&& values);
+
+	/**
+	 * @return The amount of rows that are not yet written
+	 */
+	int pendingWrites();
+};
+
+template<class FUNC>
+auto Executor::submit(FUNC&& func) -> std::future<decltype(func())> {
+	using Result = decltype(func());
+	auto task = std::make_shared<std::packaged_task<Result()> >(std::forward<FUNC>(func));
+	std::future<Result> result = task->get_future();
+	enqueue([task] () {
+		(*task)();
+	});
+	return result;
+}
+
+template<class FUNC, class CALLBACK>
+void Executor::submit(FUNC&& func, CALLBACK&& callback) {
+	enqueue([this, func = std::forward<FUNC>(func), callback = std::forward<CALLBACK>(callback)] () mutable {
+		auto result = std::make_shared<decltype(func())>(func());
+		enqueueCallback([callback, result] () mutable {
+			callback(std::move(*result));
+		});
+	});
+}
+
+typedef std::shared_ptr<Executor> ExecutorPtr;
+
+}
@@ -11,15 +11,55 @@
 
 namespace persistence {
 
+// see pg_type.h - the server headers are not available to clients
+static constexpr Oid INT4OID = 23;
+static constexpr Oid INT8OID = 20;
+static constexpr Oid TIMESTAMPOID = 1114;
+// binary timestamps are microseconds since 2000-01-01
+static constexpr int64_t PostgresEpochSeconds = 946684800;
+
+static inline int64_t toInt(const char* value, int length) {
+	switch (length) {
+	case 2: {
+		int16_t v;
+		SDL_memcpy(&v, value, sizeof(v));
+		return (int16_t)SDL_SwapBE16(v);
+	}
+	case 4: {
+		int32_t v;
+		SDL_memcpy(&v, value, sizeof(v));
+		return (int32_t)SDL_SwapBE32(v);
+	}
+	case 8: {
+		int64_t v;
+		SDL_memcpy(&v, value, sizeof(v));
+		return (int64_t)SDL_SwapBE64(v);
+	}
+	default:
+		return 0;
+	}
+}
+
 Model::Model(const std::string& tableName) :
 		_tableName(tableName) {
 	_membersPointer = (uint8_t*)this;
 }
 
 Model::~Model() {
+	if (_transaction != nullptr) {
+		Log::warn("Transaction for table %s wasn't finished", _tableName.c_str());
+		rollback();
+	}
 	_fields.clear();
 }
 
+Connection* Model::connection() const {
+	if (_transaction != nullptr) {
+		return _transaction;
+	}
+	return ConnectionPool::get().connection();
+}
+
 bool Model::isPrimaryKey(const std::string& fieldname) const {
 	auto i = std::find_if(_fields.begin(), _fields.end(),
 			[&fieldname](const Field& f) {return f.name == fieldname;}
@@ -73,13 +113,13 @@ bool Model::checkLastResult(State& state, Connection* connection) const {
 
 bool Model::exec(const char* query) {
 	Log::debug("%s", query);
-	ScopedConnection scoped(core::Singleton<ConnectionPool>::getInstance().connection());
+	ScopedConnection scoped(connection(), _transaction == nullptr);
 	if (!scoped) {
 		Log::error("Could not execute query '%s' - could not acquire connection", query);
 		return false;
 	}
 	ConnectionType* conn = scoped.connection()->connection();
-	State s(PQexec(conn, query));
+	State s(PQexecParams(conn, query, 0, nullptr, nullptr, nullptr, nullptr, 1));
 	checkLastResult(s, scoped);
 	return fillModelValues(s);
 }
@@ -94,54 +134,87 @@ Model::Field Model::getField(const std::string& name) const {
 }
 
 bool Model::begin() {
-	return exec("START TRANSACTION;");
+	if (_transaction != nullptr) {
+		Log::error("There is already a transaction running for table %s", _tableName.c_str());
+		return false;
+	}
+	_transaction = ConnectionPool::get().connection();
+	if (_transaction == nullptr) {
+		Log::error("Could not start transaction - could not acquire connection");
+		return false;
+	}
+	if (!exec("START TRANSACTION;")) {
+		Connection* c = _transaction;
+		_transaction = nullptr;
+		c->close();
+		return false;
+	}
+	return true;
+}
+
+bool Model::endTransaction(const char* query) {
+	if (_transaction == nullptr) {
+		Log::error("There is no transaction running for table %s", _tableName.c_str());
+		return false;
+	}
+	const bool state = exec(query);
+	Connection* c = _transaction;
+	_transaction = nullptr;
+	c->close();
+	return state;
 }
 
 bool Model::commit() {
-	return exec("COMMIT;");
+	return endTransaction("COMMIT;");
 }
 
 bool Model::rollback() {
-	return exec("ROLLBACK;");
+	return endTransaction("ROLLBACK;");
 }
 
-bool Model::fillModelValues(Model::State& state) {
-	if (state.affectedRows > 1) {
-		Log::debug("More than one row affected, can't fill model values");
-		return state.result;
-	} else if (state.affectedRows <= 0) {
-		Log::trace("No rows affected, can't fill model values");
-		return state.result;
-	}
-
+bool Model::mapColumns(State& state) const {
 	const int nFields = PQnfields(state.res);
 	Log::trace("Query has values for %i fields", nFields);
+	state.columns.resize(nFields);
 	for (int i = 0; i < nFields; ++i) {
 		const char* name = PQfname(state.res, i);
-		const char* value = PQgetvalue(state.res, 0, i);
-		if (value == nullptr) {
-			value = "";
-		}
-		const Field& f = getField(name);
-		if (f.name != name) {
+		auto iter = std::find_if(_fields.begin(), _fields.end(),
+				[name] (const Field& f) {return f.name == name;}
+		);
+		if (iter == _fields.end()) {
 			Log::error("Unknown field name for '%s'", name);
-			state.result = false;
+			state.columns[i] = -1;
+			continue;
+		}
+		state.columns[i] = (int)std::distance(_fields.begin(), iter);
+	}
+	return true;
+}
+
+bool Model::fillModelValues(const State& state, int row) {
+	const int nFields = (int)state.columns.size();
+	for (int i = 0; i < nFields; ++i) {
+		if (state.columns[i] == -1) {
 			return false;
 		}
-		Log::debug("Try to set '%s' to '%s'", name, value);
+		const Field& f = _fields[state.columns[i]];
+		const bool null = PQgetisnull(state.res, row, i) != 0;
+		const char* value = PQgetvalue(state.res, row, i);
+		const int length = PQgetlength(state.res, row, i);
 		switch (f.type) {
 		case FieldType::STRING:
 		case FieldType::PASSWORD:
-			setValue(f, std::string(value));
+			setValue(f, null ? std::string() : std::string(value, length));
 			break;
 		case FieldType::INT:
-			setValue(f, core::string::toInt(value));
+			setValue(f, null ? 0 : (int32_t)toInt(value, length));
 			break;
 		case FieldType::LONG:
-			setValue(f, core::string::toLong(value));
+			setValue(f, null ? (int64_t)0 : toInt(value, length));
 			break;
 		case FieldType::TIMESTAMP: {
-			setValue(f, Timestamp(core::string::toLong(value)));
+			const int64_t seconds = null ? 0 : toInt(value, length) / 1000000 + PostgresEpochSeconds;
+			setValue(f, Timestamp(seconds));
 			break;
 		}
 		}
@@ -149,13 +222,80 @@ bool Model::fillModelValues(Model::State& state) {
 	return true;
 }
 
+bool Model::fillModelValues(Model::State& state) {
+	if (state.affectedRows <= 0) {
+		Log::trace("No rows affected, can't fill model values");
+		return state.result;
+	}
+	mapColumns(state);
+	if (state.affectedRows > 1) {
+		Log::debug("More than one row affected, can't fill model values");
+		return state.result;
+	}
+	if (!fillModelValues(state, 0)) {
+		state.result = false;
+		return false;
+	}
+	return true;
+}
+
 Model::PreparedStatement::PreparedStatement(Model* model, const std::string& name, const std::string& statement) :
 		_model(model), _name(name), _statement(statement) {
 }
 
+Model::PreparedStatement::PreparedStatement() :
+		PreparedStatement(nullptr, "", "") {
+}
+
+Model::PreparedStatement& Model::PreparedStatement::append(const PreparedStatement& other) {
+	const int offset = (int)_data.size();
+	_data.insert(_data.end(), other._data.begin(), other._data.end());
+	for (const Param& param : other._params) {
+		_params.push_back(Param{param.type, param.format, param.offset + offset, param.length});
+	}
+	return *this;
+}
+
+Model::PreparedStatement& Model::PreparedStatement::add(Oid type, int format, const void* data, int length) {
+	const int offset = (int)_data.size();
+	_data.insert(_data.end(), (const char*)data, (const char*)data + length);
+	if (format == 0) {
+		// text parameters are null terminated
+		_data.push_back('\0');
+	}
+	_params.push_back(Param{type, format, offset, length});
+	return *this;
+}
+
+Model::PreparedStatement& Model::PreparedStatement::add(const std::string& value, FieldType fieldType) {
+	// the binary representation of the character types is the string itself
+	return add(0, 1, value.data(), (int)value.size());
+}
+
+Model::PreparedStatement& Model::PreparedStatement::add(int32_t value) {
+	const uint32_t swapped = SDL_SwapBE32((uint32_t)value);
+	return add(INT4OID, 1, &swapped, sizeof(swapped));
+}
+
+Model::PreparedStatement& Model::PreparedStatement::add(int64_t value) {
+	const uint64_t swapped = SDL_SwapBE64((uint64_t)value);
+	return add(INT8OID, 1, &swapped, sizeof(swapped));
+}
+
+Model::PreparedStatement& Model::PreparedStatement::add(const Timestamp& value) {
+	if (value.isNow()) {
+		// the time of the server - the type of the parameter is still the same
+		static const char now[] = "now";
+		return add(TIMESTAMPOID, 0, now, sizeof(now) - 1);
+	}
+	const int64_t micros = ((int64_t)value.time() - PostgresEpochSeconds) * 1000000;
+	const uint64_t swapped = SDL_SwapBE64((uint64_t)micros);
+	return add(TIMESTAMPOID, 1, &swapped, sizeof(swapped));
+}
+
 Model::State Model::PreparedStatement::exec() {
 	Log::debug("prepared statement: '%s'", _statement.c_str());
-	ScopedConnection scoped(core::Singleton<ConnectionPool>::getInstance().connection());
+	ScopedConnection scoped(_model->connection(), _model->_transaction == nullptr);
 	if (!scoped) {
 		Log::error("Could not prepare query '%s' - could not acquire connection", _statement.c_str());
 		return State(nullptr);
@@ -163,19 +303,29 @@ Model::State Model::PreparedStatement::exec() {
 
 	ConnectionType* conn = scoped.connection()->connection();
 
-	if (!scoped.connection()->hasPreparedStatement(_name)) {
-		State state(PQprepare(conn, _name.c_str(), _statement.c_str(), (int)_params.size(), nullptr));
+	const int size = (int)_params.size();
+	if (_name.empty() || !scoped.connection()->hasPreparedStatement(_name)) {
+		std::vector<Oid> types(size);
+		for (int i = 0; i < size; ++i) {
+			types[i] = _params[i].type;
+		}
+		State state(PQprepare(conn, _name.c_str(), _statement.c_str(), size, types.data()));
 		if (!_model->checkLastResult(state, scoped)) {
 			return state;
 		}
-		scoped.connection()->registerPreparedStatement(_name);
+		if (!_name.empty()) {
+			scoped.connection()->registerPreparedStatement(_name);
+		}
 	}
-	const int size = _params.size();
-	const char* paramValues[size];
+	std::vector<const char*> values(size);
+	std::vector<int> lengths(size);
+	std::vector<int> formats(size);
 	for (int i = 0; i < size; ++i) {
-		paramValues[i] = _params[i].first.c_str();
+		values[i] = _data.data() + _params[i].offset;
+		lengths[i] = _params[i].length;
+		formats[i] = _params[i].format;
 	}
-	State prepState(PQexecPrepared(conn, _name.c_str(), size, paramValues, nullptr, nullptr, 0));
+	State prepState(PQexecPrepared(conn, _name.c_str(), size, values.data(), lengths.data(), formats.data(), 1));
 	if (!_model->checkLastResult(prepState, scoped)) {
 		return prepState;
 	}
@@ -189,7 +339,7 @@ Model::State::State(ResultType* _res) :
 
 Model::State::State(State&& other) :
 		res(other.res), lastErrorMsg(other.lastErrorMsg), affectedRows(
-				other.affectedRows), result(other.result) {
+				other.affectedRows), result(other.result), columns(std::move(other.columns)) {
 	other.res = nullptr;
 }
 
@@ -202,6 +352,8 @@ Model::State::~State() {
 
 Model::ScopedTransaction::ScopedTransaction(Model* model, bool autocommit) :
 		_autocommit(autocommit), _model(model) {
+	// nothing to finish if the transaction couldn't get started
+	_commited = !_model->begin();
 }
 
 Model::ScopedTransaction::~ScopedTransaction() {
@@ -84,14 +84,31 @@ public:
 		int affectedRows = -1;
 		// false on error, true on success
 		bool result = false;
+		// the index of the model field for every column of the result - -1 for unknown columns
+		std::vector<int> columns;
 	};
 protected:
 	Fields _fields;
 	const std::string _tableName;
 	uint8_t* _membersPointer;
+	// the connection that is pinned to the running transaction
+	Connection* _transaction = nullptr;
 
 	Field getField(const std::string& name) const;
+	/**
+	 * @return The connection of the running transaction or a pooled one
+	 */
+	Connection* connection() const;
+	bool endTransaction(const char* query);
 	bool checkLastResult(State& state, Connection* connection) const;
+	/**
+	 * @brief Looks up the model field for each column of the result once - the rows are mapped by index
+	 */
+	bool mapColumns(State& state) const;
+	/**
+	 * @brief Fills the model values from the given row of the (binary) result
+	 */
+	bool fillModelValues(const State& state, int row);
 	bool fillModelValues(State& state);
 public:
 	Model(const std::string& tableName);
@@ -103,10 +120,17 @@ public:
 
 	bool isPrimaryKey(const std::string& fieldname) const;
 
+	/**
+	 * @brief Starts a transaction. One connection of the pool is used for all statements of this
+	 * model until the transaction is committed or rolled back.
+	 */
 	bool begin();
 	bool commit();
 	bool rollback();
 
+	/**
+	 * @brief Starts a transaction for the given model and finishes it once the scope is left
+	 */
 	class ScopedTransaction {
 	private:
 		bool _commited = false;
@@ -120,43 +144,61 @@ public:
 		void rollback();
 	};
 
+	/**
+	 * @brief Named statement that is prepared once per connection. The parameters are sent and the
+	 * results are received in the binary format.
+	 * @note An empty name results in an unnamed statement that is prepared on every execution.
+	 */
 	class PreparedStatement {
 	private:
 		Model* _model;
 		std::string _name;
 		std::string _statement;
-		typedef std::pair<std::string, FieldType> ParamEntry;
-		std::vector<ParamEntry> _params;
+		struct Param {
+			// 0 lets the server derive the type from the statement
+			Oid type;
+			// 0 is text, 1 is binary
+			int format;
+			int offset;
+			int length;
+		};
+		std::vector<Param> _params;
+		// the values of all parameters in network byte order
+		std::vector<char> _data;
+
+		PreparedStatement& add(Oid type, int format, const void* data, int length);
 	public:
 		PreparedStatement(Model* model, const std::string& name, const std::string& statement);
-
-		inline PreparedStatement& add(const std::string& type, FieldType fieldType) {
-			_params.push_back(std::make_pair(type, fieldType));
-			return *this;
+		/**
+		 * @brief Only collects parameters that are appended to another statement later on
+		 * @sa append()
+		 */
+		PreparedStatement();
+
+		/**
+		 * @brief Adds all parameters of the given statement to this statement
+		 */
+		PreparedStatement& append(const PreparedStatement& other);
+
+		inline int params() const {
+			return (int)_params.size();
 		}
 
-		template<class Type>
-		PreparedStatement& add(const Type& type, FieldType fieldType) {
-			return add(std::to_string(type), fieldType);
-		}
+		PreparedStatement& add(const std::string& value, FieldType fieldType);
+		PreparedStatement& add(int32_t value);
+		PreparedStatement& add(int64_t value);
+		PreparedStatement& add(const Timestamp& value);
 
-		inline PreparedStatement& add(const std::string& type) {
-			return add(type, FieldType::STRING);
+		inline PreparedStatement& add(const std::string& value) {
+			return add(value, FieldType::STRING);
 		}
 
 		inline PreparedStatement& addPassword(const std::string& password) {
 			return add(password, FieldType::PASSWORD);
 		}
 
-		inline PreparedStatement& add(const char* type, FieldType fieldType) {
-			return add(std::string(type), FieldType::STRING);
-		}
-
-		inline PreparedStatement& add(const Timestamp& type) {
-			if (type.isNow()) {
-				return add("NOW()", FieldType::TIMESTAMP);
-			}
-			return add(type.time(), FieldType::TIMESTAMP);
+		inline PreparedStatement& add(const char* value) {
+			return add(std::string(value), FieldType::STRING);
 		}
 
 		State exec();
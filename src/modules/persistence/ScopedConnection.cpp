@@ -3,6 +3,9 @@
 namespace persistence {
 
 ScopedConnection::~ScopedConnection() {
+	if (_c == nullptr || !_close) {
+		return;
+	}
 	_c->close();
 }
 
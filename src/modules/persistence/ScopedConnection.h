@@ -4,14 +4,24 @@
 
 namespace persistence {
 
+/**
+ * @brief Gives the connection back to the pool once the scope is left
+ */
 class ScopedConnection {
 private:
 	Connection* _c;
+	bool _close;
 public:
-	ScopedConnection(Connection* c) :
-			_c(c) {
+	/**
+	 * @param[in] close @c false if the connection is owned by someone else - e.g. pinned by a transaction
+	 */
+	ScopedConnection(Connection* c, bool close = true) :
+			_c(c), _close(close) {
 	}
 
+	ScopedConnection(const ScopedConnection& other) = delete;
+	ScopedConnection& operator=(const ScopedConnection& other) = delete;
+
 	inline operator Connection*() {
 		return _c;
 	}
@@ -17,21 +17,42 @@ public:
 		core::Var::get(cfg::DatabaseHost, "localhost");
 		core::Var::get(cfg::DatabaseUser, "engine");
 		core::Var::get(cfg::DatabasePassword, "engine");
+		core::Var::get(cfg::DatabaseConnectionTimeout, "10");
 	}
 };
 
 TEST_F(ConnectionPoolTest, testConnectionPoolSize) {
-	ConnectionPool& pool = core::Singleton<ConnectionPool>::getInstance();
+	ConnectionPool& pool = ConnectionPool::get();
 	ASSERT_EQ(1, pool.init());
 	pool.shutdown();
 }
 
 TEST_F(ConnectionPoolTest, testConnectionPoolGetConnection) {
-	ConnectionPool& pool = core::Singleton<ConnectionPool>::getInstance();
+	ConnectionPool& pool = ConnectionPool::get();
 	ASSERT_EQ(1, pool.init());
 	Connection* c = pool.connection();
 	ASSERT_NE(nullptr, c);
+	c->close();
 	pool.shutdown();
 }
 
+TEST_F(ConnectionPoolTest, testConnectionPoolMaxConnections) {
+	ConnectionPool& pool = ConnectionPool::get();
+	ASSERT_EQ(1, pool.init());
+	Connection* c1 = pool.connection();
+	ASSERT_NE(nullptr, c1);
+	Connection* c2 = pool.connection();
+	ASSERT_NE(nullptr, c2);
+	EXPECT_EQ(2, pool.connectionAmount());
+	EXPECT_EQ(nullptr, pool.connection()) << "The max connections are in use - the timeout should have been hit";
+	c1->close();
+	Connection* c3 = pool.connection();
+	EXPECT_EQ(c1, c3) << "The connection that was given back should have been reused";
+	c2->close();
+	c3->close();
+	EXPECT_EQ(2, pool.connectionAmount());
+	pool.shutdown();
+	EXPECT_EQ(0, pool.connectionAmount());
+}
+
 }
@@ -0,0 +1,120 @@
+/**
+ * @file
+ */
+
+#include "core/tests/AbstractTest.h"
+#include "persistence/Executor.h"
+#include "persistence/ConnectionPool.h"
+
+namespace persistence {
+
+class ExecutorTest : public core::AbstractTest {
+protected:
+	class TestModel : public Model {
+	protected:
+		struct Members {
+			int64_t _id = 0l;
+			int32_t _value = 0;
+		};
+		Members _m;
+	public:
+		TestModel() : Model("executortest") {
+			_membersPointer = (uint8_t*)&_m;
+			_fields.push_back(Field{"id", FieldType::LONG, 0u, "", 0, offsetof(Members, _id)});
+			_fields.push_back(Field{"value", FieldType::INT, 0u, "", 0, offsetof(Members, _value)});
+		}
+
+		int32_t value(int64_t id) {
+			PreparedStatement p = prepare("ExecutorTestValue", "SELECT * FROM executortest WHERE id = $1");
+			p.add(id);
+			if (!p.exec().result) {
+				return -1;
+			}
+			return _m._value;
+		}
+	};
+
+	Executor _executor;
+public:
+	void SetUp() override {
+		core::AbstractTest::SetUp();
+		core::Var::get(cfg::DatabaseMinConnections, "1");
+		core::Var::get(cfg::DatabaseMaxConnections, "2");
+		core::Var::get(cfg::DatabaseName, "engine");
+		core::Var::get(cfg::DatabaseHost, "localhost");
+		core::Var::get(cfg::DatabaseUser, "engine");
+		core::Var::get(cfg::DatabasePassword, "engine");
+		core::Var::get(cfg::DatabaseThreads, "2");
+		ConnectionPool::get().init();
+		ASSERT_TRUE(_executor.init());
+	}
+
+	void TearDown() override {
+		_executor.shutdown();
+		ConnectionPool::get().shutdown();
+		core::AbstractTest::TearDown();
+	}
+};
+
+TEST_F(ExecutorTest, testSubmitFuture) {
+	std::future<int> result = _executor.submit([] () {
+		return 42;
+	});
+	EXPECT_EQ(42, result.get());
+}
+
+TEST_F(ExecutorTest, testSubmitCallback) {
+	std::atomic_bool executed(false);
+	int value = 0;
+	_executor.submit([&] () {
+		executed = true;
+		return 42;
+	}, [&] (int result) {
+		value = result;
+	});
+	while (!executed) {
+		std::this_thread::yield();
+	}
+	EXPECT_EQ(0, value) << "The callback should only be executed in the update call";
+	// the result is handed over after the job was executed
+	for (int i = 0; i < 1000 && value == 0; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		_executor.update(1ul);
+	}
+	EXPECT_EQ(42, value);
+}
+
+TEST_F(ExecutorTest, testBatchedWrites) {
+	ASSERT_TRUE(TestModel().exec("CREATE TABLE IF NOT EXISTS executortest (id BIGINT PRIMARY KEY, value INT NOT NULL);"));
+	ASSERT_TRUE(TestModel().exec("TRUNCATE TABLE executortest;"));
+	ASSERT_TRUE(_executor.registerBatch("executortest", {"id", "value"}, "id"));
+	EXPECT_FALSE(_executor.write("executortest", 1, std::move(Model::PreparedStatement().add((int64_t)1))))
+		<< "The amount of values doesn't match the columns";
+
+	for (int64_t id = 1; id <= Executor::MaxBatchRows + 1; ++id) {
+		ASSERT_TRUE(_executor.write("executortest", id, std::move(Model::PreparedStatement().add(id).add((int32_t)1))));
+	}
+	// replaces the queued row for the same key
+	ASSERT_TRUE(_executor.write("executortest", 2, std::move(Model::PreparedStatement().add((int64_t)2).add((int32_t)2))));
+	// the executor must write everything on shutdown
+	_executor.shutdown();
+	EXPECT_EQ(0, _executor.pendingWrites());
+
+	TestModel model;
+	EXPECT_EQ(1, model.value(1));
+	EXPECT_EQ(2, model.value(2));
+	EXPECT_EQ(1, model.value(Executor::MaxBatchRows + 1));
+}
+
+TEST_F(ExecutorTest, testFailedBatchWritesAreKept) {
+	ASSERT_TRUE(TestModel().exec("DROP TABLE IF EXISTS executortestmissing;"));
+	ASSERT_TRUE(_executor.registerBatch("executortestmissing", {"id", "value"}, "id"));
+	for (int64_t id = 1; id <= 3; ++id) {
+		ASSERT_TRUE(_executor.write("executortestmissing", id, std::move(Model::PreparedStatement().add(id).add((int32_t)1))));
+	}
+	// the table doesn't exist - the rows are kept for the next flush
+	EXPECT_EQ(3, _executor.shutdown());
+	EXPECT_EQ(3, _executor.pendingWrites());
+}
+
+}
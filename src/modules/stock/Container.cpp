@@ -13,6 +13,15 @@ void Container::init(const ContainerShape& shape) {
 	_items.reserve(64);
 }
 
+void Container::clear() {
+	for (const ContainerItem& ci : _items) {
+		_shape.removeShape(static_cast<ItemShapeType>(ci.item->shape()), ci.x, ci.y);
+	}
+	_items.clear();
+	_itemsById.clear();
+	std::fill(std::begin(_typeCount), std::end(_typeCount), 0);
+}
+
 bool Container::canAdd(const Item* item, uint8_t x, uint8_t y) const {
 	if (item == nullptr) {
 		return false;
@@ -44,16 +53,95 @@ bool Container::add(Item* item) {
 	return add(item, x, y);
 }
 
-auto Container::findById(ItemId id) const {
-	return std::find_if(_items.begin(), _items.end(), [id] (const ContainerItem& item) { return item.item->id() == id; });
+int Container::add(const std::vector<Item*>& items, std::vector<Item*>& failed) {
+	std::vector<Item*> sorted;
+	sorted.reserve(items.size());
+	for (Item* item : items) {
+		if (item == nullptr) {
+			continue;
+		}
+		sorted.push_back(item);
+	}
+	// the biggest items first - items with the same shape next to each other
+	std::stable_sort(sorted.begin(), sorted.end(), [] (const Item* a, const Item* b) {
+		const int sizeA = a->shape().size();
+		const int sizeB = b->shape().size();
+		if (sizeA != sizeB) {
+			return sizeA > sizeB;
+		}
+		return static_cast<ItemShapeType>(a->shape()) < static_cast<ItemShapeType>(b->shape());
+	});
+
+	int added = 0;
+	ItemShapeType lastShape = (ItemShapeType)0;
+	bool full = false;
+	uint8_t x = 0u;
+	uint8_t y = 0u;
+	for (Item* item : sorted) {
+		if (_flags != 0u) {
+			if (add(item)) {
+				++added;
+			} else {
+				failed.push_back(item);
+			}
+			continue;
+		}
+		const ItemShapeType shape = static_cast<ItemShapeType>(item->shape());
+		if (shape != lastShape) {
+			lastShape = shape;
+			full = false;
+			x = y = 0u;
+		}
+		// the space in front of the previously placed item of the same shape
+		// was already searched - it can't fit there now
+		if (full || !_shape.findFree(item->shape(), x, y)) {
+			full = true;
+			failed.push_back(item);
+			continue;
+		}
+		add(item, x, y);
+		++added;
+	}
+	return added;
 }
 
-auto Container::findByType(const ItemType& type) const {
-	return std::find_if(_items.begin(), _items.end(), [type] (const ContainerItem& item) { return item.item->type() == type; });
+int Container::find(const Item* item) const {
+	auto range = _itemsById.equal_range(item->id());
+	if (range.first == range.second) {
+		return -1;
+	}
+	for (auto i = range.first; i != range.second; ++i) {
+		if (_items[i->second].item == item) {
+			return i->second;
+		}
+	}
+	return range.first->second;
 }
 
-bool Container::hasItemOfType(const ItemType& itemType) const {
-	return findByType(itemType) != _items.end();
+void Container::erase(int index) {
+	const ContainerItem& ci = _items[index];
+	auto range = _itemsById.equal_range(ci.item->id());
+	for (auto i = range.first; i != range.second; ++i) {
+		if (i->second == index) {
+			_itemsById.erase(i);
+			break;
+		}
+	}
+	--_typeCount[std::enum_value(ci.item->type())];
+
+	const int last = (int)_items.size() - 1;
+	if (index != last) {
+		// move the last item into the gap and fix its index
+		_items[index] = _items[last];
+		range = _itemsById.equal_range(_items[index].item->id());
+		for (auto i = range.first; i != range.second; ++i) {
+			if (i->second == last) {
+				i->second = index;
+				break;
+			}
+		}
+	}
+	_items.pop_back();
 }
 
 bool Container::add(Item* item, uint8_t x, uint8_t y) {
@@ -61,19 +149,21 @@ bool Container::add(Item* item, uint8_t x, uint8_t y) {
 		return false;
 	}
 	const ContainerItem ci = {item, x, y};
+	_itemsById.emplace(item->id(), (int)_items.size());
+	++_typeCount[std::enum_value(item->type())];
 	_items.push_back(ci);
 	_shape.addShape(static_cast<ItemShapeType>(item->shape()), x, y);
 	return true;
 }
 
 bool Container::notifyRemove(Item* item) {
-	const ItemId id = item->id();
-	auto i = findById(id);
-	if (i == _items.end()) {
+	const int index = find(item);
+	if (index == -1) {
 		return false;
 	}
-	_shape.removeShape(static_cast<ItemShapeType>(item->shape()), i->x, i->y);
-	_items.erase(i);
+	const ContainerItem& ci = _items[index];
+	_shape.removeShape(static_cast<ItemShapeType>(ci.item->shape()), ci.x, ci.y);
+	erase(index);
 	return true;
 }
 
@@ -98,9 +188,17 @@ Item* Container::get(uint8_t x, uint8_t y) const {
 		}
 		return _items.front().item;
 	}
+	if ((_flags & Scrollable) == 0 && _shape.isFree(x, y)) {
+		return nullptr;
+	}
 	for (const ContainerItem& item : _items) {
+		const int dx = x - item.x;
+		const int dy = y - item.y;
+		if (dx < 0 || dy < 0 || dx >= ItemMaxWidth || dy >= ItemMaxHeight) {
+			continue;
+		}
 		const ItemShape& shape = item.item->shape();
-		if (shape.isInShape(x - item.x, y - y)) {
+		if (shape.isInShape(dx, dy)) {
 			return item.item;
 		}
 	}
@@ -108,6 +206,9 @@ Item* Container::get(uint8_t x, uint8_t y) const {
 }
 
 bool Container::findSpace(const Item* item, uint8_t& targetX, uint8_t& targetY) const {
+	if (item == nullptr) {
+		return false;
+	}
 	// always fits into scrollable container
 	if ((_flags & Scrollable) != 0) {
 		targetX = targetY = 0u;
@@ -118,18 +219,17 @@ bool Container::findSpace(const Item* item, uint8_t& targetX, uint8_t& targetY)
 	if ((_flags & Single) != 0 && !_items.empty()) {
 		return false;
 	}
-	for (uint8_t y = 0; y < ContainerMaxHeight; ++y) {
-		for (uint8_t x = 0; x < ContainerMaxWidth; ++x) {
-			if (!canAdd(item, x, y)) {
-				continue;
-			}
-			targetX = x;
-			targetY = y;
-			return true;
-		}
+	if ((_flags & Unique) != 0 && hasItemOfType(item->type())) {
+		return false;
 	}
-
-	return false;
+	uint8_t x = 0u;
+	uint8_t y = 0u;
+	if (!_shape.findFree(item->shape(), x, y)) {
+		return false;
+	}
+	targetX = x;
+	targetY = y;
+	return true;
 }
 
 }
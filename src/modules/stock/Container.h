@@ -6,6 +6,8 @@
 
 #include "Shape.h"
 #include "ItemData.h"
+#include <unordered_map>
+#include <vector>
 
 namespace stock {
 
@@ -44,6 +46,13 @@ public:
 
 	bool add(Item* item);
 
+	/**
+	 * @brief Packs the given items into the container in one pass - the biggest items first
+	 * @param[out] failed The items that didn't fit into the container
+	 * @return The amount of added items
+	 */
+	int add(const std::vector<Item*>& items, std::vector<Item*>& failed);
+
 	bool notifyRemove(Item* item);
 
 	Item* remove(uint8_t x, uint8_t y);
@@ -54,9 +63,13 @@ public:
 
 	int free() const;
 private:
-	auto findById(ItemId id) const;
+	/**
+	 * @return The index in @c _items or @c -1 if the item isn't part of this container. Another
+	 * item with the same id is taken if the given instance isn't found.
+	 */
+	int find(const Item* item) const;
 
-	auto findByType(const ItemType& type) const;
+	void erase(int index);
 
 	/** each item can only be in here once */
 	static constexpr uint32_t Unique     = 1 << 0;
@@ -68,6 +81,10 @@ private:
 	ContainerShape _shape;
 	uint32_t _flags = 0u;
 	ContainerItems _items;
+	/** the indices into @c _items by item id */
+	std::unordered_multimap<ItemId, int> _itemsById;
+	/** the amount of items per type */
+	int _typeCount[std::enum_value(ItemType::MAX) + 1] {};
 };
 
 inline int Container::size() const {
@@ -78,14 +95,14 @@ inline int Container::free() const {
 	return _shape.free();
 }
 
-inline void Container::clear() {
-	_items.clear();
-}
-
 inline size_t Container::itemCount() const {
 	return items().size();
 }
 
+inline bool Container::hasItemOfType(const ItemType& itemType) const {
+	return _typeCount[std::enum_value(itemType)] > 0;
+}
+
 inline const Container::ContainerItems& Container::items() const {
 	return _items;
 }
@@ -16,6 +16,7 @@ void ContainerShape::addRect(uint8_t x, uint8_t y, uint8_t width, uint8_t height
 	const ContainerShapeType row = (((ItemShapeType)1 << width) - 1) << x;
 	for (height += y; y < height; ++y) {
 		_containerShape[y] |= row;
+		updateFreeRow(y);
 	}
 }
 
@@ -23,15 +24,7 @@ bool ContainerShape::isFree(uint8_t x, uint8_t y) const {
 	if (!isInShape(x, y)) {
 		return false;
 	}
-
-	const ContainerShapeType itemRow = ((ContainerShapeType)1) & ItemRowLength;
-	const ContainerShapeType itemShapeTranslated = itemRow << x;
-	if ((itemShapeTranslated & _itemShape[y]) != (ContainerShapeType)0) {
-		return false;
-	}
-
-	return true;
-
+	return (freeCells(y) & ((ContainerShapeType)1 << x)) != (ContainerShapeType)0;
 }
 
 bool ContainerShape::isFree(const ItemShape& itemShape, uint8_t x, uint8_t y) const {
@@ -40,8 +33,7 @@ bool ContainerShape::isFree(const ItemShape& itemShape, uint8_t x, uint8_t y) co
 	}
 
 	const ItemShapeType shape = static_cast<ItemShapeType>(itemShape);
-	const uint8_t height = itemShape.height();
-	for (uint8_t row = 0; row < height; ++row) {
+	for (uint8_t row = 0; row < ItemMaxHeight; ++row) {
 		/* Result has to be limited to ContainerBitsPerRow - theoretically the ItemShapeType
 		 * can be smaller than the ContainerShapeType - so use the potentially larger one
 		 * here. */
@@ -49,6 +41,9 @@ bool ContainerShape::isFree(const ItemShape& itemShape, uint8_t x, uint8_t y) co
 		if (itemRow == (ContainerShapeType)0) {
 			continue;
 		}
+		if (y + row >= ContainerMaxHeight) {
+			return false;
+		}
 		const ContainerShapeType itemShapeTranslated = itemRow << x;
 
 		/* Check if shifting back is out of bounds - that means the item shape is out
@@ -57,32 +52,67 @@ bool ContainerShape::isFree(const ItemShape& itemShape, uint8_t x, uint8_t y) co
 			return false;
 		}
 
-		if (y + row >= ContainerMaxHeight && itemRow > 0) {
+		if ((itemShapeTranslated & ~freeCells(y + row)) != (ContainerShapeType)0) {
 			return false;
 		}
+	}
 
-		if ((itemShapeTranslated & ~_containerShape[y + row]) != (ContainerShapeType)0) {
-			return false;
+	return true;
+}
+
+bool ContainerShape::findFree(const ItemShape& itemShape, uint8_t& x, uint8_t& y) const {
+	if (y >= ContainerMaxHeight || x >= ContainerMaxWidth) {
+		return false;
+	}
+	const ItemShapeType shape = static_cast<ItemShapeType>(itemShape);
+	if (bitCount(shape) > free()) {
+		return false;
+	}
+
+	ContainerShapeType itemRows[ItemMaxHeight];
+	// only rows that have free cells for each row of the item are candidates
+	uint32_t candidates = ~((1u << y) - 1u);
+	for (uint8_t row = 0; row < ItemMaxHeight; ++row) {
+		itemRows[row] = (shape >> (row * ItemMaxWidth)) & ItemRowLength;
+		if (itemRows[row] != (ContainerShapeType)0) {
+			candidates &= _freeRows >> row;
 		}
+	}
 
-		if ((itemShapeTranslated & _itemShape[y + row]) != (ContainerShapeType)0) {
-			return false;
+	while (candidates != 0u) {
+		const int candidateY = lowestBit(candidates);
+		candidates &= candidates - 1u;
+		// each bit is one possible x position - the position itself must be part of the container
+		ContainerShapeType fits = _containerShape[candidateY];
+		if (candidateY == y) {
+			fits &= ~(((ContainerShapeType)1 << x) - 1);
+		}
+		for (int row = 0; row < ItemMaxHeight && fits != (ContainerShapeType)0; ++row) {
+			ContainerShapeType itemRow = itemRows[row];
+			if (itemRow == (ContainerShapeType)0) {
+				continue;
+			}
+			const ContainerShapeType free = freeCells(candidateY + row);
+			// every cell of the item row needs a free cell at the same offset
+			while (itemRow != (ContainerShapeType)0) {
+				fits &= free >> lowestBit(itemRow);
+				itemRow &= itemRow - 1;
+			}
+		}
+		if (fits != (ContainerShapeType)0) {
+			x = (uint8_t)lowestBit(fits);
+			y = (uint8_t)candidateY;
+			return true;
 		}
 	}
 
-	return true;
+	return false;
 }
 
 int ContainerShape::free() const {
 	int bitCounter = 0;
 	for (int row = 0; row < ContainerMaxHeight; ++row) {
-		for (uint8_t i = 0; i < ContainerBitsPerRow; ++i) {
-			if ((_containerShape[row] & ((ItemShapeType)1 << i)) != 0) {
-				if ((_itemShape[row] & ((ItemShapeType)1 << i)) == 0) {
-					++bitCounter;
-				}
-			}
-		}
+		bitCounter += bitCount(freeCells(row));
 	}
 	return bitCounter;
 }
@@ -90,28 +120,26 @@ int ContainerShape::free() const {
 int ContainerShape::size() const {
 	int bitCounter = 0;
 	for (int row = 0; row < ContainerMaxHeight; ++row) {
-		for (uint8_t i = 0; i < ContainerBitsPerRow; ++i) {
-			if ((_containerShape[row] & ((ItemShapeType)1 << i)) != 0) {
-				++bitCounter;
-			}
-		}
+		bitCounter += bitCount(_containerShape[row]);
 	}
 	return bitCounter;
 }
 
 void ContainerShape::addShape(ItemShapeType shape, uint8_t x, uint8_t y) {
 	core_assert(isInShape(x, y));
-	core_assert_always(y < ContainerMaxHeight && y < ContainerMaxWidth);
+	core_assert_always(y < ContainerMaxHeight && x < ContainerMaxWidth);
 	for (uint8_t row = 0; row < ItemMaxHeight && y + row < ContainerMaxHeight; ++row) {
 		_itemShape[y + row] |= ((shape >> row * ItemMaxWidth) & ItemRowLength) << x;
+		updateFreeRow(y + row);
 	}
 }
 
 void ContainerShape::removeShape(ItemShapeType shape, uint8_t x, uint8_t y) {
 	core_assert(isInShape(x, y));
-	core_assert_always(y < ContainerMaxHeight && y < ContainerMaxWidth);
+	core_assert_always(y < ContainerMaxHeight && x < ContainerMaxWidth);
 	for (uint8_t row = 0; row < ItemMaxHeight && y + row < ContainerMaxHeight; ++row) {
-		_itemShape[y + row] &= ~((shape >> row * ItemMaxWidth) & ItemRowLength) << x;
+		_itemShape[y + row] &= ~(((shape >> row * ItemMaxWidth) & ItemRowLength) << x);
+		updateFreeRow(y + row);
 	}
 }
 
@@ -129,13 +157,7 @@ ItemShapeType ItemShape::set(uint8_t x, uint8_t y) {
 }
 
 int ItemShape::size() const {
-	int bitCounter = 0;
-	for (uint8_t i = 0; i < ItemBits; ++i) {
-		if ((_shape & ((ItemShapeType)1 << i)) != 0) {
-			++bitCounter;
-		}
-	}
-	return bitCounter;
+	return bitCount(_shape);
 }
 
 static inline constexpr uint64_t calcItemShapeHeightMask() {
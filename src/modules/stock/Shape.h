@@ -6,6 +6,9 @@
 
 #include "core/Common.h"
 #include "core/GLM.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace stock {
 
@@ -22,6 +25,28 @@ static constexpr uint8_t ItemMaxHeight = 8;
 static constexpr uint8_t ItemMaxWidth = 8;
 static constexpr ItemShapeType ItemRowLength = 0xff; /* ItemMaxWidth bits */
 static_assert(ItemMaxWidth * ItemMaxHeight <= ItemBits, "width and height doesn't fit into the shapetype");
+static_assert(ContainerMaxHeight <= 32, "the free row summary doesn't fit into 32 bits");
+
+inline int bitCount(uint64_t bits) {
+#ifdef _MSC_VER
+	return (int)__popcnt64(bits);
+#else
+	return __builtin_popcountll(bits);
+#endif
+}
+
+/**
+ * @return The index of the lowest set bit - @c bits may not be @c 0
+ */
+inline int lowestBit(uint64_t bits) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return (int)index;
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
 
 /**
  * @ingroup Stock
@@ -71,12 +96,20 @@ inline ItemShape::operator ItemShapeType() const {
 }
 
 /**
+ * @brief The shape of a container and the cells that are occupied by items - one bitboard row per container row.
+ *
+ * A summary of the rows that still have free cells allows to skip full rows when searching space for an item.
  * @ingroup Stock
  */
 class ContainerShape {
 private:
 	ContainerShapeType _containerShape[ContainerMaxHeight];
 	ContainerShapeType _itemShape[ContainerMaxHeight];
+	/** bit n is set if row n has free cells */
+	uint32_t _freeRows = 0u;
+
+	ContainerShapeType freeCells(int row) const;
+	void updateFreeRow(int row);
 public:
 	ContainerShape();
 
@@ -103,11 +136,31 @@ public:
 
 	bool isFree(uint8_t x, uint8_t y) const;
 
+	/**
+	 * @brief Searches the first position (row by row) the given shape fits at. All positions of a row are tested at once.
+	 * @param[in,out] x The column to start the search at in the start row - the column of the found position
+	 * @param[in,out] y The row to start the search at - the row of the found position
+	 * @return @c false if there is no space for the shape
+	 */
+	bool findFree(const ItemShape& shape, uint8_t& x, uint8_t& y) const;
+
 	int free() const;
 
 	int size() const;
 };
 
+inline ContainerShapeType ContainerShape::freeCells(int row) const {
+	return _containerShape[row] & ~_itemShape[row];
+}
+
+inline void ContainerShape::updateFreeRow(int row) {
+	if (freeCells(row) != (ContainerShapeType)0) {
+		_freeRows |= 1u << row;
+	} else {
+		_freeRows &= ~(1u << row);
+	}
+}
+
 inline bool ContainerShape::isInShape(uint8_t x, uint8_t y) const {
 	core_assert_always(y < ContainerMaxHeight && x < ContainerMaxWidth);
 	return (_containerShape[y] & ((ContainerShapeType)1 << x)) != 0;
@@ -20,26 +20,34 @@ void Stock::init(const std::vector<Item*>& items) {
 int Stock::add(Item* item) {
 	// TODO: max stock count check
 	Log::debug("Add item %s", item->data().name());
-	_items.push_back(item);
+	_items.emplace(item->id(), item);
+	++_typeCount[std::enum_value(item->type())];
 	return 1;
 }
 
 int Stock::remove(Item* item) {
-	auto i = find(item->id());
-	if (i == _items.end()) {
+	auto range = _items.equal_range(item->id());
+	if (range.first == range.second) {
 		return 0;
 	}
+	auto i = std::find_if(range.first, range.second, [item] (const Items::value_type& e) {
+		return e.second == item;
+	});
+	if (i == range.second) {
+		i = range.first;
+	}
+	--_typeCount[std::enum_value(i->second->type())];
 	_items.erase(i);
 	_inventory.notifyRemove(item);
 	return 1;
 }
 
 int Stock::count(const ItemType& itemType) const {
-	return std::count(_items.begin(), _items.end(), itemType);
+	return _typeCount[std::enum_value(itemType)];
 }
 
 int Stock::count(ItemId itemId) const {
-	return std::count_if(_items.begin(), _items.end(), [=] (const Item* item) {return item->id() == itemId;});
+	return (int)_items.count(itemId);
 }
 
 }
@@ -6,6 +6,7 @@
 
 #include "Item.h"
 #include "Inventory.h"
+#include <unordered_map>
 #include <vector>
 
 namespace stock {
@@ -20,22 +21,13 @@ namespace stock {
  */
 class Stock {
 private:
-	/** All the items this instance can deal with */
-	std::vector<Item*> _items;
+	typedef std::unordered_multimap<ItemId, Item*> Items;
+	/** All the items this instance can deal with - by their id */
+	Items _items;
+	/** The amount of items per type */
+	int _typeCount[std::enum_value(ItemType::MAX) + 1] {};
 	/** The inventory has pointers to all the items distributed over all the Container instances in the Inventory. */
 	Inventory _inventory;
-
-	inline auto find(const ItemId& itemId) const {
-		return std::find_if(_items.begin(), _items.end(), [itemId] (const Item* item) {
-			return item->id() == itemId;
-		});
-	}
-
-	inline auto find(const ItemId& itemId) {
-		return std::find_if(_items.begin(), _items.end(), [itemId] (const Item* item) {
-			return item->id() == itemId;
-		});
-	}
 public:
 	Stock();
 
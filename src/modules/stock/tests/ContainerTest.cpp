@@ -13,17 +13,66 @@ class ContainerTest: public AbstractStockTest {
 TEST_F(ContainerTest, testAddAndRemove) {
 	Container c;
 	ContainerShape shape;
-	shape.addRect(0, 1, 1, 1);
+	shape.addRect(0, 1, 1, 2);
 	c.init(shape);
 	ASSERT_FALSE(c.add(_item1, 0, 0));
+	ASSERT_FALSE(c.add(_item1, 0, 2)) << "The item is two cells high";
 	ASSERT_TRUE(c.add(_item1, 0, 1));
 	ASSERT_FALSE(c.add(_item2, 0, 0));
 	ASSERT_FALSE(c.add(_item2, 0, 1));
-	ASSERT_EQ(_item1, c.remove(0, 1));
-	ASSERT_EQ(1, c.free());
+	ASSERT_FALSE(c.add(_item2, 0, 2));
+	ASSERT_EQ(_item1, c.remove(0, 2));
+	ASSERT_EQ(2, c.free());
 	ASSERT_TRUE(c.add(_item2, 0, 1));
-	ASSERT_EQ(1, c.size());
-	ASSERT_EQ(0, c.free());
+	ASSERT_EQ(2, c.size());
+	ASSERT_EQ(1, c.free());
+}
+
+TEST_F(ContainerTest, testFindSpace) {
+	Container c;
+	ContainerShape shape;
+	shape.addRect(0, 0, 3, 2);
+	c.init(shape);
+	ASSERT_TRUE(c.add(_item2, 0, 0));
+	uint8_t x;
+	uint8_t y;
+	ASSERT_TRUE(c.findSpace(_item1, x, y));
+	EXPECT_EQ(1, x);
+	EXPECT_EQ(0, y);
+	ASSERT_TRUE(c.add(_item1));
+	EXPECT_EQ(_item1, c.get(1, 1));
+	EXPECT_EQ(nullptr, c.get(0, 1));
+	EXPECT_EQ(3, c.free());
+}
+
+TEST_F(ContainerTest, testAddBatch) {
+	Container c;
+	ContainerShape shape;
+	shape.addRect(0, 0, 2, 2);
+	c.init(shape);
+	std::vector<Item*> items;
+	for (int i = 0; i < 3; ++i) {
+		items.push_back(_provider.createItem(_itemData2->id()));
+	}
+	items.push_back(_provider.createItem(_itemData1->id()));
+	std::vector<Item*> failed;
+	// the big item is placed first - so one of the small ones doesn't fit
+	EXPECT_EQ(3, c.add(items, failed));
+	ASSERT_EQ(1u, failed.size());
+	EXPECT_EQ(_itemData2->id(), failed.front()->id());
+	EXPECT_EQ(0, c.free());
+	EXPECT_EQ(items.back(), c.get(0, 1));
+	EXPECT_TRUE(c.hasItemOfType(ItemType::WEAPON));
+
+	EXPECT_TRUE(c.notifyRemove(items[1]));
+	EXPECT_TRUE(c.notifyRemove(failed.front())) << "Another item with the same id should have been removed";
+	EXPECT_EQ(2, c.free());
+	c.clear();
+	EXPECT_EQ(4, c.free());
+	EXPECT_FALSE(c.hasItemOfType(ItemType::WEAPON));
+	for (Item* item : items) {
+		delete item;
+	}
 }
 
 }
@@ -90,4 +90,46 @@ TEST_F(ShapeTest, testContainerShape) {
 	ASSERT_TRUE(containerShape.isFree(itemShape, 0, 0));
 }
 
+TEST_F(ShapeTest, testContainerShapeFindFree) {
+	ContainerShape containerShape;
+	containerShape.addRect(0, 0, 4, 3);
+	containerShape.addShape((ItemShapeType)1, 1, 0);
+	ItemShape itemShape;
+	itemShape.addRect(0, 0, 2, 2);
+	uint8_t x = 0u;
+	uint8_t y = 0u;
+	ASSERT_TRUE(containerShape.findFree(itemShape, x, y));
+	EXPECT_EQ(2, x);
+	EXPECT_EQ(0, y);
+	containerShape.addShape(static_cast<ItemShapeType>(itemShape), x, y);
+	// continue the search behind the last position
+	ASSERT_TRUE(containerShape.findFree(itemShape, x, y));
+	EXPECT_EQ(0, x);
+	EXPECT_EQ(1, y);
+	containerShape.addShape(static_cast<ItemShapeType>(itemShape), x, y);
+	x = y = 0u;
+	EXPECT_FALSE(containerShape.findFree(itemShape, x, y));
+	EXPECT_EQ(3, containerShape.free());
+}
+
+TEST_F(ShapeTest, testContainerShapeRemoveKeepsNeighbours) {
+	ContainerShape containerShape;
+	containerShape.addRect(0, 0, 3, 1);
+	containerShape.addShape((ItemShapeType)1, 0, 0);
+	containerShape.addShape((ItemShapeType)1, 1, 0);
+	containerShape.removeShape((ItemShapeType)1, 1, 0);
+	EXPECT_FALSE(containerShape.isFree(0, 0));
+	EXPECT_TRUE(containerShape.isFree(1, 0));
+	EXPECT_EQ(2, containerShape.free());
+}
+
+TEST_F(ShapeTest, testContainerShapeIsFreeChecksAllRows) {
+	ContainerShape containerShape;
+	containerShape.addRect(0, 0, 1, 2);
+	containerShape.addShape((ItemShapeType)1, 0, 1);
+	ItemShape itemShape;
+	itemShape.addRect(0, 0, 1, 2);
+	EXPECT_FALSE(containerShape.isFree(itemShape, 0, 0));
+}
+
 }
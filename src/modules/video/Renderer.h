@@ -208,6 +208,13 @@ extern bool isOcclusionQueryAvailable(Id id);
  * or if no result is available yet - this call does not block the gpu
  */
 extern int getOcclusionQueryResult(Id id, bool wait = false);
+/**
+ * @brief The following draw calls are discarded by the gpu if the given occlusion query didn't pass any samples
+ * @param[in] wait If @c false and the result of the query is not yet available, the draw calls are executed
+ * @sa endConditionalRender()
+ */
+extern bool beginConditionalRender(Id id, bool wait = false);
+extern bool endConditionalRender();
 /**
  * Binds a new frame buffer
  * @param mode The FrameBufferMode to bind the frame buffer with
@@ -232,6 +239,14 @@ extern void uploadTexture(video::TextureType type, video::TextureFormat format,
 extern void drawElements(Primitive mode, size_t numIndices, DataType type, void* offset = nullptr);
 extern void drawElementsInstanced(Primitive mode, size_t numIndices, DataType type, size_t amount);
 extern void drawElementsBaseVertex(Primitive mode, size_t numIndices, DataType type, size_t indexSize, int baseIndex, int baseVertex);
+/**
+ * @brief Renders several index ranges of the bound buffers with one call
+ * @param[in] numIndices The amount of indices for each draw
+ * @param[in] indexOffsets The byte offsets into the index buffer for each draw
+ * @param[in] baseVertices The value that is added to each index of the draw
+ * @param[in] amount The amount of draws
+ */
+extern void multiDrawElementsBaseVertex(Primitive mode, const int32_t* numIndices, DataType type, const intptr_t* indexOffsets, const int32_t* baseVertices, int amount);
 extern void drawArrays(Primitive mode, size_t count);
 extern void disableDebug();
 extern bool hasFeature(Feature feature);
@@ -257,6 +272,11 @@ inline void drawElementsBaseVertex(Primitive mode, size_t numIndices, int baseIn
 	drawElementsBaseVertex(mode, numIndices, mapType<IndexType>(), sizeof(IndexType), baseIndex, baseVertex);
 }
 
+template<class IndexType>
+inline void multiDrawElementsBaseVertex(Primitive mode, const int32_t* numIndices, const intptr_t* indexOffsets, const int32_t* baseVertices, int amount) {
+	multiDrawElementsBaseVertex(mode, numIndices, mapType<IndexType>(), indexOffsets, baseVertices, amount);
+}
+
 inline bool hasFeature(Feature f) {
 	return renderState().features[std::enum_value(f)];
 }
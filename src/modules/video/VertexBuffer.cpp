@@ -130,6 +130,40 @@ bool VertexBuffer::update(int32_t idx, const void* data, size_t size) {
 	return true;
 }
 
+bool VertexBuffer::update(int32_t idx, size_t offset, const void* data, size_t size) {
+	if (!isValid(idx)) {
+		return false;
+	}
+	if (offset + size > _size[idx]) {
+		Log::error("Buffer range %i:%i exceeds the buffer size %i", (int)offset, (int)size, (int)_size[idx]);
+		return false;
+	}
+	if (size == 0u) {
+		return true;
+	}
+
+	core_assert(video::boundVertexArray() == InvalidId);
+	const VertexBufferType type = _targets[idx];
+	video::bindBuffer(type, _handles[idx]);
+	video::bufferSubData(type, (intptr_t)offset, data, size);
+	video::unbindBuffer(type);
+	return true;
+}
+
+bool VertexBuffer::reserve(int32_t idx, size_t size) {
+	if (!isValid(idx)) {
+		return false;
+	}
+
+	core_assert(video::boundVertexArray() == InvalidId);
+	const VertexBufferType type = _targets[idx];
+	video::bindBuffer(type, _handles[idx]);
+	video::bufferData(type, _mode, nullptr, size);
+	video::unbindBuffer(type);
+	_size[idx] = size;
+	return true;
+}
+
 int32_t VertexBuffer::create(const void* data, size_t size, VertexBufferType target) {
 	// we already have a buffer
 	if (_handleIdx >= (int)SDL_arraysize(_handles)) {
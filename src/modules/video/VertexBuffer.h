@@ -72,6 +72,15 @@ public:
 	void unmapData(int32_t idx) const;
 
 	bool update(int32_t idx, const void* data, size_t size);
+	/**
+	 * @brief Updates a part of the buffer without touching the rest of the data
+	 * @note The range must be inside of the size that was given to reserve(), create() or update()
+	 */
+	bool update(int32_t idx, size_t offset, const void* data, size_t size);
+	/**
+	 * @brief Allocates the given size on the gpu - the previous content of the buffer is lost
+	 */
+	bool reserve(int32_t idx, size_t size);
 
 	/**
 	 * @return -1 on error - otherwise the index [0,n) of the created buffer (not the Id)
@@ -722,6 +722,21 @@ bool endOcclusionQuery(Id id) {
 	return true;
 }
 
+bool beginConditionalRender(Id id, bool wait) {
+	if (id == InvalidId) {
+		return false;
+	}
+	glBeginConditionalRender(id, wait ? GL_QUERY_WAIT : GL_QUERY_NO_WAIT);
+	checkError();
+	return true;
+}
+
+bool endConditionalRender() {
+	glEndConditionalRender();
+	checkError();
+	return true;
+}
+
 // TODO: cache this per id per frame - or just the last queried id?
 bool isOcclusionQueryAvailable(Id id) {
 	if (id == InvalidId) {
@@ -912,6 +927,19 @@ void drawElementsBaseVertex(Primitive mode, size_t numIndices, DataType type, si
 	checkError();
 }
 
+void multiDrawElementsBaseVertex(Primitive mode, const int32_t* numIndices, DataType type, const intptr_t* indexOffsets, const int32_t* baseVertices, int amount) {
+	if (amount <= 0) {
+		return;
+	}
+	static_assert(sizeof(GLsizei) == sizeof(int32_t), "Unexpected size of GLsizei");
+	static_assert(sizeof(GLint) == sizeof(int32_t), "Unexpected size of GLint");
+	static_assert(sizeof(intptr_t) == sizeof(void*), "Unexpected size of intptr_t");
+	const GLenum glMode = _priv::Primitives[std::enum_value(mode)];
+	const GLenum glType = _priv::DataTypes[std::enum_value(type)];
+	glMultiDrawElementsBaseVertex(glMode, (const GLsizei*)numIndices, glType, (const void* const*)indexOffsets, (GLsizei)amount, (const GLint*)baseVertices);
+	checkError();
+}
+
 void drawArrays(Primitive mode, size_t count) {
 	const GLenum glMode = _priv::Primitives[std::enum_value(mode)];
 	glDrawArrays(glMode, (GLint)0, (GLsizei)count);
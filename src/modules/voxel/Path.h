@@ -0,0 +1,72 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "core/GLM.h"
+#include <atomic>
+#include <list>
+#include <memory>
+
+namespace voxel {
+
+class World;
+
+/**
+ * @brief Handle of an asynchronous path search - see @c World::requestPath()
+ *
+ * Identical requests share the same handle. Once the state is @c Found, the
+ * result doesn't change anymore and may be read from any thread.
+ */
+class Path {
+	friend class World;
+public:
+	enum class State : uint8_t {
+		Pending, Found, Failed, Cancelled
+	};
+
+	Path(const glm::ivec3& start, const glm::ivec3& end) :
+			_start(start), _end(end) {
+	}
+
+	inline State state() const {
+		return _state;
+	}
+
+	/**
+	 * @return @c true if the search is no longer pending
+	 */
+	inline bool done() const {
+		return _state != State::Pending;
+	}
+
+	inline const glm::ivec3& start() const {
+		return _start;
+	}
+
+	inline const glm::ivec3& end() const {
+		return _end;
+	}
+
+	/**
+	 * @note Only valid if the state is @c Found
+	 */
+	inline const std::list<glm::ivec3>& result() const {
+		return _result;
+	}
+
+private:
+	const glm::ivec3 _start;
+	const glm::ivec3 _end;
+	std::atomic<State> _state { State::Pending };
+	// the amount of entities that wait for this search - guarded by the world
+	int _requesters = 1;
+	// the path generation of the world when the search was requested - guarded by the world
+	uint32_t _generation = 0u;
+	std::list<glm::ivec3> _result;
+};
+
+typedef std::shared_ptr<Path> PathPtr;
+
+}
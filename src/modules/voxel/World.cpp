@@ -10,7 +10,6 @@
 #include "io/File.h"
 #include "core/Random.h"
 #include "core/Concurrency.h"
-#include "voxel/polyvox/AStarPathfinder.h"
 #include "voxel/polyvox/CubicSurfaceExtractor.h"
 #include "voxel/polyvox/PagedVolumeWrapper.h"
 #include "voxel/polyvox/Voxel.h"
@@ -18,11 +17,13 @@
 #include "voxel/Constants.h"
 #include "voxel/IsQuadNeeded.h"
 #include "voxel/Spiral.h"
+#include <algorithm>
+#include <thread>
 
 namespace voxel {
 
 World::World() :
-		_threadPool(core::halfcpus(), "World"), _random(_seed) {
+		_threadPool(core::halfcpus(), "World"), _pathThreadPool(std::max(1u, core::halfcpus() / 2u), "WorldPath"), _random(_seed) {
 }
 
 World::~World() {
@@ -49,7 +50,7 @@ glm::ivec3 World::randomPos() const {
 // Extract the surface for the specified region of the volume.
 // The surface extractor outputs the mesh in an efficient compressed format which
 // is not directly suitable for rendering.
-bool World::scheduleMeshExtraction(const glm::ivec3& p) {
+bool World::scheduleMeshExtraction(const glm::ivec3& p, int priority) {
 	if (_cancelThreads) {
 		return false;
 	}
@@ -61,10 +62,20 @@ bool World::scheduleMeshExtraction(const glm::ivec3& p) {
 	Log::trace("mesh extraction for %i:%i:%i (%i:%i:%i)",
 			p.x, p.y, p.z, pos.x, pos.y, pos.z);
 	_meshesExtracted.insert(pos);
-	_meshesQueue.push(pos);
+	_meshesQueue.push(ScheduledMesh{pos, priority});
 	return true;
 }
 
+bool World::isMeshExtractionScheduled(const glm::ivec3& pos) const {
+	return _meshesExtracted.find(meshPos(pos)) != _meshesExtracted.end();
+}
+
+bool World::isMeshEnclosed(const glm::ivec3& pos) const {
+	const glm::ivec3& gridPos = meshPos(pos);
+	std::lock_guard<std::mutex> lock(_meshesEnclosedMutex);
+	return _meshesEnclosed.find(gridPos) != _meshesEnclosed.end();
+}
+
 void World::setSeed(long seed) {
 	Log::info("Seed is: %li", seed);
 	_seed = seed;
@@ -92,27 +103,174 @@ void World::setVoxel(const glm::ivec3& pos, const voxel::Voxel& voxel) {
 	_volumeData->setVoxel(pos, voxel);
 	allowReExtraction(pos);
 	scheduleMeshExtraction(pos);
+	invalidatePaths(pos);
+	_pathfinder->invalidate(pos);
 }
 
 bool World::allowReExtraction(const glm::ivec3& pos) {
 	const glm::ivec3& gridPos = meshPos(pos);
+	{
+		std::lock_guard<std::mutex> lock(_meshesEnclosedMutex);
+		_meshesEnclosed.erase(gridPos);
+	}
 	return _meshesExtracted.erase(gridPos) != 0;
 }
 
 bool World::findPath(const glm::ivec3& start, const glm::ivec3& end,
 		std::list<glm::ivec3>& listResult) {
 	core_trace_scoped(FindPath);
-	static auto f = [] (const voxel::PagedVolume* volData, const glm::ivec3& v3dPos) {
-		const voxel::Voxel& voxel = volData->voxel(v3dPos);
-		return isBlocked(voxel.getMaterial());
-	};
-
-	const AStarPathfinderParams<voxel::PagedVolume> params(_volumeData, start, end, &listResult, 1.0f, 10000,
-			TwentySixConnected, std::bind(f, std::placeholders::_1, std::placeholders::_2));
-	AStarPathfinder<voxel::PagedVolume> pf(params);
-	// TODO: move into threadpool
-	pf.execute();
-	return true;
+	return _pathfinder->findPath(start, end, listResult, _pathNodeBudget->intVal());
+}
+
+PathPtr World::requestPath(const glm::ivec3& start, const glm::ivec3& end) {
+	if (_cancelThreads) {
+		return PathPtr();
+	}
+	const PathKey key{start, end};
+	PathPtr path;
+	{
+		std::lock_guard<std::mutex> lock(_pathMutex);
+		auto i = _paths.find(key);
+		if (i != _paths.end()) {
+			PathEntry& entry = i->second;
+			if (entry.cached) {
+				return entry.path;
+			}
+			// a pending search that everybody else already gave up is replaced
+			if (entry.path->_requesters > 0) {
+				++entry.path->_requesters;
+				return entry.path;
+			}
+		}
+		path = std::make_shared<Path>(start, end);
+		path->_generation = _pathGeneration;
+		PathEntry& entry = _paths[key];
+		entry.path = path;
+		entry.cached = false;
+		++_pathTasks;
+	}
+	_pathThreadPool.enqueue([this, path] () {executePath(path);});
+	return path;
+}
+
+void World::cancelPath(PathPtr& path) {
+	if (!path) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_pathMutex);
+		if (!path->done()) {
+			--path->_requesters;
+		}
+	}
+	path.reset();
+}
+
+void World::executePath(const PathPtr& path) {
+	core_trace_scoped(PathRequest);
+	const PathKey key{path->start(), path->end()};
+	bool cancelled;
+	{
+		std::lock_guard<std::mutex> lock(_pathMutex);
+		cancelled = _cancelThreads || path->_requesters <= 0;
+	}
+	Path::State state = Path::State::Cancelled;
+	if (!cancelled) {
+		state = findPath(key.start, key.end, path->_result) ? Path::State::Found : Path::State::Failed;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_pathMutex);
+		auto i = _paths.find(key);
+		const bool registered = i != _paths.end() && i->second.path == path;
+		if (registered) {
+			if (state == Path::State::Found) {
+				cachePath(i);
+			} else {
+				_paths.erase(i);
+			}
+		}
+		// the state must be set last - the result is read without a lock once it is found
+		path->_state = state;
+		if (--_pathTasks == 0) {
+			// nobody is left to compare against the chunk changes
+			_chunkGenerations.clear();
+		}
+	}
+	_pathTasksDone.notify_all();
+}
+
+void World::cachePath(Paths::iterator i) {
+	const PathKey& key = i->first;
+	const Path& path = *i->second.path;
+	std::vector<glm::ivec3> chunks;
+	for (const glm::ivec3& pos : path.result()) {
+		const glm::ivec3& chunk = chunkPos(pos);
+		if (!chunks.empty() && chunks.back() == chunk) {
+			continue;
+		}
+		auto generation = _chunkGenerations.find(chunk);
+		if (generation != _chunkGenerations.end() && (int32_t)(generation->second - path._generation) > 0) {
+			// a voxel along the path was changed while we were searching - the result is stale
+			Log::debug("Don't cache a path that passes a chunk that was modified during the search");
+			_paths.erase(i);
+			return;
+		}
+		chunks.push_back(chunk);
+	}
+	for (const glm::ivec3& chunk : chunks) {
+		std::vector<PathKey>& keys = _pathsByChunk[chunk];
+		if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+			keys.push_back(key);
+		}
+	}
+	PathEntry& entry = i->second;
+	entry.cached = true;
+	entry.order = _pathCacheOrder.insert(_pathCacheOrder.end(), key);
+	if (_pathCacheOrder.size() <= MaxCachedPaths) {
+		return;
+	}
+	auto oldest = _paths.find(_pathCacheOrder.front());
+	core_assert(oldest != _paths.end() && oldest->second.cached);
+	uncachePath(oldest);
+}
+
+void World::uncachePath(Paths::iterator i) {
+	const PathKey key = i->first;
+	const PathEntry& entry = i->second;
+	core_assert(entry.cached);
+	for (const glm::ivec3& pos : entry.path->result()) {
+		auto chunk = _pathsByChunk.find(chunkPos(pos));
+		if (chunk == _pathsByChunk.end()) {
+			continue;
+		}
+		std::vector<PathKey>& keys = chunk->second;
+		keys.erase(std::remove(keys.begin(), keys.end(), key), keys.end());
+		if (keys.empty()) {
+			_pathsByChunk.erase(chunk);
+		}
+	}
+	_pathCacheOrder.erase(entry.order);
+	_paths.erase(i);
+}
+
+void World::invalidatePaths(const glm::ivec3& pos) {
+	const glm::ivec3& chunk = chunkPos(pos);
+	std::lock_guard<std::mutex> lock(_pathMutex);
+	if (_pathTasks > 0) {
+		// the pending searches might already have passed the old voxels
+		_chunkGenerations[chunk] = ++_pathGeneration;
+	}
+	auto i = _pathsByChunk.find(chunk);
+	if (i == _pathsByChunk.end()) {
+		return;
+	}
+	const std::vector<PathKey> keys = i->second;
+	for (const PathKey& key : keys) {
+		auto p = _paths.find(key);
+		if (p != _paths.end() && p->second.cached) {
+			uncachePath(p);
+		}
+	}
 }
 
 bool World::init(const std::string& luaParameters, const std::string& luaBiomes, uint32_t volumeMemoryMegaBytes, uint16_t chunkSideLength) {
@@ -123,7 +281,9 @@ bool World::init(const std::string& luaParameters, const std::string& luaBiomes,
 		return false;
 	}
 	_meshSize = core::Var::getSafe(cfg::VoxelMeshSize);
+	_pathNodeBudget = core::Var::get(cfg::VoxelPathNodeBudget, "10000");
 	_volumeData = new PagedVolume(&_pager, volumeMemoryMegaBytes * 1024 * 1024, chunkSideLength);
+	_pathfinder.reset(new Pathfinder(_volumeData, _meshSize->intVal()));
 
 	_pager.init(_volumeData, &_biomeManager, &_ctx);
 	if (_clientData) {
@@ -140,10 +300,12 @@ bool World::init(const std::string& luaParameters, const std::string& luaBiomes,
 void World::extractScheduledMesh() {
 	while (!_cancelThreads) {
 		core_trace_scoped(MeshExtraction);
-		glm::ivec3 pos;
-		if (!_meshesQueue.waitAndPop(pos)) {
+		ScheduledMesh scheduled;
+		if (!_meshesQueue.waitAndPop(scheduled)) {
 			break;
 		}
+		++_meshesExtracting;
+		const glm::ivec3& pos = scheduled.pos;
 		const Region &region = getMeshRegion(pos);
 		// these number are made up mostly by try-and-error - we need to revisit them from time to time to prevent extra mem allocs
 		// they also heavily depend on the size of the mesh region we extract
@@ -156,20 +318,50 @@ void World::extractScheduledMesh() {
 				IsQuadNeeded(), IsWaterQuadNeeded(),
 				MAX_WATER_HEIGHT);
 		if (data.waterMesh.isEmpty() && data.opaqueMesh.isEmpty()) {
+			// without any visible face the tile is either filled with air or with solid voxels only
+			const VoxelType material = _volumeData->voxel(pos).getMaterial();
+			if (!isAir(material) && !isWater(material)) {
+				std::lock_guard<std::mutex> lock(_meshesEnclosedMutex);
+				_meshesEnclosed.insert(pos);
+			}
+			--_meshesExtracting;
 			continue;
 		}
+		{
+			// an extraction of the tile that was still running while a voxel was changed might have flagged it
+			std::lock_guard<std::mutex> lock(_meshesEnclosedMutex);
+			_meshesEnclosed.erase(pos);
+		}
 		_meshQueue.push(std::move(data));
+		--_meshesExtracting;
 	}
 }
 
 void World::shutdown() {
 	_cancelThreads = true;
 	_threadPool.shutdown();
+	{
+		std::unique_lock<std::mutex> lock(_pathMutex);
+		// the queued searches are cancelled right away - the running ones still access the volume
+		_pathTasksDone.wait(lock, [this] () {
+			return _pathTasks == 0;
+		});
+		_paths.clear();
+		_pathsByChunk.clear();
+		_pathCacheOrder.clear();
+		_chunkGenerations.clear();
+	}
+	_pathThreadPool.shutdown();
+	_pathfinder.reset();
 	_meshesQueue.clear();
 	_meshesQueue.abortWait();
 	_meshQueue.clear();
 	_meshQueue.abortWait();
 	_meshesExtracted.clear();
+	{
+		std::lock_guard<std::mutex> lock(_meshesEnclosedMutex);
+		_meshesEnclosed.clear();
+	}
 	_meshQueue.clear();
 	_pager.shutdown();
 	delete _volumeData;
@@ -191,7 +383,7 @@ void World::onFrame(long dt) {
 
 void World::stats(int& meshes, int& extracted, int& pending) const {
 	extracted = _meshesExtracted.size();
-	pending = _meshesQueue.size();
+	pending = _meshesQueue.size() + _meshesExtracting;
 	meshes = _meshQueue.size();
 }
 
@@ -11,10 +11,16 @@
 #include "polyvox/Raycast.h"
 #include "voxel/Constants.h"
 #include "voxel/polyvox/Picking.h"
+#include "voxel/polyvox/HierarchicalPathfinder.h"
+#include "voxel/Path.h"
 #include <memory>
 #include <vector>
 #include <atomic>
 #include <list>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
 
 #include "WorldPager.h"
 #include "WorldContext.h"
@@ -49,6 +55,16 @@ struct ChunkMeshes {
 
 typedef std::unordered_set<glm::ivec3, std::hash<glm::ivec3> > PositionSet;
 
+/**
+ * @brief Decides whether the npcs can walk through the given voxel
+ */
+struct WalkableVoxelValidator {
+	inline bool operator()(const PagedVolume* volData, const glm::ivec3& pos) const {
+		const Voxel& voxel = volData->voxel(pos);
+		return isBlocked(voxel.getMaterial());
+	}
+};
+
 class World {
 public:
 	enum Result {
@@ -67,8 +83,31 @@ public:
 	 */
 	void setClientData(bool clientData);
 
+	/**
+	 * @brief Searches the path on the calling thread
+	 *
+	 * Targets that are farther away than the neighbouring sectors (see @c meshSize()) are searched on the
+	 * coarse sector graph. In that case only the way to the first waypoint is given in voxel resolution,
+	 * followed by the remaining coarse waypoints.
+	 *
+	 * @return @c true if a path was found
+	 */
 	bool findPath(const glm::ivec3& start, const glm::ivec3& end, std::list<glm::ivec3>& listResult);
 
+	/**
+	 * @brief Queues the path search onto the path worker threads. Identical requests share one search, found
+	 * paths are cached until a voxel in one of the chunks they pass through is changed.
+	 * @return The handle to poll the result from - @c nullptr if the world is shutting down
+	 */
+	PathPtr requestPath(const glm::ivec3& start, const glm::ivec3& end);
+
+	/**
+	 * @brief Tells the world that the caller is no longer interested in the result - e.g. because the
+	 * target changed. The search is cancelled if nobody else requested it.
+	 * @note The given handle is reset
+	 */
+	void cancelPath(PathPtr& path);
+
 	template<typename VoxelTypeChecker>
 	int findFloor(int x, int z, VoxelTypeChecker&& check) const {
 		const glm::vec3 start = glm::vec3(x, MAX_HEIGHT, z);
@@ -138,6 +177,11 @@ public:
 	 */
 	bool pop(ChunkMeshes& item);
 
+	/**
+	 * @param[out] meshes The extracted meshes that are ready to be popped
+	 * @param[out] extracted The mesh tiles that were scheduled and not yet allowed to be re-extracted
+	 * @param[out] pending The scheduled extractions that are queued or still running
+	 */
 	void stats(int& meshes, int& extracted, int& pending) const;
 
 	/**
@@ -151,9 +195,24 @@ public:
 	 * @brief Performs async mesh extraction. You need to call @c pop in order to see if some extraction is ready.
 	 *
 	 * @param[in] pos A World vector that is automatically converted into a mesh tile vector
+	 * @param[in] priority The scheduled meshes with the lowest value are extracted first
 	 * @note This will not allow to reschedule an extraction for the same area until @c allowReExtraction was called.
 	 */
-	bool scheduleMeshExtraction(const glm::ivec3& pos);
+	bool scheduleMeshExtraction(const glm::ivec3& pos, int priority = 0);
+
+	/**
+	 * @param[in] pos A World vector that is automatically converted into a mesh tile vector
+	 * @return @c true if the extraction for the given mesh tile was already scheduled
+	 */
+	bool isMeshExtractionScheduled(const glm::ivec3& pos) const;
+
+	/**
+	 * @brief A mesh tile is enclosed if the extraction didn't produce any geometry because the tile is
+	 * completely filled with solid voxels.
+	 * @param[in] pos A World vector that is automatically converted into a mesh tile vector
+	 * @return @c false if the tile wasn't extracted yet
+	 */
+	bool isMeshEnclosed(const glm::ivec3& pos) const;
 
 	void onFrame(long dt);
 
@@ -180,6 +239,52 @@ private:
 
 	void extractScheduledMesh();
 
+	struct ScheduledMesh {
+		glm::ivec3 pos;
+		int priority;
+
+		// the priority queue pops the largest element first
+		inline bool operator<(const ScheduledMesh& rhs) const {
+			return priority > rhs.priority;
+		}
+	};
+
+	struct PathKey {
+		glm::ivec3 start;
+		glm::ivec3 end;
+
+		inline bool operator==(const PathKey& rhs) const {
+			return start == rhs.start && end == rhs.end;
+		}
+	};
+	struct PathKeyHash {
+		inline size_t operator()(const PathKey& key) const {
+			const std::hash<glm::ivec3> hasher;
+			return hasher(key.start) * 31u ^ hasher(key.end);
+		}
+	};
+	struct PathEntry {
+		PathPtr path;
+		// the position in _pathCacheOrder - only valid if the path is cached
+		std::list<PathKey>::iterator order;
+		bool cached = false;
+	};
+	typedef std::unordered_map<PathKey, PathEntry, PathKeyHash> Paths;
+	// the amount of found paths that are kept in the cache
+	static constexpr size_t MaxCachedPaths = 1024u;
+
+	void executePath(const PathPtr& path);
+	/**
+	 * @note The path mutex must be held
+	 */
+	void cachePath(Paths::iterator i);
+	/**
+	 * @brief Removes a cached path from the cache and all of its lookup structures
+	 * @note The path mutex must be held
+	 */
+	void uncachePath(Paths::iterator i);
+	void invalidatePaths(const glm::ivec3& pos);
+
 	WorldPager _pager;
 	PagedVolume *_volumeData = nullptr;
 	BiomeManager _biomeManager;
@@ -190,10 +295,35 @@ private:
 
 	core::ThreadPool _threadPool;
 	core::ConcurrentQueue<ChunkMeshes> _meshQueue;
-	core::ConcurrentQueue<glm::ivec3, VecLessThan<3, int> > _meshesQueue;
+	core::ConcurrentQueue<ScheduledMesh> _meshesQueue;
+	// the extractions that were taken from the _meshesQueue and are still running
+	std::atomic_int _meshesExtracting { 0 };
 	// fast lookup for positions that are already extracted and available in the _meshData vector
 	PositionSet _meshesExtracted;
+	// the extracted mesh tiles without geometry that are filled with solid voxels - written by the extraction threads
+	PositionSet _meshesEnclosed;
+	mutable std::mutex _meshesEnclosedMutex;
 	core::VarPtr _meshSize;
+	core::VarPtr _pathNodeBudget;
+
+	typedef HierarchicalPathfinder<PagedVolume, WalkableVoxelValidator> Pathfinder;
+	std::unique_ptr<Pathfinder> _pathfinder;
+	core::ThreadPool _pathThreadPool;
+	std::mutex _pathMutex;
+	// pending and cached path searches
+	Paths _paths;
+	// the cached paths that pass through a chunk
+	std::unordered_map<glm::ivec3, std::vector<PathKey>, std::hash<glm::ivec3> > _pathsByChunk;
+	// oldest cached path first - used to keep the cache size below MaxCachedPaths
+	std::list<PathKey> _pathCacheOrder;
+	// incremented with every voxel change - a search that passes a chunk that was changed after it
+	// was requested isn't cached
+	uint32_t _pathGeneration = 0u;
+	// the generation of the last voxel change per chunk - only needed while searches are pending
+	std::unordered_map<glm::ivec3, uint32_t, std::hash<glm::ivec3> > _chunkGenerations;
+	// the submitted searches that are queued or running
+	int _pathTasks = 0;
+	std::condition_variable _pathTasksDone;
 	core::Random _random;
 	std::atomic_bool _cancelThreads { false };
 };
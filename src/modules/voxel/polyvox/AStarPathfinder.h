@@ -20,6 +20,18 @@ namespace voxel {
 template<typename VolumeType>
 bool aStarDefaultVoxelValidator(const VolumeType* volData, const glm::ivec3& v3dPos);
 
+/**
+ * Functor version of aStarDefaultVoxelValidator() - the default validator type of the
+ * AStarPathfinderParams. Using a type instead of a @c std::function allows the compiler
+ * to inline the check that is executed for every neighbour of every expanded node.
+ */
+template<typename VolumeType>
+struct AStarDefaultVoxelValidator {
+	inline bool operator()(const VolumeType* volData, const glm::ivec3& v3dPos) const {
+		return aStarDefaultVoxelValidator(volData, v3dPos);
+	}
+};
+
 /**
  * @brief Provides a configuration for the AStarPathfinder.
  *
@@ -30,14 +42,15 @@ bool aStarDefaultVoxelValidator(const VolumeType* volData, const glm::ivec3& v3d
  * the result. All the other option have sensible default values which can
  * optionally be changed for more precise control over the pathfinder's behaviour.
  *
+ * @tparam Validator Callable with the signature @c bool(const VolumeType*, const glm::ivec3&)
  * @sa AStarPathfinder
  */
-template<typename VolumeType>
+template<typename VolumeType, typename Validator = AStarDefaultVoxelValidator<VolumeType> >
 struct AStarPathfinderParams {
 public:
 	AStarPathfinderParams(VolumeType* volData, const glm::ivec3& v3dStart, const glm::ivec3& v3dEnd, std::list<glm::ivec3>* listResult, float fHBias = 1.0,
 			uint32_t uMaxNoOfNodes = 10000, Connectivity requiredConnectivity = TwentySixConnected,
-			std::function<bool(const VolumeType*, const glm::ivec3&)> funcIsVoxelValidForPath = &aStarDefaultVoxelValidator, std::function<void(float)> funcProgressCallback =
+			const Validator& funcIsVoxelValidForPath = Validator(), std::function<void(float)> funcProgressCallback =
 					nullptr) :
 			volume(volData), start(v3dStart), end(v3dEnd), result(listResult), connectivity(requiredConnectivity), hBias(fHBias), maxNumberOfNodes(uMaxNoOfNodes), isVoxelValidForPath(
 					funcIsVoxelValidForPath), progressCallback(funcProgressCallback) {
@@ -77,13 +90,13 @@ public:
 	/// before giving up
 	uint32_t maxNumberOfNodes;
 
-	/// This function is called to determine whether the path can pass though a given voxel. The
+	/// This is called to determine whether the path can pass though a given voxel. The
 	/// default behaviour is specified by aStarDefaultVoxelValidator(), but users can specify their
 	/// own criteria if desired. For example, if you always want a path to follow a surface then
 	/// you could check to ensure that the voxel above is empty and the voxel below is solid.
 	///
 	/// @sa aStarDefaultVoxelValidator
-	std::function<bool(const VolumeType*, const glm::ivec3&)> isVoxelValidForPath;
+	Validator isVoxelValidForPath;
 
 	/// This function is called by the AStarPathfinder to report on its progress in getting to
 	/// the goal. The progress is reported by computing the distance from the closest node found
@@ -115,15 +128,32 @@ public:
  * found then this is stored in the list which was set as the 'result' field of
  * the AStarPathfinderParams.
  *
+ * The nodes are kept in a pool that is reused by the following searches. If you have to
+ * find many paths, keep the instance around and hand in the new parameters via reset().
+ *
  * @sa AStarPathfinderParams
  */
-template<typename VolumeType>
+template<typename VolumeType, typename Validator = AStarDefaultVoxelValidator<VolumeType> >
 class AStarPathfinder {
 public:
-	AStarPathfinder(const AStarPathfinderParams<VolumeType>& params);
+	typedef AStarPathfinderParams<VolumeType, Validator> Params;
+
+	AStarPathfinder(const Params& params);
+
+	/**
+	 * @brief Use new parameters for the next execute() call - the allocated node memory is kept.
+	 */
+	void reset(const Params& params);
 
 	bool execute();
 
+	/**
+	 * @return The amount of nodes that were touched by the last search
+	 */
+	inline size_t nodes() const {
+		return _nodes.size();
+	}
+
 private:
 	void processNeighbour(const glm::ivec3& neighbourPos, float neighbourGVal);
 
@@ -134,16 +164,15 @@ private:
 	uint32_t hash(uint32_t a);
 
 	// Node containers
-	AllNodesContainer _allNodes;
+	NodePool _nodes;
 	OpenNodesContainer _openNodes;
-	ClosedNodesContainer _closedNodes;
 
-	// The current node
-	AllNodesContainer::iterator _current;
+	// The index of the current node
+	uint32_t _current = Node::InvalidIndex;
 
 	float _progress = 0.0f;
 
-	AStarPathfinderParams<VolumeType> _params;
+	Params _params;
 };
 
 /**
@@ -189,46 +218,42 @@ const glm::ivec3 arrayPathfinderCorners[8] = {
  */
 template<typename VolumeType>
 bool aStarDefaultVoxelValidator(const VolumeType* volData, const glm::ivec3& v3dPos) {
-	return volData->getRegion().containsPoint(v3dPos);
+	return volData->region().containsPoint(v3dPos);
 }
 
 /**
  * @section AStarPathfinder Class
  */
-template<typename VolumeType>
-AStarPathfinder<VolumeType>::AStarPathfinder(const AStarPathfinderParams<VolumeType>& params) :
-		_params(params) {
+template<typename VolumeType, typename Validator>
+AStarPathfinder<VolumeType, Validator>::AStarPathfinder(const Params& params) :
+		_openNodes(_nodes), _params(params) {
 }
 
-template<typename VolumeType>
-bool AStarPathfinder<VolumeType>::execute() {
-	//Clear any existing nodes
-	_allNodes.clear();
+template<typename VolumeType, typename Validator>
+void AStarPathfinder<VolumeType, Validator>::reset(const Params& params) {
+	_params = params;
+}
+
+template<typename VolumeType, typename Validator>
+bool AStarPathfinder<VolumeType, Validator>::execute() {
+	//Clear any existing nodes - the memory is kept for the next search
+	_nodes.clear();
 	_openNodes.clear();
-	_closedNodes.clear();
 
 	//Clear the result
 	_params.result->clear();
 
-	//Iterators to start and end node.
-	AllNodesContainer::iterator startNode = _allNodes.insert(Node(_params.start.x, _params.start.y, _params.start.z)).first;
-	AllNodesContainer::iterator endNode = _allNodes.insert(Node(_params.end.x, _params.end.y, _params.end.z)).first;
-
-	//Regarding the const_cast - normally you should not modify an object which is in an sdt::set.
-	//The reason is that objects in a set are stored sorted in a tree so they can be accessed quickly,
-	//and changing the object directly can break the sorting. However, in our case we have provided a
-	//custom sort operator for the set which we know only uses the position to sort. Hence we can safely
-	//modify other properties of the object while it is in the set.
-	Node* tempStart = const_cast<Node*>(&(*startNode));
-	tempStart->gVal = 0;
-	tempStart->hVal = computeH(startNode->position, endNode->position);
+	const uint32_t startNode = _nodes.insert(_params.start).first;
+	const uint32_t endNode = _nodes.insert(_params.end).first;
 
-	Node* tempEnd = const_cast<Node*>(&(*endNode));
-	tempEnd->hVal = 0.0f;
+	Node& start = _nodes[startNode];
+	start.gVal = 0;
+	start.hVal = computeH(_params.start, _params.end);
+	_nodes[endNode].hVal = 0.0f;
 
 	_openNodes.insert(startNode);
 
-	float fDistStartToEnd = (endNode->position - startNode->position).length();
+	const float fDistStartToEnd = glm::length(glm::vec3(_params.end - _params.start));
 	_progress = 0.0f;
 	if (_params.progressCallback) {
 		_params.progressCallback(_progress);
@@ -236,14 +261,15 @@ bool AStarPathfinder<VolumeType>::execute() {
 
 	while (!_openNodes.empty() && _openNodes.getFirst() != endNode) {
 		//Move the first node from open to closed.
-		_current = _openNodes.getFirst();
-		_openNodes.removeFirst();
-		_closedNodes.insert(_current);
+		_current = _openNodes.removeFirst();
+		// copy - processing the neighbours might grow the pool
+		const glm::ivec3 currentPos = _nodes[_current].position;
+		const float currentGVal = _nodes[_current].gVal;
 
 		//Update the user on our progress
 		if (_params.progressCallback) {
 			const float fMinProgresIncreament = 0.001f;
-			float fDistCurrentToEnd = (endNode->position - _current->position).length();
+			float fDistCurrentToEnd = glm::length(glm::vec3(_params.end - currentPos));
 			float fDistNormalised = fDistCurrentToEnd / fDistStartToEnd;
 			float fProgress = 1.0f - fDistNormalised;
 			if (fProgress >= _progress + fMinProgresIncreament) {
@@ -261,39 +287,22 @@ bool AStarPathfinder<VolumeType>::execute() {
 		//statements, larger connectivities include smaller ones.
 		switch (_params.connectivity) {
 		case TwentySixConnected:
-			processNeighbour(_current->position + arrayPathfinderCorners[0], _current->gVal + fCornerCost);
-			processNeighbour(_current->position + arrayPathfinderCorners[1], _current->gVal + fCornerCost);
-			processNeighbour(_current->position + arrayPathfinderCorners[2], _current->gVal + fCornerCost);
-			processNeighbour(_current->position + arrayPathfinderCorners[3], _current->gVal + fCornerCost);
-			processNeighbour(_current->position + arrayPathfinderCorners[4], _current->gVal + fCornerCost);
-			processNeighbour(_current->position + arrayPathfinderCorners[5], _current->gVal + fCornerCost);
-			processNeighbour(_current->position + arrayPathfinderCorners[6], _current->gVal + fCornerCost);
-			processNeighbour(_current->position + arrayPathfinderCorners[7], _current->gVal + fCornerCost);
+			for (int i = 0; i < 8; ++i) {
+				processNeighbour(currentPos + arrayPathfinderCorners[i], currentGVal + fCornerCost);
+			}
 
 		case EighteenConnected:
-			processNeighbour(_current->position + arrayPathfinderEdges[0], _current->gVal + fEdgeCost);
-			processNeighbour(_current->position + arrayPathfinderEdges[1], _current->gVal + fEdgeCost);
-			processNeighbour(_current->position + arrayPathfinderEdges[2], _current->gVal + fEdgeCost);
-			processNeighbour(_current->position + arrayPathfinderEdges[3], _current->gVal + fEdgeCost);
-			processNeighbour(_current->position + arrayPathfinderEdges[4], _current->gVal + fEdgeCost);
-			processNeighbour(_current->position + arrayPathfinderEdges[5], _current->gVal + fEdgeCost);
-			processNeighbour(_current->position + arrayPathfinderEdges[6], _current->gVal + fEdgeCost);
-			processNeighbour(_current->position + arrayPathfinderEdges[7], _current->gVal + fEdgeCost);
-			processNeighbour(_current->position + arrayPathfinderEdges[8], _current->gVal + fEdgeCost);
-			processNeighbour(_current->position + arrayPathfinderEdges[9], _current->gVal + fEdgeCost);
-			processNeighbour(_current->position + arrayPathfinderEdges[10], _current->gVal + fEdgeCost);
-			processNeighbour(_current->position + arrayPathfinderEdges[11], _current->gVal + fEdgeCost);
+			for (int i = 0; i < 12; ++i) {
+				processNeighbour(currentPos + arrayPathfinderEdges[i], currentGVal + fEdgeCost);
+			}
 
 		case SixConnected:
-			processNeighbour(_current->position + arrayPathfinderFaces[0], _current->gVal + fFaceCost);
-			processNeighbour(_current->position + arrayPathfinderFaces[1], _current->gVal + fFaceCost);
-			processNeighbour(_current->position + arrayPathfinderFaces[2], _current->gVal + fFaceCost);
-			processNeighbour(_current->position + arrayPathfinderFaces[3], _current->gVal + fFaceCost);
-			processNeighbour(_current->position + arrayPathfinderFaces[4], _current->gVal + fFaceCost);
-			processNeighbour(_current->position + arrayPathfinderFaces[5], _current->gVal + fFaceCost);
+			for (int i = 0; i < 6; ++i) {
+				processNeighbour(currentPos + arrayPathfinderFaces[i], currentGVal + fFaceCost);
+			}
 		}
 
-		if (_allNodes.size() > _params.maxNumberOfNodes) {
+		if (_nodes.size() > _params.maxNumberOfNodes) {
 			//We've reached the specified maximum number
 			//of nodes. Just give up on the search.
 			break;
@@ -304,15 +313,8 @@ bool AStarPathfinder<VolumeType>::execute() {
 		//In this case we failed to find a valid path.
 		return false;
 	}
-	//Regarding the const_cast - normally you should not modify an object which is in an sdt::set.
-	//The reason is that objects in a set are stored sorted in a tree so they can be accessed quickly,
-	//and changing the object directly can break the sorting. However, in our case we have provided a
-	//custom sort operator for the set which we know only uses the position to sort. Hence we can safely
-	//modify other properties of the object while it is in the set.
-	Node* n = const_cast<Node*>(&(*endNode));
-	while (n != 0) {
-		_params.result->push_front(n->position);
-		n = n->parent;
+	for (uint32_t n = endNode; n != Node::InvalidIndex; n = _nodes[n].parent) {
+		_params.result->push_front(_nodes[n].position);
 	}
 
 	if (_params.progressCallback) {
@@ -322,64 +324,46 @@ bool AStarPathfinder<VolumeType>::execute() {
 	return true;
 }
 
-template<typename VolumeType>
-void AStarPathfinder<VolumeType>::processNeighbour(const glm::ivec3& neighbourPos, float neighbourGVal) {
-	bool bIsVoxelValidForPath = _params.isVoxelValidForPath(_params.volume, neighbourPos);
+template<typename VolumeType, typename Validator>
+void AStarPathfinder<VolumeType, Validator>::processNeighbour(const glm::ivec3& neighbourPos, float neighbourGVal) {
+	const bool bIsVoxelValidForPath = _params.isVoxelValidForPath(_params.volume, neighbourPos);
 	if (!bIsVoxelValidForPath) {
 		return;
 	}
 
-	float cost = neighbourGVal;
+	const float cost = neighbourGVal;
 
-	std::pair<AllNodesContainer::iterator, bool> insertResult = _allNodes.insert(Node(neighbourPos.x, neighbourPos.y, neighbourPos.z));
-	AllNodesContainer::iterator neighbour = insertResult.first;
+	const std::pair<uint32_t, bool> insertResult = _nodes.insert(neighbourPos);
+	const uint32_t neighbourIndex = insertResult.first;
+	Node& neighbour = _nodes[neighbourIndex];
 
 	if (insertResult.second) {
 		//New node, compute h.
-		Node* tempNeighbour = const_cast<Node*>(&(*neighbour));
-		tempNeighbour->hVal = computeH(neighbour->position, _params.end);
-	}
-
-	OpenNodesContainer::iterator openIter = _openNodes.find(neighbour);
-	if (openIter != _openNodes.end()) {
-		if (cost < neighbour->gVal) {
-			_openNodes.remove(openIter);
-			openIter = _openNodes.end();
-		}
-	}
-
-	//TODO - Nodes could keep track of if they are in open or closed? And a pointer to where they are?
-	ClosedNodesContainer::iterator closedIter = _closedNodes.find(neighbour);
-	if (closedIter != _closedNodes.end()) {
-		if (cost < neighbour->gVal) {
-			//Probably shouldn't happen?
-			_closedNodes.remove(closedIter);
-			closedIter = _closedNodes.end();
-		}
+		neighbour.hVal = computeH(neighbourPos, _params.end);
+	} else if (neighbour.heapIndex != Node::New && !(cost < neighbour.gVal)) {
+		//Known node (open or closed) that was already reached on a path that is at least as cheap
+		return;
 	}
 
-	if (openIter == _openNodes.end() && closedIter == _closedNodes.end()) {
-		//Regarding the const_cast - normally you should not modify an object which is in an sdt::set.
-		//The reason is that objects in a set are stored sorted in a tree so they can be accessed quickly,
-		//and changing the object directly can break the sorting. However, in our case we have provided a
-		//custom sort operator for the set which we know only uses the position to sort. Hence we can safely
-		//modify other properties of the object while it is in the set.
-		Node* temp = const_cast<Node*>(&(*neighbour));
-		temp->gVal = cost;
-		_openNodes.insert(neighbour);
-		temp->parent = const_cast<Node*>(&(*_current));
+	neighbour.gVal = cost;
+	neighbour.parent = _current;
+	if (neighbour.heapIndex >= 0) {
+		_openNodes.decreased(neighbourIndex);
+	} else {
+		//New or closed node - a closed one is reopened because a cheaper path was found
+		_openNodes.insert(neighbourIndex);
 	}
 }
 
-template<typename VolumeType>
-float AStarPathfinder<VolumeType>::SixConnectedCost(const glm::ivec3& a, const glm::ivec3& b) {
+template<typename VolumeType, typename Validator>
+float AStarPathfinder<VolumeType, Validator>::SixConnectedCost(const glm::ivec3& a, const glm::ivec3& b) {
 	//This is the only heuristic I'm sure of - just use the manhatten distance for the 6-connected case.
 	const uint32_t faceSteps = std::abs(a.x - b.x) + std::abs(a.y - b.y) + std::abs(a.z - b.z);
 	return float(faceSteps);
 }
 
-template<typename VolumeType>
-float AStarPathfinder<VolumeType>::EighteenConnectedCost(const glm::ivec3& a, const glm::ivec3& b) {
+template<typename VolumeType, typename Validator>
+float AStarPathfinder<VolumeType, Validator>::EighteenConnectedCost(const glm::ivec3& a, const glm::ivec3& b) {
 	//I'm not sure of the correct heuristic for the 18-connected case, so I'm just letting it fall through to the
 	//6-connected case. This means 'h' will be bigger than it should be, resulting in a faster path which may not
 	//actually be the shortest one. If you have a correct heuristic for the 18-connected case then please let me know.
@@ -387,8 +371,8 @@ float AStarPathfinder<VolumeType>::EighteenConnectedCost(const glm::ivec3& a, co
 	return SixConnectedCost(a, b);
 }
 
-template<typename VolumeType>
-float AStarPathfinder<VolumeType>::TwentySixConnectedCost(const glm::ivec3& a, const glm::ivec3& b) {
+template<typename VolumeType, typename Validator>
+float AStarPathfinder<VolumeType, Validator>::TwentySixConnectedCost(const glm::ivec3& a, const glm::ivec3& b) {
 	//Can't say I'm certain about this heuristic - if anyone has
 	//a better idea of what it should be then please let me know.
 	uint32_t array[3];
@@ -408,8 +392,8 @@ float AStarPathfinder<VolumeType>::TwentySixConnectedCost(const glm::ivec3& a, c
 	return cornerSteps * glm::root_three<float>() + edgeSteps * glm::root_two<float>() + faceSteps;
 }
 
-template<typename VolumeType>
-float AStarPathfinder<VolumeType>::computeH(const glm::ivec3& a, const glm::ivec3& b) {
+template<typename VolumeType, typename Validator>
+float AStarPathfinder<VolumeType, Validator>::computeH(const glm::ivec3& a, const glm::ivec3& b) {
 	float hVal;
 
 	switch (_params.connectivity) {
@@ -427,12 +411,6 @@ float AStarPathfinder<VolumeType>::computeH(const glm::ivec3& a, const glm::ivec
 		core_assert_msg(false, "Connectivity parameter has an unrecognized value.");
 	}
 
-	//Sanity checks in debug mode. These can come out eventually, but I
-	//want to make sure that the heuristics I've come up with make sense.
-	core_assert_msg((a - b).length() > TwentySixConnectedCost(a, b), "A* heuristic error.");
-	core_assert_msg(TwentySixConnectedCost(a, b) > EighteenConnectedCost(a, b), "A* heuristic error.");
-	core_assert_msg(EighteenConnectedCost(a, b) > SixConnectedCost(a, b), "A* heuristic error.");
-
 	//Apply the bias to the computed h value;
 	hVal *= _params.hBias;
 
@@ -443,10 +421,9 @@ float AStarPathfinder<VolumeType>::computeH(const glm::ivec3& a, const glm::ivec
 	//See http://theory.stanford.edu/~amitp/GameProgramming/Heuristics.html#S12
 
 	//Note that if the hash is zero we can have differences between the Linux vs. Windows
-	//(or perhaps GCC vs. VS) versions of the code. This is probably because of the way
-	//sorting inside the std::set works (i.e. one system swaps values which are identical
-	//while the other one doesn't - both approaches are valid). For the same reason we want
-	//to make sure that position (x,y,z) has a different hash from e.g. position (x,z,y).
+	//(or perhaps GCC vs. VS) versions of the code. This is because nodes with identical
+	//costs may leave the open list in any order. For the same reason we want to make sure
+	//that position (x,y,z) has a different hash from e.g. position (x,z,y).
 	const uint32_t aX = (a.x << 16) & 0x00FF0000;
 	const uint32_t aY = (a.y << 8) & 0x0000FF00;
 	const uint32_t aZ = (a.z) & 0x000000FF;
@@ -465,8 +442,8 @@ float AStarPathfinder<VolumeType>::computeH(const glm::ivec3& a, const glm::ivec
  * Robert Jenkins' 32 bit integer hash function
  * http://www.burtleburtle.net/bob/hash/integer.html
  */
-template<typename VolumeType>
-uint32_t AStarPathfinder<VolumeType>::hash(uint32_t a) {
+template<typename VolumeType, typename Validator>
+uint32_t AStarPathfinder<VolumeType, Validator>::hash(uint32_t a) {
 	a = (a + 0x7ed55d16) + (a << 12);
 	a = (a ^ 0xc761c23c) ^ (a >> 19);
 	a = (a + 0x165667b1) + (a << 5);
@@ -5,17 +5,15 @@
 #pragma once
 
 #include "core/Common.h"
+#include "core/GLM.h"
 
 #include <algorithm>
 #include <limits> //For numeric_limits
-#include <set>
+#include <utility>
 #include <vector>
 
 namespace voxel {
 
-class OpenNodesContainer;
-class ClosedNodesContainer;
-
 /// The Connectivity of a voxel determines how many neighbours it has.
 enum Connectivity {
 	/// Each voxel has six neighbours, which are those sharing a face.
@@ -27,137 +25,209 @@ enum Connectivity {
 };
 
 struct Node {
-	Node(int x, int y, int z) :
-			// Initialise with NaNs so that we will know if we forget to set these properly.
-			gVal(std::numeric_limits<float>::quiet_NaN()), hVal(std::numeric_limits<float>::quiet_NaN()), parent(nullptr) {
-		position = {x, y, z};
-	}
-
-	bool operator==(const Node& rhs) const {
-		return position == rhs.position;
-	}
-
-	bool operator<(const Node& rhs) const {
-		if (position.x < rhs.position.x)
-			return true;
-		if (rhs.position.x < position.x)
-			return false;
+	/// The node was not yet added to the open list
+	static constexpr int32_t New = -1;
+	/// The node was already expanded
+	static constexpr int32_t Closed = -2;
+	static constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
 
-		if (position.y < rhs.position.y)
-			return true;
-		if (rhs.position.y < position.y)
-			return false;
-
-		if (position.z < rhs.position.z)
-			return true;
-		if (rhs.position.z < position.z)
-			return false;
-
-		return false;
+	Node(const glm::ivec3& pos) :
+			// Initialise with NaNs so that we will know if we forget to set these properly.
+			position(pos), gVal(std::numeric_limits<float>::quiet_NaN()), hVal(std::numeric_limits<float>::quiet_NaN()),
+			parent(InvalidIndex), heapIndex(New) {
 	}
 
 	glm::ivec3 position;
 	float gVal;
 	float hVal;
-	Node* parent;
+	/// index of the parent node in the @c NodePool
+	uint32_t parent;
+	/// the position in the open list - or one of @c New and @c Closed
+	int32_t heapIndex;
 
 	inline float f() const {
 		return gVal + hVal;
 	}
 };
 
-typedef std::set<Node> AllNodesContainer;
-
-class AllNodesContainerIteratorComparator {
-public:
-	bool operator()(const AllNodesContainer::iterator& lhs, const AllNodesContainer::iterator& rhs) const {
-		return (&(*lhs)) < (&(*rhs));
+/**
+ * @brief Stores all the nodes of a search and finds them by their position.
+ *
+ * The nodes are stored in a flat array and addressed by index. The lookup is an open addressing
+ * hash table with linear probing. Clearing the pool keeps the memory - the hash table slots are
+ * invalidated by bumping a generation counter - so a pool can be reused for many searches without
+ * allocating.
+ */
+class NodePool {
+private:
+	struct Slot {
+		uint32_t generation = 0u;
+		uint32_t index = 0u;
+	};
+	std::vector<Node> _nodes;
+	std::vector<Slot> _slots;
+	uint32_t _generation = 1u;
+
+	static inline uint32_t hash(const glm::ivec3& pos) {
+		return (uint32_t)pos.x * 73856093u ^ (uint32_t)pos.y * 19349663u ^ (uint32_t)pos.z * 83492791u;
+	}
+
+	void grow() {
+		const size_t capacity = std::max(size_t(1024u), _slots.size() * 2u);
+		_slots.assign(capacity, Slot());
+		_generation = 1u;
+		const uint32_t mask = (uint32_t)capacity - 1u;
+		for (uint32_t i = 0u; i < (uint32_t)_nodes.size(); ++i) {
+			uint32_t slot = hash(_nodes[i].position) & mask;
+			while (_slots[slot].generation == _generation) {
+				slot = (slot + 1u) & mask;
+			}
+			_slots[slot].generation = _generation;
+			_slots[slot].index = i;
+		}
 	}
-};
 
-class NodeSort {
 public:
-	bool operator()(const AllNodesContainer::iterator& lhs, const AllNodesContainer::iterator& rhs) const {
-		return lhs->f() > rhs->f();
+	inline void clear() {
+		_nodes.clear();
+		if (++_generation == 0u) {
+			// the generation wrapped - all slots must be reset
+			_slots.assign(_slots.size(), Slot());
+			_generation = 1u;
+		}
+	}
+
+	inline size_t size() const {
+		return _nodes.size();
+	}
+
+	inline Node& operator[](uint32_t index) {
+		return _nodes[index];
+	}
+
+	inline const Node& operator[](uint32_t index) const {
+		return _nodes[index];
+	}
+
+	/**
+	 * @return The index of the node at the given position and @c true if the node was created
+	 */
+	std::pair<uint32_t, bool> insert(const glm::ivec3& pos) {
+		// keep the load factor below 0.5
+		if ((_nodes.size() + 1u) * 2u > _slots.size()) {
+			grow();
+		}
+		const uint32_t mask = (uint32_t)_slots.size() - 1u;
+		uint32_t slot = hash(pos) & mask;
+		while (_slots[slot].generation == _generation) {
+			const uint32_t index = _slots[slot].index;
+			if (_nodes[index].position == pos) {
+				return std::make_pair(index, false);
+			}
+			slot = (slot + 1u) & mask;
+		}
+		const uint32_t index = (uint32_t)_nodes.size();
+		_nodes.emplace_back(pos);
+		_slots[slot].generation = _generation;
+		_slots[slot].index = index;
+		return std::make_pair(index, true);
 	}
 };
 
+/**
+ * @brief Binary min heap (by @c Node::f()) of node indices. Every node knows its own
+ * position in the heap, which allows to update the costs of an open node in O(log n).
+ */
 class OpenNodesContainer {
-public:
-	typedef std::vector<AllNodesContainer::iterator>::iterator iterator;
-
-public:
-	inline void clear() {
-		open.clear();
-	}
-
-	inline bool empty() const {
-		return open.empty();
-	}
-
-	void insert(AllNodesContainer::iterator node) {
-		open.push_back(node);
-		push_heap(open.begin(), open.end(), NodeSort());
-	}
-
-	inline AllNodesContainer::iterator getFirst() {
-		return open[0];
-	}
-
-	void removeFirst() {
-		pop_heap(open.begin(), open.end(), NodeSort());
-		open.pop_back();
-	}
-
-	void remove(iterator iterToRemove) {
-		open.erase(iterToRemove);
-		make_heap(open.begin(), open.end(), NodeSort());
-	}
-
-	inline iterator begin() {
-		return open.begin();
-	}
-
-	inline iterator end() {
-		return open.end();
-	}
-
-	iterator find(AllNodesContainer::iterator node) {
-		std::vector<AllNodesContainer::iterator>::iterator openIter = std::find(open.begin(), open.end(), node);
-		return openIter;
-	}
-
 private:
-	std::vector<AllNodesContainer::iterator> open;
-};
+	std::vector<uint32_t> _heap;
+	NodePool& _pool;
+
+	inline bool lower(uint32_t a, uint32_t b) const {
+		return _pool[a].f() < _pool[b].f();
+	}
+
+	inline void place(size_t pos, uint32_t node) {
+		_heap[pos] = node;
+		_pool[node].heapIndex = (int32_t)pos;
+	}
+
+	void siftUp(size_t pos) {
+		const uint32_t node = _heap[pos];
+		while (pos > 0u) {
+			const size_t parent = (pos - 1u) / 2u;
+			if (!lower(node, _heap[parent])) {
+				break;
+			}
+			place(pos, _heap[parent]);
+			pos = parent;
+		}
+		place(pos, node);
+	}
+
+	void siftDown(size_t pos) {
+		const uint32_t node = _heap[pos];
+		const size_t size = _heap.size();
+		for (;;) {
+			size_t child = pos * 2u + 1u;
+			if (child >= size) {
+				break;
+			}
+			if (child + 1u < size && lower(_heap[child + 1u], _heap[child])) {
+				++child;
+			}
+			if (!lower(_heap[child], node)) {
+				break;
+			}
+			place(pos, _heap[child]);
+			pos = child;
+		}
+		place(pos, node);
+	}
 
-class ClosedNodesContainer {
 public:
-	typedef std::set<AllNodesContainer::iterator, AllNodesContainerIteratorComparator>::iterator iterator;
+	explicit OpenNodesContainer(NodePool& pool) :
+			_pool(pool) {
+	}
 
-public:
 	inline void clear() {
-		closed.clear();
+		_heap.clear();
 	}
 
-	inline void insert(AllNodesContainer::iterator node) {
-		closed.insert(node);
+	inline bool empty() const {
+		return _heap.empty();
 	}
 
-	inline void remove(iterator iterToRemove) {
-		closed.erase(iterToRemove);
+	inline void insert(uint32_t node) {
+		_heap.push_back(node);
+		siftUp(_heap.size() - 1u);
 	}
 
-	inline iterator end() {
-		return closed.end();
+	inline uint32_t getFirst() const {
+		return _heap[0];
 	}
 
-	inline iterator find(AllNodesContainer::iterator node) {
-		return closed.find(node);
+	/**
+	 * @brief Removes the node with the lowest costs - the node is marked as closed
+	 */
+	uint32_t removeFirst() {
+		const uint32_t first = _heap[0];
+		_pool[first].heapIndex = Node::Closed;
+		const uint32_t last = _heap.back();
+		_heap.pop_back();
+		if (!_heap.empty()) {
+			_heap[0] = last;
+			siftDown(0u);
+		}
+		return first;
 	}
 
-private:
-	std::set<AllNodesContainer::iterator, AllNodesContainerIteratorComparator> closed;
+	/**
+	 * @brief Must be called after the costs of an open node were lowered
+	 */
+	inline void decreased(uint32_t node) {
+		siftUp((size_t)_pool[node].heapIndex);
+	}
 };
 
 }
@@ -0,0 +1,437 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "AStarPathfinder.h"
+#include "core/Trace.h"
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <queue>
+
+namespace voxel {
+
+/**
+ * @brief Hierarchical pathfinding (HPA*) on top of the AStarPathfinder.
+ *
+ * The volume is split into cubic sectors. One portal is placed for each connected walkable area on
+ * the face that two neighbouring sectors share. Inside a sector, the portals are connected with the
+ * cost of the shortest path between them. A path to a target that is farther away than the
+ * neighbouring sectors is searched on this coarse graph first. Only the first coarse segment is refined
+ * to voxel resolution.
+ *
+ * Sectors are built on demand. invalidate() marks a sector for a rebuild after one of its voxels changed.
+ *
+ * @note All methods may be called from several threads. The coarse search is serialized, while the
+ * voxel searches run in parallel.
+ */
+template<typename VolumeType, typename Validator = AStarDefaultVoxelValidator<VolumeType> >
+class HierarchicalPathfinder {
+public:
+	typedef AStarPathfinder<VolumeType, Validator> Pathfinder;
+
+	/**
+	 * @brief If more sectors are known, all of them are thrown away and rebuilt on demand
+	 */
+	static constexpr size_t MaxSectors = 4096u;
+
+	HierarchicalPathfinder(VolumeType* volume, int sectorSize, const Validator& validator = Validator()) :
+			_volume(volume), _sectorSize(sectorSize), _validator(validator) {
+	}
+
+	/**
+	 * @brief Must be called after the voxel at the given position changed
+	 */
+	void invalidate(const glm::ivec3& pos);
+
+	void clear();
+
+	/**
+	 * @brief Searches a path from @c start to @c end.
+	 *
+	 * If the target is not in the same or a neighbouring sector, the result only contains the voxels up to
+	 * the first coarse waypoint, followed by the remaining coarse waypoints. Search again once the first
+	 * waypoint was reached.
+	 *
+	 * @param[in] maxNodes The node budget for the coarse and the voxel search
+	 * @return @c true if a path was found
+	 */
+	bool findPath(const glm::ivec3& start, const glm::ivec3& end, std::list<glm::ivec3>& result, uint32_t maxNodes);
+
+	glm::ivec3 sectorPos(const glm::ivec3& pos) const;
+
+	/**
+	 * @return The amount of sectors that are currently built
+	 */
+	size_t sectors();
+
+private:
+	struct Edge {
+		uint32_t node;
+		float cost;
+	};
+
+	struct Sector {
+		bool valid = false;
+		// the portal voxels inside of this sector
+		std::vector<glm::ivec3> nodes;
+		// the voxel on the other side of the portal - same index as the node
+		std::vector<glm::ivec3> links;
+		// the connections to the other nodes inside of this sector
+		std::vector<std::vector<Edge> > edges;
+
+		inline int find(const glm::ivec3& pos) const {
+			for (size_t i = 0; i < nodes.size(); ++i) {
+				if (nodes[i] == pos) {
+					return (int)i;
+				}
+			}
+			return -1;
+		}
+	};
+
+	typedef std::unordered_map<glm::ivec3, Sector, std::hash<glm::ivec3> > Sectors;
+
+	static inline int floorDiv(int a, int b) {
+		return (a >= 0 ? a : a - b + 1) / b;
+	}
+
+	inline bool walkable(const glm::ivec3& pos) const {
+		return _validator(_volume, pos);
+	}
+
+	inline int localIndex(const glm::ivec3& sectorMins, const glm::ivec3& pos) const {
+		const glm::ivec3 local = pos - sectorMins;
+		return local.x + _sectorSize * (local.y + _sectorSize * local.z);
+	}
+
+	Sector& sector(const glm::ivec3& sectorPos);
+	void build(const glm::ivec3& sectorPos, Sector& sector);
+	void sectorCosts(const glm::ivec3& sectorPos, const glm::ivec3& from);
+	bool coarsePath(const glm::ivec3& start, const glm::ivec3& end, std::list<glm::ivec3>& waypoints, uint32_t maxNodes);
+	bool voxelPath(const glm::ivec3& start, const glm::ivec3& end, std::list<glm::ivec3>& result, uint32_t maxNodes);
+	static float estimate(const glm::ivec3& a, const glm::ivec3& b);
+
+	VolumeType* _volume;
+	const int _sectorSize;
+	const Validator _validator;
+	std::mutex _mutex;
+	// guarded by _mutex
+	Sectors _sectors;
+	// the result of sectorCosts() - guarded by _mutex
+	std::vector<float> _costs;
+};
+
+template<typename VolumeType, typename Validator>
+inline glm::ivec3 HierarchicalPathfinder<VolumeType, Validator>::sectorPos(const glm::ivec3& pos) const {
+	return glm::ivec3(floorDiv(pos.x, _sectorSize), floorDiv(pos.y, _sectorSize), floorDiv(pos.z, _sectorSize));
+}
+
+template<typename VolumeType, typename Validator>
+size_t HierarchicalPathfinder<VolumeType, Validator>::sectors() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _sectors.size();
+}
+
+template<typename VolumeType, typename Validator>
+void HierarchicalPathfinder<VolumeType, Validator>::clear() {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_sectors.clear();
+}
+
+template<typename VolumeType, typename Validator>
+void HierarchicalPathfinder<VolumeType, Validator>::invalidate(const glm::ivec3& pos) {
+	const glm::ivec3& sp = sectorPos(pos);
+	const glm::ivec3 local = pos - sp * _sectorSize;
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto invalidateSector = [this] (const glm::ivec3& p) {
+		auto i = _sectors.find(p);
+		if (i != _sectors.end()) {
+			i->second.valid = false;
+		}
+	};
+	invalidateSector(sp);
+	// the portals of the neighbours also depend on the voxels at the border
+	for (int axis = 0; axis < 3; ++axis) {
+		glm::ivec3 neighbour = sp;
+		if (local[axis] == 0) {
+			neighbour[axis] -= 1;
+		} else if (local[axis] == _sectorSize - 1) {
+			neighbour[axis] += 1;
+		} else {
+			continue;
+		}
+		invalidateSector(neighbour);
+	}
+}
+
+template<typename VolumeType, typename Validator>
+typename HierarchicalPathfinder<VolumeType, Validator>::Sector& HierarchicalPathfinder<VolumeType, Validator>::sector(const glm::ivec3& sectorPos) {
+	// references to the elements stay valid if the map grows
+	Sector& s = _sectors[sectorPos];
+	if (!s.valid) {
+		build(sectorPos, s);
+	}
+	return s;
+}
+
+template<typename VolumeType, typename Validator>
+void HierarchicalPathfinder<VolumeType, Validator>::build(const glm::ivec3& sectorPos, Sector& s) {
+	core_trace_scoped(HierarchicalPathfinderBuildSector);
+	s.nodes.clear();
+	s.links.clear();
+	s.edges.clear();
+	const int size = _sectorSize;
+	const glm::ivec3 mins = sectorPos * size;
+	std::vector<uint8_t> open(size * size);
+	std::vector<int> area;
+	std::vector<int> todo;
+	for (int axis = 0; axis < 3; ++axis) {
+		const int u = (axis + 1) % 3;
+		const int v = (axis + 2) % 3;
+		for (int dir = -1; dir <= 1; dir += 2) {
+			glm::ivec3 normal(0);
+			normal[axis] = dir;
+			glm::ivec3 pos;
+			pos[axis] = dir < 0 ? mins[axis] : mins[axis] + size - 1;
+			for (int j = 0; j < size; ++j) {
+				for (int i = 0; i < size; ++i) {
+					pos[u] = mins[u] + i;
+					pos[v] = mins[v] + j;
+					open[j * size + i] = walkable(pos) && walkable(pos + normal);
+				}
+			}
+			// one portal per connected area - both sectors pick the same voxels as they scan
+			// the face in the same order
+			for (int start = 0; start < size * size; ++start) {
+				if (!open[start]) {
+					continue;
+				}
+				area.clear();
+				todo.push_back(start);
+				open[start] = 0;
+				while (!todo.empty()) {
+					const int idx = todo.back();
+					todo.pop_back();
+					area.push_back(idx);
+					const int i = idx % size;
+					const int j = idx / size;
+					const int neighbours[4][2] = { { i - 1, j }, { i + 1, j }, { i, j - 1 }, { i, j + 1 } };
+					for (const auto& n : neighbours) {
+						if (n[0] < 0 || n[0] >= size || n[1] < 0 || n[1] >= size) {
+							continue;
+						}
+						const int nidx = n[1] * size + n[0];
+						if (open[nidx]) {
+							open[nidx] = 0;
+							todo.push_back(nidx);
+						}
+					}
+				}
+				std::sort(area.begin(), area.end());
+				const int portal = area[area.size() / 2];
+				pos[u] = mins[u] + portal % size;
+				pos[v] = mins[v] + portal / size;
+				s.nodes.push_back(pos);
+				s.links.push_back(pos + normal);
+			}
+		}
+	}
+
+	const float inf = std::numeric_limits<float>::max();
+	s.edges.resize(s.nodes.size());
+	for (size_t i = 0; i < s.nodes.size(); ++i) {
+		sectorCosts(sectorPos, s.nodes[i]);
+		for (size_t j = 0; j < s.nodes.size(); ++j) {
+			if (i == j) {
+				continue;
+			}
+			const float cost = _costs[localIndex(mins, s.nodes[j])];
+			if (cost < inf) {
+				s.edges[i].push_back(Edge{(uint32_t)j, cost});
+			}
+		}
+	}
+	s.valid = true;
+}
+
+template<typename VolumeType, typename Validator>
+void HierarchicalPathfinder<VolumeType, Validator>::sectorCosts(const glm::ivec3& sectorPos, const glm::ivec3& from) {
+	const int size = _sectorSize;
+	const glm::ivec3 mins = sectorPos * size;
+	_costs.assign(size * size * size, std::numeric_limits<float>::max());
+
+	static const glm::ivec3* offsets[] = { arrayPathfinderFaces, arrayPathfinderEdges, arrayPathfinderCorners };
+	static const int offsetCount[] = { 6, 12, 8 };
+	const float offsetCost[] = { 1.0f, glm::root_two<float>(), glm::root_three<float>() };
+
+	typedef std::pair<float, int> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > queue;
+	const int fromIdx = localIndex(mins, from);
+	_costs[fromIdx] = 0.0f;
+	queue.emplace(0.0f, fromIdx);
+	while (!queue.empty()) {
+		const Entry e = queue.top();
+		queue.pop();
+		if (e.first > _costs[e.second]) {
+			continue;
+		}
+		const glm::ivec3 pos = mins + glm::ivec3(e.second % size, (e.second / size) % size, e.second / (size * size));
+		for (int type = 0; type < 3; ++type) {
+			for (int o = 0; o < offsetCount[type]; ++o) {
+				const glm::ivec3 n = pos + offsets[type][o];
+				const glm::ivec3 local = n - mins;
+				if (glm::any(glm::lessThan(local, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(local, glm::ivec3(size)))) {
+					continue;
+				}
+				const int nidx = localIndex(mins, n);
+				const float cost = e.first + offsetCost[type];
+				if (cost >= _costs[nidx] || !walkable(n)) {
+					continue;
+				}
+				_costs[nidx] = cost;
+				queue.emplace(cost, nidx);
+			}
+		}
+	}
+}
+
+template<typename VolumeType, typename Validator>
+float HierarchicalPathfinder<VolumeType, Validator>::estimate(const glm::ivec3& a, const glm::ivec3& b) {
+	int d[3] = { std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z) };
+	std::sort(&d[0], &d[3]);
+	return d[0] * glm::root_three<float>() + (d[1] - d[0]) * glm::root_two<float>() + (d[2] - d[1]);
+}
+
+template<typename VolumeType, typename Validator>
+bool HierarchicalPathfinder<VolumeType, Validator>::coarsePath(const glm::ivec3& start, const glm::ivec3& end, std::list<glm::ivec3>& waypoints, uint32_t maxNodes) {
+	core_trace_scoped(HierarchicalPathfinderCoarse);
+	if (_sectors.size() > MaxSectors) {
+		_sectors.clear();
+	}
+	const float inf = std::numeric_limits<float>::max();
+
+	// the costs from the portals of the target sector to the target
+	const glm::ivec3& endSectorPos = sectorPos(end);
+	const Sector& endSector = sector(endSectorPos);
+	sectorCosts(endSectorPos, end);
+	std::vector<float> endCosts(endSector.nodes.size());
+	for (size_t i = 0; i < endSector.nodes.size(); ++i) {
+		endCosts[i] = _costs[localIndex(endSectorPos * _sectorSize, endSector.nodes[i])];
+	}
+
+	struct Visit {
+		float g;
+		glm::ivec3 parent;
+		bool closed;
+	};
+	std::unordered_map<glm::ivec3, Visit, std::hash<glm::ivec3> > visits;
+	typedef std::pair<float, glm::ivec3> Entry;
+	auto cmp = [] (const Entry& a, const Entry& b) {
+		return a.first > b.first;
+	};
+	std::priority_queue<Entry, std::vector<Entry>, decltype(cmp)> open(cmp);
+	visits.emplace(start, Visit{0.0f, start, false});
+	open.emplace(estimate(start, end), start);
+
+	uint32_t expanded = 0u;
+	while (!open.empty()) {
+		const glm::ivec3 pos = open.top().second;
+		open.pop();
+		Visit& visit = visits[pos];
+		if (visit.closed) {
+			continue;
+		}
+		visit.closed = true;
+		if (pos == end) {
+			for (glm::ivec3 p = end; p != start; p = visits[p].parent) {
+				waypoints.push_front(p);
+			}
+			waypoints.push_front(start);
+			return true;
+		}
+		if (++expanded > maxNodes) {
+			return false;
+		}
+		const float g = visit.g;
+		auto relax = [&] (const glm::ivec3& next, float cost) {
+			const float nextG = g + cost;
+			auto i = visits.emplace(next, Visit{nextG, pos, false});
+			if (!i.second) {
+				Visit& known = i.first->second;
+				if (known.closed || known.g <= nextG) {
+					return;
+				}
+				known.g = nextG;
+				known.parent = pos;
+			}
+			open.emplace(nextG + estimate(next, end), next);
+		};
+
+		const glm::ivec3& sp = sectorPos(pos);
+		const Sector& s = sector(sp);
+		if (pos == start) {
+			sectorCosts(sp, start);
+			for (const glm::ivec3& node : s.nodes) {
+				const float cost = _costs[localIndex(sp * _sectorSize, node)];
+				if (cost < inf) {
+					relax(node, cost);
+				}
+			}
+			continue;
+		}
+		const int idx = s.find(pos);
+		if (idx < 0) {
+			// the sector was rebuilt and the portal is gone
+			continue;
+		}
+		relax(s.links[idx], 1.0f);
+		for (const Edge& edge : s.edges[idx]) {
+			relax(s.nodes[edge.node], edge.cost);
+		}
+		if (sp == endSectorPos && endCosts[idx] < inf) {
+			relax(end, endCosts[idx]);
+		}
+	}
+	return false;
+}
+
+template<typename VolumeType, typename Validator>
+bool HierarchicalPathfinder<VolumeType, Validator>::voxelPath(const glm::ivec3& start, const glm::ivec3& end, std::list<glm::ivec3>& result, uint32_t maxNodes) {
+	const typename Pathfinder::Params params(_volume, start, end, &result, 1.0f, maxNodes, TwentySixConnected, _validator);
+	// keep the node pool of the pathfinder between the searches
+	static thread_local Pathfinder pf(params);
+	pf.reset(params);
+	return pf.execute();
+}
+
+template<typename VolumeType, typename Validator>
+bool HierarchicalPathfinder<VolumeType, Validator>::findPath(const glm::ivec3& start, const glm::ivec3& end, std::list<glm::ivec3>& result, uint32_t maxNodes) {
+	const glm::ivec3 distance = glm::abs(sectorPos(end) - sectorPos(start));
+	if (glm::all(glm::lessThanEqual(distance, glm::ivec3(1)))) {
+		return voxelPath(start, end, result, maxNodes);
+	}
+	result.clear();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!coarsePath(start, end, result, maxNodes)) {
+			result.clear();
+			return false;
+		}
+	}
+	// replace the first coarse segment with the voxels
+	result.pop_front();
+	const glm::ivec3 waypoint = result.front();
+	result.pop_front();
+	std::list<glm::ivec3> segment;
+	if (!voxelPath(start, waypoint, segment, maxNodes)) {
+		result.clear();
+		return false;
+	}
+	result.splice(result.begin(), segment);
+	return true;
+}
+
+}
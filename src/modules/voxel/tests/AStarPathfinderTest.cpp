@@ -0,0 +1,99 @@
+/**
+ * @file
+ */
+
+#include "AbstractVoxelTest.h"
+#include "voxel/polyvox/AStarPathfinder.h"
+
+namespace voxel {
+
+class AStarPathfinderTest: public AbstractVoxelTest {
+protected:
+	struct AirValidator {
+		inline bool operator()(const RawVolume* volData, const glm::ivec3& pos) const {
+			return volData->region().containsPoint(pos) && isAir(volData->voxel(pos).getMaterial());
+		}
+	};
+	typedef AStarPathfinder<RawVolume, AirValidator> Pathfinder;
+
+	/**
+	 * A wall in the middle of the volume - with a gap at the upper end of the z axis
+	 */
+	void buildWall(RawVolume& volume) const {
+		const Region& region = volume.region();
+		const int x = region.getCentreX();
+		for (int y = region.getLowerY(); y <= region.getUpperY(); ++y) {
+			for (int z = region.getLowerZ(); z < region.getUpperZ(); ++z) {
+				volume.setVoxel(x, y, z, createVoxel(VoxelType::Rock, 0));
+			}
+		}
+	}
+};
+
+TEST_F(AStarPathfinderTest, testStraightPath) {
+	RawVolume volume(Region(0, 15));
+	std::list<glm::ivec3> result;
+	const AStarPathfinderParams<RawVolume> params(&volume, glm::ivec3(0), glm::ivec3(15, 0, 0), &result, 1.0f, 10000, SixConnected);
+	AStarPathfinder<RawVolume> pf(params);
+	ASSERT_TRUE(pf.execute());
+	ASSERT_EQ(16u, result.size());
+	EXPECT_EQ(glm::ivec3(0), result.front());
+	EXPECT_EQ(glm::ivec3(15, 0, 0), result.back());
+}
+
+TEST_F(AStarPathfinderTest, testAroundWall) {
+	RawVolume volume(Region(0, 15));
+	buildWall(volume);
+	std::list<glm::ivec3> result;
+	const glm::ivec3 start(0, 0, 0);
+	const glm::ivec3 end(15, 0, 0);
+	const Pathfinder::Params params(&volume, start, end, &result, 1.0f, 10000, SixConnected);
+	Pathfinder pf(params);
+	ASSERT_TRUE(pf.execute());
+	ASSERT_FALSE(result.empty());
+	EXPECT_EQ(start, result.front());
+	EXPECT_EQ(end, result.back());
+	// the only gap is at z = 15 - so the shortest path has to go there and back
+	EXPECT_EQ(15u + 15u + 15u + 1u, result.size());
+	glm::ivec3 last = result.front();
+	for (const glm::ivec3& pos : result) {
+		EXPECT_TRUE(isAir(volume.voxel(pos).getMaterial())) << glm::to_string(pos);
+		const glm::ivec3 d = glm::abs(pos - last);
+		EXPECT_LE(d.x + d.y + d.z, 1) << glm::to_string(pos);
+		last = pos;
+	}
+}
+
+TEST_F(AStarPathfinderTest, testNodeBudget) {
+	RawVolume volume(Region(0, 31));
+	buildWall(volume);
+	std::list<glm::ivec3> result;
+	const glm::ivec3 start(0, 0, 0);
+	const glm::ivec3 end(31, 0, 0);
+	Pathfinder pf(Pathfinder::Params(&volume, start, end, &result, 1.0f, 100, TwentySixConnected));
+	EXPECT_FALSE(pf.execute()) << "The node budget should have been exceeded";
+	EXPECT_TRUE(result.empty());
+
+	// reuse the pooled nodes of the previous search with a bigger budget
+	pf.reset(Pathfinder::Params(&volume, start, end, &result, 1.0f, 100000, TwentySixConnected));
+	ASSERT_TRUE(pf.execute());
+	EXPECT_EQ(start, result.front());
+	EXPECT_EQ(end, result.back());
+}
+
+TEST_F(AStarPathfinderTest, testNoPath) {
+	RawVolume volume(Region(0, 7));
+	const Region& region = volume.region();
+	// close the gap, too
+	for (int y = region.getLowerY(); y <= region.getUpperY(); ++y) {
+		for (int z = region.getLowerZ(); z <= region.getUpperZ(); ++z) {
+			volume.setVoxel(region.getCentreX(), y, z, createVoxel(VoxelType::Rock, 0));
+		}
+	}
+	std::list<glm::ivec3> result;
+	Pathfinder pf(Pathfinder::Params(&volume, glm::ivec3(0), glm::ivec3(7, 0, 0), &result));
+	EXPECT_FALSE(pf.execute());
+	EXPECT_TRUE(result.empty());
+}
+
+}
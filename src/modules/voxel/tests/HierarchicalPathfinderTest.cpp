@@ -0,0 +1,112 @@
+/**
+ * @file
+ */
+
+#include "AbstractVoxelTest.h"
+#include "voxel/polyvox/HierarchicalPathfinder.h"
+
+namespace voxel {
+
+class HierarchicalPathfinderTest: public AbstractVoxelTest {
+protected:
+	struct AirValidator {
+		inline bool operator()(const RawVolume* volData, const glm::ivec3& pos) const {
+			return volData->region().containsPoint(pos) && isAir(volData->voxel(pos).getMaterial());
+		}
+	};
+	typedef HierarchicalPathfinder<RawVolume, AirValidator> Pathfinder;
+
+	void setWall(RawVolume& volume, int x, bool gap, const VoxelType type) const {
+		const Region& region = volume.region();
+		for (int y = region.getLowerY(); y <= region.getUpperY(); ++y) {
+			for (int z = region.getLowerZ(); z <= region.getUpperZ(); ++z) {
+				if (gap && z == region.getUpperZ()) {
+					continue;
+				}
+				volume.setVoxel(x, y, z, createVoxel(type, 0));
+			}
+		}
+	}
+
+	void validate(const RawVolume& volume, const std::list<glm::ivec3>& result, const glm::ivec3& start, const glm::ivec3& end) const {
+		ASSERT_FALSE(result.empty());
+		EXPECT_EQ(start, result.front());
+		EXPECT_EQ(end, result.back());
+		for (const glm::ivec3& pos : result) {
+			EXPECT_TRUE(isAir(volume.voxel(pos).getMaterial())) << glm::to_string(pos);
+		}
+	}
+};
+
+TEST_F(HierarchicalPathfinderTest, testNeighbourSectorIsVoxelPath) {
+	RawVolume volume(Region(0, 15));
+	Pathfinder pf(&volume, 8);
+	std::list<glm::ivec3> result;
+	const glm::ivec3 start(0, 0, 0);
+	const glm::ivec3 end(15, 0, 0);
+	ASSERT_TRUE(pf.findPath(start, end, result, 10000u));
+	validate(volume, result, start, end);
+	EXPECT_EQ(16u, result.size());
+	EXPECT_EQ(0u, pf.sectors()) << "No coarse search was needed";
+}
+
+TEST_F(HierarchicalPathfinderTest, testCoarsePath) {
+	RawVolume volume(Region(glm::ivec3(0), glm::ivec3(63, 7, 7)));
+	setWall(volume, 20, true, VoxelType::Rock);
+	Pathfinder pf(&volume, 8);
+	std::list<glm::ivec3> result;
+	const glm::ivec3 start(0, 0, 0);
+	const glm::ivec3 end(63, 0, 0);
+	ASSERT_TRUE(pf.findPath(start, end, result, 10000u));
+	validate(volume, result, start, end);
+	EXPECT_GT(pf.sectors(), 0u);
+	// the first segment is refined - it leads to the portal of the start sector
+	auto i = result.begin();
+	glm::ivec3 last = *i;
+	for (++i; i != result.end(); ++i) {
+		const glm::ivec3 d = glm::abs(*i - last);
+		if (glm::max(d.x, glm::max(d.y, d.z)) > 1) {
+			break;
+		}
+		last = *i;
+	}
+	EXPECT_NE(pf.sectorPos(start), pf.sectorPos(last)) << "The refined segment should end in the neighbour sector";
+	// followed by the coarse waypoints - the portals at the sector borders
+	for (; i != result.end(); ++i) {
+		if (*i == end) {
+			break;
+		}
+		const int local = i->x % 8;
+		EXPECT_TRUE(local == 0 || local == 7) << glm::to_string(*i);
+	}
+}
+
+TEST_F(HierarchicalPathfinderTest, testInvalidate) {
+	RawVolume volume(Region(glm::ivec3(0), glm::ivec3(63, 7, 7)));
+	setWall(volume, 20, true, VoxelType::Rock);
+	Pathfinder pf(&volume, 8);
+	std::list<glm::ivec3> result;
+	const glm::ivec3 start(0, 0, 0);
+	const glm::ivec3 end(63, 0, 0);
+	ASSERT_TRUE(pf.findPath(start, end, result, 10000u));
+
+	// close the gap
+	setWall(volume, 20, false, VoxelType::Rock);
+	for (int y = 0; y <= 7; ++y) {
+		pf.invalidate(glm::ivec3(20, y, 7));
+	}
+	EXPECT_FALSE(pf.findPath(start, end, result, 10000u));
+	EXPECT_TRUE(result.empty());
+
+	// remove the wall completely
+	setWall(volume, 20, false, VoxelType::Air);
+	for (int y = 0; y <= 7; ++y) {
+		for (int z = 0; z <= 7; ++z) {
+			pf.invalidate(glm::ivec3(20, y, z));
+		}
+	}
+	ASSERT_TRUE(pf.findPath(start, end, result, 10000u));
+	validate(volume, result, start, end);
+}
+
+}
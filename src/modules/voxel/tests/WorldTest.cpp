@@ -7,6 +7,7 @@
 #include "config.h"
 #include <chrono>
 #include <string>
+#include <thread>
 
 namespace voxel {
 
@@ -75,6 +76,44 @@ protected:
 	}
 };
 
+TEST_F(WorldTest, testRequestPath) {
+	World world;
+	core::Var::get(cfg::VoxelMeshSize, "16", core::CV_READONLY);
+	const io::FilesystemPtr& filesystem = _testApp->filesystem();
+	ASSERT_TRUE(world.init(filesystem->load("world.lua"), filesystem->load("biomes.lua")));
+	world.setSeed(0);
+	world.setPersist(false);
+	const glm::ivec3 start(0, 1, 0);
+	const glm::ivec3 end(10, 1, 0);
+	// make sure there is a way
+	for (int x = start.x; x <= end.x; ++x) {
+		world.setVoxel(glm::ivec3(x, start.y, start.z), createVoxel(VoxelType::Rock, 0));
+	}
+	PathPtr path = world.requestPath(start, end);
+	ASSERT_TRUE((bool)path);
+	PathPtr same = world.requestPath(start, end);
+	EXPECT_EQ(path, same) << "Identical requests should share the search";
+	world.cancelPath(same);
+	EXPECT_FALSE((bool)same);
+
+	auto begin = std::chrono::high_resolution_clock::now();
+	while (!path->done()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - begin;
+		ASSERT_LT(elapsed.count(), 60 * 1000) << "Took too long to find the path";
+	}
+	ASSERT_EQ(Path::State::Found, path->state());
+	EXPECT_EQ(start, path->result().front());
+	EXPECT_EQ(end, path->result().back());
+
+	EXPECT_EQ(path, world.requestPath(start, end)) << "The found path should be cached";
+	world.setVoxel(start + glm::ivec3(5, 0, 0), createVoxel(VoxelType::Dirt, 0));
+	PathPtr invalidated = world.requestPath(start, end);
+	EXPECT_NE(path, invalidated) << "Changing a voxel in the chunk should invalidate the cached path";
+	world.cancelPath(invalidated);
+	world.shutdown();
+}
+
 TEST_F(WorldTest, testExtractionMultiple) {
 	extract(4);
 }
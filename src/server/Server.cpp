@@ -10,12 +10,15 @@
 #include "attrib/ContainerProvider.h"
 #include "backend/poi/PoiProvider.h"
 #include "backend/entity/EntityStorage.h"
+#include "backend/entity/InterestProvider.h"
 #include "backend/entity/ai/AIRegistry.h"
 #include "backend/entity/ai/AILoader.h"
 #include "backend/loop/ServerLoop.h"
 #include "backend/spawn/SpawnMgr.h"
+#include "persistence/Executor.h"
 
 #include <cstdlib>
+#include <algorithm>
 
 Server::Server(const network::NetworkPtr& network, const backend::ServerLoopPtr& serverLoop,
 		const core::TimeProviderPtr& timeProvider, const io::FilesystemPtr& filesystem,
@@ -36,6 +39,9 @@ core::AppState Server::onConstruct() {
 	core::Var::get(cfg::ServerPort, "11337");
 	core::Var::get(cfg::ServerHost, "");
 	core::Var::get(cfg::ServerMaxClients, "1024");
+	core::Var::get(cfg::ServerIncomingBandwidth, "0");
+	core::Var::get(cfg::ServerOutgoingBandwidth, "0");
+	core::Var::get(cfg::ServerPeerBandwidth, "131072");
 	core::Var::get(cfg::ServerAutoRegister, "true");
 	core::Var::get(cfg::ServerSeed, "1");
 	core::Var::get(cfg::VoxelMeshSize, "16", core::CV_READONLY);
@@ -64,7 +70,10 @@ core::AppState Server::onInit() {
 	const core::VarPtr& port = core::Var::getSafe(cfg::ServerPort);
 	const core::VarPtr& host = core::Var::getSafe(cfg::ServerHost);
 	const core::VarPtr& maxclients = core::Var::getSafe(cfg::ServerMaxClients);
-	if (!_network->bind(port->intVal(), host->strVal(), maxclients->intVal(), 2)) {
+	const uint32_t incomingBandwidth = (uint32_t)std::max(0, core::Var::getSafe(cfg::ServerIncomingBandwidth)->intVal());
+	const uint32_t outgoingBandwidth = (uint32_t)std::max(0, core::Var::getSafe(cfg::ServerOutgoingBandwidth)->intVal());
+	_network->setPeerBandwidth((uint32_t)std::max(0, core::Var::getSafe(cfg::ServerPeerBandwidth)->intVal()));
+	if (!_network->bind(port->intVal(), host->strVal(), maxclients->intVal(), 2, incomingBandwidth, outgoingBandwidth)) {
 		Log::error("Failed to bind the server socket on %s:%i", host->strVal().c_str(), port->intVal());
 		return core::AppState::Cleanup;
 	}
@@ -101,11 +110,15 @@ int main(int argc, char *argv[]) {
 
 	const cooldown::CooldownProviderPtr& cooldownProvider = std::make_shared<cooldown::CooldownProvider>();
 
+	const backend::InterestProviderPtr& interestProvider = std::make_shared<backend::InterestProvider>();
+
+	const persistence::ExecutorPtr& executor = std::make_shared<persistence::Executor>();
+
 	const backend::PoiProviderPtr& poiProvider = std::make_shared<backend::PoiProvider>(world, timeProvider);
-	const backend::EntityStoragePtr& entityStorage = std::make_shared<backend::EntityStorage>(messageSender, world, timeProvider, containerProvider, poiProvider, cooldownProvider);
+	const backend::EntityStoragePtr& entityStorage = std::make_shared<backend::EntityStorage>(messageSender, world, timeProvider, containerProvider, poiProvider, cooldownProvider, interestProvider, executor);
 	const backend::SpawnMgrPtr& spawnMgr = std::make_shared<backend::SpawnMgr>(world, entityStorage, messageSender, timeProvider, loader, containerProvider, poiProvider, cooldownProvider);
 
-	const backend::ServerLoopPtr& serverLoop = std::make_shared<backend::ServerLoop>(network, spawnMgr, world, entityStorage, eventBus, registry, containerProvider, poiProvider, cooldownProvider);
+	const backend::ServerLoopPtr& serverLoop = std::make_shared<backend::ServerLoop>(network, spawnMgr, world, entityStorage, eventBus, registry, containerProvider, poiProvider, cooldownProvider, executor);
 
 	Server app(network, serverLoop, timeProvider, filesystem, eventBus);
 	return app.startMainLoop(argc, argv);
@@ -13,6 +13,9 @@ static const char *FieldTypeNames[] = {
 	CORE_STRINGIFY(TIMESTAMP)
 };
 
+// every combination of the non primary key fields gets an own select statement
+static const size_t MaxSelectFields = 8u;
+
 static const char *ConstraintTypeNames[] = {
 	CORE_STRINGIFY(UNIQUE),
 	CORE_STRINGIFY(PRIMARYKEY),
@@ -184,60 +187,104 @@ bool DatabaseTool::generateClassForTable(const Table& table, std::stringstream&
 	}
 	src << "\t}\n\n";
 
-	// ctor for non primary keys
-	int nonPrimaryKeyMembers = 0;
-	std::stringstream loadNonPk;
-	std::stringstream loadNonPkAdd;
+	// ctor and select for non primary keys
+	std::vector<const persistence::Model::Field*> nonPrimaryKeys;
+	for (auto& entry : table.fields) {
+		const persistence::Model::Field& f = entry.second;
+		if (!f.isPrimaryKey()) {
+			nonPrimaryKeys.push_back(&f);
+		}
+	}
+	if (nonPrimaryKeys.size() > MaxSelectFields) {
+		Log::error("Table %s has too many non primary key fields", table.name.c_str());
+		return false;
+	}
+	if (!nonPrimaryKeys.empty()) {
+		std::stringstream params;
+		std::stringstream args;
+		for (const persistence::Model::Field* f : nonPrimaryKeys) {
+			if (f != nonPrimaryKeys.front()) {
+				params << ", ";
+				args << ", ";
+			}
+			params << getCPPType(f->type, true, true) << " " << f->name;
+			args << f->name;
+		}
 
-	loadNonPk << "\t\tstd::stringstream __load_;\n\t\tint __count_ = 1;\n\t\tbool __andNeeded_ = false;\n";
+		src << "\t" << classname << "(" << params.str() << ") : " << classname << "() {\n";
+		for (const persistence::Model::Field* f : nonPrimaryKeys) {
+			src << "\t\tif (" << f->name << " != nullptr) {\n";
+			src << "\t\t\t_m._" << f->name << " = *" << f->name << ";\n";
+			src << "\t\t}\n";
+		}
+		src << "\t\tcore_assert_always(prepareSelect(" << args.str() << ").exec().result);\n";
+		src << "\t}\n\n";
 
-	for (auto entry : table.fields) {
-		const persistence::Model::Field& f = entry.second;
-		if (f.isPrimaryKey()) {
-			continue;
+		src << "\t/**\n";
+		src << "\t * @brief Loads all rows that match the given (non null) values\n";
+		src << "\t * @param[in] func Called with the model for every row\n";
+		src << "\t * @return @c true if the execution was successful, @c false otherwise\n";
+		src << "\t */\n";
+		src << "\ttemplate<class FUNC>\n";
+		src << "\tstatic bool select(" << params.str() << ", FUNC&& func) {\n";
+		src << "\t\t" << classname << " __model_;\n";
+		src << "\t\tconst Super::State __s_ = __model_.prepareSelect(" << args.str() << ").exec();\n";
+		src << "\t\tif (!__s_.result) {\n";
+		src << "\t\t\treturn false;\n";
+		src << "\t\t}\n";
+		src << "\t\tfor (int __row_ = 0; __row_ < __s_.affectedRows; ++__row_) {\n";
+		src << "\t\t\tif (!__model_.fillModelValues(__s_, __row_)) {\n";
+		src << "\t\t\t\treturn false;\n";
+		src << "\t\t\t}\n";
+		src << "\t\t\tfunc(__model_);\n";
+		src << "\t\t}\n";
+		src << "\t\treturn true;\n";
+		src << "\t}\n\n";
+
+		// every combination of given fields is an own named statement - the statement texts are
+		// generated here to not build them on every call
+		const uint32_t combinations = 1u << nonPrimaryKeys.size();
+		src << "protected:\n";
+		src << "\tSuper::PreparedStatement prepareSelect(" << params.str() << ") {\n";
+		src << "\t\tstatic const char* __names_[] = {\n";
+		for (uint32_t mask = 0u; mask < combinations; ++mask) {
+			src << "\t\t\t\"" << classname << "Select" << mask << "\",\n";
 		}
-		const std::string& cpptype = getCPPType(f.type, true, true);
-		if (nonPrimaryKeyMembers == 0) {
-			src << "\t" << classname << "(";
-			loadNonPk << "\t\t__load_ << \"SELECT * FROM " << table.name << " WHERE \";\n";
-		} else {
-			src << ", ";
-		}
-		src << cpptype << " " << f.name;
-		++nonPrimaryKeyMembers;
-		loadNonPk << "\t\tif (" << f.name << " != nullptr) {\n";
-		loadNonPk << "\t\t\t_m._" << f.name << " = *" << f.name << ";\n";
-		loadNonPk << "\t\t\tif (__andNeeded_) {\n";
-		loadNonPk << "\t\t\t\t__load_ << \" AND \";\n";
-		loadNonPk << "\t\t\t\t__andNeeded_ = false;\n";
-		loadNonPk << "\t\t\t}\n";
-
-		loadNonPk << "\t\t\t__load_ << \"" << f.name << " = ";
-		loadNonPk << "$\" << __count_";
-		loadNonPk << ";\n\t\t\t++__count_;\n\t\t\t__andNeeded_ = true;\n";
-		loadNonPk << "\t\t}\n";
-
-		loadNonPkAdd << "\t\tif (" << f.name << " != nullptr) {\n";
-		if (f.type == persistence::Model::FieldType::TIMESTAMP) {
-			loadNonPkAdd << "\t\t\tif (" << f.name << "->isNow()) {\n";
-			loadNonPkAdd << "\t\t\t\t__p_.add(\"NOW()\");\n";
-			loadNonPkAdd << "\t\t\t} else {\n";
-			loadNonPkAdd << "\t\t\t\t__p_.add(" << f.name << "->time()" << ");\n";
-			loadNonPkAdd << "\t\t\t}\n";
-		} else if (f.type == persistence::Model::FieldType::PASSWORD) {
-			loadNonPkAdd << "\t\t\t__p_.addPassword(" << "*" << f.name << ");\n";
-		} else {
-			loadNonPkAdd << "\t\t\t__p_.add(" << "*" << f.name << ");\n";
+		src << "\t\t};\n";
+		src << "\t\tstatic const char* __statements_[] = {\n";
+		for (uint32_t mask = 0u; mask < combinations; ++mask) {
+			src << "\t\t\t\"SELECT * FROM " << table.name;
+			int count = 0;
+			for (size_t i = 0; i < nonPrimaryKeys.size(); ++i) {
+				if ((mask & (1u << i)) == 0u) {
+					continue;
+				}
+				src << (count == 0 ? " WHERE " : " AND ");
+				src << nonPrimaryKeys[i]->name << " = ";
+				sep(src, ++count);
+			}
+			src << "\",\n";
 		}
-		loadNonPkAdd << "\t\t}\n";
-	}
-	if (nonPrimaryKeyMembers > 0) {
-		src << ") : " << classname << "() {\n";
-		src << loadNonPk.str();
-		src << "\t\tSuper::PreparedStatement __p_ = prepare(\"\", __load_.str());\n";
-		src << loadNonPkAdd.str();
-		src << "\t\tcore_assert_always(__p_.exec().result);\n";
+		src << "\t\t};\n";
+		src << "\t\tuint32_t __mask_ = 0u;\n";
+		for (size_t i = 0; i < nonPrimaryKeys.size(); ++i) {
+			src << "\t\tif (" << nonPrimaryKeys[i]->name << " != nullptr) {\n";
+			src << "\t\t\t__mask_ |= " << (1u << i) << "u;\n";
+			src << "\t\t}\n";
+		}
+		src << "\t\tSuper::PreparedStatement __p_ = prepare(__names_[__mask_], __statements_[__mask_]);\n";
+		for (const persistence::Model::Field* f : nonPrimaryKeys) {
+			src << "\t\tif (" << f->name << " != nullptr) {\n";
+			if (f->type == persistence::Model::FieldType::PASSWORD) {
+				src << "\t\t\t__p_.addPassword(*" << f->name << ");\n";
+			} else {
+				src << "\t\t\t__p_.add(*" << f->name << ");\n";
+			}
+			src << "\t\t}\n";
+		}
+		src << "\t\treturn __p_;\n";
 		src << "\t}\n\n";
+		src << "public:\n";
 	}
 
 	// ctor for primary keys
@@ -0,0 +1,273 @@
+/**
+ * @file
+ */
+
+#include "LoadTest.h"
+#include "LoadTestHandlers.h"
+#include "core/Var.h"
+#include "core/TimeProvider.h"
+#include "io/Filesystem.h"
+#include "core/String.h"
+#include "config.h"
+#include <algorithm>
+#include <thread>
+
+// the tick rate of the simulated clients
+static const double FramesPerSecond = 20.0;
+static const long ReportIntervalMillis = 1000L;
+// the time to wait for the simulated clients to disconnect gracefully
+static const long DisconnectTimeoutMillis = 3000L;
+
+static double percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) {
+		return 0.0;
+	}
+	const size_t index = std::min(sorted.size() - 1u, (size_t)(p * sorted.size()));
+	return sorted[index];
+}
+
+LoadTest::LoadTest(const network::NetworkPtr& network, const network::MessageSenderPtr& messageSender,
+		const io::FilesystemPtr& filesystem, const core::EventBusPtr& eventBus, const core::TimeProviderPtr& timeProvider) :
+		core::App(filesystem, eventBus, timeProvider, 17817), _network(network), _messageSender(messageSender) {
+	init(ORGANISATION, "loadtest");
+	setFramesPerSecondsCap(FramesPerSecond);
+}
+
+core::AppState LoadTest::onConstruct() {
+	const core::AppState state = core::App::onConstruct();
+
+	core::Var::get(cfg::ClientPort, SERVER_PORT);
+	core::Var::get(cfg::ClientHost, "127.0.0.1");
+	core::Var::get(cfg::ClientIncomingBandwidth, "0");
+	core::Var::get(cfg::ClientOutgoingBandwidth, "0");
+	_maxClients = core::Var::get(cfg::LoadTestClients, "100");
+	_rampUp = core::Var::get(cfg::LoadTestRampUp, "50");
+	_duration = core::Var::get(cfg::LoadTestDuration, "60");
+
+	return state;
+}
+
+core::AppState LoadTest::onInit() {
+	const core::AppState state = core::App::onInit();
+	if (state != core::AppState::Running) {
+		return state;
+	}
+
+	eventBus()->subscribe<network::NewConnectionEvent>(*this);
+	eventBus()->subscribe<network::DisconnectEvent>(*this);
+
+	const network::ProtocolHandlerRegistryPtr& r = _network->registry();
+	r->registerHandler(network::EnumNameServerMsgType(network::ServerMsgType::Seed), std::make_shared<SeedHandler>());
+	r->registerHandler(network::EnumNameServerMsgType(network::ServerMsgType::AttribUpdate), std::make_shared<AttribUpdateHandler>());
+	r->registerHandler(network::EnumNameServerMsgType(network::ServerMsgType::AuthFailed), std::make_shared<AuthFailedHandler>());
+	r->registerHandler(network::EnumNameServerMsgType(network::ServerMsgType::UserSpawn), std::make_shared<UserSpawnHandler>());
+	r->registerHandler(network::EnumNameServerMsgType(network::ServerMsgType::EntitySpawn), std::make_shared<EntitySpawnHandler>());
+	r->registerHandler(network::EnumNameServerMsgType(network::ServerMsgType::EntityRemove), std::make_shared<EntityRemoveHandler>());
+	r->registerHandler(network::EnumNameServerMsgType(network::ServerMsgType::EntityUpdate), std::make_shared<EntityUpdateHandler>());
+
+	if (!_network->init()) {
+		Log::error("Failed to init the network");
+		return core::AppState::Cleanup;
+	}
+
+	const int maxClients = _maxClients->intVal();
+	if (maxClients <= 0) {
+		Log::error("%s must be bigger than 0", cfg::LoadTestClients);
+		return core::AppState::Cleanup;
+	}
+	const uint32_t incomingBandwidth = (uint32_t)std::max(0, core::Var::getSafe(cfg::ClientIncomingBandwidth)->intVal());
+	const uint32_t outgoingBandwidth = (uint32_t)std::max(0, core::Var::getSafe(cfg::ClientOutgoingBandwidth)->intVal());
+	if (!_network->initClient(maxClients, 1, incomingBandwidth, outgoingBandwidth)) {
+		Log::error("Failed to create the client host for %i connections", maxClients);
+		return core::AppState::Cleanup;
+	}
+	_clients.reserve(maxClients);
+
+	Log::info("Starting load test with %i clients against %s:%i", maxClients,
+			core::Var::getSafe(cfg::ClientHost)->strVal().c_str(), core::Var::getSafe(cfg::ClientPort)->intVal());
+	_startTime = _now;
+	_lastReport = _now;
+	return state;
+}
+
+void LoadTest::connectClients(long dt) {
+	const int maxClients = _maxClients->intVal();
+	if ((int)_clients.size() >= maxClients) {
+		return;
+	}
+	_rampUpRemainder += _rampUp->floatVal() * (double)dt / 1000.0;
+	const int port = core::Var::getSafe(cfg::ClientPort)->intVal();
+	const std::string& host = core::Var::getSafe(cfg::ClientHost)->strVal();
+	while (_rampUpRemainder >= 1.0 && (int)_clients.size() < maxClients) {
+		_rampUpRemainder -= 1.0;
+		ENetPeer* peer = _network->connectPeer(port, host);
+		if (peer == nullptr) {
+			Log::error("Failed to connect simulated client %i", (int)_clients.size());
+			_maxClients->setVal((int)_clients.size());
+			return;
+		}
+		const int index = (int)_clients.size();
+		_clients.emplace_back(new SimulatedClient(index, peer, _messageSender, _intervalStats));
+	}
+}
+
+void LoadTest::onEvent(const network::NewConnectionEvent& event) {
+	SimulatedClient* client = static_cast<SimulatedClient*>(event.peer()->data);
+	if (client == nullptr) {
+		return;
+	}
+	const std::string& email = core::string::format("loadtest-%i@loadtest.local", client->index());
+	client->login(email, "loadtest");
+}
+
+void LoadTest::onEvent(const network::DisconnectEvent& event) {
+	if (event.peer() == nullptr) {
+		return;
+	}
+	SimulatedClient* client = static_cast<SimulatedClient*>(event.peer()->data);
+	if (client == nullptr) {
+		return;
+	}
+	Log::debug("Simulated client %i was disconnected", client->index());
+	client->onDisconnect();
+}
+
+core::AppState LoadTest::onRunning() {
+	core::App::onRunning();
+
+	const double start = core::TimeProvider::currentNanos();
+	_network->update();
+	connectClients(_deltaFrame);
+	for (const auto& client : _clients) {
+		client->update(_now);
+	}
+	_network->flush();
+	// this is the frame of the generator itself - the server tick isn't measured here
+	const double frameTime = (core::TimeProvider::currentNanos() - start) * 1000.0;
+	_frameTimeSum += frameTime;
+	_frameTimeMax = std::max(_frameTimeMax, frameTime);
+	++_frames;
+
+	if (_now - _lastReport >= ReportIntervalMillis) {
+		report(_now);
+	}
+
+	const long duration = _duration->intVal() * 1000L;
+	if (duration > 0 && _now - _startTime >= duration) {
+		return core::AppState::Cleanup;
+	}
+	return core::AppState::Running;
+}
+
+void LoadTest::report(long now) {
+	const double seconds = (now - _lastReport) / 1000.0;
+	_lastReport = now;
+
+	int connecting = 0;
+	int spawned = 0;
+	int disconnected = 0;
+	for (const auto& client : _clients) {
+		switch (client->state()) {
+		case SimulatedClient::State::Connecting:
+		case SimulatedClient::State::LoggingIn:
+			++connecting;
+			break;
+		case SimulatedClient::State::Spawned:
+			++spawned;
+			break;
+		case SimulatedClient::State::Disconnected:
+			++disconnected;
+			break;
+		}
+	}
+
+	const network::NetworkStats& stats = _network->clientStats();
+	const double inPackets = (stats.receivedPackets - _lastNetworkStats.receivedPackets) / seconds;
+	const double outPackets = (stats.sentPackets - _lastNetworkStats.sentPackets) / seconds;
+	const double inKiB = (stats.receivedBytes - _lastNetworkStats.receivedBytes) / seconds / 1024.0;
+	const double outKiB = (stats.sentBytes - _lastNetworkStats.sentBytes) / seconds / 1024.0;
+	_lastNetworkStats = stats;
+
+	std::vector<double>& latencies = _intervalStats.latencies;
+	std::sort(latencies.begin(), latencies.end());
+	Log::info("clients: %i spawned, %i connecting, %i disconnected | generator frame: avg %.2fms, max %.2fms | "
+			"in: %.0f pkt/s, %.1f KiB/s, %.0f msg/s | out: %.0f pkt/s, %.1f KiB/s | "
+			"latency: p50 %.1fms, p90 %.1fms, p99 %.1fms, max %.1fms (%i samples)",
+			spawned, connecting, disconnected, _frames > 0 ? _frameTimeSum / _frames : 0.0, _frameTimeMax,
+			inPackets, inKiB, _intervalStats.messages / seconds, outPackets, outKiB,
+			percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99),
+			latencies.empty() ? 0.0 : latencies.back(), (int)latencies.size());
+
+	_totalStats.latencies.insert(_totalStats.latencies.end(), latencies.begin(), latencies.end());
+	_totalStats.messages += _intervalStats.messages;
+	_totalStats.spawned += _intervalStats.spawned;
+	_totalStats.authFailed += _intervalStats.authFailed;
+	_totalStats.disconnects += _intervalStats.disconnects;
+	latencies.clear();
+	_intervalStats.messages = 0u;
+	_intervalStats.spawned = 0;
+	_intervalStats.authFailed = 0;
+	_intervalStats.disconnects = 0;
+	_frameTimeSum = 0.0;
+	_frameTimeMax = 0.0;
+	_frames = 0;
+}
+
+void LoadTest::summary() const {
+	const double seconds = std::max(1L, _now - _startTime) / 1000.0;
+	const network::NetworkStats& stats = _network->clientStats();
+	std::vector<double> latencies = _totalStats.latencies;
+	std::sort(latencies.begin(), latencies.end());
+	Log::info("Load test summary after %.1f seconds with %i clients:", seconds, (int)_clients.size());
+	Log::info("  logins: %i spawned, %i auth failures, %i disconnects", _totalStats.spawned, _totalStats.authFailed, _totalStats.disconnects);
+	Log::info("  received: %li packets (%.0f/s), %.1f KiB (%.1f KiB/s), %li messages",
+			(long)stats.receivedPackets, stats.receivedPackets / seconds, stats.receivedBytes / 1024.0,
+			stats.receivedBytes / seconds / 1024.0, (long)_totalStats.messages);
+	Log::info("  sent: %li packets (%.0f/s), %.1f KiB (%.1f KiB/s)",
+			(long)stats.sentPackets, stats.sentPackets / seconds, stats.sentBytes / 1024.0, stats.sentBytes / seconds / 1024.0);
+	Log::info("  move latency: p50 %.1fms, p90 %.1fms, p99 %.1fms, max %.1fms (%i samples)",
+			percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99),
+			latencies.empty() ? 0.0 : latencies.back(), (int)latencies.size());
+}
+
+core::AppState LoadTest::onCleanup() {
+	if (!_clients.empty()) {
+		report(_now);
+		summary();
+	}
+
+	// disconnect all clients at once - the network shutdown would wait for each of them in turn
+	for (const auto& client : _clients) {
+		if (client->state() != SimulatedClient::State::Disconnected) {
+			_network->disconnectPeerAsync(client->peer());
+		}
+	}
+	const long timeout = currentMillis() + DisconnectTimeoutMillis;
+	while (currentMillis() < timeout) {
+		_network->update();
+		const bool allDisconnected = std::all_of(_clients.begin(), _clients.end(), [] (const std::unique_ptr<SimulatedClient>& client) {
+			return client->state() == SimulatedClient::State::Disconnected;
+		});
+		if (allDisconnected) {
+			break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	eventBus()->unsubscribe<network::NewConnectionEvent>(*this);
+	eventBus()->unsubscribe<network::DisconnectEvent>(*this);
+	_network->shutdown();
+	_clients.clear();
+	return core::App::onCleanup();
+}
+
+int main(int argc, char *argv[]) {
+	const core::EventBusPtr& eventBus = std::make_shared<core::EventBus>();
+	const core::TimeProviderPtr& timeProvider = std::make_shared<core::TimeProvider>();
+	const io::FilesystemPtr& filesystem = std::make_shared<io::Filesystem>();
+	const network::ProtocolHandlerRegistryPtr& protocolHandlerRegistry = std::make_shared<network::ProtocolHandlerRegistry>();
+	const network::NetworkPtr& network = std::make_shared<network::Network>(protocolHandlerRegistry, eventBus);
+	const network::MessageSenderPtr& messageSender = std::make_shared<network::MessageSender>(network);
+	LoadTest app(network, messageSender, filesystem, eventBus, timeProvider);
+	return app.startMainLoop(argc, argv);
+}
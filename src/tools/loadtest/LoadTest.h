@@ -0,0 +1,66 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "core/App.h"
+#include "core/EventBus.h"
+#include "network/Network.h"
+#include "network/NetworkEvents.h"
+#include "network/MessageSender.h"
+#include "SimulatedClient.h"
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Headless load generator for the server.
+ *
+ * Connects a configurable amount of simulated clients (see @c SimulatedClient) over one client
+ * host to the server and reports the frame time of the load generator, the packet rates, the
+ * bandwidth and the move latency percentiles once per second and as a summary at the end.
+ *
+ * @note The tick time of the server isn't measured - the server doesn't publish it. A server that
+ * doesn't keep up shows up as growing move latencies. The generator frame time only tells whether
+ * the generator itself is the bottleneck.
+ *
+ * @note The simulated users log in as loadtest-<n>@loadtest.local - the server must run against
+ * a test database with @c sv_autoregister enabled.
+ */
+class LoadTest: public core::App, public core::IEventBusHandler<network::NewConnectionEvent>,
+		public core::IEventBusHandler<network::DisconnectEvent> {
+private:
+	network::NetworkPtr _network;
+	network::MessageSenderPtr _messageSender;
+	std::vector<std::unique_ptr<SimulatedClient>> _clients;
+
+	core::VarPtr _maxClients;
+	core::VarPtr _rampUp;
+	core::VarPtr _duration;
+
+	LoadTestStats _intervalStats;
+	LoadTestStats _totalStats;
+	network::NetworkStats _lastNetworkStats;
+	long _startTime = 0L;
+	long _lastReport = 0L;
+	double _rampUpRemainder = 0.0;
+	// the frame time of the generator - not of the server
+	double _frameTimeSum = 0.0;
+	double _frameTimeMax = 0.0;
+	int _frames = 0;
+
+	void connectClients(long dt);
+	void report(long now);
+	void summary() const;
+public:
+	LoadTest(const network::NetworkPtr& network, const network::MessageSenderPtr& messageSender,
+			const io::FilesystemPtr& filesystem, const core::EventBusPtr& eventBus, const core::TimeProviderPtr& timeProvider);
+
+	core::AppState onConstruct() override;
+	core::AppState onInit() override;
+	core::AppState onRunning() override;
+	core::AppState onCleanup() override;
+
+	void onEvent(const network::NewConnectionEvent& event) override;
+	void onEvent(const network::DisconnectEvent& event) override;
+};
@@ -0,0 +1,56 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "network/IMsgProtocolHandler.h"
+#include "ServerMessages_generated.h"
+#include "SimulatedClient.h"
+
+template<class MSGTYPE>
+class ILoadTestProtocolHandler: public network::IMsgProtocolHandler<MSGTYPE, SimulatedClient> {
+public:
+	ILoadTestProtocolHandler() :
+			network::IMsgProtocolHandler<MSGTYPE, SimulatedClient>(true) {
+	}
+
+	void execute(SimulatedClient* client, const MSGTYPE* message) override {
+		client->onMessage();
+		handle(client, message);
+	}
+
+	virtual void handle(SimulatedClient* client, const MSGTYPE* message) = 0;
+};
+
+#define LOADTESTPROTOHANDLERIMPL(msgType) \
+struct msgType##Handler: public ILoadTestProtocolHandler<network::msgType> { \
+	void handle(SimulatedClient* client, const network::msgType* message) override; \
+}; \
+inline void msgType##Handler::handle(SimulatedClient* client, const network::msgType* message)
+
+LOADTESTPROTOHANDLERIMPL(Seed) {
+}
+
+LOADTESTPROTOHANDLERIMPL(AttribUpdate) {
+}
+
+LOADTESTPROTOHANDLERIMPL(AuthFailed) {
+	client->onAuthFailed();
+}
+
+LOADTESTPROTOHANDLERIMPL(UserSpawn) {
+	client->onSpawn(message->id());
+}
+
+LOADTESTPROTOHANDLERIMPL(EntitySpawn) {
+	client->onEntitySpawn(message->id());
+}
+
+LOADTESTPROTOHANDLERIMPL(EntityRemove) {
+	client->onEntityRemove(message->id());
+}
+
+LOADTESTPROTOHANDLERIMPL(EntityUpdate) {
+	client->onEntityUpdate(message->id());
+}
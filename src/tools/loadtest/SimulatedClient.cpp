@@ -0,0 +1,120 @@
+/**
+ * @file
+ */
+
+#include "SimulatedClient.h"
+#include "core/TimeProvider.h"
+#include "core/Log.h"
+#include "core/GLM.h"
+
+SimulatedClient::SimulatedClient(int index, ENetPeer* peer, const network::MessageSenderPtr& messageSender, LoadTestStats& stats) :
+		_index(index), _peer(peer), _messageSender(messageSender), _stats(stats), _random(index) {
+	_peer->data = this;
+}
+
+void SimulatedClient::login(const std::string& email, const std::string& password) {
+	_state = State::LoggingIn;
+	flatbuffers::FlatBufferBuilder fbb;
+	_messageSender->sendClientMessage(_peer, fbb, network::ClientMsgType::UserConnect,
+			network::CreateUserConnect(fbb, fbb.CreateString(email), fbb.CreateString(password)).Union());
+}
+
+void SimulatedClient::onSpawn(int64_t entityId) {
+	Log::debug("Simulated client %i spawned as entity %li", _index, (long)entityId);
+	_entityId = entityId;
+	_state = State::Spawned;
+	++_stats.spawned;
+	flatbuffers::FlatBufferBuilder fbb;
+	_messageSender->sendClientMessage(_peer, fbb, network::ClientMsgType::UserConnected,
+			network::CreateUserConnected(fbb).Union());
+}
+
+void SimulatedClient::onAuthFailed() {
+	Log::warn("Simulated client %i failed to log in", _index);
+	++_stats.authFailed;
+}
+
+void SimulatedClient::onDisconnect() {
+	if (_state == State::Disconnected) {
+		return;
+	}
+	_state = State::Disconnected;
+	_peer->data = nullptr;
+	++_stats.disconnects;
+}
+
+void SimulatedClient::onEntitySpawn(int64_t entityId) {
+	_visible.insert(entityId);
+}
+
+void SimulatedClient::onEntityRemove(int64_t entityId) {
+	_visible.erase(entityId);
+}
+
+void SimulatedClient::onEntityUpdate(int64_t entityId) {
+	if (entityId != _entityId || _moveSent < 0.0) {
+		return;
+	}
+	_stats.latencies.push_back((core::TimeProvider::currentNanos() - _moveSent) * 1000.0);
+	_moveSent = -1.0;
+}
+
+void SimulatedClient::sendMove() {
+	_messageSender->sendClientMessage(_peer, _fbb, network::ClientMsgType::Move,
+			network::CreateMove(_fbb, _moveMask, 0.0f, _yaw).Union());
+}
+
+void SimulatedClient::sendAttack() {
+	if (_visible.empty()) {
+		return;
+	}
+	std::uniform_int_distribution<size_t> dist(0u, _visible.size() - 1u);
+	auto i = _visible.begin();
+	std::advance(i, dist(_random));
+	_messageSender->sendClientMessage(_peer, _fbb, network::ClientMsgType::Attack,
+			network::CreateAttack(_fbb, *i).Union());
+}
+
+void SimulatedClient::update(long now) {
+	if (_state != State::Spawned) {
+		return;
+	}
+	if (now < _nextAction) {
+		return;
+	}
+	std::uniform_int_distribution<long> delay(250L, 2000L);
+	_nextAction = now + delay(_random);
+
+	static const network::MoveDirection directions[] = {
+		network::MoveDirection::MOVEFORWARD,
+		network::MoveDirection::MOVEBACKWARD,
+		network::MoveDirection::MOVELEFT,
+		network::MoveDirection::MOVERIGHT,
+		network::MoveDirection::MOVEFORWARD | network::MoveDirection::MOVELEFT,
+		network::MoveDirection::MOVEFORWARD | network::MoveDirection::MOVERIGHT
+	};
+
+	std::uniform_int_distribution<int> action(0, 99);
+	const int roll = action(_random);
+	if (roll < 60) {
+		std::uniform_int_distribution<size_t> direction(0u, SDL_arraysize(directions) - 1u);
+		std::uniform_real_distribution<float> yaw(0.0f, glm::two_pi<float>());
+		// the latency is only measured when starting to move - the server sends an update
+		// of the own entity on every tick while moving, so any later update would do.
+		if (_moveMask == network::MoveDirection::NONE) {
+			_moveSent = core::TimeProvider::currentNanos();
+		}
+		_moveMask = directions[direction(_random)];
+		_yaw = yaw(_random);
+		sendMove();
+	} else if (roll < 85) {
+		if (_moveMask == network::MoveDirection::NONE) {
+			return;
+		}
+		_moveMask = network::MoveDirection::NONE;
+		_moveSent = -1.0;
+		sendMove();
+	} else {
+		sendAttack();
+	}
+}
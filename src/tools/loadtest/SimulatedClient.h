@@ -0,0 +1,93 @@
+/**
+ * @file
+ */
+
+#pragma once
+
+#include "network/MessageSender.h"
+#include "ClientMessages_generated.h"
+#include <unordered_set>
+#include <vector>
+#include <random>
+#include <string>
+
+/**
+ * @brief The measurements that the simulated clients are collecting during a report interval
+ */
+struct LoadTestStats {
+	// the time in millis between sending a move command and receiving the entity update of the own entity
+	std::vector<double> latencies;
+	uint64_t messages = 0u;
+	int spawned = 0;
+	int authFailed = 0;
+	int disconnects = 0;
+};
+
+/**
+ * @brief A lightweight headless client that logs into the server and performs a scripted
+ * behaviour - it moves around randomly and attacks the entities it sees.
+ */
+class SimulatedClient {
+public:
+	enum class State {
+		Connecting, LoggingIn, Spawned, Disconnected
+	};
+private:
+	const int _index;
+	ENetPeer* _peer;
+	network::MessageSenderPtr _messageSender;
+	LoadTestStats& _stats;
+	State _state = State::Connecting;
+	int64_t _entityId = -1;
+	std::unordered_set<int64_t> _visible;
+	network::MoveDirection _moveMask = network::MoveDirection::NONE;
+	float _yaw = 0.0f;
+	long _nextAction = 0L;
+	// the time in seconds when the move was sent that we are waiting for an entity update for - or a negative value
+	double _moveSent = -1.0;
+	std::mt19937 _random;
+	flatbuffers::FlatBufferBuilder _fbb;
+
+	void sendMove();
+	void sendAttack();
+public:
+	SimulatedClient(int index, ENetPeer* peer, const network::MessageSenderPtr& messageSender, LoadTestStats& stats);
+
+	/**
+	 * @brief Sends the login credentials - the server registers the users automatically if @c sv_autoregister is active
+	 */
+	void login(const std::string& email, const std::string& password);
+	/**
+	 * @brief Executes the scripted behaviour
+	 * @param[in] now The current time in millis
+	 */
+	void update(long now);
+
+	void onSpawn(int64_t entityId);
+	void onAuthFailed();
+	void onDisconnect();
+	void onEntitySpawn(int64_t entityId);
+	void onEntityRemove(int64_t entityId);
+	void onEntityUpdate(int64_t entityId);
+	void onMessage();
+
+	State state() const;
+	int index() const;
+	ENetPeer* peer() const;
+};
+
+inline SimulatedClient::State SimulatedClient::state() const {
+	return _state;
+}
+
+inline int SimulatedClient::index() const {
+	return _index;
+}
+
+inline ENetPeer* SimulatedClient::peer() const {
+	return _peer;
+}
+
+inline void SimulatedClient::onMessage() {
+	++_stats.messages;
+}
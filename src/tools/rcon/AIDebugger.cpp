@@ -26,6 +26,20 @@ public:
 	}
 };
 
+class StateDeltaHandler: public ProtocolHandler<AIStateDeltaMessage> {
+private:
+	AIDebugger& _aiDebugger;
+public:
+	StateDeltaHandler (AIDebugger& aiDebugger) :
+			_aiDebugger(aiDebugger) {
+	}
+
+	void execute(const ClientId&, const AIStateDeltaMessage* msg) override {
+		_aiDebugger.applyEntityChanges(*msg);
+		emit _aiDebugger.onEntitiesUpdated();
+	}
+};
+
 class CharacterHandler: public ProtocolHandler<AICharacterDetailsMessage> {
 private:
 	AIDebugger& _aiDebugger;
@@ -84,7 +98,7 @@ public:
 };
 
 AIDebugger::AIDebugger(AINodeStaticResolver& resolver) :
-		QObject(), _stateHandler(new StateHandler(*this)), _characterHandler(new CharacterHandler(*this)), _characterStaticHandler(
+		QObject(), _stateHandler(new StateHandler(*this)), _stateDeltaHandler(new StateDeltaHandler(*this)), _characterHandler(new CharacterHandler(*this)), _characterStaticHandler(
 				new CharacterStaticHandler(*this)), _pauseHandler(new PauseHandler(*this)), _namesHandler(new NamesHandler(*this)), _nopHandler(
 				new NopHandler()), _selectedId(AI_NOTHING_SELECTED), _socket(this), _pause(false), _resolver(resolver) {
 	connect(&_socket, SIGNAL(readyRead()), SLOT(readTcpData()));
@@ -92,6 +106,7 @@ AIDebugger::AIDebugger(AINodeStaticResolver& resolver) :
 
 	ai::ProtocolHandlerRegistry& r = ai::ProtocolHandlerRegistry::get();
 	r.registerHandler(ai::PROTO_STATE, _stateHandler);
+	r.registerHandler(ai::PROTO_STATE_DELTA, _stateDeltaHandler);
 	r.registerHandler(ai::PROTO_CHARACTER_DETAILS, _characterHandler);
 	r.registerHandler(ai::PROTO_CHARACTER_STATIC, _characterStaticHandler);
 	r.registerHandler(ai::PROTO_PAUSE, _pauseHandler);
@@ -102,6 +117,7 @@ AIDebugger::AIDebugger(AINodeStaticResolver& resolver) :
 AIDebugger::~AIDebugger() {
 	disconnectFromAIServer();
 	delete _stateHandler;
+	delete _stateDeltaHandler;
 	delete _characterHandler;
 	delete _characterStaticHandler;
 	delete _pauseHandler;
@@ -177,6 +193,15 @@ bool AIDebugger::writeMessage(const IProtocolMessage& msg) {
 	return true;
 }
 
+void AIDebugger::setViewport(const QRectF& rect) {
+	if (rect == _viewport) {
+		return;
+	}
+	if (writeMessage(AIViewportMessage(glm::vec2(rect.left(), rect.top()), glm::vec2(rect.right(), rect.bottom())))) {
+		_viewport = rect;
+	}
+}
+
 void AIDebugger::unselect() {
 	writeMessage(AISelectMessage(AI_NOTHING_SELECTED));
 	_selectedId = AI_NOTHING_SELECTED;
@@ -266,6 +291,7 @@ void AIDebugger::onDisconnect() {
 		_entities.clear();
 		emit onEntitiesUpdated();
 	}
+	_viewport = QRectF();
 }
 
 void AIDebugger::readTcpData() {
@@ -313,6 +339,28 @@ void AIDebugger::setNames(const std::vector<std::string>& names) {
 	}
 }
 
+void AIDebugger::applyEntityChanges(const AIStateDeltaMessage& msg) {
+	const std::vector<AIStateWorld>& states = msg.getStates();
+	for (size_t i = 0; i < states.size(); ++i) {
+		const AIStateWorld& state = states[i];
+		if (msg.hasAttributes(i)) {
+			_entities.insert(state.getId(), state);
+			continue;
+		}
+		Iter existing = _entities.find(state.getId());
+		if (existing == _entities.end()) {
+			_entities.insert(state.getId(), state);
+			continue;
+		}
+		// keep the previously received attributes
+		AIStateWorld updated(state.getId(), state.getPosition(), state.getOrientation(), std::move(existing.value().getAttributes()));
+		existing.value() = std::move(updated);
+	}
+	for (CharacterId id : msg.getRemoved()) {
+		_entities.remove(id);
+	}
+}
+
 void AIDebugger::setEntities(const std::vector<AIStateWorld>& entities) {
 	_entities.clear();
 	for (const AIStateWorld& state : entities) {
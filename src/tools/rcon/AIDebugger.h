@@ -12,6 +12,7 @@
 #include <QStringList>
 #include <QMap>
 #include <QHash>
+#include <QRectF>
 
 namespace ai {
 namespace debug {
@@ -41,6 +42,7 @@ protected:
 
 	// the network protocol message handlers
 	ai::IProtocolHandler *_stateHandler;
+	ai::IProtocolHandler *_stateDeltaHandler;
 	ai::IProtocolHandler *_characterHandler;
 	ai::IProtocolHandler *_characterStaticHandler;
 	ai::IProtocolHandler *_pauseHandler;
@@ -63,6 +65,8 @@ protected:
 	bool _pause;
 	QStringList _names;
 	AINodeStaticResolver& _resolver;
+	// the area of the map that was last announced to the server
+	QRectF _viewport;
 
 	bool writeMessage(const IProtocolMessage& msg);
 
@@ -78,6 +82,15 @@ public:
 	 */
 	const Entities& getEntities() const;
 	void setEntities(const std::vector<AIStateWorld>& entities);
+	/**
+	 * @brief Merges the changed entities into the current entities
+	 */
+	void applyEntityChanges(const AIStateDeltaMessage& msg);
+	/**
+	 * @brief Tells the server which area of the map is visible - the entities outside of this area are updated less often.
+	 * The x axis of the rect is mapped to the x axis of the world, the y axis to the z axis of the world.
+	 */
+	void setViewport(const QRectF& rect);
 	void setCharacterDetails(const CharacterId& id, const AIStateAggro& aggro, const AIStateNode& node);
 	void addCharacterStaticData(const AICharacterStaticMessage& msg);
 	void setNames(const std::vector<std::string>& names);
@@ -122,6 +122,8 @@ void MapView::updateMapView() {
 		_scene.removeItem(i.value());
 		_items.remove(i.key());
 	}
+
+	_debugger.setViewport(mapToScene(viewport()->rect()).boundingRect());
 }
 
 bool MapView::center(CharacterId id) {
@@ -134,7 +134,7 @@ void WorldRendererTool::beforeUI() {
 	_camera.setFarPlane(_worldRenderer.getViewDistance());
 	_camera.update(_deltaFrame);
 
-	_worldRenderer.extractMeshes(_camera.position());
+	_worldRenderer.extractMeshes(_camera);
 	_worldRenderer.onRunning(_camera, _deltaFrame);
 	ScopedProfiler<video::ProfilerGPU> wt(_worldTimer);
 	if (_lineModeRendering) {